@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
+#include <stdexcept>
 #include <string>
 
 #include "gflags/gflags.h"
@@ -22,7 +24,7 @@
 #include "dpca-psi/common/utils.h"
 #include "dpca-psi/crypto/prng.h"
 #include "dpca-psi/dp_cardinality_psi.h"
-#include "dpca-psi/network/two_channel_net_io.h"
+#include "dpca-psi/network/net_io_factory.h"
 
 void dpca_psi_example(const std::string& config_path, const std::string& log_path, bool use_random_data,
         std::size_t intersection_size, std::size_t intersection_ratio, std::size_t feature_size, bool use_default_tau,
@@ -48,11 +50,20 @@ void dpca_psi_example(const std::string& config_path, const std::string& log_pat
     }
     google::InitGoogleLogging(log_file_name.c_str());
 
-    // 2. Connect net io.
-    std::string address = params["common"]["address"];
-    std::uint16_t remote_port = params["common"]["remote_port"];
-    std::uint16_t local_port = params["common"]["local_port"];
-    auto net = std::make_shared<privacy_go::dpca_psi::TwoChannelNetIO>(address, remote_port, local_port);
+    // seeds the randomness of this party before anything is drawn, if configured, e.g. to replay a transcript.
+    std::string random_seed = params["common"].value("random_seed", "");
+    if (!random_seed.empty()) {
+        std::string seed_bytes = privacy_go::dpca_psi::hex_2_string(random_seed);
+        if (seed_bytes.size() != sizeof(privacy_go::dpca_psi::block)) {
+            throw std::invalid_argument("random_seed must have 32 hex digits");
+        }
+        privacy_go::dpca_psi::block seed;
+        std::memcpy(&seed, seed_bytes.data(), sizeof(seed));
+        privacy_go::dpca_psi::set_random_seed(seed);
+    }
+
+    // 2. Connect net io, see create_net_io() for the transport keys of the config.
+    std::shared_ptr<privacy_go::dpca_psi::IOBase> net = privacy_go::dpca_psi::create_net_io(params);
 
     // 3. Read keys and features from file or use randomly generated data.
     std::vector<std::vector<std::string>> keys;
@@ -144,8 +155,12 @@ void dpca_psi_example(const std::string& config_path, const std::string& log_pat
     // 4. run dpca-psi.
     privacy_go::dpca_psi::DPCardinalityPSI psi;
     psi.init(params, net);
-    psi.data_sampling(keys, features);
-    psi.process(shares);
+    // continues an interrupted run from its checkpoints, if any, so that the data is not sampled again.
+    std::string checkpoint_dir = params["common"].value("checkpoint_dir", "");
+    if (checkpoint_dir.empty() || !psi.resume(shares)) {
+        psi.data_sampling(keys, features);
+        psi.process(shares);
+    }
 
     if (!use_random_data) {
         privacy_go::dpca_psi::CsvFileIO csv;
@@ -196,12 +211,12 @@ void dpca_psi_example(const std::string& config_path, const std::string& log_pat
     LOG(INFO) << (is_sender ? "Sender" : "Receiver");
     LOG(INFO) << "Apply dp: " << params["dp_params"]["input_dp"];
     LOG(INFO) << (use_random_data ? "Use random data." : "Use input file.");
-    if (feature_size != 0) {
-        LOG(INFO) << "Intersection size is " << shares[0].size() << std::endl;
-    }
+    LOG(INFO) << "Intersection size is " << psi.get_intersection_size() << std::endl;
     LOG(INFO) << "Total Communication is " << total_comm << "(" << self_comm << " + " << remote_comm << ")"
               << "MB." << std::endl;
     LOG(INFO) << "Total time is " << duration << " s.";
+    // tells the phases bound by the network, or by the peer, from those bound by local computation.
+    LOG(INFO) << "Traffic by phase:\n" << net->get_traffic_report();
     LOG(INFO) << "Expected / Actual sum is " << expected_sum << " / " << actual_sum;
 
     google::ShutdownGoogleLogging();
@@ -0,0 +1,135 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/common/checkpoint_store.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+namespace {
+
+// Identifies the file format, and its version in the last byte.
+const std::uint64_t kCheckpointMagic = 0x54504b4341435001;
+
+// Writes nbyte bytes of data to fd. Returns false on errors.
+bool write_all(int fd, const void* data, std::size_t nbyte) {
+    const char* bytes = reinterpret_cast<const char*>(data);
+    while (nbyte > 0) {
+        ssize_t res = ::write(fd, bytes, nbyte);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        bytes += res;
+        nbyte -= static_cast<std::size_t>(res);
+    }
+    return true;
+}
+
+}  // namespace
+
+CheckpointStore::CheckpointStore(const std::string& directory, const std::string& name)
+        : directory_(directory), name_(name) {
+}
+
+// Writes to a temporary file first, so that a crash never leaves a partially written checkpoint behind. The file is
+// only readable by its owner since it holds secrets of the run, and is synced before the rename, so that the renamed
+// file never lacks the data after a power loss.
+void CheckpointStore::save(std::size_t phase, const block& run_id, const ByteVector& state) const {
+    if (!enabled()) {
+        return;
+    }
+    std::string path = checkpoint_path(phase);
+    std::string temp_path = path + ".tmp";
+    // a temporary file left by a crash may have other permissions, which O_CREAT would keep.
+    std::remove(temp_path.c_str());
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open checkpoint file " + temp_path);
+    }
+    std::uint64_t header[2] = {kCheckpointMagic, state.size()};
+    bool written = write_all(fd, header, sizeof(header)) && write_all(fd, &run_id, sizeof(run_id)) &&
+                   write_all(fd, state.data(), state.size()) && fsync(fd) == 0;
+    if (close(fd) != 0 || !written) {
+        throw std::runtime_error("failed to write checkpoint file " + temp_path);
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("failed to replace checkpoint file " + path);
+    }
+}
+
+std::size_t CheckpointStore::latest_phase(std::size_t max_phase, block& run_id) const {
+    if (!enabled() || !read(1, run_id, nullptr)) {
+        return 0;
+    }
+    std::size_t phase = 1;
+    block phase_run_id;
+    while (phase < max_phase && read(phase + 1, phase_run_id, nullptr) &&
+            std::memcmp(&phase_run_id, &run_id, sizeof(block)) == 0) {
+        ++phase;
+    }
+    return phase;
+}
+
+bool CheckpointStore::load(std::size_t phase, const block& run_id, ByteVector& state) const {
+    block phase_run_id;
+    return enabled() && read(phase, phase_run_id, &state) && std::memcmp(&phase_run_id, &run_id, sizeof(block)) == 0;
+}
+
+void CheckpointStore::clear(std::size_t max_phase) const {
+    if (!enabled()) {
+        return;
+    }
+    for (std::size_t phase = 1; phase <= max_phase; ++phase) {
+        std::remove(checkpoint_path(phase).c_str());
+    }
+}
+
+std::string CheckpointStore::checkpoint_path(std::size_t phase) const {
+    return directory_ + "/" + name_ + "_" + std::to_string(phase) + ".ckpt";
+}
+
+bool CheckpointStore::read(std::size_t phase, block& run_id, ByteVector* state) const {
+    std::ifstream in(checkpoint_path(phase), std::ios::binary | std::ios::ate);
+    if (!in) {
+        return false;
+    }
+    std::uint64_t file_size = static_cast<std::uint64_t>(in.tellg());
+    in.seekg(0);
+    std::uint64_t header[2] = {0, 0};
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    in.read(reinterpret_cast<char*>(&run_id), sizeof(run_id));
+    // guards against a corrupted file or one of another format.
+    if (!in || header[0] != kCheckpointMagic || header[1] != file_size - sizeof(header) - sizeof(run_id)) {
+        return false;
+    }
+    if (state != nullptr) {
+        state->resize(header[1]);
+        in.read(reinterpret_cast<char*>(state->data()), static_cast<std::streamsize>(header[1]));
+    }
+    return static_cast<bool>(in);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
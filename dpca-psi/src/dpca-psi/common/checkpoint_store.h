@@ -0,0 +1,156 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "dpca-psi/common/defines.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Local-file store of protocol checkpoints, so that an interrupted run resumes from the last phase that both parties
+// have completed instead of recomputing it.
+// Phases are numbered from 1 in protocol order. The state of every phase is saved in its own file together with the
+// id of the run, and is written atomically. A checkpoint holds secrets of the run, the directory must be protected as
+// the key store is.
+// An empty directory disables the store.
+class CheckpointStore {
+public:
+    CheckpointStore() = default;
+
+    // directory must exist. name tells apart the parties that share a directory.
+    CheckpointStore(const std::string& directory, const std::string& name);
+
+    // Saves the state of phase for the run of run_id.
+    void save(std::size_t phase, const block& run_id, const ByteVector& state) const;
+
+    // Returns the latest phase p in [1, max_phase] such that phases 1 to p are all saved for the same run, whose id is
+    // stored in run_id. Returns 0 if phase 1 is not saved.
+    std::size_t latest_phase(std::size_t max_phase, block& run_id) const;
+
+    // Loads the state of phase into state. Returns false if the phase is not saved for the run of run_id.
+    bool load(std::size_t phase, const block& run_id, ByteVector& state) const;
+
+    // Removes the checkpoints of phases in [1, max_phase].
+    void clear(std::size_t max_phase) const;
+
+    bool enabled() const {
+        return !directory_.empty();
+    }
+
+private:
+    std::string checkpoint_path(std::size_t phase) const;
+
+    // Reads the header of the checkpoint of phase, and the state if state is not nullptr.
+    bool read(std::size_t phase, block& run_id, ByteVector* state) const;
+
+    std::string directory_{};
+    std::string name_{};
+};
+
+// Serializes the state of a checkpoint.
+class CheckpointWriter {
+public:
+    // Can only be used for primitive type.
+    template <typename T>
+    void write_value(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        const Byte* bytes = reinterpret_cast<const Byte*>(&value);
+        data_.insert(data_.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    void write_vector(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        write_value<std::uint64_t>(values.size());
+        const Byte* bytes = reinterpret_cast<const Byte*>(values.data());
+        data_.insert(data_.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    void write_bytes_vector(const std::vector<ByteVector>& values) {
+        write_value<std::uint64_t>(values.size());
+        for (const auto& value : values) {
+            write_vector(value);
+        }
+    }
+
+    const ByteVector& get_data() const {
+        return data_;
+    }
+
+private:
+    ByteVector data_{};
+};
+
+// Deserializes what CheckpointWriter wrote, in the same order.
+// Throws std::runtime_error if the state is truncated.
+class CheckpointReader {
+public:
+    explicit CheckpointReader(const ByteVector& data) : data_(data) {
+    }
+
+    template <typename T>
+    T read_value() {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void read_vector(std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        std::uint64_t size = read_value<std::uint64_t>();
+        if (size > (data_.size() - offset_) / sizeof(T)) {
+            throw std::runtime_error("checkpoint is truncated");
+        }
+        values.resize(size);
+        std::memcpy(values.data(), take(size * sizeof(T)), size * sizeof(T));
+    }
+
+    void read_bytes_vector(std::vector<ByteVector>& values) {
+        std::uint64_t size = read_value<std::uint64_t>();
+        if (size > (data_.size() - offset_) / sizeof(std::uint64_t)) {
+            throw std::runtime_error("checkpoint is truncated");
+        }
+        values.resize(size);
+        for (auto& value : values) {
+            read_vector(value);
+        }
+    }
+
+private:
+    const Byte* take(std::size_t nbyte) {
+        if (nbyte > data_.size() - offset_) {
+            throw std::runtime_error("checkpoint is truncated");
+        }
+        const Byte* bytes = data_.data() + offset_;
+        offset_ += nbyte;
+        return bytes;
+    }
+
+    const ByteVector& data_;
+    std::size_t offset_ = 0;
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
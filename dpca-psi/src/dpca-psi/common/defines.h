@@ -28,10 +28,13 @@ using block = __m128i;
 const std::size_t kHashDigestLen = SHA256_DIGEST_LENGTH;
 const std::size_t kHashDigestBitsLen = SHA256_DIGEST_LENGTH * 8;
 const std::size_t kEccPointLen = 33;
+const std::size_t kEccUncompressedPointLen = 65;
 const std::size_t kEccKeyBitsLen = 256;
 const std::size_t kECCCompareBytesLen = 12;
 const std::size_t kCurveID = NID_X9_62_prime256v1;
 const std::size_t kValueBits = 64;
+// Number of bytes of ciphertexts or points that are encrypted and sent at a time, unless tuned to the link.
+const std::size_t kExchangeChunkSize = std::size_t(1) << 21;
 const block kZeroBlock = _mm_set_epi64x(0, 0);
 enum class Byte : unsigned char {};
 using ByteVector = std::vector<Byte>;
@@ -14,12 +14,16 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "nlohmann/json.hpp"
+
 #include "dpca-psi/network/io_base.h"
 
 namespace privacy_go {
@@ -96,5 +100,82 @@ void check_consistency(bool is_sender, std::shared_ptr<IOBase> net, const std::s
     }
 }
 
+// Marks a handshake message, so that a party that checks its parameters one by one fails instead of reading a
+// message as parameters.
+const std::uint64_t kHandshakeMagic = 0x4b48534850414301;
+
+// Exchanges the parameters of both parties in one round trip, as one message per side, and checks them locally
+// instead of once per parameter. message is a json object of
+//   "version": the version of the handshake, which must be equal on both sides,
+//   "capabilities": the features that this party supports,
+//   "requires": the capabilities that the parameters of this party need from the other party,
+//   "params": the parameters that both parties must agree on,
+//   "error": the message of the failed local checks of this party, or empty,
+// and any other field. Returns the message of the other party.
+// Throws std::invalid_argument on both sides if the local checks of either party failed, or the versions or a
+// parameter disagree, or a required capability is missing.
+inline nlohmann::json exchange_handshake(bool is_sender, std::shared_ptr<IOBase> net, const nlohmann::json& message) {
+    std::string remote_message_str;
+    auto recv_message = [&net, &remote_message_str]() {
+        if (net->recv_value<std::uint64_t>() != kHandshakeMagic) {
+            throw std::invalid_argument("the other party does not run a compatible handshake");
+        }
+        remote_message_str = net->recv_string();
+    };
+    if (is_sender) {
+        net->send_value<std::uint64_t>(kHandshakeMagic);
+        net->send_string(message.dump());
+        recv_message();
+    } else {
+        recv_message();
+        net->send_value<std::uint64_t>(kHandshakeMagic);
+        net->send_string(message.dump());
+    }
+    net->flush();
+    nlohmann::json remote_message = nlohmann::json::parse(remote_message_str);
+
+    std::string error = message.at("error");
+    if (!error.empty()) {
+        throw std::invalid_argument(error);
+    }
+    std::string remote_error = remote_message.at("error");
+    if (!remote_error.empty()) {
+        throw std::invalid_argument("The other party failed to check its parameters. " + remote_error);
+    }
+    if (message.at("version") != remote_message.at("version")) {
+        throw std::invalid_argument("Disagreement on handshake version, " + message.at("version").dump() + " vs " +
+                                    remote_message.at("version").dump() + ".");
+    }
+    const auto& capabilities = message.at("capabilities");
+    const auto& remote_capabilities = remote_message.at("capabilities");
+    for (const auto& capability : message.at("requires")) {
+        if (std::find(remote_capabilities.begin(), remote_capabilities.end(), capability) ==
+                remote_capabilities.end()) {
+            throw std::invalid_argument("The other party does not support " + capability.dump() + ".");
+        }
+    }
+    for (const auto& capability : remote_message.at("requires")) {
+        if (std::find(capabilities.begin(), capabilities.end(), capability) == capabilities.end()) {
+            throw std::invalid_argument("The other party requires unsupported " + capability.dump() + ".");
+        }
+    }
+    // a parameter set on one side only disagrees with the null of the other side.
+    auto check_agreement = [](const nlohmann::json& params, const nlohmann::json& remote_params, bool is_local) {
+        for (auto it = params.begin(); it != params.end(); ++it) {
+            auto found = remote_params.find(it.key());
+            nlohmann::json remote_value = found != remote_params.end() ? *found : nlohmann::json();
+            if (it.value() != remote_value) {
+                auto error_message = "Disagreement on parmeter " + it.key() + ", " +
+                                     (is_local ? it.value() : remote_value).dump() + " vs " +
+                                     (is_local ? remote_value : it.value()).dump() + ".";
+                throw std::invalid_argument(error_message);
+            }
+        }
+    };
+    check_agreement(message.at("params"), remote_message.at("params"), true);
+    check_agreement(remote_message.at("params"), message.at("params"), false);
+    return remote_message;
+}
+
 }  // namespace dpca_psi
 }  // namespace privacy_go
@@ -14,9 +14,14 @@
 
 #pragma once
 
+#include <openssl/bn.h>
+
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <sstream>
 #include <string>
@@ -47,20 +52,83 @@ inline std::string hex_2_string(const std::string& data) {
     return result;
 }
 
-inline block read_block_from_dev_urandom() {
-    block ret;
+// The seeded randomness of set_random_seed(). seeded is read without the mutex, so that unseeded draws never lock.
+struct SeededRandomness {
+    std::atomic<bool> seeded{false};
+    std::mutex mutex{};
+    std::unique_ptr<PRNG> prng = nullptr;
+};
+
+inline SeededRandomness& get_seeded_randomness() {
+    static SeededRandomness randomness;
+    return randomness;
+}
+
+// Replaces /dev/urandom of read_random_bytes() by a PRNG seeded with seed, so that a party draws the same random
+// values in every run, e.g. to replay a recorded transcript. Values drawn by several threads at once are only
+// reproduced if the threads draw in the same order. Every secret derives from seed, never set one in production.
+inline void set_random_seed(const block& seed) {
+    SeededRandomness& randomness = get_seeded_randomness();
+    std::lock_guard<std::mutex> lock(randomness.mutex);
+    randomness.prng.reset(new PRNG(seed));
+    randomness.seeded.store(true, std::memory_order_release);
+}
+
+// Restores /dev/urandom.
+inline void clear_random_seed() {
+    SeededRandomness& randomness = get_seeded_randomness();
+    std::lock_guard<std::mutex> lock(randomness.mutex);
+    randomness.seeded.store(false, std::memory_order_release);
+    randomness.prng.reset();
+}
+
+inline bool has_random_seed() {
+    return get_seeded_randomness().seeded.load(std::memory_order_acquire);
+}
+
+// Fills nbyte bytes at data with randomness from /dev/urandom, or from the seeded PRNG if set_random_seed() is called.
+inline void read_random_bytes(void* data, std::size_t nbyte) {
+    SeededRandomness& randomness = get_seeded_randomness();
+    if (randomness.seeded.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(randomness.mutex);
+        // the seed may be cleared since the check.
+        if (randomness.prng != nullptr) {
+            randomness.prng->get(reinterpret_cast<std::uint8_t*>(data), nbyte);
+            return;
+        }
+    }
     std::ifstream in("/dev/urandom");
-    in.read(reinterpret_cast<char*>(&ret), sizeof(ret));
+    in.read(reinterpret_cast<char*>(data), nbyte);
     in.close();
+}
+
+// Drop-in replacement of BN_rand_range() that follows set_random_seed(). Returns 1 on success and 0 otherwise.
+inline int bn_rand_range(BIGNUM* rnd, const BIGNUM* range) {
+    if (!has_random_seed()) {
+        return BN_rand_range(rnd, range);
+    }
+    // 64 extra bits make the bias of the reduction negligible.
+    std::vector<unsigned char> bytes(static_cast<std::size_t>(BN_num_bytes(range)) + 8);
+    read_random_bytes(bytes.data(), bytes.size());
+    BN_CTX* ctx = BN_CTX_new();
+    int ret = (ctx != nullptr && BN_bin2bn(bytes.data(), static_cast<int>(bytes.size()), rnd) != nullptr &&
+                      BN_nnmod(rnd, rnd, range, ctx) == 1)
+                      ? 1
+                      : 0;
+    BN_CTX_free(ctx);
+    return ret;
+}
+
+inline block read_block_from_dev_urandom() {
+    block ret;
+    read_random_bytes(&ret, sizeof(ret));
     return ret;
 }
 
 template <typename T>
 inline T read_data_from_dev_urandom() {
     T ret;
-    std::ifstream in("/dev/urandom");
-    in.read(reinterpret_cast<char*>(&ret), sizeof(ret));
-    in.close();
+    read_random_bytes(&ret, sizeof(ret));
     return ret;
 }
 
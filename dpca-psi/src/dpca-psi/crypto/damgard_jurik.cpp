@@ -0,0 +1,294 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/damgard_jurik.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "ipcl/ipcl.hpp"
+#include "ipcl/mod_exp.hpp"
+#include "ipcl/utils/common.hpp"
+
+#include "dpca-psi/crypto/ipcl_utils.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+DamgardJurik::DamgardJurik(std::size_t s) : s_(s), n_len_(0), pk_set_(false), sk_set_(false), enable_djn_(false) {
+    if (s_ < 1) {
+        throw std::invalid_argument("Damgard-Jurik s must be at least 1");
+    }
+}
+
+void DamgardJurik::keygen(std::size_t n_len, bool enable_djn) {
+    if (n_len < 1024) {
+        throw std::logic_error("Damgard-Jurik key length is too short");
+    }
+    // only the primes are taken from IPCL, the rest of the keys depends on s.
+    ipcl::KeyPair key_pair = ipcl::generateKeypair(n_len, false);
+    BigNumber n = *(key_pair.pub_key.getN());
+    BigNumber hs = BigNumber::Zero();
+    if (enable_djn) {
+        // hs = (-x^2)^(n^s) mod n^(s+1) for a random x.
+        BigNumber x = ipcl_random_bn(static_cast<int>(n_len)) % n;
+        BigNumber h = n - x * x % n;
+        BigNumber n_power_s = BigNumber::One();
+        for (std::size_t i = 0; i < s_; ++i) {
+            n_power_s *= n;
+        }
+        hs = ipcl::modExp(h, n_power_s, n_power_s * n);
+    }
+    set_pk(n, n_len, hs, enable_djn);
+    set_sk(*(key_pair.priv_key.getP()), *(key_pair.priv_key.getQ()));
+}
+
+void DamgardJurik::set_pk(const BigNumber& n, std::size_t n_len, const BigNumber& hs, bool enable_djn) {
+    // the sk stays valid for the same n, e.g. when a pk is imported after its sk.
+    bool keeps_sk = sk_set_ && n == n_powers_[1];
+    n_powers_.assign(1, BigNumber::One());
+    for (std::size_t k = 1; k <= s_ + 1; ++k) {
+        n_powers_.emplace_back(n_powers_.back() * n);
+    }
+    inverse_factorials_.assign(1, BigNumber::One());
+    BigNumber factorial = BigNumber::One();
+    for (std::size_t k = 1; k <= s_; ++k) {
+        factorial *= static_cast<Ipp32u>(k);
+        inverse_factorials_.emplace_back(n_powers_[s_ + 1].InverseMul(factorial));
+    }
+    hs_ = hs;
+    pk_ = std::make_shared<ipcl::PublicKey>();
+    pk_->create(n, static_cast<int>(n_len), false);
+    n_len_ = n_len;
+    enable_djn_ = enable_djn;
+    pk_set_ = true;
+    sk_set_ = keeps_sk;
+}
+
+void DamgardJurik::set_sk(const BigNumber& p, const BigNumber& q) {
+    if (p * q != n_powers_[1]) {
+        throw std::logic_error("invalid sk");
+    }
+    p_ = p;
+    q_ = q;
+    lambda_ = (p - BigNumber::One()) * (q - BigNumber::One());
+    lambda_inverse_ = n_powers_[s_].InverseMul(lambda_ % n_powers_[s_]);
+    sk_set_ = true;
+}
+
+BigNumber DamgardJurik::one_plus_n_pow(const BigNumber& m) const {
+    const BigNumber& modulus = n_powers_[s_ + 1];
+    BigNumber result = BigNumber::One();
+    // m * (m - 1) * ... * (m - k + 1) mod n^(s+1).
+    BigNumber falling_factorial = BigNumber::One();
+    for (std::size_t k = 1; k <= s_; ++k) {
+        BigNumber k_minus_one(static_cast<Ipp32u>(k - 1));
+        // C(m, k) = 0 for k > m.
+        if (m <= k_minus_one) {
+            break;
+        }
+        falling_factorial = falling_factorial * (m - k_minus_one) % modulus;
+        BigNumber term = falling_factorial * inverse_factorials_[k] % modulus * n_powers_[k] % modulus;
+        result = (result + term) % modulus;
+    }
+    return result;
+}
+
+BigNumber DamgardJurik::discrete_log(const BigNumber& a) const {
+    // recovers i mod n^j from L(a mod n^(j+1)) = sum_{k=1}^{j} C(i, k) * n^(k-1) mod n^j, for j = 1, 2, ..., s.
+    BigNumber i = BigNumber::Zero();
+    for (std::size_t j = 1; j <= s_; ++j) {
+        const BigNumber& n_power_j = n_powers_[j];
+        BigNumber t1 = (a % n_powers_[j + 1] - BigNumber::One()) / n_powers_[1];
+        BigNumber t2 = i;
+        BigNumber i_minus_k = i;
+        for (std::size_t k = 2; k <= j; ++k) {
+            i_minus_k = (i_minus_k + n_power_j - BigNumber::One()) % n_power_j;
+            t2 = t2 * i_minus_k % n_power_j;
+            BigNumber t3 = t2 * n_powers_[k - 1] % n_power_j * inverse_factorials_[k] % n_power_j;
+            t1 = (t1 + n_power_j - t3) % n_power_j;
+        }
+        i = t1 % n_power_j;
+    }
+    return i;
+}
+
+ipcl::CipherText DamgardJurik::encrypt(const ipcl::PlainText& plain) const {
+    if (!pk_set_) {
+        throw std::logic_error("pk not set.");
+    }
+    const BigNumber& modulus = n_powers_[s_ + 1];
+    std::size_t size = plain.getSize();
+    std::vector<BigNumber> bases(size);
+    std::vector<BigNumber> exponents(size);
+    std::vector<BigNumber> moduli(size, modulus);
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        if (enable_djn_) {
+            bases[idx] = hs_;
+            exponents[idx] = ipcl_random_bn(static_cast<int>(n_len_ / 2));
+        } else {
+            bases[idx] = ipcl_random_bn(static_cast<int>(n_len_)) % n_powers_[1];
+            exponents[idx] = n_powers_[s_];
+        }
+    }
+    ipcl::setHybridMode(ipcl::HybridMode::IPP);
+    std::vector<BigNumber> randomizers = ipcl::modExp(bases, exponents, moduli);
+    ipcl::setHybridOff();
+
+    std::vector<BigNumber> cipher(size);
+#pragma omp parallel for
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        cipher[idx] = one_plus_n_pow(plain.getElement(idx) % n_powers_[s_]) * randomizers[idx] % modulus;
+    }
+    return ipcl::CipherText(*pk_, cipher);
+}
+
+ipcl::PlainText DamgardJurik::decrypt(const ipcl::CipherText& cipher) const {
+    if (!sk_set_) {
+        throw std::logic_error("sk not set.");
+    }
+    std::size_t size = cipher.getSize();
+    std::vector<BigNumber> bases(size);
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        bases[idx] = cipher.getElement(idx);
+    }
+    std::vector<BigNumber> exponents(size, lambda_);
+    std::vector<BigNumber> moduli(size, n_powers_[s_ + 1]);
+    ipcl::setHybridMode(ipcl::HybridMode::IPP);
+    std::vector<BigNumber> powers = ipcl::modExp(bases, exponents, moduli);
+    ipcl::setHybridOff();
+
+    std::vector<BigNumber> plain(size);
+#pragma omp parallel for
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        plain[idx] = discrete_log(powers[idx]) * lambda_inverse_ % n_powers_[s_];
+    }
+    return ipcl::PlainText(plain);
+}
+
+ipcl::CipherText DamgardJurik::add(const ipcl::CipherText& cipher0, const ipcl::CipherText& cipher1) const {
+    if (cipher0.getSize() != cipher1.getSize()) {
+        throw std::invalid_argument("ciphertexts size mismatch");
+    }
+    const BigNumber& modulus = n_powers_[s_ + 1];
+    std::vector<BigNumber> result(cipher0.getSize());
+    for (std::size_t idx = 0; idx < result.size(); ++idx) {
+        result[idx] = cipher0.getElement(idx) * cipher1.getElement(idx) % modulus;
+    }
+    return ipcl::CipherText(*pk_, result);
+}
+
+ipcl::CipherText DamgardJurik::add(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const {
+    if (cipher.getSize() != plain.getSize()) {
+        throw std::invalid_argument("ciphertexts and plaintexts size mismatch");
+    }
+    const BigNumber& modulus = n_powers_[s_ + 1];
+    std::vector<BigNumber> result(cipher.getSize());
+#pragma omp parallel for
+    for (std::size_t idx = 0; idx < result.size(); ++idx) {
+        result[idx] = cipher.getElement(idx) * one_plus_n_pow(plain.getElement(idx) % n_powers_[s_]) % modulus;
+    }
+    return ipcl::CipherText(*pk_, result);
+}
+
+ipcl::CipherText DamgardJurik::mult(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const {
+    if (cipher.getSize() != plain.getSize()) {
+        throw std::invalid_argument("ciphertexts and plaintexts size mismatch");
+    }
+    std::size_t size = cipher.getSize();
+    std::vector<BigNumber> bases(size);
+    std::vector<BigNumber> exponents(size);
+    std::vector<BigNumber> moduli(size, n_powers_[s_ + 1]);
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        bases[idx] = cipher.getElement(idx);
+        exponents[idx] = plain.getElement(idx) % n_powers_[s_];
+    }
+    ipcl::setHybridMode(ipcl::HybridMode::IPP);
+    std::vector<BigNumber> result = ipcl::modExp(bases, exponents, moduli);
+    ipcl::setHybridOff();
+    return ipcl::CipherText(*pk_, result);
+}
+
+ByteVector DamgardJurik::export_pk() const {
+    if (!pk_set_) {
+        throw std::logic_error("pk not set.");
+    }
+    ByteVector serialized_pk;
+    ipcl_bn_2_bytes(n_powers_[1], serialized_pk);
+    serialized_pk.resize((n_len_ + 7) / 8, Byte('\x00'));
+    if (enable_djn_) {
+        ByteVector serialized_hs = encode(hs_, true);
+        serialized_pk.insert(serialized_pk.end(), serialized_hs.begin(), serialized_hs.end());
+    }
+    return serialized_pk;
+}
+
+void DamgardJurik::import_pk(const ByteVector& in, bool enable_djn) {
+    if (enable_djn) {
+        if (in.size() % (s_ + 2) || in.empty()) {
+            throw std::logic_error("enable djn, invalid pk.");
+        }
+        std::size_t n_bytes = in.size() / (s_ + 2);
+        ByteVector n(in.begin(), in.begin() + n_bytes);
+        ByteVector hs(in.begin() + n_bytes, in.end());
+        set_pk(decode(n), n_bytes * 8, decode(hs), true);
+    } else {
+        if (in.empty()) {
+            throw std::logic_error("invalid pk.");
+        }
+        set_pk(decode(in), in.size() * 8, BigNumber::Zero(), false);
+    }
+}
+
+ByteVector DamgardJurik::export_sk() const {
+    if (!sk_set_) {
+        throw std::logic_error("sk not set.");
+    }
+    std::size_t n_bytes = (n_len_ + 7) / 8;
+    ByteVector encoded_n;
+    ipcl_bn_2_bytes(n_powers_[1], encoded_n);
+    ByteVector encoded_p;
+    ipcl_bn_2_bytes(p_, encoded_p);
+    ByteVector encoded_q;
+    ipcl_bn_2_bytes(q_, encoded_q);
+    encoded_n.resize(n_bytes, Byte('\x00'));
+    encoded_p.resize(n_bytes / 2, Byte('\x00'));
+    encoded_q.resize(n_bytes / 2, Byte('\x00'));
+    encoded_n.insert(encoded_n.end(), encoded_p.begin(), encoded_p.end());
+    encoded_n.insert(encoded_n.end(), encoded_q.begin(), encoded_q.end());
+    return encoded_n;
+}
+
+void DamgardJurik::import_sk(const ByteVector& in) {
+    if (in.size() % 4 || in.empty()) {
+        throw std::logic_error("invalid sk");
+    }
+    std::size_t half_n_bytes = in.size() / 4;
+    BigNumber n = decode(ByteVector(in.begin(), in.begin() + 2 * half_n_bytes));
+    BigNumber p = decode(ByteVector(in.begin() + 2 * half_n_bytes, in.begin() + 3 * half_n_bytes));
+    BigNumber q = decode(ByteVector(in.begin() + 3 * half_n_bytes, in.end()));
+    // keeps hs of an imported pk of the same n.
+    if (!pk_set_ || n != n_powers_[1]) {
+        set_pk(n, half_n_bytes * 16, BigNumber::Zero(), false);
+    }
+    set_sk(p, q);
+}
+
+std::size_t DamgardJurik::get_bytes_len(bool is_n_square) const {
+    std::size_t bytes_len = (n_len_ + 7) / 8;
+    return bytes_len * (s_ + is_n_square);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,137 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ipcl/bignum.h"
+#include "ipcl/ciphertext.hpp"
+#include "ipcl/plaintext.hpp"
+#include "ipcl/pub_key.hpp"
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/crypto/paillier.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Damgard-Jurik cryptosystem, the generalization of Paillier to plaintexts in Z_{n^s} and ciphertexts in
+// Z_{n^(s+1)}. A ciphertext carries s * |n| bits of plaintext at a cost of (s + 1) * |n| bits, against |n| bits at a
+// cost of 2 * |n| bits for Paillier, which is worth it when plaintexts are packed.
+// Primes are generated by IPCL, modular exponentiations are done by IPCL in batches.
+// Details refer to "A Generalisation, a Simplification and Some Applications of Paillier's Probabilistic Public-Key
+// System", Damgard and Jurik, PKC 2001.
+class DamgardJurik : public Paillier {
+public:
+    // s must be at least 1.
+    explicit DamgardJurik(std::size_t s);
+
+    // Generates pk and sk given the bits length of n.
+    void keygen(std::size_t n_len, bool enable_djn) override;
+
+    // If DJN optimiztion is enabled, c = (1 + n)^m * hs^r mod n^(s+1), where hs = h^(n^s) mod n^(s+1).
+    // Otherwise, c = (1 + n)^m * r^(n^s) mod n^(s+1).
+    // Returns encrypted cipherText.
+    ipcl::CipherText encrypt(const ipcl::PlainText& plain) const override;
+
+    // Computes c^lambda = (1 + n)^(m * lambda) mod n^(s+1), extracts m * lambda mod n^s, then multiplies it with
+    // lambda^(-1) mod n^s.
+    // Returns decrypted plaintext.
+    ipcl::PlainText decrypt(const ipcl::CipherText& cipher) const override;
+
+    // Homomorphic addition, cipher0 + cipher1.
+    ipcl::CipherText add(const ipcl::CipherText& cipher0, const ipcl::CipherText& cipher1) const override;
+
+    // Homomorphic addition, cipher + plain
+    ipcl::CipherText add(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const override;
+
+    // Homomorphic multiplication, cipher * plain.
+    ipcl::CipherText mult(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const override;
+
+    // If DJN optimiztion is enabled, the public key is (n, hs), otherwise, the public key is (n).
+    // Returns serialized pk.
+    ByteVector export_pk() const override;
+
+    // Deserializes pk.
+    void import_pk(const ByteVector& in, bool enable_djn) override;
+
+    // Returns serialized sk in the form of (n, p, q).
+    ByteVector export_sk() const override;
+
+    // Deserializes sk.
+    void import_sk(const ByteVector& in) override;
+
+    // Returns bytes length of n^s, or of n^(s+1) if is_n_square is true.
+    std::size_t get_bytes_len(bool is_n_square) const override;
+
+    std::size_t get_plaintext_bits() const override {
+        return static_cast<std::size_t>(n_powers_[s_].BitSize() - 1);
+    }
+
+    BigNumber n() const override {
+        return n_powers_[1];
+    }
+
+    std::shared_ptr<ipcl::PublicKey> get_pk() const override {
+        return pk_;
+    }
+
+    std::string scheme_name() const override {
+        return "damgard_jurik_s" + std::to_string(s_);
+    }
+
+    std::size_t s() const {
+        return s_;
+    }
+
+private:
+    // Sets n and the values derived from it. If DJN optimiztion is enabled, will also set hs. Keeps the sk if n is
+    // unchanged, and unsets it otherwise.
+    void set_pk(const BigNumber& n, std::size_t n_len, const BigNumber& hs, bool enable_djn);
+
+    // Sets p, q and the values derived from them. The public key must be set.
+    void set_sk(const BigNumber& p, const BigNumber& q);
+
+    // Returns (1 + n)^m mod n^(s+1) through the binomial expansion sum_{k=0}^{s} C(m, k) * n^k.
+    BigNumber one_plus_n_pow(const BigNumber& m) const;
+
+    // Returns i mod n^s given a = (1 + n)^i mod n^(s+1).
+    BigNumber discrete_log(const BigNumber& a) const;
+
+    std::size_t s_;
+    std::size_t n_len_;
+    bool pk_set_;
+    bool sk_set_;
+    bool enable_djn_;
+
+    // n^0, n^1, ..., n^(s+1).
+    std::vector<BigNumber> n_powers_{};
+    // (k!)^(-1) mod n^(s+1) for k = 0, 1, ..., s.
+    std::vector<BigNumber> inverse_factorials_{};
+    BigNumber hs_{};
+
+    BigNumber p_{};
+    BigNumber q_{};
+    // lambda = (p - 1) * (q - 1), and lambda^(-1) mod n^s.
+    BigNumber lambda_{};
+    BigNumber lambda_inverse_{};
+
+    std::shared_ptr<ipcl::PublicKey> pk_ = nullptr;
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "dpca-psi/common/defines.h"
+#include "dpca-psi/common/utils.h"
 
 namespace privacy_go {
 namespace dpca_psi {
@@ -121,6 +122,32 @@ ByteVector EccCipher::encrypt_and_div(
     return export_to_bytes(deserialized_point);
 }
 
+ByteVector EccCipher::export_private_keys() const {
+    // every key is less than the order of 256 bits.
+    std::size_t key_len = kEccKeyBitsLen / 8;
+    ByteVector data(private_keys_num_ * key_len);
+    for (std::size_t i = 0; i < private_keys_num_; ++i) {
+        auto* out = reinterpret_cast<unsigned char*>(data.data() + i * key_len);
+        if (BN_bn2binpad(private_keys_.get()[i].get(), out, static_cast<int>(key_len)) < 0) {
+            throw_openssl_error();
+        }
+    }
+    return data;
+}
+
+void EccCipher::import_private_keys(const ByteVector& data) {
+    std::size_t key_len = kEccKeyBitsLen / 8;
+    if (data.size() != private_keys_num_ * key_len) {
+        throw std::invalid_argument("size of private keys does not match");
+    }
+    for (std::size_t i = 0; i < private_keys_num_; ++i) {
+        const auto* in = reinterpret_cast<const unsigned char*>(data.data() + i * key_len);
+        if (BN_bin2bn(in, static_cast<int>(key_len), private_keys_.get()[i].get()) == nullptr) {
+            throw_openssl_error();
+        }
+    }
+}
+
 void EccCipher::generate_private_key() {
     BignumPtr order(BN_dup(EC_GROUP_get0_order(group_.get())));
     if (order == nullptr) {
@@ -133,14 +160,14 @@ void EccCipher::generate_private_key() {
     }
 
     for (std::size_t i = 0; i < private_keys_num_; ++i) {
-        ret = BN_rand_range(private_keys_.get()[i].get(), order.get());
+        ret = bn_rand_range(private_keys_.get()[i].get(), order.get());
         if (ret != 1) {
             throw_openssl_error();
         }
 
         // Checks bit length of private key to ensure strong radomness.
         while (BN_num_bits(private_keys_.get()[i].get()) != kEccKeyBitsLen) {
-            ret = BN_rand_range(private_keys_.get()[i].get(), order.get());
+            ret = bn_rand_range(private_keys_.get()[i].get(), order.get());
             if (ret != 1) {
                 throw_openssl_error();
             }
@@ -214,16 +241,14 @@ ECPointPtr EccCipher::hash_to_curve(const std::string& plaintext) {
 }
 
 ByteVector EccCipher::export_to_bytes(const ECPointPtr& point) const {
-    std::array<std::uint8_t, kEccPointLen> point_str;
+    point_conversion_form_t form =
+            point_len_ == kEccPointLen ? POINT_CONVERSION_COMPRESSED : POINT_CONVERSION_UNCOMPRESSED;
+    ByteVector out(point_len_);
     auto ret = EC_POINT_point2oct(
-            group_.get(), point.get(), POINT_CONVERSION_COMPRESSED, point_str.data(), kEccPointLen, NULL);
-    if (ret == 0) {
+            group_.get(), point.get(), form, reinterpret_cast<std::uint8_t*>(out.data()), point_len_, NULL);
+    if (ret != point_len_) {
         throw_openssl_error();
     }
-    ByteVector out(kEccPointLen);
-    for (std::size_t idx = 0; idx < kEccPointLen; ++idx) {
-        out[idx] = Byte(point_str[idx]);
-    }
     return out;
 }
 
@@ -232,8 +257,9 @@ ECPointPtr EccCipher::import_from_bytes(const ByteVector& plaintext) const {
     if (point == nullptr) {
         throw_openssl_error();
     }
-    auto ret = EC_POINT_oct2point(
-            group_.get(), point.get(), reinterpret_cast<const std::uint8_t*>(plaintext.data()), kEccPointLen, NULL);
+    // the first byte tells the form.
+    auto ret = EC_POINT_oct2point(group_.get(), point.get(), reinterpret_cast<const std::uint8_t*>(plaintext.data()),
+            plaintext.size(), NULL);
     if (ret == 0) {
         throw_openssl_error();
     }
@@ -34,18 +34,36 @@ class EccCipher {
     EccCipher& operator=(const EccCipher& other) = delete;
 
     // Maps plaintext to a point on elliptic curve and exponentiates the point to `private_keys_[key_index]` power.
-    // Returns a compressed form of the result point.
+    // Returns the result point serialized in the form of set_point_compression().
     ByteVector hash_encrypt(const std::string& plaintext, std::size_t key_index);
 
     // Deserializes the points and exponentiates the point to `private_keys_[key_index]` power.
-    // Returns a compressed form of the result point.
+    // Returns the result point serialized in the form of set_point_compression().
     ByteVector encrypt(const ByteVector& point, std::size_t key_index);
 
     // Deserializes the points and exponentiates the point to `private_key_[key_index_first] /
     // private_key_[key_index_second] ` power.
-    // Returns a compressed form of the result point.
+    // Returns the result point serialized in the form of set_point_compression().
     ByteVector encrypt_and_div(const ByteVector& point, std::size_t key_index_first, std::size_t key_index_second);
 
+    // Serializes result points in compressed form of kEccPointLen bytes if compress is true, which is the default, or
+    // in uncompressed form of kEccUncompressedPointLen bytes otherwise, which saves a square root to deserialize them.
+    // Points of either form are deserialized.
+    void set_point_compression(bool compress) {
+        point_len_ = compress ? kEccPointLen : kEccUncompressedPointLen;
+    }
+
+    std::size_t get_point_len() const {
+        return point_len_;
+    }
+
+    // Serializes the private keys, e.g. to resume a protocol from a checkpoint. Must be kept as secret as the keys.
+    ByteVector export_private_keys() const;
+
+    // Replaces the private keys with those serialized by export_private_keys().
+    // Throws std::invalid_argument if data does not hold the same number of keys.
+    void import_private_keys(const ByteVector& data);
+
     ~EccCipher() {
     }
 
@@ -60,7 +78,7 @@ class EccCipher {
     //   b. If successful, return the elliptic curve point (x,y).
     ECPointPtr hash_to_curve(const std::string& plaintext);
 
-    // Serializes a point to a byte vector in compressed form.
+    // Serializes a point to a byte vector of point_len_ bytes.
     ByteVector export_to_bytes(const ECPointPtr& point) const;
 
     // Deserializes a byte vector to a point.
@@ -100,6 +118,8 @@ class EccCipher {
     const BignumPtr b_;
     const BignumPtr three_;
     const BignumPtr p_minus_one_over_two_;
+
+    std::size_t point_len_ = kEccPointLen;
 };
 
 }  // namespace dpca_psi
@@ -0,0 +1,96 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/fixed_bignum.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+FixedBigNum::FixedBigNum(std::size_t bits) : limbs_((bits + 63) / 64, 0) {
+}
+
+void FixedBigNum::set_zero() {
+    std::fill(limbs_.begin(), limbs_.end(), 0);
+}
+
+void FixedBigNum::set_u64(std::size_t bit_offset, std::uint64_t value) {
+    set_bits(bit_offset, &value, 64);
+}
+
+void FixedBigNum::set_bits(std::size_t bit_offset, const std::uint64_t* value, std::size_t bits) {
+    if (bit_offset + bits > this->bits()) {
+        throw std::out_of_range("value does not fit in fixed bignum");
+    }
+    std::size_t limb_idx = bit_offset / 64;
+    std::size_t shift = bit_offset % 64;
+    std::size_t value_limbs = (bits + 63) / 64;
+    for (std::size_t idx = 0; idx < value_limbs; ++idx) {
+        std::uint64_t limb = value[idx];
+        std::size_t remaining_bits = bits - idx * 64;
+        if (remaining_bits < 64) {
+            limb &= (std::uint64_t(1) << remaining_bits) - 1;
+        }
+        limbs_[limb_idx + idx] |= limb << shift;
+        if (shift != 0 && limb_idx + idx + 1 < limbs_.size()) {
+            limbs_[limb_idx + idx + 1] |= limb >> (64 - shift);
+        }
+    }
+}
+
+std::uint64_t FixedBigNum::get_u64(std::size_t bit_offset) const {
+    std::size_t limb_idx = bit_offset / 64;
+    std::size_t shift = bit_offset % 64;
+    if (limb_idx >= limbs_.size()) {
+        return 0;
+    }
+    std::uint64_t value = limbs_[limb_idx] >> shift;
+    if (shift != 0 && limb_idx + 1 < limbs_.size()) {
+        value |= limbs_[limb_idx + 1] << (64 - shift);
+    }
+    return value;
+}
+
+void FixedBigNum::from_bn(const BigNumber& bn) {
+    IppsBigNumSGN sign;
+    int bit_size = 0;
+    Ipp32u* data = nullptr;
+    ippsRef_BN(&sign, &bit_size, &data, bn);
+    std::size_t words = bit_size > 0 ? (static_cast<std::size_t>(bit_size) + 31) / 32 : 0;
+    if (words > limbs_.size() * 2) {
+        throw std::out_of_range("BigNumber does not fit in fixed bignum");
+    }
+    set_zero();
+    if (words != 0) {
+        std::memcpy(limbs_.data(), data, words * sizeof(Ipp32u));
+    }
+}
+
+BigNumber FixedBigNum::to_bn() const {
+    const Ipp32u* words = reinterpret_cast<const Ipp32u*>(limbs_.data());
+    std::size_t length = limbs_.size() * 2;
+    while (length > 0 && words[length - 1] == 0) {
+        --length;
+    }
+    if (length == 0) {
+        return BigNumber::Zero();
+    }
+    return BigNumber(words, static_cast<int>(length));
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,72 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ipcl/bignum.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Unsigned integer of a fixed bit width, stored as little-endian 64-bit limbs.
+// Packed Paillier plaintexts place every slot at a fixed bit offset, so packing, unpacking and reduction modulo 2^64
+// are shifts and masks on limbs rather than BigNumber multiplications, divisions and modular reductions. The limbs are
+// allocated once and reused for every value of a batch.
+class FixedBigNum {
+public:
+    FixedBigNum() = default;
+
+    // Creates a zero value able to hold bits bits.
+    explicit FixedBigNum(std::size_t bits);
+
+    // Sets the value to zero, keeping the width.
+    void set_zero();
+
+    // Adds (value << bit_offset). The bits being written must be zero.
+    // Throws std::out_of_range if the value does not fit in the width.
+    void set_u64(std::size_t bit_offset, std::uint64_t value);
+
+    // Adds (value << bit_offset), where value holds bits bits in little-endian 64-bit limbs.
+    // The bits being written must be zero.
+    // Throws std::out_of_range if the value does not fit in the width.
+    void set_bits(std::size_t bit_offset, const std::uint64_t* value, std::size_t bits);
+
+    // Returns (this >> bit_offset) mod 2^64.
+    std::uint64_t get_u64(std::size_t bit_offset) const;
+
+    // Loads the magnitude of bn. Throws std::out_of_range if bn does not fit in the width.
+    void from_bn(const BigNumber& bn);
+
+    // Returns the value as a BigNumber.
+    BigNumber to_bn() const;
+
+    // Returns the width in bits, rounded up to a whole number of limbs.
+    std::size_t bits() const {
+        return limbs_.size() * 64;
+    }
+
+    const std::uint64_t* data() const {
+        return limbs_.data();
+    }
+
+private:
+    std::vector<std::uint64_t> limbs_{};
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -15,8 +15,12 @@
 #include "dpca-psi/crypto/ipcl_paillier.h"
 
 #include <algorithm>
+#include <stdexcept>
 #include <vector>
 
+#include "ipcl/mod_exp.hpp"
+#include "ipcl/utils/common.hpp"
+
 #include "dpca-psi/crypto/ipcl_utils.h"
 
 namespace privacy_go {
@@ -71,14 +75,82 @@ void IpclPaillier::set_pk(const ipcl::PublicKey& pk, bool enable_djn) {
 
 void IpclPaillier::set_sk(const ipcl::PrivateKey& sk) {
     sk_ = std::make_shared<ipcl::PrivateKey>(*(sk.getN()), *(sk.getP()), *(sk.getQ()));
+    const BigNumber& n = *(sk_->getN());
+    const BigNumber& p = *(sk_->getP());
+    const BigNumber& q = *(sk_->getQ());
+    p_square_ = p * p;
+    q_square_ = q * q;
+    q_square_inverse_ = p_square_.InverseMul(q_square_ % p_square_);
+    n_mod_phi_p_square_ = n % (p * (p - BigNumber::One()));
+    n_mod_phi_q_square_ = n % (q * (q - BigNumber::One()));
     sk_set_ = true;
 }
 
-ipcl::CipherText IpclPaillier::encrypt(const ipcl::PlainText& plain) const {
+std::vector<BigNumber> IpclPaillier::get_crt_randomizers(std::size_t size) const {
+    // the exponentiations modulo p^2 and q^2 are interleaved in a single batch.
+    std::vector<BigNumber> bases(2 * size);
+    std::vector<BigNumber> exponents(2 * size);
+    std::vector<BigNumber> moduli(2 * size);
+    BigNumber hs_mod_p_square;
+    BigNumber hs_mod_q_square;
+    if (enable_djn_) {
+        hs_mod_p_square = pk_->getHS() % p_square_;
+        hs_mod_q_square = pk_->getHS() % q_square_;
+    }
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        if (enable_djn_) {
+            BigNumber r = ipcl_random_bn(pk_->getRandBits());
+            bases[2 * idx] = hs_mod_p_square;
+            bases[2 * idx + 1] = hs_mod_q_square;
+            exponents[2 * idx] = r;
+            exponents[2 * idx + 1] = r;
+        } else {
+            BigNumber r = ipcl_random_bn(static_cast<int>(n_len_)) % *(pk_->getN());
+            bases[2 * idx] = r % p_square_;
+            bases[2 * idx + 1] = r % q_square_;
+            exponents[2 * idx] = n_mod_phi_p_square_;
+            exponents[2 * idx + 1] = n_mod_phi_q_square_;
+        }
+        moduli[2 * idx] = p_square_;
+        moduli[2 * idx + 1] = q_square_;
+    }
     ipcl::setHybridMode(ipcl::HybridMode::IPP);
-    ipcl::CipherText cipher = pk_->encrypt(plain, true);
+    std::vector<BigNumber> powers = ipcl::modExp(bases, exponents, moduli);
     ipcl::setHybridOff();
-    return cipher;
+
+    // x = x_q + q^2 * ((x_p - x_q) * (q^2)^(-1) mod p^2).
+    std::vector<BigNumber> randomizers(size);
+#pragma omp parallel for
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        const BigNumber& x_p = powers[2 * idx];
+        const BigNumber& x_q = powers[2 * idx + 1];
+        BigNumber diff = (x_p + p_square_ - x_q % p_square_) % p_square_;
+        randomizers[idx] = x_q + q_square_ * (diff * q_square_inverse_ % p_square_);
+    }
+    return randomizers;
+}
+
+ipcl::CipherText IpclPaillier::encrypt(const ipcl::PlainText& plain) const {
+    if (!pk_set_) {
+        throw std::logic_error("pk not set.");
+    }
+    if (!sk_set_) {
+        ipcl::setHybridMode(ipcl::HybridMode::IPP);
+        ipcl::CipherText cipher = pk_->encrypt(plain, true);
+        ipcl::setHybridOff();
+        return cipher;
+    }
+    std::size_t size = plain.getSize();
+    std::vector<BigNumber> randomizers = get_crt_randomizers(size);
+    const BigNumber& n = *(pk_->getN());
+    const BigNumber& n_square = *(pk_->getNSQ());
+    std::vector<BigNumber> cipher(size);
+#pragma omp parallel for
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        BigNumber n_m_plus_one = n * (plain.getElement(idx) % n) + BigNumber::One();
+        cipher[idx] = n_m_plus_one * randomizers[idx] % n_square;
+    }
+    return ipcl::CipherText(*pk_, cipher);
 }
 
 ipcl::PlainText IpclPaillier::decrypt(const ipcl::CipherText& cipher) const {
@@ -186,30 +258,10 @@ std::size_t IpclPaillier::privkey_bytes(std::size_t key_bits) {
     return n_bytes * 2;
 }
 
-ByteVector IpclPaillier::encode(const BigNumber& bn, bool is_n_square) const {
-    ByteVector out;
-    ipcl_bn_2_bytes(bn, out);
-    padding_zero(out, is_n_square);
-    return out;
-}
-
-BigNumber IpclPaillier::decode(const ByteVector& in) {
-    BigNumber out;
-    ipcl_bytes_2_bn(in, out);
-    return out;
-}
-
 std::size_t IpclPaillier::get_bytes_len(bool is_n_square) const {
     std::size_t bytes_len = (n_len_ + 7) / 8;
     return bytes_len * (1 + is_n_square);
 }
 
-void IpclPaillier::padding_zero(ByteVector& in, bool is_n_square) const {
-    std::size_t zero_num = get_bytes_len(is_n_square) - in.size();
-    for (std::size_t idx = 0; idx < zero_num; ++idx) {
-        in.push_back(Byte('\x00'));
-    }
-}
-
 }  // namespace dpca_psi
 }  // namespace privacy_go
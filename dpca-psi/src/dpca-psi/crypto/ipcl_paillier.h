@@ -16,6 +16,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "ipcl/bignum.h"
 #include "ipcl/ciphertext.hpp"
@@ -25,6 +26,7 @@
 #include "ipcl/pub_key.hpp"
 
 #include "dpca-psi/common/defines.h"
+#include "dpca-psi/crypto/paillier.h"
 
 namespace privacy_go {
 namespace dpca_psi {
@@ -32,7 +34,7 @@ namespace dpca_psi {
 // Wrapper class for Intel Paillier Cryptosystem Library(IPCL).
 // IPCL is certified for ISO compliance.
 // Basic implementation details refers to https://github.com/intel/pailliercryptolib.
-class IpclPaillier {
+class IpclPaillier : public Paillier {
 public:
     IpclPaillier();
 
@@ -42,80 +44,91 @@ class IpclPaillier {
 
     // Generates pk and sk given the bits length of n.
     // More details refer to https://github.com/intel/pailliercryptolib/blob/development/ipcl/keygen.cpp.
-    void keygen(std::size_t n_len, bool enable_djn);
+    void keygen(std::size_t n_len, bool enable_djn) override;
 
     // If DJN optimiztion is enabled, c = (1 + n * m) * (hs) ^ r mod n^2.
     // Otherwise, c = (1 + n * m) * (r ^ n) mod n^2.
+    // If sk is set, the randomizer is computed modulo p^2 and q^2, then recombined by CRT.
     // Returns encrypted cipherText.
-    ipcl::CipherText encrypt(const ipcl::PlainText& plain) const;
+    ipcl::CipherText encrypt(const ipcl::PlainText& plain) const override;
 
     // CRT optimization is used by default.
     // Returns decrypted plaintext.
-    ipcl::PlainText decrypt(const ipcl::CipherText& cipher) const;
+    ipcl::PlainText decrypt(const ipcl::CipherText& cipher) const override;
 
     // Homomorphic addition, cipher0 + cipher1.
-    ipcl::CipherText add(const ipcl::CipherText& cipher0, const ipcl::CipherText& cipher1) const;
+    ipcl::CipherText add(const ipcl::CipherText& cipher0, const ipcl::CipherText& cipher1) const override;
 
     // Homomorphic addition, cipher + plain
-    ipcl::CipherText add(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const;
+    ipcl::CipherText add(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const override;
 
     // Homomorphic multiplication, cipher * plain.
-    ipcl::CipherText mult(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const;
+    ipcl::CipherText mult(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const override;
 
     // If DJN optimiztion is enabled, the public key is (n, hs), otherwise, the public key is (n).
     // Returns serialized pk.
-    ByteVector export_pk() const;
+    ByteVector export_pk() const override;
 
     // Deserializes pk.
-    void import_pk(const ByteVector& in, bool enable_djn);
+    void import_pk(const ByteVector& in, bool enable_djn) override;
 
     // Returns the bytes length of pubkey given the bits length of key(n) .
     static std::size_t pubkey_bytes(std::size_t key_bits, bool enable_djn);
 
     // Returns serialized sk in the form of (n, p, q).
-    ByteVector export_sk() const;
+    ByteVector export_sk() const override;
 
     // Deserializes sk.
-    void import_sk(const ByteVector& in);
+    void import_sk(const ByteVector& in) override;
 
     // Returns the bytes length of privkey given the bits length of key(n).
     static std::size_t privkey_bytes(std::size_t key_bits);
 
-    // Encodes the BigNumber bn into bytes and padding zero if the length of bn is not same with n or n^2.
-    // Returns serialized cipher.
-    ByteVector encode(const BigNumber& bn, bool is_n_square) const;
-
-    // Returns deserialized BigNumber.
-    static BigNumber decode(const ByteVector& in);
-
     // Returns bytes length of n^(1+n_square).
-    std::size_t get_bytes_len(bool is_n_square) const;
+    std::size_t get_bytes_len(bool is_n_square) const override;
 
-    BigNumber n() const {
+    std::size_t get_plaintext_bits() const override {
+        return static_cast<std::size_t>(pk_->getN()->BitSize() - 1);
+    }
+
+    BigNumber n() const override {
         return BigNumber(*(pk_->getN()));
     }
 
-    std::shared_ptr<ipcl::PublicKey> get_pk() const {
+    std::shared_ptr<ipcl::PublicKey> get_pk() const override {
         return pk_;
     }
 
+    std::string scheme_name() const override {
+        return "paillier";
+    }
+
     ~IpclPaillier() {
     }
 
 private:
-    // Padding zero to the end of input bytes.
-    void padding_zero(ByteVector& in, bool is_n_square) const;
-
     // Sets public key. If DJN optimiztion is enabled, will also set hs.
     void set_pk(const ipcl::PublicKey& pk, bool enable_djn);
 
-    // Sets private key.
+    // Sets private key, and the CRT values of p^2 and q^2 for encryption.
     void set_sk(const ipcl::PrivateKey& sk);
 
+    // Returns the randomizers (hs) ^ r or r ^ n mod n^2 of size ciphertexts, computed modulo p^2 and q^2 by the owner
+    // of sk. Every modular exponentiation takes half-length operands.
+    std::vector<BigNumber> get_crt_randomizers(std::size_t size) const;
+
     std::shared_ptr<ipcl::PublicKey> pk_ = nullptr;
 
     std::shared_ptr<ipcl::PrivateKey> sk_ = nullptr;
 
+    // p^2, q^2 and (q^2)^(-1) mod p^2.
+    BigNumber p_square_{};
+    BigNumber q_square_{};
+    BigNumber q_square_inverse_{};
+    // n mod p * (p - 1) and n mod q * (q - 1), i.e. the exponents of r ^ n reduced by the orders of the groups.
+    BigNumber n_mod_phi_p_square_{};
+    BigNumber n_mod_phi_q_square_{};
+
     std::size_t n_len_;
     bool pk_set_;
     bool sk_set_;
@@ -15,16 +15,33 @@
 #pragma once
 
 #include <cstddef>
+#include <cstring>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "ipcl/bignum.h"
+#include "ipcl/utils/common.hpp"
 
 #include "dpca-psi/common/defines.h"
+#include "dpca-psi/common/utils.h"
 
 namespace privacy_go {
 namespace dpca_psi {
 
+// Drop-in replacement of ipcl::getRandomBN() that follows set_random_seed().
+inline BigNumber ipcl_random_bn(int bits) {
+    if (!has_random_seed()) {
+        return ipcl::getRandomBN(bits);
+    }
+    std::vector<std::uint32_t> words((static_cast<std::size_t>(bits) + 31) / 32);
+    read_random_bytes(words.data(), words.size() * sizeof(std::uint32_t));
+    if (bits % 32 != 0) {
+        words.back() &= (std::uint32_t(1) << (bits % 32)) - 1;
+    }
+    return BigNumber(words.data(), static_cast<int>(words.size()));
+}
+
 // Converts BigNumber to bytes.
 inline void ipcl_bn_2_bytes(const BigNumber& in, ByteVector& out) {
     std::size_t length = (in.BitSize() + 7) / 8;
@@ -52,6 +69,37 @@ inline void ipcl_bytes_2_bn(const ByteVector& in, BigNumber& out) {
     out = BigNumber(vec_u32.data(), static_cast<int>(length));
 }
 
+// Writes the magnitude of in as len little-endian bytes at out, padding zero.
+// Reads the words of bn in place instead of exporting them with num2char.
+// Throws std::out_of_range if in does not fit in len bytes.
+inline void ipcl_bn_2_bytes(const BigNumber& in, Byte* out, std::size_t len) {
+    IppsBigNumSGN sign;
+    int bit_size = 0;
+    Ipp32u* data = nullptr;
+    ippsRef_BN(&sign, &bit_size, &data, in);
+    std::size_t bytes = bit_size > 0 ? (static_cast<std::size_t>(bit_size) + 7) / 8 : 0;
+    if (bytes > len) {
+        throw std::out_of_range("BigNumber does not fit in bytes");
+    }
+    if (bytes != 0) {
+        std::memcpy(out, data, bytes);
+    }
+    std::memset(out + bytes, 0, len - bytes);
+}
+
+// Returns the BigNumber of len little-endian bytes at in.
+// words is a buffer that can be reused across calls to avoid allocations.
+inline BigNumber ipcl_bytes_2_bn(const Byte* in, std::size_t len, std::vector<std::uint32_t>& words) {
+    std::size_t length = (len + 3) / 4;
+    words.resize(length);
+    if (length == 0) {
+        return BigNumber::Zero();
+    }
+    words[length - 1] = 0;
+    std::memcpy(words.data(), in, len);
+    return BigNumber(words.data(), static_cast<int>(length));
+}
+
 // Left shift bn bits. bn << bits.
 inline void ipcl_bn_lshift(BigNumber& in, const std::size_t bits) {
     std::size_t length = (bits + 1 + 31) / 32;
@@ -62,16 +110,18 @@ inline void ipcl_bn_lshift(BigNumber& in, const std::size_t bits) {
     in *= shift_bn;
 }
 
-// Converts BigNumber to std::uint64_t.
+// Converts BigNumber to std::uint64_t, i.e. returns in mod 2^64.
+// Reads the low words of bn in place instead of exporting them with num2vec.
 inline std::uint64_t ipcl_bn_2_u64(const BigNumber& in) {
-    std::size_t length = in.DwordSize();
-    if (length == 0) {
+    IppsBigNumSGN sign;
+    int bit_size = 0;
+    Ipp32u* data = nullptr;
+    ippsRef_BN(&sign, &bit_size, &data, in);
+    if (bit_size <= 0 || data == nullptr) {
         return 0;
     }
-    std::vector<std::uint32_t> data;
-    in.num2vec(data);
     std::uint64_t value = data[0];
-    if (length > 1) {
+    if (bit_size > 32) {
         value += static_cast<std::uint64_t>(data[1]) << 32;
     }
     return value;
@@ -79,8 +129,8 @@ inline std::uint64_t ipcl_bn_2_u64(const BigNumber& in) {
 
 // Converts std::uint64_t to BigNumber.
 inline BigNumber ipcl_u64_2_bn(std::uint64_t value) {
-    std::vector<std::uint32_t> vec_u32 = {static_cast<std::uint32_t>(value), static_cast<std::uint32_t>(value >> 32)};
-    return BigNumber(vec_u32.data(), 2);
+    Ipp32u words[2] = {static_cast<Ipp32u>(value), static_cast<Ipp32u>(value >> 32)};
+    return BigNumber(words, 2);
 }
 
 }  // namespace dpca_psi
@@ -0,0 +1,153 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/oblivious_switching_network.h"
+
+#include <stdexcept>
+
+#include "dpca-psi/common/utils.h"
+#include "dpca-psi/crypto/aes.h"
+#include "dpca-psi/crypto/permutation_network.h"
+#include "dpca-psi/crypto/prng.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+ObliviousSwitchingNetwork::ObliviousSwitchingNetwork(std::shared_ptr<IOBase> io) : io_(io), ot_(io) {
+}
+
+const std::uint64_t* ObliviousSwitchingNetwork::expand_pad(
+        const block& seed, std::size_t column_num, std::vector<block>& pad) {
+    pad.resize(column_num);
+    AES aes(seed);
+    aes.ecb_encrypt_counter_mode(0, column_num, pad.data());
+    return reinterpret_cast<const std::uint64_t*>(pad.data());
+}
+
+// Every wire w carries u_w on the permutation holder's side and m_w on the value holder's side, u_w + m_w is the
+// value on w. The value holder picks the input masks and sends u = x - m.
+// For a switch from wires (a, b) to (c0, c1), the permutation holder with bit s needs
+//     s = 0: (m_a - m_c0, m_b - m_c1),
+//     s = 1: (m_b - m_c0, m_a - m_c1).
+// Given the random OT messages (p0, p1), the value holder sets the output masks so that the s = 0 message is p0,
+// and sends p1 subtracted from the s = 1 message.
+void ObliviousSwitchingNetwork::send(const std::vector<std::vector<std::uint64_t>>& values, std::size_t output_size,
+        std::vector<std::vector<std::uint64_t>>& shares) {
+    std::size_t column_num = values.size();
+    std::size_t data_size = values.empty() ? 0 : values[0].size();
+    if (column_num == 0 || output_size > data_size) {
+        throw std::invalid_argument("invalid size of values");
+    }
+    std::size_t network_size = PermutationNetwork::network_size(data_size);
+    std::size_t switch_count = PermutationNetwork::switch_count(data_size);
+
+    std::vector<std::uint64_t> masks(network_size * column_num);
+    PRNG prng(read_block_from_dev_urandom());
+    prng.get<std::uint64_t>(masks.data(), masks.size());
+    std::vector<std::uint64_t> masked_values(network_size * column_num);
+    for (std::size_t item_idx = 0; item_idx < network_size; ++item_idx) {
+        for (std::size_t col_idx = 0; col_idx < column_num; ++col_idx) {
+            std::uint64_t value = (item_idx < data_size) ? values[col_idx][item_idx] : 0;
+            masked_values[item_idx * column_num + col_idx] = value - masks[item_idx * column_num + col_idx];
+        }
+    }
+    io_->send_data(masked_values.data(), masked_values.size() * sizeof(std::uint64_t));
+    masked_values.clear();
+
+    std::vector<block> ot_messages_0;
+    std::vector<block> ot_messages_1;
+    ot_.send_random(switch_count, ot_messages_0, ot_messages_1);
+
+    std::vector<std::uint64_t> corrections(switch_count * 2 * column_num);
+    std::vector<block> pad_0_buffer;
+    std::vector<block> pad_1_buffer;
+    PermutationNetwork::traverse(data_size, [&](std::size_t switch_idx, std::size_t wire_0, std::size_t wire_1) {
+        const std::uint64_t* pad_0 = expand_pad(ot_messages_0[switch_idx], column_num, pad_0_buffer);
+        const std::uint64_t* pad_1 = expand_pad(ot_messages_1[switch_idx], column_num, pad_1_buffer);
+        std::uint64_t* mask_a = masks.data() + wire_0 * column_num;
+        std::uint64_t* mask_b = masks.data() + wire_1 * column_num;
+        std::uint64_t* correction = corrections.data() + switch_idx * 2 * column_num;
+        for (std::size_t col_idx = 0; col_idx < column_num; ++col_idx) {
+            std::uint64_t mask_c0 = mask_a[col_idx] - pad_0[col_idx];
+            std::uint64_t mask_c1 = mask_b[col_idx] - pad_0[column_num + col_idx];
+            correction[col_idx] = mask_b[col_idx] - mask_c0 - pad_1[col_idx];
+            correction[column_num + col_idx] = mask_a[col_idx] - mask_c1 - pad_1[column_num + col_idx];
+            mask_a[col_idx] = mask_c0;
+            mask_b[col_idx] = mask_c1;
+        }
+    });
+    io_->send_data(corrections.data(), corrections.size() * sizeof(std::uint64_t));
+
+    shares.resize(column_num);
+    for (std::size_t col_idx = 0; col_idx < column_num; ++col_idx) {
+        shares[col_idx].resize(output_size);
+        for (std::size_t item_idx = 0; item_idx < output_size; ++item_idx) {
+            shares[col_idx][item_idx] = masks[item_idx * column_num + col_idx];
+        }
+    }
+}
+
+void ObliviousSwitchingNetwork::recv(const std::vector<std::size_t>& permutation, std::size_t column_num,
+        std::size_t output_size, std::vector<std::vector<std::uint64_t>>& shares) {
+    std::size_t data_size = permutation.size();
+    if (column_num == 0 || output_size > data_size) {
+        throw std::invalid_argument("invalid size of permutation");
+    }
+    PermutationNetwork network(permutation);
+    std::size_t network_size = PermutationNetwork::network_size(data_size);
+    std::size_t switch_count = PermutationNetwork::switch_count(data_size);
+
+    std::vector<std::uint64_t> masked_values(network_size * column_num);
+    io_->recv_data(masked_values.data(), masked_values.size() * sizeof(std::uint64_t));
+
+    std::vector<bool> switches = network.get_switches();
+    std::vector<block> ot_messages;
+    ot_.recv_random(switches, ot_messages);
+
+    std::vector<std::uint64_t> corrections(switch_count * 2 * column_num);
+    io_->recv_data(corrections.data(), corrections.size() * sizeof(std::uint64_t));
+
+    std::vector<block> pad_buffer;
+    std::vector<std::uint64_t> wire_0_buffer(column_num);
+    PermutationNetwork::traverse(data_size, [&](std::size_t switch_idx, std::size_t wire_0, std::size_t wire_1) {
+        const std::uint64_t* pad = expand_pad(ot_messages[switch_idx], column_num, pad_buffer);
+        std::uint64_t* value_a = masked_values.data() + wire_0 * column_num;
+        std::uint64_t* value_b = masked_values.data() + wire_1 * column_num;
+        if (switches[switch_idx]) {
+            const std::uint64_t* correction = corrections.data() + switch_idx * 2 * column_num;
+            for (std::size_t col_idx = 0; col_idx < column_num; ++col_idx) {
+                wire_0_buffer[col_idx] = value_a[col_idx];
+                value_a[col_idx] = value_b[col_idx] + correction[col_idx] + pad[col_idx];
+                value_b[col_idx] =
+                        wire_0_buffer[col_idx] + correction[column_num + col_idx] + pad[column_num + col_idx];
+            }
+        } else {
+            for (std::size_t col_idx = 0; col_idx < column_num; ++col_idx) {
+                value_a[col_idx] += pad[col_idx];
+                value_b[col_idx] += pad[column_num + col_idx];
+            }
+        }
+    });
+
+    shares.resize(column_num);
+    for (std::size_t col_idx = 0; col_idx < column_num; ++col_idx) {
+        shares[col_idx].resize(output_size);
+        for (std::size_t item_idx = 0; item_idx < output_size; ++item_idx) {
+            shares[col_idx][item_idx] = masked_values[item_idx * column_num + col_idx];
+        }
+    }
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
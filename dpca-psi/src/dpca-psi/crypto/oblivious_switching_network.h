@@ -0,0 +1,56 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "dpca-psi/crypto/oblivious_transfer.h"
+#include "dpca-psi/network/io_base.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Oblivious switching network: one party holds rows of values, the other holds a permutation. Both get additive
+// shares in Z_{2^64} of the permuted rows, without learning the other's input.
+// The values are masked on every wire of a Benes network. One random OT per switch lets the permutation holder
+// re-mask the two wires along its switch bit, only a correction of the crossed case is sent.
+// Details refer to "On the Power of Secure Two-Party Computation", Mohassel and Sadeghian, EUROCRYPT 2013.
+class ObliviousSwitchingNetwork {
+public:
+    explicit ObliviousSwitchingNetwork(std::shared_ptr<IOBase> io);
+
+    // Acts as the holder of values, where values are columns of the same length.
+    // Stores the shares of the first output_size permuted rows in shares, column by column.
+    void send(const std::vector<std::vector<std::uint64_t>>& values, std::size_t output_size,
+            std::vector<std::vector<std::uint64_t>>& shares);
+
+    // Acts as the holder of permutation, the i-th permuted row is the permutation[i]-th row of values.
+    // Stores the shares of the first output_size permuted rows of column_num columns in shares, column by column.
+    void recv(const std::vector<std::size_t>& permutation, std::size_t column_num, std::size_t output_size,
+            std::vector<std::vector<std::uint64_t>>& shares);
+
+private:
+    // Expands a random OT message into pad, and returns the 2 * column_num words that mask the two wires of a switch.
+    static const std::uint64_t* expand_pad(const block& seed, std::size_t column_num, std::vector<block>& pad);
+
+    std::shared_ptr<IOBase> io_ = nullptr;
+
+    ObliviousTransfer ot_;
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
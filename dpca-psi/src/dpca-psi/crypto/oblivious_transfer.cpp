@@ -0,0 +1,287 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/oblivious_transfer.h"
+
+#include <emmintrin.h>
+#include <openssl/ec.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "dpca-psi/common/utils.h"
+#include "dpca-psi/crypto/prng.h"
+#include "dpca-psi/crypto/smart_pointer.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+namespace {
+
+// Digits of pi, any public constant works as the key of the fixed-key AES hash.
+const block kFixedAesKey = _mm_set_epi64x(0x243f6a8885a308d3, 0x13198a2e03707344);
+
+const std::size_t kBlockBits = sizeof(block) * 8;
+
+inline void throw_openssl_error() {
+    throw std::runtime_error("openssl error: " + std::to_string(ERR_get_error()));
+}
+
+void point_to_bytes(const EC_GROUP* group, const EC_POINT* point, BN_CTX* ctx, unsigned char* out) {
+    if (EC_POINT_point2oct(group, point, POINT_CONVERSION_COMPRESSED, out, kEccPointLen, ctx) != kEccPointLen) {
+        throw_openssl_error();
+    }
+}
+
+ECPointPtr bytes_to_point(const EC_GROUP* group, const unsigned char* in, BN_CTX* ctx) {
+    ECPointPtr point(EC_POINT_new(group));
+    if (point == nullptr || EC_POINT_oct2point(group, point.get(), in, kEccPointLen, ctx) != 1) {
+        throw_openssl_error();
+    }
+    return point;
+}
+
+// Derives the i-th base OT message from a shared point by SHA3-256.
+block hash_point(const EC_GROUP* group, const EC_POINT* point, std::size_t i, BN_CTX* ctx) {
+    unsigned char point_bytes[kEccPointLen];
+    point_to_bytes(group, point, ctx, point_bytes);
+    std::uint64_t index = i;
+    EvpMdCtxPtr evp_md_ctx(EVP_MD_CTX_new());
+    std::vector<unsigned char> md(EVP_MAX_MD_SIZE);
+    unsigned int len = 0;
+    if (evp_md_ctx == nullptr || EVP_DigestInit_ex(evp_md_ctx.get(), EVP_sha3_256(), nullptr) != 1 ||
+            EVP_DigestUpdate(evp_md_ctx.get(), &index, sizeof(index)) != 1 ||
+            EVP_DigestUpdate(evp_md_ctx.get(), point_bytes, kEccPointLen) != 1 ||
+            EVP_DigestFinal_ex(evp_md_ctx.get(), md.data(), &len) != 1) {
+        throw_openssl_error();
+    }
+    block out;
+    std::memcpy(&out, md.data(), sizeof(block));
+    return out;
+}
+
+BignumPtr random_scalar(const EC_GROUP* group) {
+    BignumPtr scalar(BN_new());
+    if (scalar == nullptr || bn_rand_range(scalar.get(), EC_GROUP_get0_order(group)) != 1) {
+        throw_openssl_error();
+    }
+    return scalar;
+}
+
+// Bit j of a block is bit (j % 8) of its (j / 8)-th byte.
+// Transposes the 128 x 128 bit matrix in, whose i-th row is in[i], into out.
+// Every _mm_movemask_epi8 gathers one column bit of 16 rows at once.
+void transpose_128(const block* in, block* out) {
+    const std::uint8_t* in_u8 = reinterpret_cast<const std::uint8_t*>(in);
+    std::uint8_t* out_u8 = reinterpret_cast<std::uint8_t*>(out);
+    for (std::size_t row = 0; row < kBlockBits; row += 16) {
+        for (std::size_t col = 0; col < kBlockBits; col += 8) {
+            std::uint8_t bytes[16];
+            for (std::size_t k = 0; k < 16; ++k) {
+                bytes[k] = in_u8[(row + k) * sizeof(block) + col / 8];
+            }
+            block data = _mm_loadu_si128(reinterpret_cast<const block*>(bytes));
+            for (std::size_t k = 8; k > 0; --k) {
+                std::uint16_t bits = static_cast<std::uint16_t>(_mm_movemask_epi8(data));
+                std::memcpy(out_u8 + (col + k - 1) * sizeof(block) + row / 8, &bits, sizeof(bits));
+                data = _mm_slli_epi64(data, 1);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+const std::size_t ObliviousTransfer::kBaseOtNum;
+
+ObliviousTransfer::ObliviousTransfer(std::shared_ptr<IOBase> io) : io_(io) {
+    fixed_key_aes_.set_key(kFixedAesKey);
+}
+
+block ObliviousTransfer::hash(const block& row, std::size_t i) const {
+    block x = _mm_xor_si128(row, _mm_set_epi64x(0, static_cast<std::int64_t>(i)));
+    return _mm_xor_si128(fixed_key_aes_.ecb_encrypt_block(x), x);
+}
+
+// The sender picks a, sends A = aG. The receiver with choice c sends B = bG + cA and keeps H(bA).
+// The sender computes H(aB) and H(a(B - A)), one of which equals H(bA).
+void ObliviousTransfer::base_send(std::vector<block>& messages_0, std::vector<block>& messages_1) {
+    ECGroupPtr group(EC_GROUP_new_by_curve_name(static_cast<int>(kCurveID)));
+    BnCtxPtr ctx(BN_CTX_new());
+    if (group == nullptr || ctx == nullptr) {
+        throw_openssl_error();
+    }
+    BignumPtr a = random_scalar(group.get());
+    ECPointPtr point_a(EC_POINT_new(group.get()));
+    ECPointPtr neg_point_aa(EC_POINT_new(group.get()));
+    if (point_a == nullptr || neg_point_aa == nullptr ||
+            EC_POINT_mul(group.get(), point_a.get(), a.get(), nullptr, nullptr, ctx.get()) != 1 ||
+            EC_POINT_mul(group.get(), neg_point_aa.get(), nullptr, point_a.get(), a.get(), ctx.get()) != 1 ||
+            EC_POINT_invert(group.get(), neg_point_aa.get(), ctx.get()) != 1) {
+        throw_openssl_error();
+    }
+    std::vector<unsigned char> point_bytes(kEccPointLen);
+    point_to_bytes(group.get(), point_a.get(), ctx.get(), point_bytes.data());
+    io_->send_data(point_bytes.data(), kEccPointLen);
+
+    point_bytes.resize(kBaseOtNum * kEccPointLen);
+    io_->recv_data(point_bytes.data(), point_bytes.size());
+    messages_0.resize(kBaseOtNum);
+    messages_1.resize(kBaseOtNum);
+    ECPointPtr shared(EC_POINT_new(group.get()));
+    if (shared == nullptr) {
+        throw_openssl_error();
+    }
+    for (std::size_t i = 0; i < kBaseOtNum; ++i) {
+        ECPointPtr point_b = bytes_to_point(group.get(), point_bytes.data() + i * kEccPointLen, ctx.get());
+        if (EC_POINT_mul(group.get(), shared.get(), nullptr, point_b.get(), a.get(), ctx.get()) != 1) {
+            throw_openssl_error();
+        }
+        messages_0[i] = hash_point(group.get(), shared.get(), i, ctx.get());
+        if (EC_POINT_add(group.get(), shared.get(), shared.get(), neg_point_aa.get(), ctx.get()) != 1) {
+            throw_openssl_error();
+        }
+        messages_1[i] = hash_point(group.get(), shared.get(), i, ctx.get());
+    }
+}
+
+void ObliviousTransfer::base_recv(const std::vector<bool>& choices, std::vector<block>& messages) {
+    ECGroupPtr group(EC_GROUP_new_by_curve_name(static_cast<int>(kCurveID)));
+    BnCtxPtr ctx(BN_CTX_new());
+    if (group == nullptr || ctx == nullptr) {
+        throw_openssl_error();
+    }
+    std::vector<unsigned char> point_bytes(kEccPointLen);
+    io_->recv_data(point_bytes.data(), kEccPointLen);
+    ECPointPtr point_a = bytes_to_point(group.get(), point_bytes.data(), ctx.get());
+
+    point_bytes.resize(kBaseOtNum * kEccPointLen);
+    messages.resize(kBaseOtNum);
+    ECPointPtr point_b(EC_POINT_new(group.get()));
+    ECPointPtr shared(EC_POINT_new(group.get()));
+    if (point_b == nullptr || shared == nullptr) {
+        throw_openssl_error();
+    }
+    for (std::size_t i = 0; i < kBaseOtNum; ++i) {
+        BignumPtr b = random_scalar(group.get());
+        if (EC_POINT_mul(group.get(), point_b.get(), b.get(), nullptr, nullptr, ctx.get()) != 1 ||
+                EC_POINT_mul(group.get(), shared.get(), nullptr, point_a.get(), b.get(), ctx.get()) != 1) {
+            throw_openssl_error();
+        }
+        if (choices[i] && EC_POINT_add(group.get(), point_b.get(), point_b.get(), point_a.get(), ctx.get()) != 1) {
+            throw_openssl_error();
+        }
+        point_to_bytes(group.get(), point_b.get(), ctx.get(), point_bytes.data() + i * kEccPointLen);
+        messages[i] = hash_point(group.get(), shared.get(), i, ctx.get());
+    }
+    io_->send_data(point_bytes.data(), point_bytes.size());
+}
+
+// The OT receiver with choices r acts as the base OT sender of seeds (k0_j, k1_j), and sends the columns
+// u_j = G(k0_j) ^ G(k1_j) ^ r. The OT sender with random bits s receives k_{s_j} and computes the columns
+// q_j = G(k_{s_j}) ^ s_j * u_j = t_j ^ s_j * r, where t_j = G(k0_j). Hence the i-th rows satisfy q_i = t_i ^ r_i * s.
+// The OT sender outputs H(q_i) and H(q_i ^ s), the OT receiver outputs H(t_i).
+void ObliviousTransfer::send_random(
+        std::size_t ot_num, std::vector<block>& messages_0, std::vector<block>& messages_1) {
+    std::size_t block_num = (ot_num + kBlockBits - 1) / kBlockBits;
+
+    PRNG prng(read_block_from_dev_urandom());
+    std::vector<bool> base_choices(kBaseOtNum);
+    block delta = prng.get<block>();
+    const std::uint8_t* delta_u8 = reinterpret_cast<const std::uint8_t*>(&delta);
+    for (std::size_t j = 0; j < kBaseOtNum; ++j) {
+        base_choices[j] = (delta_u8[j / 8] >> (j % 8)) & 1;
+    }
+    std::vector<block> base_messages;
+    base_recv(base_choices, base_messages);
+
+    std::vector<block> columns(kBaseOtNum * block_num);
+    io_->recv_block(columns.data(), columns.size());
+    std::vector<block> expanded(block_num);
+    for (std::size_t j = 0; j < kBaseOtNum; ++j) {
+        PRNG column_prng(base_messages[j]);
+        column_prng.get<block>(expanded.data(), block_num);
+        block* column = columns.data() + j * block_num;
+        for (std::size_t b = 0; b < block_num; ++b) {
+            column[b] = base_choices[j] ? _mm_xor_si128(column[b], expanded[b]) : expanded[b];
+        }
+    }
+
+    messages_0.resize(ot_num);
+    messages_1.resize(ot_num);
+    std::vector<block> matrix_in(kBaseOtNum);
+    std::vector<block> matrix_out(kBlockBits);
+    for (std::size_t b = 0; b < block_num; ++b) {
+        for (std::size_t j = 0; j < kBaseOtNum; ++j) {
+            matrix_in[j] = columns[j * block_num + b];
+        }
+        transpose_128(matrix_in.data(), matrix_out.data());
+        for (std::size_t k = 0; k < kBlockBits && b * kBlockBits + k < ot_num; ++k) {
+            std::size_t i = b * kBlockBits + k;
+            messages_0[i] = hash(matrix_out[k], i);
+            messages_1[i] = hash(_mm_xor_si128(matrix_out[k], delta), i);
+        }
+    }
+}
+
+void ObliviousTransfer::recv_random(const std::vector<bool>& choices, std::vector<block>& messages) {
+    std::size_t ot_num = choices.size();
+    std::size_t block_num = (ot_num + kBlockBits - 1) / kBlockBits;
+
+    std::vector<block> packed_choices(block_num, kZeroBlock);
+    std::uint8_t* packed_choices_u8 = reinterpret_cast<std::uint8_t*>(packed_choices.data());
+    for (std::size_t i = 0; i < ot_num; ++i) {
+        packed_choices_u8[i / 8] |= static_cast<std::uint8_t>(choices[i] << (i % 8));
+    }
+
+    std::vector<block> base_messages_0;
+    std::vector<block> base_messages_1;
+    base_send(base_messages_0, base_messages_1);
+
+    std::vector<block> t_columns(kBaseOtNum * block_num);
+    std::vector<block> u_columns(kBaseOtNum * block_num);
+    for (std::size_t j = 0; j < kBaseOtNum; ++j) {
+        block* t_column = t_columns.data() + j * block_num;
+        block* u_column = u_columns.data() + j * block_num;
+        PRNG prng_0(base_messages_0[j]);
+        PRNG prng_1(base_messages_1[j]);
+        prng_0.get<block>(t_column, block_num);
+        prng_1.get<block>(u_column, block_num);
+        for (std::size_t b = 0; b < block_num; ++b) {
+            u_column[b] = _mm_xor_si128(_mm_xor_si128(u_column[b], t_column[b]), packed_choices[b]);
+        }
+    }
+    io_->send_block(u_columns.data(), u_columns.size());
+
+    messages.resize(ot_num);
+    std::vector<block> matrix_in(kBaseOtNum);
+    std::vector<block> matrix_out(kBlockBits);
+    for (std::size_t b = 0; b < block_num; ++b) {
+        for (std::size_t j = 0; j < kBaseOtNum; ++j) {
+            matrix_in[j] = t_columns[j * block_num + b];
+        }
+        transpose_128(matrix_in.data(), matrix_out.data());
+        for (std::size_t k = 0; k < kBlockBits && b * kBlockBits + k < ot_num; ++k) {
+            std::size_t i = b * kBlockBits + k;
+            messages[i] = hash(matrix_out[k], i);
+        }
+    }
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,61 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/crypto/aes.h"
+#include "dpca-psi/network/io_base.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Random oblivious transfers of 128-bit messages, secure against semi-honest adversaries.
+// kBaseOtNum base OTs follow "The Simplest Protocol for Oblivious Transfer", Chou and Orlandi, LATINCRYPT 2015, on
+// the curve prime256v1. They are extended by "Extending Oblivious Transfers Efficiently", Ishai, Kilian, Nissim and
+// Petrank, CRYPTO 2003, with a fixed-key AES hash.
+class ObliviousTransfer {
+public:
+    explicit ObliviousTransfer(std::shared_ptr<IOBase> io);
+
+    // Acts as the sender of ot_num random OTs.
+    // Stores the two random messages of the i-th OT in messages_0[i] and messages_1[i].
+    void send_random(std::size_t ot_num, std::vector<block>& messages_0, std::vector<block>& messages_1);
+
+    // Acts as the receiver of choices.size() random OTs.
+    // Stores the message selected by choices[i] in messages[i].
+    void recv_random(const std::vector<bool>& choices, std::vector<block>& messages);
+
+    static const std::size_t kBaseOtNum = 128;
+
+private:
+    // Acts as the sender of kBaseOtNum base OTs, which are random OTs.
+    void base_send(std::vector<block>& messages_0, std::vector<block>& messages_1);
+
+    // Acts as the receiver of kBaseOtNum base OTs.
+    void base_recv(const std::vector<bool>& choices, std::vector<block>& messages);
+
+    // Returns the correlation robust hash of the i-th row, AES(x) ^ x where x = row ^ i.
+    block hash(const block& row, std::size_t i) const;
+
+    std::shared_ptr<IOBase> io_ = nullptr;
+
+    AES fixed_key_aes_{};
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
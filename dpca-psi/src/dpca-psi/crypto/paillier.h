@@ -0,0 +1,133 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ipcl/bignum.h"
+#include "ipcl/ciphertext.hpp"
+#include "ipcl/plaintext.hpp"
+#include "ipcl/pub_key.hpp"
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/crypto/ipcl_utils.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Interface of the additively homomorphic encryption schemes of the Paillier family.
+// Plaintexts are in Z_{n^s} and ciphertexts are in Z_{n^(s+1)}, s = 1 is the Paillier cryptosystem.
+// Batches of plaintexts and ciphertexts are carried in ipcl::PlainText and ipcl::CipherText. Ciphertexts must only be
+// operated through this interface, since the operators of ipcl::CipherText assume s = 1.
+class Paillier {
+public:
+    virtual ~Paillier() = default;
+
+    // Generates pk and sk given the bits length of n.
+    virtual void keygen(std::size_t n_len, bool enable_djn) = 0;
+
+    // Returns encrypted cipherText.
+    virtual ipcl::CipherText encrypt(const ipcl::PlainText& plain) const = 0;
+
+    // Returns decrypted plaintext.
+    virtual ipcl::PlainText decrypt(const ipcl::CipherText& cipher) const = 0;
+
+    // Homomorphic addition, cipher0 + cipher1.
+    virtual ipcl::CipherText add(const ipcl::CipherText& cipher0, const ipcl::CipherText& cipher1) const = 0;
+
+    // Homomorphic addition, cipher + plain
+    virtual ipcl::CipherText add(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const = 0;
+
+    // Homomorphic multiplication, cipher * plain.
+    virtual ipcl::CipherText mult(const ipcl::CipherText& cipher, const ipcl::PlainText& plain) const = 0;
+
+    // Returns serialized pk.
+    virtual ByteVector export_pk() const = 0;
+
+    // Deserializes pk.
+    virtual void import_pk(const ByteVector& in, bool enable_djn) = 0;
+
+    // Returns serialized sk.
+    virtual ByteVector export_sk() const = 0;
+
+    // Deserializes sk.
+    virtual void import_sk(const ByteVector& in) = 0;
+
+    // Returns bytes length of the plaintext modulus n^s, or of the ciphertext modulus n^(s+1) if is_n_square is true.
+    virtual std::size_t get_bytes_len(bool is_n_square) const = 0;
+
+    // Returns the bits length of the values that always fit in a plaintext, i.e. floor(log2(n^s)).
+    virtual std::size_t get_plaintext_bits() const = 0;
+
+    virtual BigNumber n() const = 0;
+
+    // Returns the IPCL public key of n, which is attached to the batches of ciphertexts.
+    virtual std::shared_ptr<ipcl::PublicKey> get_pk() const = 0;
+
+    // Returns the name of the scheme and its parameters, e.g. "paillier".
+    virtual std::string scheme_name() const = 0;
+
+    // Encodes the BigNumber bn into bytes and padding zero if the length of bn is not same with get_bytes_len().
+    // Returns serialized cipher.
+    ByteVector encode(const BigNumber& bn, bool is_n_square) const {
+        ByteVector out;
+        ipcl_bn_2_bytes(bn, out);
+        padding_zero(out, is_n_square);
+        return out;
+    }
+
+    // Returns deserialized BigNumber.
+    static BigNumber decode(const ByteVector& in) {
+        BigNumber out;
+        ipcl_bytes_2_bn(in, out);
+        return out;
+    }
+
+    // Serializes every ciphertext of cipher into get_bytes_len(true) bytes at out, one after another.
+    // out must hold cipher.getSize() * get_bytes_len(true) bytes.
+    void encode(const ipcl::CipherText& cipher, Byte* out) const {
+        std::size_t bytes_len = get_bytes_len(true);
+        std::size_t size = cipher.getSize();
+        for (std::size_t idx = 0; idx < size; ++idx) {
+            ipcl_bn_2_bytes(cipher.getElement(idx), out + idx * bytes_len, bytes_len);
+        }
+    }
+
+    // Returns the batch of count ciphertexts serialized by encode() at in.
+    ipcl::CipherText decode(const Byte* in, std::size_t count) const {
+        std::size_t bytes_len = get_bytes_len(true);
+        std::vector<std::uint32_t> words;
+        std::vector<BigNumber> bns;
+        bns.reserve(count);
+        for (std::size_t idx = 0; idx < count; ++idx) {
+            bns.emplace_back(ipcl_bytes_2_bn(in + idx * bytes_len, bytes_len, words));
+        }
+        return ipcl::CipherText(*get_pk(), bns);
+    }
+
+protected:
+    // Padding zero to the end of input bytes.
+    void padding_zero(ByteVector& in, bool is_n_square) const {
+        std::size_t bytes_len = get_bytes_len(is_n_square);
+        if (in.size() < bytes_len) {
+            in.resize(bytes_len, Byte('\x00'));
+        }
+    }
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
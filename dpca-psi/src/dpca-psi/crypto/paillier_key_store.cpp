@@ -0,0 +1,212 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/paillier_key_store.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include "openssl/evp.h"
+
+#include "dpca-psi/common/utils.h"
+#include "dpca-psi/crypto/smart_pointer.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+namespace {
+
+std::uint64_t now_in_seconds() {
+    return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+                    .count());
+}
+
+void append_value(ByteVector& out, std::uint64_t value) {
+    const auto* bytes = reinterpret_cast<const Byte*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+void append_bytes(ByteVector& out, const ByteVector& data) {
+    append_value(out, data.size());
+    out.insert(out.end(), data.begin(), data.end());
+}
+
+bool read_bytes(std::ifstream& in, ByteVector& data) {
+    // no key of a supported setting is anywhere near this size.
+    const std::uint64_t max_len = 1 << 16;
+    std::uint64_t len = 0;
+    in.read(reinterpret_cast<char*>(&len), sizeof(len));
+    if (!in || len == 0 || len > max_len) {
+        return false;
+    }
+    data.resize(len);
+    in.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(len));
+    return static_cast<bool>(in);
+}
+
+// Writes nbyte bytes of data to fd. Returns false on errors.
+bool write_all(int fd, const void* data, std::size_t nbyte) {
+    const char* bytes = reinterpret_cast<const char*>(data);
+    while (nbyte > 0) {
+        ssize_t res = ::write(fd, bytes, nbyte);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        bytes += res;
+        nbyte -= static_cast<std::size_t>(res);
+    }
+    return true;
+}
+
+// Writes to a temporary file first, so that a reader never observes a partially written key. As the checkpoints, see
+// CheckpointStore::save(), the file is only readable by its owner and is synced before the rename.
+void write_file_atomically(const std::string& path, const ByteVector& data) {
+    std::string temp_path = path + ".tmp";
+    // a temporary file left by a crash may have other permissions, which O_CREAT would keep.
+    std::remove(temp_path.c_str());
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open key store file " + temp_path);
+    }
+    bool written = write_all(fd, data.data(), data.size()) && fsync(fd) == 0;
+    if (close(fd) != 0 || !written) {
+        throw std::runtime_error("failed to write key store file " + temp_path);
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("failed to replace key store file " + path);
+    }
+}
+
+}  // namespace
+
+PaillierKeyStore::PaillierKeyStore(const std::string& directory, std::uint64_t key_lifetime)
+        : directory_(directory), key_lifetime_(key_lifetime) {
+}
+
+bool PaillierKeyStore::load(std::size_t n_len, bool enable_djn, Paillier& paillier) const {
+    if (!enabled()) {
+        return false;
+    }
+    std::ifstream in(own_key_path(paillier.scheme_name(), n_len, enable_djn), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::uint64_t created_at = 0;
+    in.read(reinterpret_cast<char*>(&created_at), sizeof(created_at));
+    ByteVector sk;
+    ByteVector pk;
+    bool valid = static_cast<bool>(in) && read_bytes(in, sk) && read_bytes(in, pk);
+    bool expired = key_lifetime_ != 0 && now_in_seconds() - created_at >= key_lifetime_;
+    if (!valid || expired) {
+        return false;
+    }
+    try {
+        paillier.import_sk(sk);
+        paillier.import_pk(pk, enable_djn);
+    } catch (const std::logic_error&) {
+        return false;
+    }
+    return true;
+}
+
+bool PaillierKeyStore::load_or_generate(std::size_t n_len, bool enable_djn, Paillier& paillier) const {
+    if (!enabled()) {
+        paillier.keygen(n_len, enable_djn);
+        return false;
+    }
+    if (load(n_len, enable_djn, paillier)) {
+        return true;
+    }
+
+    // rotates the missing, expired or corrupted key pair.
+    paillier.keygen(n_len, enable_djn);
+    ByteVector data;
+    append_value(data, now_in_seconds());
+    append_bytes(data, paillier.export_sk());
+    append_bytes(data, paillier.export_pk());
+    write_file_atomically(own_key_path(paillier.scheme_name(), n_len, enable_djn), data);
+    return false;
+}
+
+bool PaillierKeyStore::load_peer_pk(const ByteVector& fingerprint, bool enable_djn, Paillier& paillier) const {
+    if (!enabled()) {
+        return false;
+    }
+    std::ifstream in(peer_pk_path(fingerprint), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    ByteVector pk;
+    for (auto it = std::istreambuf_iterator<char>(in); it != std::istreambuf_iterator<char>(); ++it) {
+        pk.push_back(Byte(*it));
+    }
+    // guards against a corrupted or mismatched cache entry.
+    if (PaillierKeyStore::fingerprint(pk, enable_djn) != fingerprint) {
+        return false;
+    }
+    paillier.import_pk(pk, enable_djn);
+    return true;
+}
+
+void PaillierKeyStore::save_peer_pk(const ByteVector& pk, bool enable_djn) const {
+    if (!enabled()) {
+        return;
+    }
+    write_file_atomically(peer_pk_path(fingerprint(pk, enable_djn)), pk);
+}
+
+ByteVector PaillierKeyStore::fingerprint(const ByteVector& pk, bool enable_djn) {
+    std::array<std::uint8_t, kHashDigestLen> md;
+    EvpMdCtxPtr evp_md_ctx(EVP_MD_CTX_new());
+    if (evp_md_ctx == nullptr || EVP_DigestInit_ex(evp_md_ctx.get(), EVP_sha3_256(), nullptr) != 1) {
+        throw std::runtime_error("failed to initialize sha3-256");
+    }
+    std::uint8_t djn_flag = enable_djn ? 1 : 0;
+    unsigned int len = 0;
+    if (EVP_DigestUpdate(evp_md_ctx.get(), &djn_flag, sizeof(djn_flag)) != 1 ||
+            EVP_DigestUpdate(evp_md_ctx.get(), pk.data(), pk.size()) != 1 ||
+            EVP_DigestFinal_ex(evp_md_ctx.get(), md.data(), &len) != 1) {
+        throw std::runtime_error("failed to compute sha3-256");
+    }
+    ByteVector out(kHashDigestLen);
+    for (std::size_t idx = 0; idx < kHashDigestLen; ++idx) {
+        out[idx] = Byte(md[idx]);
+    }
+    return out;
+}
+
+std::string PaillierKeyStore::own_key_path(const std::string& scheme_name, std::size_t n_len, bool enable_djn) const {
+    return directory_ + "/" + scheme_name + "_" + std::to_string(n_len) + (enable_djn ? "_djn" : "") + ".key";
+}
+
+std::string PaillierKeyStore::peer_pk_path(const ByteVector& fingerprint) const {
+    std::string fingerprint_str(reinterpret_cast<const char*>(fingerprint.data()), fingerprint.size());
+    return directory_ + "/peer_" + string_2_hex(fingerprint_str) + ".pk";
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,71 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/crypto/paillier.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Local-file store of Paillier keys, so that short jobs skip key generation.
+//   1. The own key pair of every (scheme, n_len, enable_djn) setting is saved with its creation time and is rotated,
+//      i.e. regenerated and replaced, once it is older than key_lifetime seconds.
+//   2. Public keys of peers, including the precomputed DJN value hs, are cached under their fingerprints.
+// An empty directory disables the store: keys are always generated and nothing is cached.
+class PaillierKeyStore {
+public:
+    PaillierKeyStore() = default;
+
+    // directory must exist. A key_lifetime of 0 means keys never expire.
+    PaillierKeyStore(const std::string& directory, std::uint64_t key_lifetime);
+
+    // Loads the own key pair into paillier if it is stored and not expired.
+    // Returns false otherwise, and then paillier may have been modified.
+    bool load(std::size_t n_len, bool enable_djn, Paillier& paillier) const;
+
+    // Loads the own key pair into paillier if it is stored and not expired, see load().
+    // Otherwise generates a new key pair and saves it in place of the stored one.
+    // Returns true if the key pair is loaded from the store.
+    bool load_or_generate(std::size_t n_len, bool enable_djn, Paillier& paillier) const;
+
+    // Loads the peer's public key with the given fingerprint into paillier.
+    // Returns false if it is not cached.
+    bool load_peer_pk(const ByteVector& fingerprint, bool enable_djn, Paillier& paillier) const;
+
+    // Caches the peer's public key under its fingerprint.
+    void save_peer_pk(const ByteVector& pk, bool enable_djn) const;
+
+    // Returns SHA3-256 of the serialized public key and the DJN flag.
+    static ByteVector fingerprint(const ByteVector& pk, bool enable_djn);
+
+    bool enabled() const {
+        return !directory_.empty();
+    }
+
+private:
+    std::string own_key_path(const std::string& scheme_name, std::size_t n_len, bool enable_djn) const;
+
+    std::string peer_pk_path(const ByteVector& fingerprint) const;
+
+    std::string directory_{};
+    std::uint64_t key_lifetime_ = 0;
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
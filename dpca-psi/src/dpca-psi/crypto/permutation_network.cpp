@@ -0,0 +1,103 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/permutation_network.h"
+
+#include <stdexcept>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+PermutationNetwork::PermutationNetwork(const std::vector<std::size_t>& permutation) : size_(permutation.size()) {
+    std::size_t n = network_size(size_);
+    std::vector<std::size_t> padded_permutation(n);
+    std::vector<bool> used(n, false);
+    for (std::size_t i = 0; i < n; ++i) {
+        padded_permutation[i] = (i < size_) ? permutation[i] : i;
+        if (padded_permutation[i] >= n || used[padded_permutation[i]]) {
+            throw std::invalid_argument("input is not a permutation");
+        }
+        used[padded_permutation[i]] = true;
+    }
+    switches_.resize(switch_count(size_));
+    std::size_t switch_idx = 0;
+    route(padded_permutation, switch_idx);
+}
+
+std::size_t PermutationNetwork::network_size(std::size_t size) {
+    std::size_t n = 2;
+    while (n < size) {
+        n <<= 1;
+    }
+    return n;
+}
+
+std::size_t PermutationNetwork::switch_count(std::size_t size) {
+    std::size_t n = network_size(size);
+    std::size_t layers = 1;
+    for (std::size_t i = 2; i < n; i <<= 1) {
+        layers += 2;
+    }
+    return layers * n / 2;
+}
+
+// Looping algorithm: the two outputs of an output switch must come from different subnetworks, so do the two inputs
+// of an input switch. Starting from an unrouted output switch, assigns its even output to the upper subnetwork and
+// follows the constraints alternately through input and output switches until the loop closes.
+void PermutationNetwork::route(const std::vector<std::size_t>& permutation, std::size_t& switch_idx) {
+    std::size_t n = permutation.size();
+    std::size_t half = n / 2;
+    if (half == 1) {
+        switches_[switch_idx++] = (permutation[0] == 1);
+        return;
+    }
+
+    std::vector<std::size_t> inverse(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        inverse[permutation[i]] = i;
+    }
+
+    // is_lower[i] tells whether the output i is routed through the lower subnetwork.
+    const int kUnrouted = -1;
+    std::vector<int> is_lower(n, kUnrouted);
+    for (std::size_t start = 0; start < n; start += 2) {
+        std::size_t output_idx = start;
+        while (is_lower[output_idx] == kUnrouted) {
+            is_lower[output_idx] = 0;
+            is_lower[output_idx ^ 1] = 1;
+            // the partner of the lower input must go through the upper subnetwork.
+            output_idx = inverse[permutation[output_idx ^ 1] ^ 1];
+        }
+    }
+
+    std::vector<std::size_t> upper_permutation(half);
+    std::vector<std::size_t> lower_permutation(half);
+    std::size_t output_layer_idx = switch_idx + half + 2 * switch_count(half);
+    for (std::size_t i = 0; i < half; ++i) {
+        // the input switch crosses if its even input goes to the lower subnetwork.
+        switches_[switch_idx + i] = (is_lower[inverse[2 * i]] == 1);
+        // the output switch crosses if its even output comes from the lower subnetwork.
+        switches_[output_layer_idx + i] = (is_lower[2 * i] == 1);
+        std::size_t upper_output = is_lower[2 * i] ? 2 * i + 1 : 2 * i;
+        upper_permutation[i] = permutation[upper_output] / 2;
+        lower_permutation[i] = permutation[upper_output ^ 1] / 2;
+    }
+    switch_idx += half;
+    route(upper_permutation, switch_idx);
+    route(lower_permutation, switch_idx);
+    switch_idx += half;
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,104 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Benes permutation network over n = 2^d wires, made of 2d - 1 layers of n / 2 switches.
+// A switch takes two wires and either passes them straight (false) or crosses them (true).
+// Switches are programmed by the looping algorithm so that the network outputs out[i] = in[permutation[i]].
+// Details refer to "Optimal Rearrangeable Multistage Connecting Networks", Waksman, 1968.
+class PermutationNetwork {
+public:
+    // Programs the switches for permutation, which is padded with identity to the network size.
+    explicit PermutationNetwork(const std::vector<std::size_t>& permutation);
+
+    // Returns the number of wires of the network that can route size inputs, i.e. the next power of two, at least 2.
+    static std::size_t network_size(std::size_t size);
+
+    // Returns the number of switches of the network that can route size inputs.
+    static std::size_t switch_count(std::size_t size);
+
+    // Visits every switch of the network that can route size inputs in evaluation order.
+    // Calls func(switch_idx, wire_0, wire_1), where the switch writes its two outputs back in place to wire_0 and
+    // wire_1. Once all switches are visited, wire i holds the i-th output.
+    template <typename SwitchFunc>
+    static void traverse(std::size_t size, SwitchFunc&& func) {
+        std::size_t n = network_size(size);
+        std::vector<std::size_t> wires(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            wires[i] = i;
+        }
+        std::size_t switch_idx = 0;
+        traverse_impl(wires, switch_idx, func);
+    }
+
+    // Applies the switches on values in place, whose size must be the network size.
+    template <typename T>
+    void apply(std::vector<T>& values) const {
+        traverse(values.size(), [this, &values](std::size_t switch_idx, std::size_t wire_0, std::size_t wire_1) {
+            if (switches_[switch_idx]) {
+                std::swap(values[wire_0], values[wire_1]);
+            }
+        });
+    }
+
+    const std::vector<bool>& get_switches() const {
+        return switches_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+private:
+    // Programs the switches of the subnetwork for permutation, in the same order as traverse().
+    void route(const std::vector<std::size_t>& permutation, std::size_t& switch_idx);
+
+    // The input layer switches wires 2i and 2i+1, which then feed the i-th input of the upper and the lower
+    // subnetworks. The output layer switches the i-th outputs of both subnetworks into wires 2i and 2i+1.
+    template <typename SwitchFunc>
+    static void traverse_impl(const std::vector<std::size_t>& wires, std::size_t& switch_idx, SwitchFunc& func) {
+        std::size_t half = wires.size() / 2;
+        if (half == 1) {
+            func(switch_idx++, wires[0], wires[1]);
+            return;
+        }
+        std::vector<std::size_t> upper_wires(half);
+        std::vector<std::size_t> lower_wires(half);
+        for (std::size_t i = 0; i < half; ++i) {
+            func(switch_idx++, wires[2 * i], wires[2 * i + 1]);
+            upper_wires[i] = wires[2 * i];
+            lower_wires[i] = wires[2 * i + 1];
+        }
+        traverse_impl(upper_wires, switch_idx, func);
+        traverse_impl(lower_wires, switch_idx, func);
+        for (std::size_t i = 0; i < half; ++i) {
+            func(switch_idx++, wires[2 * i], wires[2 * i + 1]);
+        }
+    }
+
+    std::size_t size_ = 0;
+
+    std::vector<bool> switches_{};
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -17,21 +17,47 @@
 #include <omp.h>
 
 #include <algorithm>
+#include <cstring>
+#include <exception>
+#include <future>
 #include <map>
+#include <numeric>
 #include <set>
+#include <stdexcept>
 #include <thread>
 #include <utility>
 
 #include "glog/logging.h"
 
 #include "dpca-psi/common/defines.h"
+#include "dpca-psi/common/dummy_data_utils.h"
 #include "dpca-psi/common/parameter_check.h"
 #include "dpca-psi/common/utils.h"
+#include "dpca-psi/crypto/damgard_jurik.h"
+#include "dpca-psi/crypto/fixed_bignum.h"
+#include "dpca-psi/crypto/ipcl_paillier.h"
 #include "dpca-psi/crypto/ipcl_utils.h"
+#include "dpca-psi/crypto/oblivious_switching_network.h"
+#include "dpca-psi/network/link_tuner.h"
 
 namespace privacy_go {
 namespace dpca_psi {
 
+namespace {
+
+// Version of the parameter handshake of check_params(), increased with every change of the protocol.
+const std::size_t kHandshakeVersion = 1;
+
+// Damgard-Jurik with s = 1 is Paillier, which is served by IPCL.
+std::unique_ptr<Paillier> create_paillier(std::size_t damgard_jurik_s) {
+    if (damgard_jurik_s > 1) {
+        return std::make_unique<DamgardJurik>(damgard_jurik_s);
+    }
+    return std::make_unique<IpclPaillier>();
+}
+
+}  // namespace
+
 DPCardinalityPSI::DPCardinalityPSI() {
 }
 
@@ -47,16 +73,29 @@ void DPCardinalityPSI::init(const json& params, std::shared_ptr<IOBase> net) {
             "output_file": "example/data/sender_output_file.csv",
             "ids_num": 3,
             "is_sender": true,
-            "verbose": false
+            "verbose": false,
+            "feature_sharing": "paillier",
+            "feature_bits": [],
+            "send_buffer_size": 0,
+            "send_delay": false,
+            "zero_copy_threshold": 0,
+            "socket_buffer_size": 0,
+            "auto_tune": false,
+            "exchange_chunk_size": 0,
+            "checkpoint_dir": ""
         },
         "paillier_params": {
             "paillier_n_len": 2048,
             "enable_djn": true,
             "apply_packing": true,
-            "statistical_security_bits": 40
+            "statistical_security_bits": 40,
+            "damgard_jurik_s": 1,
+            "key_store_dir": "",
+            "key_lifetime": 86400
         },
         "ecc_params": {
-            "curve_id": 415
+            "curve_id": 415,
+            "point_compression": "auto"
         },
         "dp_params": {
             "epsilon": 2.0,
@@ -66,84 +105,136 @@ void DPCardinalityPSI::init(const json& params, std::shared_ptr<IOBase> net) {
             "input_dp": true,
             "has_zero_column": false,
             "zero_column_index": -1
+        },
+        "aggregate_params": {
+            "group_column": -1,
+            "group_num": 1
         }
     })"_json;
 
     defalut_config.merge_patch(params);
     params_ = defalut_config;
     io_ = net;
+    // the exchanges in both directions at a time run on the background writer and reader of an AsyncNetIO.
+    async_io_ = std::dynamic_pointer_cast<AsyncNetIO>(net);
+    if (async_io_ == nullptr) {
+        async_io_ = std::make_shared<AsyncNetIO>(net, AsyncNetIO::kDefaultMaxPendingBytes);
+    }
 
     verbose_ = params_["common"]["verbose"];
     is_sender_ = params_["common"]["is_sender"];
 
+    // the transfer settings are applied once the handshake has checked them on both sides.
     check_params();
+    io_->set_send_buffer_size(params_["common"]["send_buffer_size"]);
+    io_->set_delay(params_["common"]["send_delay"]);
+    io_->set_zero_copy_threshold(params_["common"]["zero_copy_threshold"]);
+    tune_link();
 
     key_size_ = params_["common"]["ids_num"];
+    use_ot_sharing_ = (params_["common"]["feature_sharing"] == "ot");
+    LOG_IF(INFO, verbose_) << "feature sharing is " << (use_ot_sharing_ ? "ot" : "paillier");
     apply_packing_ = params_["paillier_params"]["apply_packing"];
     if (apply_packing_) {
         statistical_security_bits_ = params_["paillier_params"]["statistical_security_bits"];
-        slot_bits_ = kValueBits + statistical_security_bits_ + 1;
     }
+    headroom_bits_ = 0;
     LOG_IF(INFO, verbose_) << "\nDPCA PSI parameters: \n" << params_.dump(4);
 
     std::size_t curve_id = params_["ecc_params"]["curve_id"];
     ecc_cipher_ = std::make_unique<EccCipher>(curve_id, key_size_);
+    ecc_cipher_->set_point_compression(compress_points_);
     LOG_IF(INFO, verbose_) << "ecc curve id is " << curve_id;
 
     num_threads_ = omp_get_max_threads();
 
-    std::size_t paillier_n_len = params_["paillier_params"]["paillier_n_len"];
-    LOG_IF(INFO, verbose_) << "paillier n len is " << paillier_n_len;
-
-    bool enable_djn = params_["paillier_params"]["enable_djn"];
-
-    if (is_sender_) {
-        sender_paillier_.keygen(paillier_n_len, enable_djn);
-
-        io_->send_value<bool>(enable_djn);
-        io_->send_bytes(sender_paillier_.export_pk());
-        LOG_IF(INFO, verbose_) << "sender sent paillier pk";
-
-        bool receiver_enable_djn = io_->recv_value<bool>();
-        ByteVector receiver_pk;
-        io_->recv_bytes(receiver_pk);
-        LOG_IF(INFO, verbose_) << "sender received paillier pk";
-        receiver_paillier_.import_pk(receiver_pk, receiver_enable_djn);
-    } else {
-        receiver_paillier_.keygen(paillier_n_len, enable_djn);
+    // Paillier keys are only needed by the feature phases, they are set up on the first use.
+    std::string key_store_dir = params_["paillier_params"]["key_store_dir"];
+    std::uint64_t key_lifetime = params_["paillier_params"]["key_lifetime"];
+    key_store_ = PaillierKeyStore(key_store_dir, key_lifetime);
+    paillier_initialized_ = false;
+    paillier_key_ready_ = false;
+
+    std::string checkpoint_dir = params_["common"]["checkpoint_dir"];
+    checkpoint_store_ = CheckpointStore(checkpoint_dir, is_sender_ ? "sender" : "receiver");
+    checkpoints_started_ = false;
+    io_->flush();
+}
 
-        bool sender_enable_djn = io_->recv_value<bool>();
-        ByteVector sender_pk;
-        io_->recv_bytes(sender_pk);
-        LOG_IF(INFO, verbose_) << "receiver received paillier pk";
+void DPCardinalityPSI::tune_link() {
+    LinkTuning tuning;
+    tuning.chunk_size = kExchangeChunkSize;
+    if (params_["common"]["auto_tune"]) {
+        ScopedIOPhase io_phase(io_, "tune_link");
+        LinkProfile profile = LinkTuner::probe(is_sender_, io_);
+        tuning = LinkTuner::tune(profile);
+        LOG_IF(INFO, verbose_) << "link round-trip time is " << profile.rtt * 1e3 << " ms, throughput is "
+                               << profile.throughput / 1e6 << " MB/s";
+    }
 
-        io_->send_value<bool>(enable_djn);
-        io_->send_bytes(receiver_paillier_.export_pk());
-        LOG_IF(INFO, verbose_) << "receiver sent paillier pk";
-        sender_paillier_.import_pk(sender_pk, sender_enable_djn);
+    // the configured settings take precedence over the tuned ones.
+    std::size_t exchange_chunk_size = params_["common"]["exchange_chunk_size"];
+    std::size_t socket_buffer_size = params_["common"]["socket_buffer_size"];
+    std::string point_compression = params_["ecc_params"]["point_compression"];
+    if (exchange_chunk_size != 0) {
+        tuning.chunk_size = exchange_chunk_size;
+    }
+    if (socket_buffer_size != 0) {
+        tuning.socket_buffer_size = socket_buffer_size;
     }
+    if (point_compression != "auto") {
+        tuning.compress_points = (point_compression == "compressed");
+    }
+    io_->set_socket_buffer_size(tuning.socket_buffer_size);
+    exchange_chunk_size_ = tuning.chunk_size;
+    compress_points_ = tuning.compress_points;
+    LOG_IF(INFO, verbose_) << "transfer settings: " << tuning.to_string();
 }
 
 void DPCardinalityPSI::data_sampling(
         const std::vector<std::vector<std::string>>& keys, const std::vector<std::vector<std::uint64_t>>& features) {
+    ScopedIOPhase io_phase(io_, "data_sampling");
+    bool input_dp = params_["dp_params"]["input_dp"];
+    bool use_precomputed_tau = input_dp && params_["dp_params"]["use_precomputed_tau"];
+    std::size_t precomputed_tau = use_precomputed_tau ? params_["dp_params"]["precomputed_tau"].get<std::size_t>() : 0;
+    block common_seed = kZeroBlock;
+
+    // sync data size, feature size, tau and the seed of dp sampling in one round trip.
     if (is_sender_) {
         sender_data_size_ = keys[0].size();
         sender_feature_size_ = features.size();
+        if (input_dp) {
+            common_seed = read_block_from_dev_urandom();
+        }
 
-        // sync data size and feature size.
         io_->send_value<std::size_t>(sender_data_size_);
         io_->send_value<std::size_t>(sender_feature_size_);
+        if (input_dp) {
+            io_->send_value<std::size_t>(precomputed_tau);
+            io_->send_value<block>(common_seed);
+        }
         receiver_data_size_ = io_->recv_value<std::size_t>();
         receiver_feature_size_ = io_->recv_value<std::size_t>();
+        if (input_dp) {
+            precomputed_tau = std::max(io_->recv_value<std::size_t>(), precomputed_tau);
+        }
     } else {
         receiver_data_size_ = keys[0].size();
         receiver_feature_size_ = features.size();
 
-        // sync data size and feature size.
         sender_data_size_ = io_->recv_value<std::size_t>();
         sender_feature_size_ = io_->recv_value<std::size_t>();
+        std::size_t remote_tau = 0;
+        if (input_dp) {
+            remote_tau = io_->recv_value<std::size_t>();
+            common_seed = io_->recv_value<block>();
+        }
         io_->send_value<std::size_t>(receiver_data_size_);
         io_->send_value<std::size_t>(receiver_feature_size_);
+        if (input_dp) {
+            io_->send_value<std::size_t>(precomputed_tau);
+            precomputed_tau = std::max(remote_tau, precomputed_tau);
+        }
     }
 
     LOG_IF(INFO, verbose_) << "sender data size is " << sender_data_size_;
@@ -151,39 +242,22 @@ void DPCardinalityPSI::data_sampling(
     LOG_IF(INFO, verbose_) << "receiver data size is  " << receiver_data_size_;
     LOG_IF(INFO, verbose_) << "receiver feature size is " << receiver_feature_size_;
 
+    set_value_bits(features);
+    const auto& self_value_bits = is_sender_ ? sender_value_bits_ : receiver_value_bits_;
+    input_data_size_ = keys[0].size();
+
     plaintext_keys_.assign(keys.begin(), keys.end());
     plaintext_features_.assign(features.begin(), features.end());
 
-    bool input_dp = params_["dp_params"]["input_dp"];
     LOG_IF(INFO, verbose_) << "apply input dp " << input_dp;
 
     if (input_dp) {
         std::size_t max_data_size = std::max(sender_data_size_, receiver_data_size_);
         double epsilon = params_["dp_params"]["epsilon"];
         std::size_t maximum_queries = params_["dp_params"]["maximum_queries"];
-        bool use_precomputed_tau = params_["dp_params"]["use_precomputed_tau"];
-        std::size_t precomputed_tau = 0;
-        if (use_precomputed_tau) {
-            precomputed_tau = params_["dp_params"]["precomputed_tau"];
-            if (is_sender_) {
-                io_->send_value<std::size_t>(precomputed_tau);
-                std::size_t remote_tau = io_->recv_value<std::size_t>();
-                precomputed_tau = std::max(remote_tau, precomputed_tau);
-            } else {
-                std::size_t remote_tau = io_->recv_value<std::size_t>();
-                io_->send_value<std::size_t>(precomputed_tau);
-                precomputed_tau = std::max(remote_tau, precomputed_tau);
-            }
-        }
         bool has_zero_column = params_["dp_params"]["has_zero_column"];
-        int zero_column_index = params_["dp_params"]["zero_column_index"];
         std::size_t feature_size = is_sender_ ? sender_feature_size_ : receiver_feature_size_;
-        if (feature_size == 0) {
-            zero_column_index = -1;
-        } else {
-            int temp_idx = (zero_column_index + static_cast<int>(feature_size)) % static_cast<int>(feature_size);
-            zero_column_index = has_zero_column ? temp_idx : -1;
-        }
+        int zero_column_index = get_zero_column_index(feature_size);
         LOG_IF(INFO, verbose_) << "\nDP parameters: "
                                << "\ndata size: " << max_data_size << "\nepsilon: " << epsilon
                                << "\nmaximum queries: " << maximum_queries
@@ -192,14 +266,7 @@ void DPCardinalityPSI::data_sampling(
                                << "\nzero column index: " << zero_column_index << "\nfeature size: " << feature_size;
 
         DPSampling dp_sampling;
-        if (is_sender_) {
-            block common_seed = read_block_from_dev_urandom();
-            io_->send_value<block>(common_seed);
-            dp_sampling.set_common_prng_seed(common_seed);
-        } else {
-            block common_seed = io_->recv_value<block>();
-            dp_sampling.set_common_prng_seed(common_seed);
-        }
+        dp_sampling.set_common_prng_seed(common_seed);
 
         LOG_IF(INFO, verbose_) << "dp sample start.";
         auto sampled_dummies = dp_sampling.multi_key_sampling(
@@ -214,6 +281,13 @@ void DPCardinalityPSI::data_sampling(
             LOG_IF(INFO, verbose_) << "total data size of key " << key_idx << " is " << plaintext_keys_[key_idx].size();
         }
         for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
+            // dummy values are truncated to the width of the column.
+            if (self_value_bits[feat_idx] < kValueBits) {
+                std::uint64_t value_mask = (std::uint64_t(1) << self_value_bits[feat_idx]) - 1;
+                for (auto& value : sampled_dummies.second[feat_idx]) {
+                    value &= value_mask;
+                }
+            }
             plaintext_features_[feat_idx].insert(plaintext_features_[feat_idx].end(),
                     sampled_dummies.second[feat_idx].begin(), sampled_dummies.second[feat_idx].end());
             LOG_IF(INFO, verbose_) << "total data size of feature " << feat_idx << " is "
@@ -236,154 +310,826 @@ void DPCardinalityPSI::data_sampling(
     sender_permutation_ = generate_permutation(sender_data_size_);
     receiver_permutation_ = generate_permutation(receiver_data_size_);
     LOG_IF(INFO, verbose_) << "generate permutation done.";
+    io_->flush();
 }
 
 void DPCardinalityPSI::process(std::vector<std::vector<std::uint64_t>>& shares) {
-    std::vector<std::vector<ByteVector>> encrypted_keys;
-    shuffle_and_encrypt_keys_round_one(encrypted_keys);
-    LOG_IF(INFO, verbose_) << "shuffle and encrypt keys round one done.";
+    start_checkpoints();
+    intersection_size_ = match_keys();
+    save_checkpoint(CheckpointPhase::kIntersectionComputed);
+    share_features(intersection_size_, shares);
+    finish_checkpoints();
+    reset_data();
+    io_->flush();
+}
 
-    auto received_data_size = is_sender_ ? receiver_data_size_ : sender_data_size_;
-    exchange_encrypted_keys(encrypted_keys, key_size_, received_data_size, exchanged_keys_, kEccPointLen);
-    for (std::size_t key_idx = 0; key_idx < encrypted_keys.size(); ++key_idx) {
-        encrypted_keys[key_idx].clear();
+bool DPCardinalityPSI::resume(std::vector<std::vector<std::uint64_t>>& shares) {
+    ScopedIOPhase io_phase(io_, "resume");
+    if (!checkpoint_store_.enabled()) {
+        throw std::logic_error("checkpoint_dir is not set");
+    }
+    const std::size_t max_phase = static_cast<std::size_t>(CheckpointPhase::kFeaturesExchanged);
+    block run_id = kZeroBlock;
+    std::size_t phase = checkpoint_store_.latest_phase(max_phase, run_id);
+
+    // the exchanged features are only usable with the own Paillier key pair of the run, so it is loaded before the
+    // phase is announced. Without it, the run resumes from the intersection instead of generating a new key pair.
+    ByteVector state;
+    std::vector<ByteVector> exchanged_encrypted_features;
+    std::size_t loaded_phase = 0;
+    if (phase == max_phase) {
+        if (!checkpoint_store_.load(phase, run_id, state)) {
+            throw std::runtime_error("failed to load checkpoint");
+        }
+        ByteVector paillier_pk;
+        load_checkpoint(CheckpointPhase::kFeaturesExchanged, state, exchanged_encrypted_features, paillier_pk);
+        if (create_paillier_key_pair(false) &&
+                (is_sender_ ? sender_paillier_ : receiver_paillier_)->export_pk() == paillier_pk) {
+            loaded_phase = phase;
+        } else {
+            LOG_IF(INFO, verbose_) << "paillier key pair of the checkpoint is not in the key store.";
+            paillier_key_ready_ = false;
+            exchanged_encrypted_features.clear();
+            phase = checkpoint_store_.latest_phase(
+                    static_cast<std::size_t>(CheckpointPhase::kIntersectionComputed), run_id);
+        }
     }
-    encrypted_keys.clear();
-    LOG_IF(INFO, verbose_) << "send and receive encryptd keys round one done.";
 
-    std::vector<ByteVector> reshuffled_keys;
-    reshuffle_and_encrypt_exchanged_keys_round_one(reshuffled_keys);
-    LOG_IF(INFO, verbose_) << "reshuffle and double encrypt keys round one done.";
-    received_data_size = is_sender_ ? sender_data_size_ : receiver_data_size_;
-    std::vector<ByteVector> single_encrypted_keys;
-    exchange_single_encrypted_keys(reshuffled_keys, received_data_size, single_encrypted_keys, kECCCompareBytesLen);
-    reshuffled_keys.clear();
-    LOG_IF(INFO, verbose_) << "send and receive double encryptd keys round one done.";
+    // the receiver picks the latest phase that both parties have saved for the same run, 0 if there is none.
+    if (is_sender_) {
+        io_->send_value<std::size_t>(phase);
+        io_->send_value<block>(run_id);
+        phase = io_->recv_value<std::size_t>();
+    } else {
+        std::size_t remote_phase = io_->recv_value<std::size_t>();
+        block remote_run_id = io_->recv_value<block>();
+        if (std::memcmp(&remote_run_id, &run_id, sizeof(block)) != 0) {
+            phase = 0;
+        }
+        phase = std::min(phase, remote_phase);
+        io_->send_value<std::size_t>(phase);
+    }
+    io_->flush();
+    if (phase == 0) {
+        checkpoint_store_.clear(max_phase);
+        LOG_IF(INFO, verbose_) << "no common checkpoint to resume from.";
+        return false;
+    }
 
-    auto intersection_size_round_one = calculate_intersection_round_one(single_encrypted_keys, exchanged_keys_[0]);
-    single_encrypted_keys.clear();
-    LOG_IF(INFO, verbose_) << "intersection size round 1 is " << intersection_size_round_one;
+    if (phase != loaded_phase) {
+        if (!checkpoint_store_.load(phase, run_id, state)) {
+            throw std::runtime_error("failed to load checkpoint");
+        }
+        ByteVector paillier_pk;
+        exchanged_encrypted_features.clear();
+        load_checkpoint(static_cast<CheckpointPhase>(phase), state, exchanged_encrypted_features, paillier_pk);
+    }
+    state.clear();
+    run_id_ = run_id;
+    checkpoints_started_ = true;
+    LOG_IF(INFO, verbose_) << "resume from checkpoint phase " << phase;
+
+    switch (static_cast<CheckpointPhase>(phase)) {
+        case CheckpointPhase::kKeysExchanged:
+            intersection_size_ = match_exchanged_keys();
+            save_checkpoint(CheckpointPhase::kIntersectionComputed);
+            share_features(intersection_size_, shares);
+            break;
+        case CheckpointPhase::kIntersectionComputed:
+            share_features(intersection_size_, shares);
+            break;
+        case CheckpointPhase::kFeaturesExchanged:
+            init_paillier();
+            share_exchanged_features_with_paillier(intersection_size_, false, exchanged_encrypted_features, shares);
+            break;
+    }
+    finish_checkpoints();
+    reset_data();
+    io_->flush();
+    return true;
+}
 
-    LOG_IF(INFO, verbose_) << "repeatedly match begin.";
-    auto intersection_size = repeatedly_match(intersection_size_round_one);
-    LOG_IF(INFO, verbose_) << "repeatedly match end.";
+void DPCardinalityPSI::start_checkpoints() {
+    checkpoints_started_ = false;
+    if (!checkpoint_store_.enabled()) {
+        return;
+    }
+    checkpoint_store_.clear(static_cast<std::size_t>(CheckpointPhase::kFeaturesExchanged));
+    if (is_sender_) {
+        run_id_ = read_block_from_dev_urandom();
+        io_->send_value<block>(run_id_);
+    } else {
+        run_id_ = io_->recv_value<block>();
+    }
+    checkpoints_started_ = true;
+}
 
-    LOG_IF(INFO, verbose_) << "calculates intersection and saves intersection indices done.";
-    LOG_IF(INFO, verbose_) << "intersection size is " << intersection_size;
+// Every checkpoint holds the result of data_sampling(), the later phases add the results of their own.
+void DPCardinalityPSI::save_checkpoint(CheckpointPhase phase, const std::vector<ByteVector>& exchanged_features) {
+    if (!checkpoints_started_) {
+        return;
+    }
+    if (phase == CheckpointPhase::kFeaturesExchanged && !key_store_.enabled()) {
+        // the features are encrypted under a Paillier key pair that a new run does not have.
+        return;
+    }
+    CheckpointWriter writer;
+    writer.write_value<std::uint64_t>(sender_data_size_);
+    writer.write_value<std::uint64_t>(sender_feature_size_);
+    writer.write_value<std::uint64_t>(receiver_data_size_);
+    writer.write_value<std::uint64_t>(receiver_feature_size_);
+    writer.write_value<std::uint64_t>(input_data_size_);
+    writer.write_vector(sender_value_bits_);
+    writer.write_vector(receiver_value_bits_);
+    writer.write_vector(sender_permutation_);
+    writer.write_vector(receiver_permutation_);
+    writer.write_value<std::uint64_t>(plaintext_features_.size());
+    for (const auto& feature : plaintext_features_) {
+        writer.write_vector(feature);
+    }
+    if (phase == CheckpointPhase::kKeysExchanged) {
+        writer.write_vector(ecc_cipher_->export_private_keys());
+        writer.write_value<std::uint64_t>(exchanged_keys_.size());
+        for (const auto& keys : exchanged_keys_) {
+            writer.write_bytes_vector(keys);
+        }
+    } else {
+        writer.write_value<std::uint64_t>(intersection_size_);
+        std::vector<std::uint8_t> flags(intersection_indices_.size());
+        std::vector<ByteVector> compare_keys(intersection_indices_.size());
+        for (std::size_t item_idx = 0; item_idx < intersection_indices_.size(); ++item_idx) {
+            flags[item_idx] = intersection_indices_[item_idx].first ? 1 : 0;
+            compare_keys[item_idx] = intersection_indices_[item_idx].second;
+        }
+        writer.write_vector(flags);
+        writer.write_bytes_vector(compare_keys);
+    }
+    if (phase == CheckpointPhase::kFeaturesExchanged) {
+        writer.write_vector((is_sender_ ? sender_paillier_ : receiver_paillier_)->export_pk());
+        writer.write_bytes_vector(exchanged_features);
+    }
+    checkpoint_store_.save(static_cast<std::size_t>(phase), run_id_, writer.get_data());
+    LOG_IF(INFO, verbose_) << "checkpoint phase " << static_cast<std::size_t>(phase) << " saved.";
+}
 
-    std::vector<std::vector<ByteVector>> encrypted_features;
-    shuffle_and_encrypt_features(encrypted_features);
-    LOG_IF(INFO, verbose_) << "shuffle and encrypt features done.";
+void DPCardinalityPSI::load_checkpoint(CheckpointPhase phase, const ByteVector& state,
+        std::vector<ByteVector>& exchanged_features, ByteVector& paillier_pk) {
+    CheckpointReader reader(state);
+    sender_data_size_ = reader.read_value<std::uint64_t>();
+    sender_feature_size_ = reader.read_value<std::uint64_t>();
+    receiver_data_size_ = reader.read_value<std::uint64_t>();
+    receiver_feature_size_ = reader.read_value<std::uint64_t>();
+    input_data_size_ = reader.read_value<std::uint64_t>();
+    reader.read_vector(sender_value_bits_);
+    reader.read_vector(receiver_value_bits_);
+    reader.read_vector(sender_permutation_);
+    reader.read_vector(receiver_permutation_);
+    plaintext_features_.resize(reader.read_value<std::uint64_t>());
+    for (auto& feature : plaintext_features_) {
+        reader.read_vector(feature);
+    }
+    if (phase == CheckpointPhase::kKeysExchanged) {
+        ByteVector private_keys;
+        reader.read_vector(private_keys);
+        ecc_cipher_->import_private_keys(private_keys);
+        exchanged_keys_.resize(reader.read_value<std::uint64_t>());
+        for (auto& keys : exchanged_keys_) {
+            reader.read_bytes_vector(keys);
+        }
+    } else {
+        intersection_size_ = reader.read_value<std::uint64_t>();
+        std::vector<std::uint8_t> flags;
+        std::vector<ByteVector> compare_keys;
+        reader.read_vector(flags);
+        reader.read_bytes_vector(compare_keys);
+        if (flags.size() != compare_keys.size()) {
+            throw std::runtime_error("checkpoint is corrupted");
+        }
+        intersection_indices_.resize(flags.size());
+        for (std::size_t item_idx = 0; item_idx < flags.size(); ++item_idx) {
+            intersection_indices_[item_idx] = std::make_pair(flags[item_idx] != 0, std::move(compare_keys[item_idx]));
+        }
+    }
+    if (phase == CheckpointPhase::kFeaturesExchanged) {
+        // the received features are encrypted under the peer's key pair. The peer masks the features that it has
+        // received under the own key pair, which decrypts the masked shares in turn.
+        reader.read_vector(paillier_pk);
+        reader.read_bytes_vector(exchanged_features);
+    }
+}
 
-    std::vector<std::vector<ByteVector>> exchanged_encrypted_features;
-    auto self_pailler_len = is_sender_ ? sender_paillier_.get_bytes_len(1) : receiver_paillier_.get_bytes_len(1);
-    auto remote_paillier_len = is_sender_ ? receiver_paillier_.get_bytes_len(1) : sender_paillier_.get_bytes_len(1);
-    auto received_feature_size = is_sender_ ? receiver_feature_size_ : sender_feature_size_;
-    if (apply_packing_) {
-        std::size_t packing_capacity = remote_paillier_len * 4 / slot_bits_;
-        received_feature_size = (received_feature_size + packing_capacity - 1) / packing_capacity;
+void DPCardinalityPSI::finish_checkpoints() {
+    if (checkpoints_started_) {
+        checkpoint_store_.clear(static_cast<std::size_t>(CheckpointPhase::kFeaturesExchanged));
+        checkpoints_started_ = false;
     }
-    received_data_size = is_sender_ ? receiver_data_size_ : sender_data_size_;
-    exchange_encrypted_features(encrypted_features, self_pailler_len, remote_paillier_len, received_feature_size,
-            received_data_size, exchanged_encrypted_features);
-    for (std::size_t feat_idx = 0; feat_idx < encrypted_features.size(); ++feat_idx) {
-        encrypted_features[feat_idx].clear();
+}
+
+std::size_t DPCardinalityPSI::process_cardinality() {
+    intersection_size_ = match_keys();
+    reset_data();
+    io_->flush();
+    return intersection_size_;
+}
+
+void DPCardinalityPSI::process_aggregate(std::vector<std::vector<std::uint64_t>>& sums) {
+    intersection_size_ = match_keys();
+    aggregate_features(intersection_size_, sums);
+    reset_data();
+    io_->flush();
+}
+
+std::size_t DPCardinalityPSI::start_session() {
+    if (in_session_) {
+        throw std::logic_error("session already started");
+    }
+    intersection_size_ = match_keys();
+    exchanged_keys_.clear();
+    plaintext_keys_.clear();
+
+    // the smaller budget of both parties applies.
+    std::size_t maximum_queries = params_["dp_params"]["maximum_queries"];
+    if (is_sender_) {
+        io_->send_value<std::size_t>(maximum_queries);
+        maximum_queries = std::min(maximum_queries, io_->recv_value<std::size_t>());
+    } else {
+        std::size_t remote_maximum_queries = io_->recv_value<std::size_t>();
+        io_->send_value<std::size_t>(maximum_queries);
+        maximum_queries = std::min(maximum_queries, remote_maximum_queries);
+    }
+    remaining_queries_ = maximum_queries;
+    in_session_ = true;
+    io_->flush();
+    LOG_IF(INFO, verbose_) << "session started, query budget is " << remaining_queries_;
+    return intersection_size_;
+}
+
+void DPCardinalityPSI::query(
+        const std::vector<std::vector<std::uint64_t>>& features, std::vector<std::vector<std::uint64_t>>& shares) {
+    load_query_features(features);
+    share_features(intersection_size_, shares);
+    --remaining_queries_;
+    io_->flush();
+    LOG_IF(INFO, verbose_) << "query done, remaining queries " << remaining_queries_;
+}
+
+void DPCardinalityPSI::query_aggregate(
+        const std::vector<std::vector<std::uint64_t>>& features, std::vector<std::vector<std::uint64_t>>& sums) {
+    load_query_features(features);
+    aggregate_features(intersection_size_, sums);
+    --remaining_queries_;
+    io_->flush();
+    LOG_IF(INFO, verbose_) << "aggregate query done, remaining queries " << remaining_queries_;
+}
+
+void DPCardinalityPSI::end_session() {
+    in_session_ = false;
+    remaining_queries_ = 0;
+    reset_data();
+}
+
+void DPCardinalityPSI::share_features(std::size_t intersection_size, std::vector<std::vector<std::uint64_t>>& shares) {
+    ScopedIOPhase io_phase(io_, "share_features");
+    if (sender_feature_size_ + receiver_feature_size_ == 0) {
+        LOG_IF(INFO, verbose_) << "no feature columns on both sides, skip feature phases.";
+        return;
+    }
+    if (use_ot_sharing_) {
+        share_features_with_ot(intersection_size, shares);
+        LOG_IF(INFO, verbose_) << "share features with ot done.";
+        return;
+    }
+    share_features_with_paillier(intersection_size, false, shares);
+}
+
+void DPCardinalityPSI::aggregate_features(
+        std::size_t intersection_size, std::vector<std::vector<std::uint64_t>>& sums) {
+    ScopedIOPhase io_phase(io_, "aggregate_features");
+    // sync the feature sizes and widths after grouping, and the group numbers.
+    std::size_t self_group_num = expand_group_column();
+    std::size_t sender_group_num = 1;
+    std::size_t receiver_group_num = 1;
+    if (is_sender_) {
+        sender_group_num = self_group_num;
+        io_->send_value<std::size_t>(sender_feature_size_);
+        io_->send_value<std::size_t>(sender_group_num);
+        io_->send_data(sender_value_bits_.data(), sender_feature_size_ * sizeof(std::size_t));
+        receiver_feature_size_ = io_->recv_value<std::size_t>();
+        receiver_group_num = io_->recv_value<std::size_t>();
+        receiver_value_bits_.resize(receiver_feature_size_);
+        io_->recv_data(receiver_value_bits_.data(), receiver_feature_size_ * sizeof(std::size_t));
+    } else {
+        receiver_group_num = self_group_num;
+        sender_feature_size_ = io_->recv_value<std::size_t>();
+        sender_group_num = io_->recv_value<std::size_t>();
+        sender_value_bits_.resize(sender_feature_size_);
+        io_->recv_data(sender_value_bits_.data(), sender_feature_size_ * sizeof(std::size_t));
+        io_->send_value<std::size_t>(receiver_feature_size_);
+        io_->send_value<std::size_t>(receiver_group_num);
+        io_->send_data(receiver_value_bits_.data(), receiver_feature_size_ * sizeof(std::size_t));
+    }
+    LOG_IF(INFO, verbose_) << "sender group number is " << sender_group_num;
+    LOG_IF(INFO, verbose_) << "receiver group number is " << receiver_group_num;
+
+    if (sender_feature_size_ + receiver_feature_size_ == 0) {
+        LOG_IF(INFO, verbose_) << "no feature columns on both sides, skip feature phases.";
+        return;
+    }
+
+    std::vector<std::vector<std::uint64_t>> shares;
+    if (use_ot_sharing_) {
+        // shares of a sum are the sums of shares.
+        share_features_with_ot(intersection_size, shares);
+        for (auto& column : shares) {
+            std::uint64_t sum = std::accumulate(column.begin(), column.end(), std::uint64_t(0));
+            column.assign(1, sum);
+        }
+        LOG_IF(INFO, verbose_) << "share features with ot done.";
+    } else {
+        if (apply_packing_) {
+            // every slot has room for the sum of all rows.
+            std::size_t max_data_size = std::max(sender_data_size_, receiver_data_size_);
+            while ((std::size_t(1) << headroom_bits_) < max_data_size) {
+                ++headroom_bits_;
+            }
+            LOG_IF(INFO, verbose_) << "headroom bits for aggregation is " << headroom_bits_;
+        }
+        share_features_with_paillier(intersection_size, true, shares);
+        headroom_bits_ = 0;
+    }
+
+    std::size_t sender_column_num = sender_feature_size_ / sender_group_num;
+    std::size_t receiver_column_num = receiver_feature_size_ / receiver_group_num;
+    sums.reserve(sums.size() + sender_column_num + receiver_column_num);
+    auto append_sums = [&sums, &shares](std::size_t offset, std::size_t column_num, std::size_t group_num) {
+        for (std::size_t col_idx = 0; col_idx < column_num; ++col_idx) {
+            std::vector<std::uint64_t> column_sums(group_num);
+            for (std::size_t group_idx = 0; group_idx < group_num; ++group_idx) {
+                column_sums[group_idx] = shares[offset + col_idx * group_num + group_idx][0];
+            }
+            sums.emplace_back(std::move(column_sums));
+        }
+    };
+    append_sums(0, sender_column_num, sender_group_num);
+    append_sums(sender_feature_size_, receiver_column_num, receiver_group_num);
+}
+
+void DPCardinalityPSI::load_query_features(const std::vector<std::vector<std::uint64_t>>& features) {
+    if (!in_session_) {
+        throw std::logic_error("session not started");
+    }
+    if (remaining_queries_ == 0) {
+        throw std::logic_error("query budget exhausted");
+    }
+    for (const auto& feature : features) {
+        if (feature.size() != input_data_size_) {
+            throw std::invalid_argument("feature size does not match the number of rows");
+        }
+    }
+
+    // sync feature size.
+    if (is_sender_) {
+        sender_feature_size_ = features.size();
+        io_->send_value<std::size_t>(sender_feature_size_);
+        receiver_feature_size_ = io_->recv_value<std::size_t>();
+    } else {
+        receiver_feature_size_ = features.size();
+        sender_feature_size_ = io_->recv_value<std::size_t>();
+        io_->send_value<std::size_t>(receiver_feature_size_);
     }
-    encrypted_features.clear();
-    LOG_IF(INFO, verbose_) << "send and receive encrypted features done.";
+    set_value_bits(features);
+    const auto& self_value_bits = is_sender_ ? sender_value_bits_ : receiver_value_bits_;
 
-    std::vector<std::vector<ByteVector>> intersection_features;
-    filter_intersection_features(exchanged_encrypted_features, intersection_size, intersection_features);
-    for (std::size_t feat_idx = 0; feat_idx < exchanged_encrypted_features.size(); ++feat_idx) {
-        exchanged_encrypted_features[feat_idx].clear();
+    // the dummy rows get fresh dummy values, the same as sampled in data_sampling().
+    std::size_t dummy_data_size = (is_sender_ ? sender_data_size_ : receiver_data_size_) - input_data_size_;
+    int zero_column_index = get_zero_column_index(features.size());
+    PRNG prng(read_block_from_dev_urandom());
+    plaintext_features_.assign(features.begin(), features.end());
+    for (std::size_t feat_idx = 0; feat_idx < features.size(); ++feat_idx) {
+        auto dummies = random_features(prng, dummy_data_size, feat_idx == static_cast<std::size_t>(zero_column_index));
+        if (self_value_bits[feat_idx] < kValueBits) {
+            std::uint64_t value_mask = (std::uint64_t(1) << self_value_bits[feat_idx]) - 1;
+            for (auto& value : dummies) {
+                value &= value_mask;
+            }
+        }
+        plaintext_features_[feat_idx].insert(plaintext_features_[feat_idx].end(), dummies.begin(), dummies.end());
     }
+}
+
+void DPCardinalityPSI::set_value_bits(const std::vector<std::vector<std::uint64_t>>& features) {
+    sender_value_bits_ = sender_feature_bits_;
+    receiver_value_bits_ = receiver_feature_bits_;
+    if (sender_value_bits_.empty()) {
+        sender_value_bits_.assign(sender_feature_size_, kValueBits);
+    }
+    if (receiver_value_bits_.empty()) {
+        receiver_value_bits_.assign(receiver_feature_size_, kValueBits);
+    }
+    if (sender_value_bits_.size() != sender_feature_size_ || receiver_value_bits_.size() != receiver_feature_size_) {
+        throw std::invalid_argument("feature_bits does not match the number of feature columns");
+    }
+    const auto& self_value_bits = is_sender_ ? sender_value_bits_ : receiver_value_bits_;
+    for (std::size_t feat_idx = 0; feat_idx < features.size(); ++feat_idx) {
+        if (self_value_bits[feat_idx] < kValueBits) {
+            for (auto value : features[feat_idx]) {
+                if ((value >> self_value_bits[feat_idx]) != 0) {
+                    throw std::invalid_argument("feature value exceeds feature_bits");
+                }
+            }
+        }
+    }
+}
+
+int DPCardinalityPSI::get_zero_column_index(std::size_t feature_size) const {
+    bool has_zero_column = params_["dp_params"]["has_zero_column"];
+    int zero_column_index = params_["dp_params"]["zero_column_index"];
+    if (feature_size == 0 || !has_zero_column) {
+        return -1;
+    }
+    return (zero_column_index + static_cast<int>(feature_size)) % static_cast<int>(feature_size);
+}
+
+void DPCardinalityPSI::share_features_with_paillier(
+        std::size_t intersection_size, bool aggregate, std::vector<std::vector<std::uint64_t>>& shares) {
+    init_paillier();
+
+    std::vector<ByteVector> exchanged_encrypted_features;
+    const Paillier& remote_paillier = *(is_sender_ ? receiver_paillier_ : sender_paillier_);
+    auto received_feature_size = is_sender_ ? receiver_feature_size_ : sender_feature_size_;
+    if (apply_packing_) {
+        received_feature_size =
+                get_packing_layout(remote_paillier, is_sender_ ? receiver_value_bits_ : sender_value_bits_).size();
+    }
+    shuffle_encrypt_and_exchange_features(received_feature_size, exchanged_encrypted_features);
+    LOG_IF(INFO, verbose_) << "shuffle, encrypt and exchange features done.";
+    save_checkpoint(CheckpointPhase::kFeaturesExchanged, exchanged_encrypted_features);
+    share_exchanged_features_with_paillier(intersection_size, aggregate, exchanged_encrypted_features, shares);
+}
+
+void DPCardinalityPSI::share_exchanged_features_with_paillier(std::size_t intersection_size, bool aggregate,
+        std::vector<ByteVector>& exchanged_encrypted_features, std::vector<std::vector<std::uint64_t>>& shares) {
+    const Paillier& self_paillier = *(is_sender_ ? sender_paillier_ : receiver_paillier_);
+    const Paillier& remote_paillier = *(is_sender_ ? receiver_paillier_ : sender_paillier_);
+    std::vector<ByteVector> intersection_features;
+    filter_intersection_features(exchanged_encrypted_features, remote_paillier.get_bytes_len(true), intersection_size,
+            intersection_features);
     exchanged_encrypted_features.clear();
     LOG_IF(INFO, verbose_) << "filter intersection features done.";
 
-    std::vector<std::vector<BigNumber>> random_r;
-    generate_additive_shares((is_sender_ ? receiver_paillier_ : sender_paillier_), intersection_features, random_r);
+    // only the sums are masked, exchanged and decrypted in aggregate mode.
+    std::size_t output_size = intersection_size;
+    if (aggregate) {
+        sum_intersection_features(remote_paillier, intersection_features);
+        output_size = 1;
+        LOG_IF(INFO, verbose_) << "sum intersection features done.";
+    }
+
+    std::vector<std::vector<std::uint64_t>> random_r;
+    generate_additive_shares(*(is_sender_ ? receiver_paillier_ : sender_paillier_), intersection_features, random_r);
     LOG_IF(INFO, verbose_) << "generate additive shares done.";
 
-    std::vector<std::vector<ByteVector>> exchanged_shares;
-    received_feature_size = is_sender_ ? sender_feature_size_ : receiver_feature_size_;
+    std::vector<ByteVector> exchanged_shares;
+    auto received_feature_size = is_sender_ ? sender_feature_size_ : receiver_feature_size_;
     if (apply_packing_) {
-        std::size_t packing_capacity = self_pailler_len * 4 / slot_bits_;
-        received_feature_size = (received_feature_size + packing_capacity - 1) / packing_capacity;
-    }
-    exchange_encrypted_features(intersection_features, remote_paillier_len, self_pailler_len, received_feature_size,
-            intersection_size, exchanged_shares);
-    for (std::size_t feat_idx = 0; feat_idx < intersection_features.size(); ++feat_idx) {
-        intersection_features[feat_idx].clear();
+        received_feature_size =
+                get_packing_layout(self_paillier, is_sender_ ? sender_value_bits_ : receiver_value_bits_).size();
     }
+    // every column of shares holds output_size ciphertexts of the own public key.
+    exchange_encrypted_features(intersection_features, received_feature_size,
+            output_size * self_paillier.get_bytes_len(true), exchanged_shares);
     intersection_features.clear();
     LOG_IF(INFO, verbose_) << "send and receive encrypted additive shares done.";
 
-    decrypt_and_reveal_shares(exchanged_shares, random_r, intersection_size, shares);
+    decrypt_and_reveal_shares(exchanged_shares, random_r, output_size, shares);
     LOG_IF(INFO, verbose_) << "decrypt and reveal shares done.";
 
     for (std::size_t feat_idx = 0; feat_idx < random_r.size(); ++feat_idx) {
         random_r[feat_idx].clear();
     }
     random_r.clear();
-    for (std::size_t feat_idx = 0; feat_idx < exchanged_shares.size(); ++feat_idx) {
-        exchanged_shares[feat_idx].clear();
-    }
     exchanged_shares.clear();
-    reset_data();
+}
+
+// Column c of the other features is replaced by group_num columns, where the g-th one keeps the values of the rows in
+// group g and zeros elsewhere. Rows of other group ids, e.g. the dummy rows, fall in no group.
+std::size_t DPCardinalityPSI::expand_group_column() {
+    int group_column = params_["aggregate_params"]["group_column"];
+    if (group_column < 0) {
+        return 1;
+    }
+    std::size_t& feature_size = is_sender_ ? sender_feature_size_ : receiver_feature_size_;
+    if (static_cast<std::size_t>(group_column) >= feature_size) {
+        throw std::invalid_argument("group_column is out of range");
+    }
+    std::size_t group_num = params_["aggregate_params"]["group_num"];
+    std::vector<std::uint64_t> group_ids = std::move(plaintext_features_[group_column]);
+    plaintext_features_.erase(plaintext_features_.begin() + group_column);
+    auto& value_bits = is_sender_ ? sender_value_bits_ : receiver_value_bits_;
+    value_bits.erase(value_bits.begin() + group_column);
+    std::vector<std::size_t> grouped_value_bits;
+    grouped_value_bits.reserve(value_bits.size() * group_num);
+    for (auto bits : value_bits) {
+        grouped_value_bits.insert(grouped_value_bits.end(), group_num, bits);
+    }
+    value_bits = std::move(grouped_value_bits);
+
+    std::vector<std::vector<std::uint64_t>> grouped_features;
+    grouped_features.reserve(plaintext_features_.size() * group_num);
+    for (const auto& feature : plaintext_features_) {
+        for (std::size_t group_idx = 0; group_idx < group_num; ++group_idx) {
+            std::vector<std::uint64_t> grouped_feature(feature.size(), 0);
+            for (std::size_t item_idx = 0; item_idx < feature.size(); ++item_idx) {
+                if (group_ids[item_idx] == group_idx) {
+                    grouped_feature[item_idx] = feature[item_idx];
+                }
+            }
+            grouped_features.emplace_back(std::move(grouped_feature));
+        }
+    }
+    plaintext_features_ = std::move(grouped_features);
+    feature_size = plaintext_features_.size();
+    LOG_IF(INFO, verbose_) << "group column " << group_column << " expands features to " << feature_size << " columns";
+    return group_num;
+}
+
+// Adds the two halves of every column until a single ciphertext is left, so that the batched additions of IPCL apply.
+void DPCardinalityPSI::sum_intersection_features(
+        const Paillier& paillier, std::vector<ByteVector>& intersection_features) {
+    std::size_t cipher_len = paillier.get_bytes_len(true);
+    for (auto& column : intersection_features) {
+        if (column.empty()) {
+            auto zero = paillier.encrypt(ipcl::PlainText(BigNumber::Zero()));
+            column.resize(cipher_len);
+            paillier.encode(zero, column.data());
+            continue;
+        }
+        std::size_t data_size = column.size() / cipher_len;
+        auto column_ciphertexts = paillier.decode(column.data(), data_size);
+        std::vector<BigNumber> ciphertexts;
+        ciphertexts.reserve(data_size);
+        for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
+            ciphertexts.emplace_back(column_ciphertexts.getElement(item_idx));
+        }
+        while (ciphertexts.size() > 1) {
+            std::size_t half = ciphertexts.size() / 2;
+            std::vector<BigNumber> lhs(ciphertexts.begin(), ciphertexts.begin() + half);
+            std::vector<BigNumber> rhs(ciphertexts.begin() + half, ciphertexts.begin() + 2 * half);
+            auto sum = paillier.add(
+                    ipcl::CipherText(*paillier.get_pk(), lhs), ipcl::CipherText(*paillier.get_pk(), rhs));
+            std::vector<BigNumber> next;
+            next.reserve(half + 1);
+            for (std::size_t item_idx = 0; item_idx < half; ++item_idx) {
+                next.emplace_back(sum.getElement(item_idx));
+            }
+            if (ciphertexts.size() % 2 == 1) {
+                next.emplace_back(ciphertexts.back());
+            }
+            ciphertexts = std::move(next);
+        }
+        column.resize(cipher_len);
+        paillier.encode(ipcl::CipherText(*paillier.get_pk(), ciphertexts), column.data());
+    }
+}
+
+void DPCardinalityPSI::init_paillier() {
+    if (paillier_initialized_) {
+        return;
+    }
+    ScopedIOPhase io_phase(io_, "init_paillier");
+    // resume() may have loaded the key pair of its checkpoint.
+    if (!paillier_key_ready_) {
+        bool key_loaded = create_paillier_key_pair(true);
+        LOG_IF(INFO, verbose_) << (key_loaded ? "paillier key loaded from key store" : "paillier key generated");
+    }
+
+    bool enable_djn = params_["paillier_params"]["enable_djn"];
+    exchange_paillier_pk(key_store_, enable_djn);
+    paillier_initialized_ = true;
+}
+
+bool DPCardinalityPSI::create_paillier_key_pair(bool generate) {
+    std::size_t paillier_n_len = params_["paillier_params"]["paillier_n_len"];
+    LOG_IF(INFO, verbose_) << "paillier n len is " << paillier_n_len;
+
+    bool enable_djn = params_["paillier_params"]["enable_djn"];
+
+    std::size_t damgard_jurik_s = params_["paillier_params"]["damgard_jurik_s"];
+    sender_paillier_ = create_paillier(damgard_jurik_s);
+    receiver_paillier_ = create_paillier(damgard_jurik_s);
+    LOG_IF(INFO, verbose_) << "paillier scheme is " << sender_paillier_->scheme_name();
+
+    Paillier& self_paillier = *(is_sender_ ? sender_paillier_ : receiver_paillier_);
+    bool key_loaded = generate ? key_store_.load_or_generate(paillier_n_len, enable_djn, self_paillier)
+                               : key_store_.load(paillier_n_len, enable_djn, self_paillier);
+    paillier_key_ready_ = generate || key_loaded;
+    return key_loaded;
+}
+
+// Slots are filled in column order, a column that does not fit in the rest of a plaintext starts the next one.
+std::vector<std::vector<DPCardinalityPSI::PackingSlot>> DPCardinalityPSI::get_packing_layout(
+        const Paillier& paillier, const std::vector<std::size_t>& value_bits) const {
+    std::size_t plaintext_bits = paillier.get_plaintext_bits();
+    std::vector<std::vector<PackingSlot>> packing_layout;
+    std::size_t offset = plaintext_bits;
+    for (std::size_t feat_idx = 0; feat_idx < value_bits.size(); ++feat_idx) {
+        std::size_t slot_bits = get_slot_bits(value_bits[feat_idx]);
+        if (slot_bits > plaintext_bits) {
+            throw std::logic_error("slot is wider than the plaintext");
+        }
+        if (offset + slot_bits > plaintext_bits) {
+            packing_layout.emplace_back();
+            offset = 0;
+        }
+        PackingSlot slot;
+        slot.feature_idx = feat_idx;
+        slot.offset = offset;
+        slot.value_bits = value_bits[feat_idx];
+        packing_layout.back().emplace_back(slot);
+        offset += slot_bits;
+    }
+    return packing_layout;
+}
+
+std::size_t DPCardinalityPSI::match_keys() {
+    ScopedIOPhase io_phase(io_, "match_keys");
+    auto received_data_size = is_sender_ ? receiver_data_size_ : sender_data_size_;
+    shuffle_encrypt_and_exchange_keys_round_one(received_data_size);
+    LOG_IF(INFO, verbose_) << "shuffle, encrypt and exchange keys round one done.";
+    save_checkpoint(CheckpointPhase::kKeysExchanged);
+    return match_exchanged_keys();
+}
+
+std::size_t DPCardinalityPSI::match_exchanged_keys() {
+    ScopedIOPhase io_phase(io_, "match_exchanged_keys");
+    std::vector<ByteVector> reshuffled_keys;
+    reshuffle_and_encrypt_exchanged_keys_round_one(reshuffled_keys);
+    LOG_IF(INFO, verbose_) << "reshuffle and double encrypt keys round one done.";
+    auto received_data_size = is_sender_ ? sender_data_size_ : receiver_data_size_;
+    std::vector<ByteVector> single_encrypted_keys;
+    exchange_single_encrypted_keys(reshuffled_keys, received_data_size, single_encrypted_keys, kECCCompareBytesLen);
+    reshuffled_keys.clear();
+    LOG_IF(INFO, verbose_) << "send and receive double encryptd keys round one done.";
+
+    auto intersection_size_round_one = calculate_intersection_round_one(single_encrypted_keys, exchanged_keys_[0]);
+    single_encrypted_keys.clear();
+    LOG_IF(INFO, verbose_) << "intersection size round 1 is " << intersection_size_round_one;
+
+    LOG_IF(INFO, verbose_) << "repeatedly match begin.";
+    auto intersection_size = repeatedly_match(intersection_size_round_one);
+    LOG_IF(INFO, verbose_) << "repeatedly match end.";
+
+    LOG_IF(INFO, verbose_) << "calculates intersection and saves intersection indices done.";
+    LOG_IF(INFO, verbose_) << "intersection size is " << intersection_size;
+
+    return intersection_size;
 }
 
 void DPCardinalityPSI::check_params() {
+    ScopedIOPhase io_phase(io_, "check_params");
     std::size_t curve_id = params_["ecc_params"]["curve_id"];
-    check_consistency(is_sender_, io_, "ecc_curve_id", curve_id);
-    check_equal<std::size_t>("curve_id", curve_id, 415);
-
     std::size_t ids_num = params_["common"]["ids_num"];
-    check_consistency(is_sender_, io_, "ids_num", ids_num);
-    check_in_range<std::size_t>("ids_num", ids_num, 1, 100);
-
     bool input_dp = params_["dp_params"]["input_dp"];
-    check_consistency(is_sender_, io_, "input_dp", input_dp);
+    std::string checkpoint_dir = params_["common"]["checkpoint_dir"];
+    std::string feature_sharing = params_["common"]["feature_sharing"];
+    std::vector<std::size_t> feature_bits = params_["common"]["feature_bits"];
     std::size_t paillier_n_len = params_["paillier_params"]["paillier_n_len"];
-    check_equal<std::size_t>("paillier_n_len", paillier_n_len, {1024, 2048, 3072});
-
+    std::size_t damgard_jurik_s = params_["paillier_params"]["damgard_jurik_s"];
     bool apply_packing = params_["paillier_params"]["apply_packing"];
-    check_consistency(is_sender_, io_, "apply_packing", apply_packing);
+    int group_column = params_["aggregate_params"]["group_column"];
+    bool use_precomputed_tau = params_["dp_params"]["use_precomputed_tau"];
+    bool auto_tune = params_["common"]["auto_tune"];
+    std::string point_compression = params_["ecc_params"]["point_compression"];
+
+    // the parameters that both parties must agree on.
+    json agreed_params = {{"ecc_curve_id", curve_id}, {"ids_num", ids_num}, {"input_dp", input_dp},
+            {"checkpoint", !checkpoint_dir.empty()}, {"feature_sharing_ot", feature_sharing == "ot"},
+            {"damgard_jurik_s", damgard_jurik_s}, {"apply_packing", apply_packing}, {"auto_tune", auto_tune},
+            {"point_compression", point_compression}};
     if (apply_packing) {
-        std::size_t statistical_security_bits = params_["paillier_params"]["statistical_security_bits"];
-        check_consistency(is_sender_, io_, "statistical_security_bits", statistical_security_bits);
-        check_in_range<std::size_t>("statistical_security_bits", statistical_security_bits, 40, 80);
+        agreed_params["statistical_security_bits"] = params_["paillier_params"]["statistical_security_bits"];
     }
     if (input_dp) {
-        bool use_precomputed_tau = params_["dp_params"]["use_precomputed_tau"];
-        check_consistency(is_sender_, io_, "use_precomputed_tau", use_precomputed_tau);
+        agreed_params["use_precomputed_tau"] = use_precomputed_tau;
         if (!use_precomputed_tau) {
-            double epsilon = params_["dp_params"]["epsilon"];
-            std::size_t maximum_queries = params_["dp_params"]["maximum_queries"];
-            check_consistency(is_sender_, io_, "dp_epsilon", epsilon);
-            check_consistency(is_sender_, io_, "dp_maximum_queries", maximum_queries);
-        } else {
+            agreed_params["dp_epsilon"] = params_["dp_params"]["epsilon"];
+            agreed_params["dp_maximum_queries"] = params_["dp_params"]["maximum_queries"];
+        }
+    }
+
+    // the local checks run before the handshake, so that both parties fail if either one does.
+    std::string error;
+    try {
+        check_equal<std::size_t>("curve_id", curve_id, 415);
+        if (point_compression != "auto" && point_compression != "compressed" && point_compression != "uncompressed") {
+            throw std::invalid_argument("Check equal failed.point_compression(" + point_compression +
+                                        ") is not equal to expected values (auto, compressed, uncompressed).");
+        }
+        check_in_range<std::size_t>("send_buffer_size", params_["common"]["send_buffer_size"], 0, 1ull << 30);
+        check_in_range<std::size_t>("zero_copy_threshold", params_["common"]["zero_copy_threshold"], 0, 1ull << 30);
+        check_in_range<std::size_t>("exchange_chunk_size", params_["common"]["exchange_chunk_size"], 0, 1ull << 30);
+        check_in_range<std::size_t>("socket_buffer_size", params_["common"]["socket_buffer_size"], 0, 1ull << 30);
+        check_in_range<std::size_t>("ids_num", ids_num, 1, 100);
+        if (feature_sharing != "paillier" && feature_sharing != "ot") {
+            throw std::invalid_argument("Check equal failed.feature_sharing(" + feature_sharing +
+                                        ") is not equal to expected values (paillier, ot).");
+        }
+        for (auto bits : feature_bits) {
+            check_in_range<std::size_t>("feature_bits", bits, 1, kValueBits);
+        }
+        check_equal<std::size_t>("paillier_n_len", paillier_n_len, {1024, 2048, 3072});
+        check_in_range<std::size_t>("damgard_jurik_s", damgard_jurik_s, 1, 4);
+        if (apply_packing) {
+            std::size_t statistical_security_bits = params_["paillier_params"]["statistical_security_bits"];
+            check_in_range<std::size_t>("statistical_security_bits", statistical_security_bits, 40, 80);
+        }
+        if (group_column >= 0) {
+            std::size_t group_num = params_["aggregate_params"]["group_num"];
+            check_in_range<std::size_t>("group_num", group_num, 1, 1ull << 16);
+        }
+        if (input_dp && use_precomputed_tau) {
             std::size_t precomputed_tau = params_["dp_params"]["precomputed_tau"];
             check_in_range<std::size_t>("precomputed_tau", precomputed_tau, 0, 1ull << 20);
         }
+    } catch (const std::invalid_argument& e) {
+        error = e.what();
+    }
+
+    json required_capabilities = {feature_sharing == "ot" ? "ot_sharing" : "paillier_sharing"};
+    if (damgard_jurik_s > 1) {
+        required_capabilities.push_back("damgard_jurik");
+    }
+    if (apply_packing) {
+        required_capabilities.push_back("packing");
+    }
+    if (!checkpoint_dir.empty()) {
+        required_capabilities.push_back("checkpoint");
     }
+    if (auto_tune) {
+        required_capabilities.push_back("auto_tune");
+    }
+    if (point_compression != "compressed" && (auto_tune || point_compression == "uncompressed")) {
+        required_capabilities.push_back("uncompressed_points");
+    }
+    json message = {{"version", kHandshakeVersion}, {"capabilities", get_capabilities()},
+            {"requires", required_capabilities}, {"params", agreed_params}, {"error", error},
+            {"feature_bits", feature_bits}};
+    json remote_message = exchange_handshake(is_sender_, io_, message);
+
+    // the widths of both parties' feature columns are needed to pack and to mask features.
+    std::vector<std::size_t> remote_feature_bits = remote_message.at("feature_bits");
+    sender_feature_bits_ = is_sender_ ? feature_bits : remote_feature_bits;
+    receiver_feature_bits_ = is_sender_ ? remote_feature_bits : feature_bits;
 }
 
-void DPCardinalityPSI::shuffle_and_encrypt_keys_round_one(std::vector<std::vector<ByteVector>>& encrypted_keys) {
-    encrypted_keys.reserve(plaintext_keys_.size());
+std::vector<std::string> DPCardinalityPSI::get_capabilities() {
+    return {"paillier_sharing", "ot_sharing", "damgard_jurik", "packing", "checkpoint", "auto_tune",
+            "uncompressed_points"};
+}
+
+// The other party's keys are received in the background while the own keys are encrypted chunk by chunk, and every
+// chunk is sent as soon as it is encrypted. The chunks of a column follow its length, the same as send_bytes_vector().
+void DPCardinalityPSI::shuffle_encrypt_and_exchange_keys_round_one(std::size_t received_data_size) {
+    std::size_t point_len = ecc_cipher_->get_point_len();
+    exchanged_keys_.assign(key_size_, std::vector<ByteVector>(received_data_size, ByteVector(point_len)));
+    std::vector<std::vector<iovec>> received_spans(key_size_);
     for (std::size_t key_idx = 0; key_idx < key_size_; ++key_idx) {
-        std::vector<ByteVector> encrypted_keys_i;
-        encrypted_keys_i.resize(plaintext_keys_[key_idx].size());
-        if (is_sender_) {
-            permute_and_undo(sender_permutation_, true, plaintext_keys_[key_idx]);
-        } else {
-            permute_and_undo(receiver_permutation_, true, plaintext_keys_[key_idx]);
+        for (auto& received_key : exchanged_keys_[key_idx]) {
+            received_spans[key_idx].push_back({received_key.data(), point_len});
         }
+    }
+
+    exchange_columns(received_spans, [this, point_len]() {
+        std::size_t chunk_keys = std::max<std::size_t>(exchange_chunk_size_ / point_len, 1);
+        ByteVector chunk;
+        for (std::size_t key_idx = 0; key_idx < key_size_; ++key_idx) {
+            auto& keys = plaintext_keys_[key_idx];
+            permute_and_undo((is_sender_ ? sender_permutation_ : receiver_permutation_), true, keys);
+            async_io_->send_value<std::size_t>(keys.size() * point_len);
+            for (std::size_t begin = 0; begin < keys.size(); begin += chunk_keys) {
+                std::size_t end = std::min(begin + chunk_keys, keys.size());
+                chunk.resize((end - begin) * point_len);
+                // an exception must not leave the parallel region.
+                std::exception_ptr error = nullptr;
 #pragma omp parallel for num_threads(num_threads_)
-        for (std::size_t item_idx = 0; item_idx < plaintext_keys_[key_idx].size(); ++item_idx) {
-            encrypted_keys_i[item_idx] = ecc_cipher_->hash_encrypt(plaintext_keys_[key_idx][item_idx], 0);
+                for (std::size_t item_idx = begin; item_idx < end; ++item_idx) {
+                    try {
+                        ByteVector encrypted_key = ecc_cipher_->hash_encrypt(keys[item_idx], 0);
+                        std::copy(encrypted_key.begin(), encrypted_key.end(),
+                                chunk.begin() + (item_idx - begin) * point_len);
+                    } catch (...) {
+#pragma omp critical
+                        error = std::current_exception();
+                    }
+                }
+                if (error != nullptr) {
+                    std::rethrow_exception(error);
+                }
+                async_io_->send_data(chunk.data(), chunk.size());
+            }
         }
-        encrypted_keys.emplace_back(encrypted_keys_i);
-    }
+        LOG_IF(INFO, verbose_) << "encrypt and send keys done.";
+    });
 }
 
 void DPCardinalityPSI::reshuffle_and_encrypt_exchanged_keys_round_one(
@@ -431,8 +1177,8 @@ std::size_t DPCardinalityPSI::repeatedly_match(std::size_t intersection_round_on
         std::vector<ByteVector> single_encrypted_keys;
         auto received_data_size =
                 is_sender_ ? sender_data_size_ - intersection_size : receiver_data_size_ - intersection_size;
-        exchange_single_encrypted_keys(
-                filtered_exchanged_keys_i, received_data_size, single_encrypted_keys, kEccPointLen);
+        exchange_single_encrypted_keys(filtered_exchanged_keys_i, received_data_size, single_encrypted_keys,
+                ecc_cipher_->get_point_len());
         LOG_IF(INFO, verbose_) << "send and receive encryptd keys round " << key_idx + 1 << " done.";
 
 #pragma omp parallel for num_threads(num_threads_)
@@ -509,121 +1255,149 @@ std::size_t DPCardinalityPSI::calculate_intersection_round_i(const std::vector<B
     return count;
 }
 
-void DPCardinalityPSI::shuffle_and_encrypt_features(std::vector<std::vector<ByteVector>>& encrypted_features) {
+// The other party's columns are received in the background while the own columns are encrypted chunk by chunk, and
+// every chunk is sent as soon as it is encrypted. The chunks of a column follow its length, the same as send_bytes().
+void DPCardinalityPSI::shuffle_encrypt_and_exchange_features(
+        std::size_t received_feature_size, std::vector<ByteVector>& received_features) {
+    // every column of the other party holds a ciphertext of its public key per row.
+    auto received_data_size = is_sender_ ? receiver_data_size_ : sender_data_size_;
+    const Paillier& remote_pai = *(is_sender_ ? receiver_paillier_ : sender_paillier_);
+    received_features.assign(received_feature_size, ByteVector(received_data_size * remote_pai.get_bytes_len(true)));
+    std::vector<std::vector<iovec>> received_spans;
+    for (auto& feature : received_features) {
+        received_spans.push_back({{feature.data(), feature.size()}});
+    }
+
     auto feature_size = is_sender_ ? sender_feature_size_ : receiver_feature_size_;
     auto data_size = is_sender_ ? sender_data_size_ : receiver_data_size_;
+    const Paillier& pai = *(is_sender_ ? sender_paillier_ : receiver_paillier_);
 
-    std::size_t packing_capacity = 1;
-    std::size_t raw_feature_size = feature_size;
-    if (apply_packing_) {
-        packing_capacity = is_sender_ ? (sender_paillier_.get_bytes_len(0) * 8 / slot_bits_)
-                                      : (receiver_paillier_.get_bytes_len(0) * 8 / slot_bits_);
-        feature_size = (feature_size + packing_capacity - 1) / packing_capacity;
+    // permuting plaintexts before encryption is the same as permuting ciphertexts, without moving ciphertexts.
+    for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
+        permute_and_undo(
+                (is_sender_ ? sender_permutation_ : receiver_permutation_), true, plaintext_features_[feat_idx]);
     }
 
-    encrypted_features.resize(feature_size);
-    for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
-        encrypted_features[feat_idx].resize(data_size);
+    std::vector<std::vector<PackingSlot>> packing_layout;
+    if (apply_packing_) {
+        packing_layout = get_packing_layout(pai, is_sender_ ? sender_value_bits_ : receiver_value_bits_);
+        feature_size = packing_layout.size();
     }
-    auto compute_paillier_cipher = [this, &encrypted_features, feature_size, data_size](const IpclPaillier& pai) {
-        for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
-            std::vector<BigNumber> plaintexts_bn;
-            plaintexts_bn.reserve(data_size);
-            for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
-                plaintexts_bn.emplace_back(ipcl_u64_2_bn(plaintext_features_[feat_idx][item_idx]));
-            }
-            ipcl::PlainText plaintexts(plaintexts_bn);
-            auto ciphertexts = pai.encrypt(plaintexts);
-            for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
-                encrypted_features[feat_idx][item_idx] = pai.encode(ciphertexts.getElement(item_idx), true);
-            }
-        }
-    };
 
     // shifting-and-adding.
-    // [x_0||x_1].
+    // [x_1||x_0], where every slot is as wide as its column needs.
     // support the case when feature size is bigger than single cipher's packing capacity.
-    auto compute_paillier_cipher_with_packing = [this, &encrypted_features, feature_size, data_size, packing_capacity,
-                                                        raw_feature_size](const IpclPaillier& pai) {
-        BigNumber bn_slot(BigNumber::One());
-        ipcl_bn_lshift(bn_slot, slot_bits_);
+    FixedBigNum packed_value(pai.get_plaintext_bits());
+    auto get_plaintext = [this, &packing_layout, &packed_value](std::size_t feat_idx, std::size_t item_idx) {
+        if (!apply_packing_) {
+            return ipcl_u64_2_bn(plaintext_features_[feat_idx][item_idx]);
+        }
+        packed_value.set_zero();
+        for (const auto& slot : packing_layout[feat_idx]) {
+            packed_value.set_bits(slot.offset, &plaintext_features_[slot.feature_idx][item_idx], slot.value_bits);
+        }
+        return packed_value.to_bn();
+    };
+
+    std::size_t cipher_len = pai.get_bytes_len(true);
+    std::size_t chunk_ciphers = std::max<std::size_t>(exchange_chunk_size_ / cipher_len, 1);
+    exchange_columns(received_spans, [&]() {
+        ByteVector chunk;
         for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
-            std::vector<BigNumber> plaintexts_bn;
-            plaintexts_bn.reserve(data_size);
-            std::size_t cur_packed_num = std::min(packing_capacity, raw_feature_size - feat_idx * packing_capacity);
-            for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
-                BigNumber packed_value(0);
-                packed_value += ipcl_u64_2_bn(plaintext_features_[feat_idx * packing_capacity][item_idx]);
-                for (std::size_t pack_idx = 1; pack_idx < cur_packed_num; ++pack_idx) {
-                    std::size_t raw_feat_idx = feat_idx * packing_capacity + pack_idx;
-                    packed_value *= bn_slot;
-                    packed_value += ipcl_u64_2_bn(plaintext_features_[raw_feat_idx][item_idx]);
+            async_io_->send_value<std::size_t>(data_size * cipher_len);
+            for (std::size_t begin = 0; begin < data_size; begin += chunk_ciphers) {
+                std::size_t end = std::min(begin + chunk_ciphers, data_size);
+                std::vector<BigNumber> plaintexts_bn;
+                plaintexts_bn.reserve(end - begin);
+                for (std::size_t item_idx = begin; item_idx < end; ++item_idx) {
+                    plaintexts_bn.emplace_back(get_plaintext(feat_idx, item_idx));
                 }
-                plaintexts_bn.emplace_back(packed_value);
-            }
-            ipcl::PlainText plaintexts(plaintexts_bn);
-            auto ciphertexts = pai.encrypt(plaintexts);
-            for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
-                encrypted_features[feat_idx][item_idx] = pai.encode(ciphertexts.getElement(item_idx), true);
+                ipcl::PlainText plaintexts(plaintexts_bn);
+                chunk.resize((end - begin) * cipher_len);
+                pai.encode(pai.encrypt(plaintexts), chunk.data());
+                async_io_->send_data(chunk.data(), chunk.size());
             }
         }
-    };
-
-    if (apply_packing_) {
-        compute_paillier_cipher_with_packing(is_sender_ ? sender_paillier_ : receiver_paillier_);
-    } else {
-        compute_paillier_cipher(is_sender_ ? sender_paillier_ : receiver_paillier_);
-    }
-    LOG_IF(INFO, verbose_) << "encrypt features done.";
-
-    for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
-        permute_and_undo(
-                (is_sender_ ? sender_permutation_ : receiver_permutation_), true, encrypted_features[feat_idx]);
-    }
+        LOG_IF(INFO, verbose_) << "encrypt and send features done.";
+    });
 }
 
-void DPCardinalityPSI::filter_intersection_features(const std::vector<std::vector<ByteVector>>& encrypted_features,
-        std::size_t intersection_size, std::vector<std::vector<ByteVector>>& intersection_features) {
-    if (encrypted_features.empty()) {
-        return;
-    }
+std::vector<std::size_t> DPCardinalityPSI::get_intersection_permutation() const {
     std::vector<std::pair<ByteVector, std::size_t>> intersection_keys;
-    std::size_t feature_size = encrypted_features.size();
-    std::size_t data_size = encrypted_features.empty() ? 0 : encrypted_features[0].size();
-    intersection_keys.reserve(intersection_size);
-    intersection_features.reserve(feature_size);
-
-    // select intersection keys and intersection features.
-    // intersection keys from different columns will be merged into one column as the final intersection set.
-    std::size_t index_counter = 0;
     for (std::size_t item_idx = 0; item_idx < intersection_indices_.size(); ++item_idx) {
         if (intersection_indices_[item_idx].first) {
-            intersection_keys.emplace_back(intersection_indices_[item_idx].second, index_counter++);
+            intersection_keys.emplace_back(intersection_indices_[item_idx].second, item_idx);
+        }
+    }
+    // intersection keys from different columns are merged into one column as the final intersection set.
+    std::sort(intersection_keys.begin(), intersection_keys.end());
+
+    std::vector<std::size_t> permutation;
+    permutation.reserve(intersection_indices_.size());
+    for (const auto& intersection_key : intersection_keys) {
+        permutation.emplace_back(intersection_key.second);
+    }
+    for (std::size_t item_idx = 0; item_idx < intersection_indices_.size(); ++item_idx) {
+        if (!intersection_indices_[item_idx].first) {
+            permutation.emplace_back(item_idx);
         }
     }
+    return permutation;
+}
 
-    std::vector<ByteVector> intersection_features_buffer;
-    intersection_features_buffer.reserve(intersection_size);
+// The feature columns of the sender are switched first, where the sender holds the values and the receiver holds the
+// permutation. Then the roles are swapped for the feature columns of the receiver.
+void DPCardinalityPSI::share_features_with_ot(
+        std::size_t intersection_size, std::vector<std::vector<std::uint64_t>>& shares) {
+    auto feature_size = is_sender_ ? sender_feature_size_ : receiver_feature_size_;
     for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
-        for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
-            if (intersection_indices_[item_idx].first) {
-                intersection_features_buffer.emplace_back(encrypted_features[feat_idx][item_idx]);
-            }
+        permute_and_undo(
+                (is_sender_ ? sender_permutation_ : receiver_permutation_), true, plaintext_features_[feat_idx]);
+    }
+    std::vector<std::size_t> permutation = get_intersection_permutation();
+
+    ObliviousSwitchingNetwork osn(io_);
+    std::vector<std::vector<std::uint64_t>> sender_shares;
+    std::vector<std::vector<std::uint64_t>> receiver_shares;
+    if (sender_feature_size_ != 0) {
+        if (is_sender_) {
+            osn.send(plaintext_features_, intersection_size, sender_shares);
+        } else {
+            osn.recv(permutation, sender_feature_size_, intersection_size, sender_shares);
         }
-        intersection_features.emplace_back(intersection_features_buffer);
-        intersection_features_buffer.clear();
+        LOG_IF(INFO, verbose_) << "switch sender features done.";
+    }
+    if (receiver_feature_size_ != 0) {
+        if (is_sender_) {
+            osn.recv(permutation, receiver_feature_size_, intersection_size, receiver_shares);
+        } else {
+            osn.send(plaintext_features_, intersection_size, receiver_shares);
+        }
+        LOG_IF(INFO, verbose_) << "switch receiver features done.";
     }
 
-    // sort intersection keys and intersection features.
-    std::sort(intersection_keys.begin(), intersection_keys.end());
-    std::vector<std::size_t> sort_permutation;
-    sort_permutation.reserve(intersection_size);
-    for (std::size_t item_idx = 0; item_idx < intersection_size; ++item_idx) {
-        sort_permutation.emplace_back(intersection_keys[item_idx].second);
+    shares.reserve(sender_feature_size_ + receiver_feature_size_);
+    for (auto& column : sender_shares) {
+        shares.emplace_back(std::move(column));
+    }
+    for (auto& column : receiver_shares) {
+        shares.emplace_back(std::move(column));
     }
+}
 
-    for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
-        permute_and_undo(sort_permutation, false, intersection_features[feat_idx]);
+void DPCardinalityPSI::filter_intersection_features(const std::vector<ByteVector>& encrypted_features,
+        std::size_t cipher_len, std::size_t intersection_size, std::vector<ByteVector>& intersection_features) {
+    if (encrypted_features.empty()) {
+        return;
+    }
+    std::vector<std::size_t> permutation = get_intersection_permutation();
+    intersection_features.resize(encrypted_features.size());
+    for (std::size_t feat_idx = 0; feat_idx < encrypted_features.size(); ++feat_idx) {
+        intersection_features[feat_idx].resize(intersection_size * cipher_len);
+        for (std::size_t item_idx = 0; item_idx < intersection_size; ++item_idx) {
+            std::memcpy(intersection_features[feat_idx].data() + item_idx * cipher_len,
+                    encrypted_features[feat_idx].data() + permutation[item_idx] * cipher_len, cipher_len);
+        }
     }
 }
 
@@ -651,407 +1425,298 @@ void DPCardinalityPSI::filter_intersection_features(const std::vector<std::vecto
 //             res = (((x_1||x_0) + (r_1||r_0)) mod n
 //             x_0: res mod 2^l
 //             x_1: (res >> (l+delta+1) mod 2^l.
-void DPCardinalityPSI::generate_additive_shares(IpclPaillier& paillier,
-        std::vector<std::vector<ByteVector>>& encrypted_features, std::vector<std::vector<BigNumber>>& random_r) {
+void DPCardinalityPSI::generate_additive_shares(Paillier& paillier,
+        std::vector<ByteVector>& encrypted_features, std::vector<std::vector<std::uint64_t>>& random_r) {
     auto feature_size = encrypted_features.size();
-    auto data_size = encrypted_features.empty() ? 0 : encrypted_features[0].size();
+    auto data_size = encrypted_features.empty() ? 0 : encrypted_features[0].size() / paillier.get_bytes_len(true);
     BigNumber two_power_l(BigNumber::One());
     ipcl_bn_lshift(two_power_l, kValueBits);
     BigNumber n_minus_l = paillier.n() - two_power_l;
     std::size_t n_len = paillier.get_bytes_len(0);
     std::size_t raw_feature_size = is_sender_ ? receiver_feature_size_ : sender_feature_size_;
 
-    std::size_t packing_capacity = apply_packing_ ? (n_len * 8 / slot_bits_) : 1;
-
-    BigNumber mask_minus_l;
-    if (apply_packing_) {
-        BigNumber two_power_k_minus_one(BigNumber::One());
-        ipcl_bn_lshift(two_power_k_minus_one, (slot_bits_ - 1));
-        mask_minus_l = two_power_k_minus_one - two_power_l;
-    } else {
-        mask_minus_l = n_minus_l;
+    // only r mod 2^l is needed to reveal shares, it is kept for every raw feature column.
+    random_r.resize(raw_feature_size);
+    for (auto& random_r_i : random_r) {
+        random_r_i.reserve(data_size);
     }
-
-    random_r.reserve(feature_size);
     std::vector<BigNumber> random_r_buffer;
     random_r_buffer.reserve(data_size);
-    std::vector<BigNumber> encrypted_features_buffer;
-    encrypted_features_buffer.reserve(data_size);
 
-    // shifting-and-adding.
+    // shifting-and-adding on fixed-width limbs.
+    // every r_i of a column of w bits is uniformly sampled from [2^w, 2^(slot_bits - 1)) by rejecting the values below
+    // 2^w, where slot_bits - 1 is w + delta, plus the headroom of sums in aggregate mode.
     if (apply_packing_) {
-        std::size_t mask_bits = kValueBits + statistical_security_bits_;
-        BigNumber bn_slot(BigNumber::One());
-        ipcl_bn_lshift(bn_slot, slot_bits_);
+        auto packing_layout = get_packing_layout(paillier, is_sender_ ? receiver_value_bits_ : sender_value_bits_);
+        std::vector<std::uint64_t> r_i((get_slot_bits(kValueBits) + 63) / 64, 0);
+        PRNG prng(read_block_from_dev_urandom());
+        FixedBigNum r(paillier.get_plaintext_bits());
         for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
-            std::size_t cur_packed_num = std::min(packing_capacity, raw_feature_size - feat_idx * packing_capacity);
             for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
-                BigNumber r = two_power_l + (ipcl::getRandomBN(static_cast<int>(mask_bits)) % mask_minus_l);
-                for (std::size_t pack_idx = 1; pack_idx < cur_packed_num; ++pack_idx) {
-                    r *= bn_slot;
-                    r += two_power_l + (ipcl::getRandomBN(static_cast<int>(mask_bits)) % mask_minus_l);
+                r.set_zero();
+                for (const auto& slot : packing_layout[feat_idx]) {
+                    std::size_t mask_bits = get_slot_bits(slot.value_bits) - 1;
+                    std::size_t mask_limbs = (mask_bits + 63) / 64;
+                    std::uint64_t top_limb_mask =
+                            (mask_bits % 64 == 0) ? ~std::uint64_t(0) : ((std::uint64_t(1) << (mask_bits % 64)) - 1);
+                    std::size_t value_limb = slot.value_bits / 64;
+                    bool above_two_power_w = false;
+                    while (!above_two_power_w) {
+                        prng.get<std::uint64_t>(r_i.data(), mask_limbs);
+                        r_i[mask_limbs - 1] &= top_limb_mask;
+                        above_two_power_w =
+                                (value_limb < mask_limbs && (r_i[value_limb] >> (slot.value_bits % 64)) != 0) ||
+                                std::any_of(r_i.begin() + std::min(value_limb + 1, mask_limbs),
+                                        r_i.begin() + mask_limbs, [](std::uint64_t limb) { return limb != 0; });
+                    }
+                    r.set_bits(slot.offset, r_i.data(), mask_bits);
+                    random_r[slot.feature_idx].emplace_back(r_i[0]);
                 }
-                random_r_buffer.emplace_back(r);
-                encrypted_features_buffer.emplace_back(paillier.decode(encrypted_features[feat_idx][item_idx]));
+                random_r_buffer.emplace_back(r.to_bn());
             }
             ipcl::PlainText plaintexts_r(random_r_buffer);
-            ipcl::CipherText ciphertexts_encrypted_features(*paillier.get_pk(), encrypted_features_buffer);
-            auto additive_share = paillier.add(ciphertexts_encrypted_features, plaintexts_r);
-            for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
-                encrypted_features[feat_idx][item_idx] = paillier.encode(additive_share.getElement(item_idx), true);
-            }
-            random_r.emplace_back(random_r_buffer);
+            auto additive_share =
+                    paillier.add(paillier.decode(encrypted_features[feat_idx].data(), data_size), plaintexts_r);
+            paillier.encode(additive_share, encrypted_features[feat_idx].data());
             random_r_buffer.clear();
-            encrypted_features_buffer.clear();
         }
     } else {
         for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
             for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
-                BigNumber r = two_power_l + (ipcl::getRandomBN(static_cast<int>(n_len)) % n_minus_l);
+                BigNumber r = two_power_l + (ipcl_random_bn(static_cast<int>(n_len)) % n_minus_l);
+                random_r[feat_idx].emplace_back(ipcl_bn_2_u64(r));
                 random_r_buffer.emplace_back(r);
-                encrypted_features_buffer.emplace_back(paillier.decode(encrypted_features[feat_idx][item_idx]));
             }
             ipcl::PlainText plaintexts_r(random_r_buffer);
-            ipcl::CipherText ciphertexts_encrypted_features(*paillier.get_pk(), encrypted_features_buffer);
-            auto additive_share = paillier.add(ciphertexts_encrypted_features, plaintexts_r);
-            for (std::size_t item_idx = 0; item_idx < data_size; ++item_idx) {
-                encrypted_features[feat_idx][item_idx] = paillier.encode(additive_share.getElement(item_idx), true);
-            }
-            random_r.emplace_back(random_r_buffer);
+            auto additive_share =
+                    paillier.add(paillier.decode(encrypted_features[feat_idx].data(), data_size), plaintexts_r);
+            paillier.encode(additive_share, encrypted_features[feat_idx].data());
             random_r_buffer.clear();
-            encrypted_features_buffer.clear();
         }
     }
 }
 
-void DPCardinalityPSI::decrypt_and_reveal_shares(const std::vector<std::vector<ByteVector>>& encrypetd_shares,
-        const std::vector<std::vector<BigNumber>>& random_r, std::size_t intersection_size,
+void DPCardinalityPSI::decrypt_and_reveal_shares(const std::vector<ByteVector>& encrypetd_shares,
+        const std::vector<std::vector<std::uint64_t>>& random_r, std::size_t intersection_size,
         std::vector<std::vector<std::uint64_t>>& shares) {
     std::size_t total_feature_size = sender_feature_size_ + receiver_feature_size_;
     shares.reserve(total_feature_size);
-    BigNumber modulus(BigNumber::One());
-    ipcl_bn_lshift(modulus, kValueBits);
 
-    auto compute_a = [&shares, &intersection_size, &random_r, &modulus](
-                             const IpclPaillier& paillier, std::size_t feature_size) {
+    // -r mod n reduces to -r mod 2^l, with or without packing, since every slot is at least l bits wide.
+    auto compute_a = [&shares, &intersection_size, &random_r]() {
         std::vector<std::uint64_t> shares_buffer;
         shares_buffer.reserve(intersection_size);
-        BigNumber n = paillier.n();
-        BigNumber n_mod_modulus = n % modulus;
-        for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
+        for (std::size_t feat_idx = 0; feat_idx < random_r.size(); ++feat_idx) {
             for (std::size_t item_idx = 0; item_idx < intersection_size; ++item_idx) {
-                BigNumber a = (n - random_r[feat_idx][item_idx]) % modulus;
-                a = (a + modulus - n_mod_modulus) % modulus;
-                shares_buffer.emplace_back(ipcl_bn_2_u64(a));
+                shares_buffer.emplace_back(std::uint64_t(0) - random_r[feat_idx][item_idx]);
             }
             shares.emplace_back(shares_buffer);
             shares_buffer.clear();
         }
     };
 
-    auto compute_a_with_packing = [&shares, &intersection_size, &random_r, &modulus](std::size_t feature_size,
-                                          std::size_t raw_feature_size, std::size_t packing_capacity,
-                                          std::size_t slot_bits) {
-        std::vector<std::vector<std::uint64_t>> shares_buffer;
-        shares_buffer.resize(packing_capacity);
-        for (std::size_t pack_idx = 0; pack_idx < packing_capacity; ++pack_idx) {
-            shares_buffer[pack_idx].reserve(intersection_size);
-        }
-        BigNumber slot_modulus(BigNumber::One());
-        ipcl_bn_lshift(slot_modulus, slot_bits);
-        for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
-            std::size_t cur_packed_num = std::min(packing_capacity, raw_feature_size - feat_idx * packing_capacity);
-            for (std::size_t item_idx = 0; item_idx < intersection_size; ++item_idx) {
-                BigNumber r = random_r[feat_idx][item_idx];
-                BigNumber a = (slot_modulus - (r % slot_modulus)) % modulus;
-                // slot_modulus % modulus == 0
-                shares_buffer[cur_packed_num - 1].emplace_back(ipcl_bn_2_u64(a));
-                for (std::size_t pack_idx = 1; pack_idx < cur_packed_num; ++pack_idx) {
-                    r /= slot_modulus;
-                    a = (slot_modulus - (r % slot_modulus)) % modulus;
-                    shares_buffer[cur_packed_num - 1 - pack_idx].emplace_back(ipcl_bn_2_u64(a));
-                }
-            }
-            for (std::size_t pack_idx = 0; pack_idx < cur_packed_num; ++pack_idx) {
-                shares.emplace_back(shares_buffer[pack_idx]);
-                shares_buffer[pack_idx].clear();
-            }
-        }
-    };
-
-    auto compute_b = [&shares, &intersection_size, &encrypetd_shares, &modulus](
-                             const IpclPaillier& paillier, std::size_t feature_size) {
+    auto compute_b = [&shares, &intersection_size, &encrypetd_shares](
+                             const Paillier& paillier, std::size_t feature_size) {
         std::vector<std::uint64_t> shares_buffer;
         shares_buffer.reserve(intersection_size);
-        std::vector<BigNumber> encrypetd_shares_buffer;
-        encrypetd_shares_buffer.reserve(intersection_size);
         for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
+            auto plaintexts_shares =
+                    paillier.decrypt(paillier.decode(encrypetd_shares[feat_idx].data(), intersection_size));
             for (std::size_t item_idx = 0; item_idx < intersection_size; ++item_idx) {
-                encrypetd_shares_buffer.emplace_back(paillier.decode(encrypetd_shares[feat_idx][item_idx]));
-            }
-            ipcl::CipherText ciphertexts_shares(*paillier.get_pk(), encrypetd_shares_buffer);
-            auto plaintexts_shares = paillier.decrypt(ciphertexts_shares);
-            for (std::size_t item_idx = 0; item_idx < intersection_size; ++item_idx) {
-                BigNumber b = plaintexts_shares.getElement(item_idx) % modulus;
-                shares_buffer.emplace_back(ipcl_bn_2_u64(b));
+                shares_buffer.emplace_back(ipcl_bn_2_u64(plaintexts_shares.getElement(item_idx)));
             }
             shares.emplace_back(shares_buffer);
             shares_buffer.clear();
-            encrypetd_shares_buffer.clear();
         }
     };
 
-    auto compute_b_with_packing = [&shares, &intersection_size, &encrypetd_shares, &modulus](
-                                          const IpclPaillier& paillier, std::size_t feature_size,
-                                          std::size_t raw_feature_size, std::size_t packing_capacity,
-                                          std::size_t slot_bits) {
+    // x_i + r_i fills its slot, reading the low 64 bits of the slot reveals b_i.
+    auto compute_b_with_packing = [this, &shares, &intersection_size, &encrypetd_shares](const Paillier& paillier,
+                                          const std::vector<std::vector<PackingSlot>>& packing_layout,
+                                          std::size_t raw_feature_size) {
         std::vector<std::vector<std::uint64_t>> shares_buffer;
-        shares_buffer.resize(packing_capacity);
-        for (std::size_t pack_idx = 0; pack_idx < packing_capacity; ++pack_idx) {
-            shares_buffer[pack_idx].reserve(intersection_size);
-        }
-        std::vector<BigNumber> encrypetd_shares_buffer;
-        encrypetd_shares_buffer.reserve(intersection_size);
-        BigNumber slot_modulus(BigNumber::One());
-        ipcl_bn_lshift(slot_modulus, slot_bits);
-        for (std::size_t feat_idx = 0; feat_idx < feature_size; ++feat_idx) {
-            std::size_t cur_packed_num = std::min(packing_capacity, raw_feature_size - feat_idx * packing_capacity);
-            for (std::size_t item_idx = 0; item_idx < intersection_size; ++item_idx) {
-                encrypetd_shares_buffer.emplace_back(paillier.decode(encrypetd_shares[feat_idx][item_idx]));
-            }
-            ipcl::CipherText ciphertexts_shares(*paillier.get_pk(), encrypetd_shares_buffer);
-            auto plaintexts_shares = paillier.decrypt(ciphertexts_shares);
+        shares_buffer.resize(raw_feature_size);
+        for (std::size_t raw_feat_idx = 0; raw_feat_idx < raw_feature_size; ++raw_feat_idx) {
+            shares_buffer[raw_feat_idx].reserve(intersection_size);
+        }
+        FixedBigNum x_plus_r(paillier.get_bytes_len(0) * 8);
+        for (std::size_t feat_idx = 0; feat_idx < packing_layout.size(); ++feat_idx) {
+            auto plaintexts_shares =
+                    paillier.decrypt(paillier.decode(encrypetd_shares[feat_idx].data(), intersection_size));
 
             for (std::size_t item_idx = 0; item_idx < intersection_size; ++item_idx) {
-                BigNumber x_plus_r = plaintexts_shares.getElement(item_idx);
-                BigNumber b = (x_plus_r % slot_modulus) % modulus;
-                shares_buffer[cur_packed_num - 1].emplace_back(ipcl_bn_2_u64(b));
-                for (std::size_t pack_idx = 1; pack_idx < cur_packed_num; ++pack_idx) {
-                    x_plus_r /= slot_modulus;
-                    b = (x_plus_r % slot_modulus) % modulus;
-                    shares_buffer[cur_packed_num - 1 - pack_idx].emplace_back(ipcl_bn_2_u64(b));
+                x_plus_r.from_bn(plaintexts_shares.getElement(item_idx));
+                for (const auto& slot : packing_layout[feat_idx]) {
+                    std::size_t slot_bits = get_slot_bits(slot.value_bits);
+                    std::uint64_t slot_mask =
+                            (slot_bits >= 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << slot_bits) - 1);
+                    shares_buffer[slot.feature_idx].emplace_back(x_plus_r.get_u64(slot.offset) & slot_mask);
                 }
             }
-            for (std::size_t pack_idx = 0; pack_idx < cur_packed_num; ++pack_idx) {
-                shares.emplace_back(shares_buffer[pack_idx]);
-                shares_buffer[pack_idx].clear();
-            }
+        }
+        for (auto& shares_i : shares_buffer) {
+            shares.emplace_back(std::move(shares_i));
         }
     };
 
     if (apply_packing_) {
-        std::size_t sender_packing_capacity = sender_paillier_.get_bytes_len(0) * 8 / slot_bits_;
-        std::size_t receiver_packing_capacity = receiver_paillier_.get_bytes_len(0) * 8 / slot_bits_;
         if (is_sender_) {
-            compute_b_with_packing(sender_paillier_, encrypetd_shares.size(), sender_feature_size_,
-                    sender_packing_capacity, slot_bits_);
-            compute_a_with_packing(random_r.size(), receiver_feature_size_, receiver_packing_capacity, slot_bits_);
+            compute_b_with_packing(*sender_paillier_, get_packing_layout(*sender_paillier_, sender_value_bits_),
+                    sender_feature_size_);
+            compute_a();
         } else {
-            compute_a_with_packing(random_r.size(), sender_feature_size_, sender_packing_capacity, slot_bits_);
-            compute_b_with_packing(receiver_paillier_, encrypetd_shares.size(), receiver_feature_size_,
-                    receiver_packing_capacity, slot_bits_);
+            compute_a();
+            compute_b_with_packing(*receiver_paillier_, get_packing_layout(*receiver_paillier_, receiver_value_bits_),
+                    receiver_feature_size_);
         }
     } else {
         if (is_sender_) {
-            compute_b(sender_paillier_, sender_feature_size_);
-            compute_a(receiver_paillier_, receiver_feature_size_);
+            compute_b(*sender_paillier_, sender_feature_size_);
+            compute_a();
         } else {
-            compute_a(sender_paillier_, sender_feature_size_);
-            compute_b(receiver_paillier_, receiver_feature_size_);
+            compute_a();
+            compute_b(*receiver_paillier_, receiver_feature_size_);
         }
     }
 }
 
-void DPCardinalityPSI::exchange_encrypted_keys(const std::vector<std::vector<ByteVector>>& encrypted_keys,
-        std::size_t key_size, std::size_t received_data_size, std::vector<std::vector<ByteVector>>& received_keys,
-        std::size_t point_len) {
-    std::size_t self_data_size = encrypted_keys[0].size();
+// Public keys are identified by fingerprints, so a public key cached in the peer's key store is not sent again.
+void DPCardinalityPSI::exchange_paillier_pk(const PaillierKeyStore& key_store, bool enable_djn) {
+    Paillier& self_paillier = *(is_sender_ ? sender_paillier_ : receiver_paillier_);
+    Paillier& remote_paillier = *(is_sender_ ? receiver_paillier_ : sender_paillier_);
+    ByteVector self_pk = self_paillier.export_pk();
+    ByteVector self_fingerprint = PaillierKeyStore::fingerprint(self_pk, enable_djn);
+
+    bool remote_enable_djn = false;
+    ByteVector remote_fingerprint;
+    bool self_pk_cached = false;
+    bool remote_pk_cached = false;
     if (is_sender_) {
-        ByteVector encrypted_keys_buffer;
-        encrypted_keys_buffer.reserve(self_data_size * point_len);
-        for (std::size_t key_idx = 0; key_idx < key_size; ++key_idx) {
-            for (const auto& key : encrypted_keys[key_idx]) {
-                encrypted_keys_buffer.insert(encrypted_keys_buffer.end(), key.begin(), key.end());
-            }
-            io_->send_bytes(encrypted_keys_buffer);
-            encrypted_keys_buffer.clear();
-        }
-        LOG_IF(INFO, verbose_) << "sender sent encryptd keys.";
-
-        received_keys.reserve(key_size);
-
-        ByteVector received_keys_buffer;
-        received_keys_buffer.reserve(received_data_size * point_len);
+        io_->send_value<bool>(enable_djn);
+        io_->send_bytes(self_fingerprint);
 
-        std::vector<ByteVector> received_keys_i;
-        received_keys_i.reserve(received_data_size);
+        remote_enable_djn = io_->recv_value<bool>();
+        io_->recv_bytes(remote_fingerprint);
+        self_pk_cached = io_->recv_value<bool>();
 
-        for (std::size_t key_idx = 0; key_idx < key_size; ++key_idx) {
-            io_->recv_bytes(received_keys_buffer);
-            for (std::size_t item_idx = 0; item_idx < received_data_size; ++item_idx) {
-                received_keys_i.emplace_back(received_keys_buffer.begin() + item_idx * point_len,
-                        received_keys_buffer.begin() + (item_idx + 1) * point_len);
-            }
-            received_keys_buffer.clear();
-            received_keys.emplace_back(received_keys_i);
-            received_keys_i.clear();
-        }
-        LOG_IF(INFO, verbose_) << "sender received encryptd keys.";
+        remote_pk_cached = key_store.load_peer_pk(remote_fingerprint, remote_enable_djn, remote_paillier);
+        io_->send_value<bool>(remote_pk_cached);
     } else {
-        received_keys.reserve(key_size);
+        remote_enable_djn = io_->recv_value<bool>();
+        io_->recv_bytes(remote_fingerprint);
+        remote_pk_cached = key_store.load_peer_pk(remote_fingerprint, remote_enable_djn, remote_paillier);
 
-        ByteVector received_keys_buffer;
-        received_keys_buffer.reserve(received_data_size * point_len);
+        io_->send_value<bool>(enable_djn);
+        io_->send_bytes(self_fingerprint);
+        io_->send_value<bool>(remote_pk_cached);
 
-        std::vector<ByteVector> received_keys_i;
-        received_keys_i.reserve(received_data_size);
+        self_pk_cached = io_->recv_value<bool>();
+    }
+    LOG_IF(INFO, verbose_) << "paillier pk cached by remote: " << self_pk_cached
+                           << ", remote paillier pk cached: " << remote_pk_cached;
 
-        for (std::size_t key_idx = 0; key_idx < key_size; ++key_idx) {
-            io_->recv_bytes(received_keys_buffer);
-            for (std::size_t item_idx = 0; item_idx < received_data_size; ++item_idx) {
-                received_keys_i.emplace_back(received_keys_buffer.begin() + item_idx * point_len,
-                        received_keys_buffer.begin() + (item_idx + 1) * point_len);
-            }
-            received_keys_buffer.clear();
-            received_keys.emplace_back(received_keys_i);
-            received_keys_i.clear();
+    auto send_pk = [this, &self_pk, self_pk_cached]() {
+        if (!self_pk_cached) {
+            io_->send_bytes(self_pk);
+            LOG_IF(INFO, verbose_) << (is_sender_ ? "sender" : "receiver") << " sent paillier pk";
         }
-        LOG_IF(INFO, verbose_) << "receiver received encryptd keys.";
-
-        ByteVector encrypted_keys_buffer;
-        encrypted_keys_buffer.reserve(self_data_size * point_len);
-        for (std::size_t key_idx = 0; key_idx < key_size; ++key_idx) {
-            for (const auto& key : encrypted_keys[key_idx]) {
-                encrypted_keys_buffer.insert(encrypted_keys_buffer.end(), key.begin(), key.end());
+    };
+    auto recv_pk = [this, &key_store, &remote_paillier, &remote_fingerprint, remote_enable_djn, remote_pk_cached]() {
+        if (!remote_pk_cached) {
+            ByteVector remote_pk;
+            io_->recv_bytes(remote_pk);
+            if (PaillierKeyStore::fingerprint(remote_pk, remote_enable_djn) != remote_fingerprint) {
+                throw std::runtime_error("paillier pk does not match its fingerprint");
             }
-            io_->send_bytes(encrypted_keys_buffer);
-            encrypted_keys_buffer.clear();
+            remote_paillier.import_pk(remote_pk, remote_enable_djn);
+            key_store.save_peer_pk(remote_pk, remote_enable_djn);
+            LOG_IF(INFO, verbose_) << (is_sender_ ? "sender" : "receiver") << " received paillier pk";
         }
-        LOG_IF(INFO, verbose_) << "receiver sent encryptd keys.";
+    };
+
+    if (is_sender_) {
+        send_pk();
+        recv_pk();
+    } else {
+        recv_pk();
+        send_pk();
     }
 }
 
+// Keys are sent by scatter-gather I/O and received in place, without flattening them into one buffer.
 void DPCardinalityPSI::exchange_single_encrypted_keys(const std::vector<ByteVector>& encrypted_keys,
         std::size_t received_data_size, std::vector<ByteVector>& received_keys, std::size_t point_len) {
-    std::size_t self_data_size = encrypted_keys[0].size();
-    if (is_sender_) {
-        ByteVector encrypted_keys_buffer;
-        encrypted_keys_buffer.reserve(self_data_size * point_len);
-        for (const auto& key : encrypted_keys) {
-            encrypted_keys_buffer.insert(encrypted_keys_buffer.end(), key.begin(), key.end());
-        }
-        io_->send_bytes(encrypted_keys_buffer);
-        encrypted_keys_buffer.clear();
-        LOG_IF(INFO, verbose_) << "sender sent single column's encryptd keys.";
-
-        ByteVector received_keys_buffer;
-        received_keys_buffer.reserve(received_data_size * point_len);
-
-        received_keys.reserve(received_data_size);
-
-        io_->recv_bytes(received_keys_buffer);
-        for (std::size_t item_idx = 0; item_idx < received_data_size; ++item_idx) {
-            received_keys.emplace_back(received_keys_buffer.begin() + item_idx * point_len,
-                    received_keys_buffer.begin() + (item_idx + 1) * point_len);
-        }
-        received_keys_buffer.clear();
-        LOG_IF(INFO, verbose_) << "sender received single column's encryptd keys.";
-    } else {
-        ByteVector received_keys_buffer;
-        received_keys_buffer.reserve(received_data_size * point_len);
-
-        received_keys.reserve(received_data_size);
-
-        io_->recv_bytes(received_keys_buffer);
-        for (std::size_t item_idx = 0; item_idx < received_data_size; ++item_idx) {
-            received_keys.emplace_back(received_keys_buffer.begin() + item_idx * point_len,
-                    received_keys_buffer.begin() + (item_idx + 1) * point_len);
-        }
-        received_keys_buffer.clear();
-        LOG_IF(INFO, verbose_) << "receiver received single column's encryptd keys.";
-
-        ByteVector encrypted_keys_buffer;
-        encrypted_keys_buffer.reserve(self_data_size * point_len);
-        for (const auto& key : encrypted_keys) {
-            encrypted_keys_buffer.insert(encrypted_keys_buffer.end(), key.begin(), key.end());
-        }
-        io_->send_bytes(encrypted_keys_buffer);
-        encrypted_keys_buffer.clear();
-        LOG_IF(INFO, verbose_) << "receiver sent single column's encryptd keys.";
+    received_keys.assign(received_data_size, ByteVector(point_len));
+    std::vector<std::vector<iovec>> received_spans(1);
+    for (auto& received_key : received_keys) {
+        received_spans[0].push_back({received_key.data(), point_len});
     }
+    exchange_columns(received_spans, [this, &encrypted_keys]() { async_io_->send_bytes_vector(encrypted_keys); });
+    LOG_IF(INFO, verbose_) << "send and receive single column's encryptd keys done.";
 }
 
-void DPCardinalityPSI::exchange_encrypted_features(const std::vector<std::vector<ByteVector>>& encrypted_features,
-        std::size_t self_paillier_len, std::size_t remote_paillier_len, std::size_t received_feature_size,
-        std::size_t received_data_size, std::vector<std::vector<ByteVector>>& received_features) {
-    std::size_t self_feature_size = encrypted_features.size();
-    std::size_t self_data_size = encrypted_features.empty() ? 0 : encrypted_features[0].size();
-    if (is_sender_) {
-        ByteVector encrypted_features_buffer;
-        encrypted_features_buffer.reserve(self_data_size * self_paillier_len);
-        for (std::size_t feat_idx = 0; feat_idx < self_feature_size; ++feat_idx) {
-            for (const auto& feature : encrypted_features[feat_idx]) {
-                encrypted_features_buffer.insert(encrypted_features_buffer.end(), feature.begin(), feature.end());
-            }
-            io_->send_bytes(encrypted_features_buffer);
-            encrypted_features_buffer.clear();
+// Every column is a contiguous buffer of ciphertexts, which is sent and received as it is.
+void DPCardinalityPSI::exchange_encrypted_features(const std::vector<ByteVector>& encrypted_features,
+        std::size_t received_feature_size, std::size_t received_column_len,
+        std::vector<ByteVector>& received_features) {
+    received_features.assign(received_feature_size, ByteVector(received_column_len));
+    std::vector<std::vector<iovec>> received_spans;
+    for (auto& feature : received_features) {
+        received_spans.push_back({{feature.data(), feature.size()}});
+    }
+    exchange_columns(received_spans, [this, &encrypted_features]() {
+        for (const auto& feature : encrypted_features) {
+            async_io_->send_bytes(feature);
         }
+    });
+}
 
-        received_features.reserve(received_feature_size);
-
-        ByteVector received_features_buffer;
-        received_features_buffer.reserve(received_data_size * remote_paillier_len);
-
-        std::vector<ByteVector> received_features_i;
-        received_features_i.reserve(received_data_size);
-
-        for (std::size_t feat_idx = 0; feat_idx < received_feature_size; ++feat_idx) {
-            io_->recv_bytes(received_features_buffer);
-            for (std::size_t item_idx = 0; item_idx < received_data_size; ++item_idx) {
-                received_features_i.emplace_back(received_features_buffer.begin() + item_idx * remote_paillier_len,
-                        received_features_buffer.begin() + (item_idx + 1) * remote_paillier_len);
+// The receives are queued before the first send, so that the reader drains the other party's columns while this
+// party's sends wait for the link, whatever the sizes of the columns.
+void DPCardinalityPSI::exchange_columns(
+        const std::vector<std::vector<iovec>>& received_spans, const std::function<void()>& send_columns) {
+    std::vector<std::size_t> received_lens(received_spans.size(), 0);
+    std::vector<std::future<void>> receiving;
+    receiving.reserve(2 * received_spans.size());
+    for (std::size_t column_idx = 0; column_idx < received_spans.size(); ++column_idx) {
+        const auto& spans = received_spans[column_idx];
+        receiving.emplace_back(async_io_->recv_data_async(&received_lens[column_idx], sizeof(std::size_t)));
+        receiving.emplace_back(async_io_->recv_data_vector_async(spans.data(), spans.size()));
+    }
+    try {
+        send_columns();
+        async_io_->flush();
+        for (std::size_t column_idx = 0; column_idx < received_spans.size(); ++column_idx) {
+            receiving[2 * column_idx].get();
+            std::size_t column_len = 0;
+            for (const auto& span : received_spans[column_idx]) {
+                column_len += span.iov_len;
             }
-            received_features_buffer.clear();
-            received_features.emplace_back(received_features_i);
-            received_features_i.clear();
-        }
-    } else {
-        received_features.reserve(received_data_size);
-
-        ByteVector received_features_buffer;
-        received_features_buffer.reserve(received_data_size * remote_paillier_len);
-
-        std::vector<ByteVector> received_features_i;
-        received_features_i.reserve(received_data_size);
-
-        for (std::size_t feat_idx = 0; feat_idx < received_feature_size; ++feat_idx) {
-            io_->recv_bytes(received_features_buffer);
-            for (std::size_t item_idx = 0; item_idx < received_data_size; ++item_idx) {
-                received_features_i.emplace_back(received_features_buffer.begin() + item_idx * remote_paillier_len,
-                        received_features_buffer.begin() + (item_idx + 1) * remote_paillier_len);
+            if (received_lens[column_idx] != column_len) {
+                throw std::runtime_error("unexpected length of a received column");
             }
-            received_features_buffer.clear();
-            received_features.emplace_back(received_features_i);
-            received_features_i.clear();
+            receiving[2 * column_idx + 1].get();
         }
-
-        ByteVector encrypted_features_buffer;
-        encrypted_features_buffer.reserve(self_data_size * self_paillier_len);
-        for (std::size_t feat_idx = 0; feat_idx < self_feature_size; ++feat_idx) {
-            for (const auto& feature : encrypted_features[feat_idx]) {
-                encrypted_features_buffer.insert(encrypted_features_buffer.end(), feature.begin(), feature.end());
+    } catch (...) {
+        // the other party may wait for columns that are never sent, and the reader for columns that never come.
+        async_io_->shutdown();
+        for (auto& done : receiving) {
+            if (done.valid()) {
+                done.wait();
             }
-            io_->send_bytes(encrypted_features_buffer);
-            encrypted_features_buffer.clear();
         }
+        throw;
     }
 }
 
 void DPCardinalityPSI::reset_data() {
+    headroom_bits_ = 0;
     sender_data_size_ = 0;
     sender_feature_size_ = 0;
     receiver_data_size_ = 0;
     receiver_feature_size_ = 0;
+    sender_value_bits_.clear();
+    receiver_value_bits_.clear();
     for (auto& keys : plaintext_keys_) {
         keys.clear();
     }
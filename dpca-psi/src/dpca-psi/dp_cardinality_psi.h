@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <sys/uio.h>
+
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -21,10 +24,13 @@
 
 #include "nlohmann/json.hpp"
 
+#include "dpca-psi/common/checkpoint_store.h"
 #include "dpca-psi/crypto/dp_sampling.h"
 #include "dpca-psi/crypto/ecc_cipher.h"
-#include "dpca-psi/crypto/ipcl_paillier.h"
+#include "dpca-psi/crypto/paillier.h"
+#include "dpca-psi/crypto/paillier_key_store.h"
 #include "dpca-psi/crypto/prng.h"
+#include "dpca-psi/network/async_net_io.h"
 #include "dpca-psi/network/io_base.h"
 
 namespace privacy_go {
@@ -42,9 +48,11 @@ class DPCardinalityPSI {
     // DPCardinalityPSI is not assignable.
     DPCardinalityPSI& operator=(const DPCardinalityPSI& other) = delete;
 
-    // Initializes parameters and variables according to parameters' json configuration.
-    //   1. Generates multiple ECC encryptors and a Paillier encryptor, with secret keys.
-    //   2. Exchanges Paillier public keys with the other party.
+    // Initializes parameters and variables according to parameters' json configuration, see example/json/README.md.
+    // net must allow a send and a receive at the same time from two threads, e.g. TwoChannelNetIO or AsyncNetIO.
+    //   1. Checks the params of both parties, and sets the transfer settings of net, see LinkTuner for "auto_tune".
+    //   2. Generates multiple ECC encryptors with secret keys.
+    // The Paillier encryptor is set up by the first process() that has feature columns.
     // Params of json format is structured as follows:
     /*
     {
@@ -58,16 +66,29 @@ class DPCardinalityPSI {
             "output_file": "example/data/sender_output_file.csv",
             "ids_num": 3,
             "is_sender": true,
-            "verbose": false
+            "verbose": false,
+            "feature_sharing": "paillier",
+            "feature_bits": [],
+            "send_buffer_size": 0,
+            "send_delay": false,
+            "zero_copy_threshold": 0,
+            "socket_buffer_size": 0,
+            "auto_tune": false,
+            "exchange_chunk_size": 0,
+            "checkpoint_dir": ""
         },
         "paillier_params": {
             "paillier_n_len": 2048,
             "enable_djn": true,
             "apply_packing": true,
-            "statistical_security_bits": 40
+            "statistical_security_bits": 40,
+            "damgard_jurik_s": 1,
+            "key_store_dir": "",
+            "key_lifetime": 86400
         },
         "ecc_params": {
-            "curve_id": NID_X9_62_prime256v1(415)
+            "curve_id": NID_X9_62_prime256v1(415),
+            "point_compression": "auto"
         },
         "dp_params": {
             "epsilon": 2/4/6/8,
@@ -77,12 +98,18 @@ class DPCardinalityPSI {
             "input_dp": true,
             "has_zero_column": false,
             "zero_column_index": -1
+        },
+        "aggregate_params": {
+            "group_column": -1,
+            "group_num": 1
         }
     }
     */
     void init(const json& params, std::shared_ptr<IOBase> net);
 
     // 1. Exchanges the number of rows and the number of feature columns per row.
+    //    "feature_bits" declares the bit width of every feature column for packing, all 64 if empty. Values must fit in
+    //    their widths, dummy values are truncated to them.
     // 2. Samples dummy data and appends them to the original datasets, on both sender's and receiver's side.
     // 3. Generates random permutations of rows.
     void data_sampling(
@@ -94,21 +121,181 @@ class DPCardinalityPSI {
     //   2. Reshuffles and doublely encrypts the exchanged keys. Sends back keys to the other party.
     //   3. Computes intersection on the first column and saves indices of the intersection.
     //   4. Iteratively repeats 1~3 for the rest of columns and saves the intersection's indices.
-    //   5. Shuffles and encrypts features on both parties' side. Exchanges features with the other party.
+    //   5. Shuffles and encrypts features on both parties' side. Exchanges features with the other party while
+    //      encrypting.
     //   6. Generates additive shares of Paillier-encrypted features.
     //   7. Decrypts and converts additive shares in Z_n to additive shares in Z_{2^l}.
+    // If neither party has feature columns, 5~7 and the Paillier setup are skipped and no shares are appended.
+    // With "feature_sharing": "ot", 5~7 are replaced by share_features_with_ot(), the shares are in the same format.
+    // With "checkpoint_dir", saves a checkpoint after the keys of the first column are exchanged, after the
+    // intersection is computed, and after the features are exchanged. The last one is only saved with Paillier
+    // feature sharing and "key_store_dir", which keeps the Paillier key pair that the features are encrypted under.
+    // The checkpoints are removed once process() is done.
     void process(std::vector<std::vector<std::uint64_t>>& shares);
 
+    // Resumes an interrupted process() from the latest checkpoint that both parties have saved for the same run, and
+    // stores the shares in shares as process() would. Both parties call resume() after init() in a new run, e.g.
+    //     if (!psi.resume(shares)) {
+    //         psi.data_sampling(keys, features);
+    //         psi.process(shares);
+    //     }
+    // Returns false and removes the checkpoints if there is no common checkpoint, then nothing else is done.
+    // If the Paillier key pair of the exchanged features is no longer in the key store, resumes from the intersection.
+    // Throws std::logic_error without "checkpoint_dir".
+    bool resume(std::vector<std::vector<std::uint64_t>>& shares);
+
+    // Performs intersection only, i.e. 1~4 of process(), and returns the intersection size.
+    // With input_dp, the size includes the matched dummy rows, so it is differentially private.
+    // Both parties must call process_cardinality() instead of process().
+    std::size_t process_cardinality();
+
+    // Performs intersection and stores secret shares of the sums of features over the intersection in sums, i.e. one
+    // share per feature column instead of one per intersected row.
+    // With "feature_sharing": "paillier", the intersected ciphertexts are summed homomorphically before 6~7 of
+    // process(), so masking, transfer and decryption scale with the number of feature columns.
+    // If "group_column" of "aggregate_params" is a party's own feature column, that column holds group ids, and every
+    // other column of the party is summed per group id in [0, "group_num"). Rows of other ids fall in no group.
+    // sums[c][g] is the share of the sum of the c-th column in group g, or sums[c][0] without grouping. The sender's
+    // columns go first, where the group column is left out.
+    // Both parties must call process_aggregate() instead of process().
+    void process_aggregate(std::vector<std::vector<std::uint64_t>>& sums);
+
+    // Performs intersection only, i.e. 1~4 of process(), and keeps the intersection for the queries of a session.
+    // Every query answers the feature columns it is given over the same rows, so the key matching is paid once.
+    // The session allows the smaller "maximum_queries" of both parties, for which the dummy rows are sampled.
+    // Returns the intersection size.
+    // Both parties must call start_session() instead of process(), and end the session with end_session().
+    std::size_t start_session();
+
+    // Stores secret shares of the intersection's features in shares, the same as process() would do.
+    // features replaces the features of data_sampling(), with one value per input row in the same order, and may
+    // differ in the number of columns and the values. "feature_bits" declares the widths of the columns given here.
+    // Fresh dummy values are appended for the dummy rows.
+    // Throws std::logic_error if no session is started or the session is out of queries.
+    void query(
+            const std::vector<std::vector<std::uint64_t>>& features, std::vector<std::vector<std::uint64_t>>& shares);
+
+    // Stores secret shares of the sums of features over the intersection in sums, the same as process_aggregate()
+    // would do. features is given the same as to query(), and takes one query of the session.
+    void query_aggregate(
+            const std::vector<std::vector<std::uint64_t>>& features, std::vector<std::vector<std::uint64_t>>& sums);
+
+    // Returns the number of queries left in the session.
+    std::size_t get_remaining_queries() const {
+        return remaining_queries_;
+    }
+
+    // Ends the session and resets data.
+    void end_session();
+
+    // Returns the intersection size of the last process(), process_cardinality(), process_aggregate() or
+    // start_session().
+    std::size_t get_intersection_size() const {
+        return intersection_size_;
+    }
+
     ~DPCardinalityPSI() {
     }
 
 private:
-    // Checks the validity and consistency of json params of both parties.
+    // Checks the validity and consistency of json params of both parties in one handshake round trip, see
+    // exchange_handshake(), and exchanges the feature bits.
     void check_params();
 
-    // Permutes the keys with the pattern generated by itself. Encrypts them with ECC encryptors.
-    // Stores keys encrypted by the first ECC key in encrypted_keys.
-    void shuffle_and_encrypt_keys_round_one(std::vector<std::vector<ByteVector>>& encrypted_keys);
+    // Returns the capabilities that this version supports in the handshake.
+    static std::vector<std::string> get_capabilities();
+
+    // Sets up the Paillier encryptors if not yet done, see init().
+    void init_paillier();
+
+    // Creates the Paillier encryptors with the own key pair loaded from the key store. If it is not loaded and
+    // generate is set, generates a new key pair and saves it in the key store. Returns true if it is loaded.
+    bool create_paillier_key_pair(bool generate);
+
+    // A feature column packed in a plaintext, where the slot starts at bit offset and holds values of value_bits bits.
+    struct PackingSlot {
+        std::size_t feature_idx = 0;
+        std::size_t offset = 0;
+        std::size_t value_bits = 0;
+    };
+
+    // Returns the width of a slot holding values of value_bits bits, with room for the masks and sums.
+    std::size_t get_slot_bits(std::size_t value_bits) const {
+        return value_bits + headroom_bits_ + statistical_security_bits_ + 1;
+    }
+
+    // Packs feature columns of the given value widths in order into plaintexts of the given encryptor.
+    // Returns the slots of every plaintext.
+    std::vector<std::vector<PackingSlot>> get_packing_layout(
+            const Paillier& paillier, const std::vector<std::size_t>& value_bits) const;
+
+    // Phases of process() after which a checkpoint is saved.
+    enum class CheckpointPhase : std::size_t { kKeysExchanged = 1, kIntersectionComputed = 2, kFeaturesExchanged = 3 };
+
+    // Starts a run of process() with checkpoints if "checkpoint_dir" is set, where the sender draws the id of the run.
+    // Removes the checkpoints of earlier runs.
+    void start_checkpoints();
+
+    // Saves the state needed to continue after phase, if checkpoints are started.
+    // exchanged_features are the received encrypted features of kFeaturesExchanged.
+    void save_checkpoint(CheckpointPhase phase, const std::vector<ByteVector>& exchanged_features = {});
+
+    // Restores the state saved after phase. Stores the received encrypted features and the own Paillier public key
+    // of kFeaturesExchanged in exchanged_features and paillier_pk.
+    void load_checkpoint(CheckpointPhase phase, const ByteVector& state, std::vector<ByteVector>& exchanged_features,
+            ByteVector& paillier_pk);
+
+    // Removes the checkpoints of a finished run.
+    void finish_checkpoints();
+
+    // Matches encrypted keys of all columns and saves the intersection's indices, i.e. 1~4 of process().
+    // Returns the size of the final intersection.
+    std::size_t match_keys();
+
+    // The part of match_keys() after the encrypted keys of the first column are exchanged.
+    std::size_t match_exchanged_keys();
+
+    // Generates additive shares of the intersection's features with the selected feature sharing, i.e. 5~7 of
+    // process(). Skips if neither party has feature columns.
+    void share_features(std::size_t intersection_size, std::vector<std::vector<std::uint64_t>>& shares);
+
+    // Generates additive shares of the sums of the intersection's features, see process_aggregate().
+    void aggregate_features(std::size_t intersection_size, std::vector<std::vector<std::uint64_t>>& sums);
+
+    // Replaces the own features with the features of a query, and appends fresh dummy values for the dummy rows.
+    // Exchanges the number of feature columns with the other party.
+    void load_query_features(const std::vector<std::vector<std::uint64_t>>& features);
+
+    // Sets the value widths of both parties' feature columns from "feature_bits", and checks the own features fit.
+    void set_value_bits(const std::vector<std::vector<std::uint64_t>>& features);
+
+    // Returns the index of the all-zero dummy column among feature_size columns, or -1 if there is none.
+    int get_zero_column_index(std::size_t feature_size) const;
+
+    // Generates additive shares of the intersection's features with Paillier, i.e. 5~7 of process().
+    // With aggregate, every column of the intersection's features is summed before masking, and a single share per
+    // column is stored in shares.
+    void share_features_with_paillier(
+            std::size_t intersection_size, bool aggregate, std::vector<std::vector<std::uint64_t>>& shares);
+
+    // The part of share_features_with_paillier() after the encrypted features are exchanged.
+    void share_exchanged_features_with_paillier(std::size_t intersection_size, bool aggregate,
+            std::vector<ByteVector>& exchanged_encrypted_features, std::vector<std::vector<std::uint64_t>>& shares);
+
+    // Replaces the own feature columns with one column per feature and group if a group column is given.
+    // Returns the number of groups, which is 1 without a group column.
+    std::size_t expand_group_column();
+
+    // Homomorphically sums every column of the intersection's features encrypted by paillier into one ciphertext.
+    void sum_intersection_features(const Paillier& paillier, std::vector<ByteVector>& intersection_features);
+
+    // Probes the link if "auto_tune" is set, and applies the transfer settings, see init().
+    void tune_link();
+
+    // Permutes the keys with the pattern generated by itself. Encrypts them with the first ECC key.
+    // Sends every chunk of "exchange_chunk_size" bytes once encrypted, while receiving the other party's encrypted
+    // keys of every column, received_data_size per column, into exchanged_keys_.
+    void shuffle_encrypt_and_exchange_keys_round_one(std::size_t received_data_size);
 
     // Permutes the exchanged keys with the pattern generated by the other. Doublely encrypts them with ECC encryptors.
     // Stores the first column's reshuffled encrypted keys in reshuffled_encrypted_keys.
@@ -135,37 +322,59 @@ class DPCardinalityPSI {
 
     // Permutes the features with the pattern generated by itself. Encrypts them with a Paillier encryptor.
     // Adopts Paillier's ciphertext packing to reduce communication and computation.
-    // Stores encrypted features in encrypted_features.
-    void shuffle_and_encrypt_features(std::vector<std::vector<ByteVector>>& encrypted_features);
-
-    // Filters out intersect features from all encrypted features according to intersect keys.
-    // Stores filtered features in intersection_features.
-    void filter_intersection_features(const std::vector<std::vector<ByteVector>>& encrypted_features,
-            std::size_t intersection_size, std::vector<std::vector<ByteVector>>& intersection_features);
+    // Sends every chunk of "exchange_chunk_size" bytes once encrypted, while receiving the other party's encrypted
+    // features. Stores received_feature_size received columns in received_features, every column as a contiguous
+    // buffer of serialized ciphertexts.
+    void shuffle_encrypt_and_exchange_features(
+            std::size_t received_feature_size, std::vector<ByteVector>& received_features);
+
+    // Returns the permutation of the other party's rows that brings the intersection to the front, in the order of the
+    // doublely encrypted keys on which both parties agree, followed by the rest rows.
+    std::vector<std::size_t> get_intersection_permutation() const;
+
+    // Generates additive shares of the intersection's features through oblivious switching networks, without Paillier.
+    // The owner of a feature column permutes it with the pattern generated by itself, the other party programs the
+    // switching network with get_intersection_permutation(). Both parties get shares of the first intersection_size
+    // rows. The sender's columns go first.
+    void share_features_with_ot(std::size_t intersection_size, std::vector<std::vector<std::uint64_t>>& shares);
+
+    // Filters out intersect features from all encrypted features according to intersect keys, where every ciphertext
+    // takes cipher_len bytes. Stores filtered features in intersection_features.
+    void filter_intersection_features(const std::vector<ByteVector>& encrypted_features, std::size_t cipher_len,
+            std::size_t intersection_size, std::vector<ByteVector>& intersection_features);
 
     // Generates additive shares of Paillier-encrypted features.
-    // Stores encrypted additives shares in random_r.
-    void generate_additive_shares(IpclPaillier& paillier, std::vector<std::vector<ByteVector>>& encrypted_features,
-            std::vector<std::vector<BigNumber>>& random_r);
+    // Stores the masks r mod 2^l of every raw feature column in random_r.
+    void generate_additive_shares(Paillier& paillier, std::vector<ByteVector>& encrypted_features,
+            std::vector<std::vector<std::uint64_t>>& random_r);
 
     // Decrypts and converts additive shares in Z_n to additive shares in Z_{2^l}.
-    void decrypt_and_reveal_shares(const std::vector<std::vector<ByteVector>>& encrypetd_shares,
-            const std::vector<std::vector<BigNumber>>& random_r, std::size_t intersection_size,
+    void decrypt_and_reveal_shares(const std::vector<ByteVector>& encrypetd_shares,
+            const std::vector<std::vector<std::uint64_t>>& random_r, std::size_t intersection_size,
             std::vector<std::vector<std::uint64_t>>& shares);
 
-    // Exchanges encrypted keys or doublely encrypted keys with the other party.
-    void exchange_encrypted_keys(const std::vector<std::vector<ByteVector>>& encrypted_keys,
-            std::size_t received_keys_size, std::size_t received_data_size,
-            std::vector<std::vector<ByteVector>>& received_keys, std::size_t point_len);
+    // Exchanges Paillier public key fingerprints with the other party, then exchanges the public keys that are not
+    // cached in the key stores. Received public keys are cached.
+    void exchange_paillier_pk(const PaillierKeyStore& key_store, bool enable_djn);
 
-    // Exchanges a single column's encrypted keys or doublely encrypted keys with the other party.
+    // Exchanges a single column's encrypted keys or doublely encrypted keys with the other party, in both directions
+    // at a time.
     void exchange_single_encrypted_keys(const std::vector<ByteVector>& encrypted_keys, std::size_t received_data_size,
             std::vector<ByteVector>& received_keys, std::size_t point_len);
 
-    // Exchanges encrypted features or encrypted additives shares with the other party.
-    void exchange_encrypted_features(const std::vector<std::vector<ByteVector>>& encrypted_features,
-            std::size_t self_paillier_len, std::size_t remote_paillier_len, std::size_t received_features_size,
-            std::size_t received_data_size, std::vector<std::vector<ByteVector>>& received_features);
+    // Exchanges encrypted features or encrypted additives shares with the other party, in both directions at a time.
+    // Receives received_feature_size columns of received_column_len bytes each.
+    void exchange_encrypted_features(const std::vector<ByteVector>& encrypted_features,
+            std::size_t received_feature_size, std::size_t received_column_len,
+            std::vector<ByteVector>& received_features);
+
+    // Receives the columns that the other party sends as send_bytes() or send_bytes_vector() do into received_spans,
+    // one array of spans per column, in the background of send_columns, which sends the own columns through
+    // async_io_. Throws std::runtime_error if a received column does not have the length of its spans.
+    // If anything fails, shuts the connection down so that neither party waits for the other, and rethrows once the
+    // queued receives have ended.
+    void exchange_columns(
+            const std::vector<std::vector<iovec>>& received_spans, const std::function<void()>& send_columns);
 
     // Resets data at the end of process function.
     void reset_data();
@@ -175,22 +384,39 @@ class DPCardinalityPSI {
     json params_ = "";
     bool verbose_ = false;
 
+    bool use_ot_sharing_ = false;
+
     std::unique_ptr<EccCipher> ecc_cipher_ = nullptr;
     std::size_t num_threads_ = 0;
 
-    IpclPaillier sender_paillier_{};
-    IpclPaillier receiver_paillier_{};
+    std::size_t exchange_chunk_size_ = kExchangeChunkSize;
+    bool compress_points_ = true;
+
+    PaillierKeyStore key_store_{};
+    CheckpointStore checkpoint_store_{};
+    bool checkpoints_started_ = false;
+    block run_id_ = kZeroBlock;
+    bool paillier_initialized_ = false;
+    bool paillier_key_ready_ = false;
+    std::unique_ptr<Paillier> sender_paillier_ = nullptr;
+    std::unique_ptr<Paillier> receiver_paillier_ = nullptr;
     bool apply_packing_ = false;
     std::size_t statistical_security_bits_ = 0;
-    std::size_t slot_bits_ = 0;
+    std::size_t headroom_bits_ = 0;
+    std::vector<std::size_t> sender_feature_bits_{};
+    std::vector<std::size_t> receiver_feature_bits_{};
 
     std::shared_ptr<IOBase> io_ = nullptr;
+    // runs the exchanges in both directions at a time, io_ itself if it is an AsyncNetIO.
+    std::shared_ptr<AsyncNetIO> async_io_ = nullptr;
 
     std::size_t key_size_ = 0;
     std::size_t sender_data_size_ = 0;
     std::size_t sender_feature_size_ = 0;
     std::size_t receiver_data_size_ = 0;
     std::size_t receiver_feature_size_ = 0;
+    std::vector<std::size_t> sender_value_bits_{};
+    std::vector<std::size_t> receiver_value_bits_{};
 
     std::vector<std::vector<std::string>> plaintext_keys_{};
     std::vector<std::vector<std::uint64_t>> plaintext_features_{};
@@ -201,6 +427,12 @@ class DPCardinalityPSI {
     std::vector<std::vector<ByteVector>> exchanged_keys_{};
 
     std::vector<std::pair<bool, ByteVector>> intersection_indices_{};
+
+    std::size_t intersection_size_ = 0;
+
+    std::size_t input_data_size_ = 0;
+    bool in_session_ = false;
+    std::size_t remaining_queries_ = 0;
 };
 
 }  // namespace dpca_psi
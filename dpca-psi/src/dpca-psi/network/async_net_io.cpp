@@ -0,0 +1,191 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/async_net_io.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+AsyncNetIO::AsyncNetIO(std::shared_ptr<IOBase> io, std::size_t max_pending_bytes)
+        : ForwardingNetIO(io), max_pending_bytes_(max_pending_bytes) {
+    writer_ = std::thread([this]() { write_loop(); });
+    reader_ = std::thread([this]() { read_loop(); });
+}
+
+AsyncNetIO::~AsyncNetIO() {
+    try {
+        flush();
+    } catch (...) {
+        // the error of the underlying io has no receiver here.
+    }
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        send_stopped_ = true;
+    }
+    send_cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(recv_mutex_);
+        recv_stopped_ = true;
+        recv_queue_.clear();
+    }
+    recv_cv_.notify_all();
+    writer_.join();
+    reader_.join();
+}
+
+std::future<void> AsyncNetIO::recv_data_async(void* data, std::size_t nbyte) {
+    count_bytes_received(nbyte);
+    iovec span = {data, nbyte};
+    return push_recv_request(&span, 1);
+}
+
+std::future<void> AsyncNetIO::recv_data_vector_async(const iovec* spans, std::size_t span_num) {
+    count_bytes_received(get_total_size(spans, span_num));
+    return push_recv_request(spans, span_num);
+}
+
+void AsyncNetIO::flush_impl() {
+    {
+        std::unique_lock<std::mutex> lock(send_mutex_);
+        send_cv_.wait(lock, [this]() { return pending_bytes_ == 0 || send_error_ != nullptr; });
+        if (send_error_ != nullptr) {
+            std::rethrow_exception(send_error_);
+        }
+    }
+    // the writer is idle as the queue is empty.
+    io_->flush();
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    sent_messages_.clear();
+    sent_bytes_ = 0;
+}
+
+void AsyncNetIO::send_data_impl(const void* data, std::size_t nbyte) {
+    if (nbyte == 0) {
+        return;
+    }
+    const Byte* bytes = reinterpret_cast<const Byte*>(data);
+    {
+        std::unique_lock<std::mutex> lock(send_mutex_);
+        send_cv_.wait(lock, [this, nbyte]() {
+            return pending_bytes_ == 0 || pending_bytes_ + nbyte <= max_pending_bytes_ || send_error_ != nullptr;
+        });
+        if (send_error_ != nullptr) {
+            std::rethrow_exception(send_error_);
+        }
+        if (send_queue_.empty()) {
+            send_queue_.emplace_back(bytes, bytes + nbyte);
+        } else {
+            send_queue_.back().insert(send_queue_.back().end(), bytes, bytes + nbyte);
+        }
+        pending_bytes_ += nbyte;
+    }
+    send_cv_.notify_all();
+}
+
+void AsyncNetIO::recv_data_impl(void* data, std::size_t nbyte) {
+    iovec span = {data, nbyte};
+    push_recv_request(&span, 1).get();
+}
+
+void AsyncNetIO::recv_data_vector_impl(const iovec* spans, std::size_t span_num) {
+    push_recv_request(spans, span_num).get();
+}
+
+std::future<void> AsyncNetIO::push_recv_request(const iovec* spans, std::size_t span_num) {
+    RecvRequest request;
+    request.spans.assign(spans, spans + span_num);
+    std::future<void> done = request.done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(recv_mutex_);
+        recv_queue_.emplace_back(std::move(request));
+    }
+    recv_cv_.notify_all();
+    return done;
+}
+
+void AsyncNetIO::write_loop() {
+    while (true) {
+        ByteVector message;
+        bool failed = false;
+        {
+            std::unique_lock<std::mutex> lock(send_mutex_);
+            send_cv_.wait(lock, [this]() { return send_stopped_ || !send_queue_.empty(); });
+            if (send_queue_.empty()) {
+                return;
+            }
+            message = std::move(send_queue_.front());
+            send_queue_.pop_front();
+            failed = (send_error_ != nullptr);
+        }
+        // after a failure, the queued messages are dropped.
+        std::size_t message_size = message.size();
+        if (!failed) {
+            try {
+                io_->send_data_no_copy(message.data(), message_size);
+                std::vector<ByteVector> released;
+                {
+                    std::lock_guard<std::mutex> lock(send_mutex_);
+                    sent_bytes_ += message_size;
+                    sent_messages_.emplace_back(std::move(message));
+                    if (sent_bytes_ > max_pending_bytes_) {
+                        released.swap(sent_messages_);
+                        sent_bytes_ = 0;
+                    }
+                }
+                if (!released.empty()) {
+                    io_->flush();
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(send_mutex_);
+                send_error_ = std::current_exception();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            pending_bytes_ -= message_size;
+        }
+        send_cv_.notify_all();
+    }
+}
+
+void AsyncNetIO::read_loop() {
+    while (true) {
+        RecvRequest request;
+        {
+            std::unique_lock<std::mutex> lock(recv_mutex_);
+            recv_cv_.wait(lock, [this]() { return recv_stopped_ || !recv_queue_.empty(); });
+            if (recv_stopped_) {
+                return;
+            }
+            request = std::move(recv_queue_.front());
+            recv_queue_.pop_front();
+        }
+        try {
+            if (request.spans.size() == 1) {
+                io_->recv_data(request.spans[0].iov_base, request.spans[0].iov_len);
+            } else if (!request.spans.empty()) {
+                io_->recv_data_vector(request.spans.data(), request.spans.size());
+            }
+            request.done.set_value();
+        } catch (...) {
+            request.done.set_exception(std::current_exception());
+        }
+    }
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,118 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/network/forwarding_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Decorator of an IOBase that sends and receives in background threads, so that a party computes the next message
+// while the last one is on the wire.
+// A send copies the message to a queue and returns, a background writer sends the queued messages in order. Messages
+// queued before the writer takes them are coalesced into one send of the underlying io, by send_data_no_copy(). The
+// writer keeps the sent messages until the underlying io is flushed, which it does itself only once they exceed
+// max_pending_bytes bytes, so that zero-copy sends are not waited for one by one.
+// Receives are served in order by a background reader, either blocking through recv_data() or as futures through
+// recv_data_async(). flush() waits for the queue.
+class AsyncNetIO : public ForwardingNetIO {
+public:
+    AsyncNetIO() = delete;
+
+    AsyncNetIO(const AsyncNetIO& other) = delete;
+
+    AsyncNetIO& operator=(const AsyncNetIO& other) = delete;
+
+    // Sends and receives through io, which must allow a send and a receive at the same time.
+    // A send blocks while more than max_pending_bytes bytes wait in the queue, which bounds the memory.
+    AsyncNetIO(std::shared_ptr<IOBase> io, std::size_t max_pending_bytes);
+
+    // Sends the buffered and queued messages, and cancels the receives not yet served, whose futures get
+    // std::future_error.
+    ~AsyncNetIO() override;
+
+    // Receives nbyte bytes into data in the background. data must be valid until the returned future is ready.
+    // Throws what the underlying io throws through the future.
+    std::future<void> recv_data_async(void* data, std::size_t nbyte);
+
+    // Receives into the spans in the background, as recv_data_vector() does. The buffers of the spans must be valid
+    // until the returned future is ready, the array of spans is copied.
+    std::future<void> recv_data_vector_async(const iovec* spans, std::size_t span_num);
+
+    static const std::size_t kDefaultMaxPendingBytes = std::size_t(1) << 26;
+
+private:
+    // A receive waiting for the reader.
+    struct RecvRequest {
+        std::vector<iovec> spans{};
+        std::promise<void> done{};
+    };
+
+    void send_data_impl(const void* data, std::size_t nbyte) override;
+
+    void recv_data_impl(void* data, std::size_t nbyte) override;
+
+    void recv_data_vector_impl(const iovec* spans, std::size_t span_num) override;
+
+    // Blocks until every queued message is sent by the underlying io, then flushes the underlying io and releases
+    // the sent messages.
+    // Throws what the underlying io has thrown in the background.
+    void flush_impl() override;
+
+    // Queues a receive without counting its bytes.
+    std::future<void> push_recv_request(const iovec* spans, std::size_t span_num);
+
+    // Loop of the background writer.
+    void write_loop();
+
+    // Loop of the background reader.
+    void read_loop();
+
+    std::size_t max_pending_bytes_ = 0;
+
+    std::mutex send_mutex_{};
+    std::condition_variable send_cv_{};
+    std::deque<ByteVector> send_queue_{};
+    std::size_t pending_bytes_ = 0;
+    std::exception_ptr send_error_ = nullptr;
+    bool send_stopped_ = false;
+    // Messages sent by the underlying io that it may still read until its next flush().
+    std::vector<ByteVector> sent_messages_{};
+    std::size_t sent_bytes_ = 0;
+
+    std::mutex recv_mutex_{};
+    std::condition_variable recv_cv_{};
+    std::deque<RecvRequest> recv_queue_{};
+    bool recv_stopped_ = false;
+
+    std::thread writer_{};
+    std::thread reader_{};
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,234 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/channel_mux.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+const std::size_t ChannelMux::kDefaultWindowSize;
+const std::size_t ChannelMux::kMaxFrameSize;
+const std::size_t ChannelMux::kCloseTimeoutMs;
+
+// A logical channel, the send buffer of IOBase coalesces its small messages before they are framed.
+class ChannelMux::Channel : public IOBase {
+public:
+    Channel(std::shared_ptr<ChannelMux> mux, std::uint32_t tag, std::shared_ptr<ChannelState> state)
+            : mux_(mux), tag_(tag), state_(state) {
+    }
+
+    ~Channel() override {
+        try {
+            flush();
+        } catch (...) {
+            // the error of the underlying io has no receiver here.
+        }
+    }
+
+private:
+    void send_data_impl(const void* data, std::size_t nbyte) override {
+        mux_->send(tag_, *state_, data, nbyte);
+    }
+
+    void recv_data_impl(void* data, std::size_t nbyte) override {
+        mux_->recv(tag_, *state_, data, nbyte);
+    }
+
+    void flush_impl() override {
+        mux_->flush();
+    }
+
+    std::shared_ptr<ChannelMux> mux_ = nullptr;
+    std::uint32_t tag_ = 0;
+    std::shared_ptr<ChannelState> state_ = nullptr;
+};
+
+ChannelMux::ChannelMux(std::shared_ptr<IOBase> io, std::size_t window_size) : io_(io), window_size_(window_size) {
+    if (io_ == nullptr) {
+        throw std::invalid_argument("io is nullptr");
+    }
+    if (window_size_ == 0) {
+        throw std::invalid_argument("window_size must be positive");
+    }
+    reader_ = std::thread([this]() { read_loop(); });
+}
+
+ChannelMux::~ChannelMux() {
+    try {
+        FrameHeader header;
+        header.type = FrameType::kClose;
+        send_frame(header, nullptr);
+        flush();
+    } catch (...) {
+        // the reader stops on the error of the underlying io as well.
+    }
+    bool closed = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        closed = cv_.wait_for(lock, std::chrono::milliseconds(kCloseTimeoutMs),
+                [this]() { return closed_by_peer_ || recv_error_ != nullptr; });
+    }
+    // a peer that never closes its mux, e.g. one that has failed, would block the reader forever.
+    if (!closed) {
+        io_->shutdown();
+    }
+    reader_.join();
+}
+
+std::shared_ptr<IOBase> ChannelMux::open_channel(std::uint32_t tag) {
+    std::shared_ptr<ChannelState> state = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        state = get_state(tag);
+        if (state->opened) {
+            throw std::logic_error("channel is already opened");
+        }
+        state->opened = true;
+    }
+    return std::make_shared<Channel>(shared_from_this(), tag, state);
+}
+
+std::shared_ptr<ChannelMux::ChannelState> ChannelMux::get_state(std::uint32_t tag) {
+    auto& state = states_[tag];
+    if (state == nullptr) {
+        state = std::make_shared<ChannelState>();
+        state->send_credit = window_size_;
+    }
+    return state;
+}
+
+void ChannelMux::send_frame(const FrameHeader& header, const void* payload) {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    io_->send_data(&header, sizeof(header));
+    if (header.type == FrameType::kData) {
+        io_->send_data(payload, header.value);
+    }
+}
+
+void ChannelMux::send(std::uint32_t tag, ChannelState& state, const void* data, std::size_t nbyte) {
+    const Byte* bytes = reinterpret_cast<const Byte*>(data);
+    std::size_t sent = 0;
+    while (sent < nbyte) {
+        FrameHeader header;
+        header.tag = tag;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this, &state]() {
+                return state.send_credit != 0 || closed_by_peer_ || recv_error_ != nullptr;
+            });
+            if (state.send_credit == 0) {
+                if (recv_error_ != nullptr) {
+                    std::rethrow_exception(recv_error_);
+                }
+                throw std::runtime_error("channel is closed by the other party");
+            }
+            header.value = std::min({nbyte - sent, state.send_credit, kMaxFrameSize});
+            state.send_credit -= header.value;
+        }
+        send_frame(header, bytes + sent);
+        sent += header.value;
+    }
+    // frames of a channel are not held back by the underlying io, the channel has its own send buffer.
+    flush();
+}
+
+void ChannelMux::recv(std::uint32_t tag, ChannelState& state, void* data, std::size_t nbyte) {
+    Byte* bytes = reinterpret_cast<Byte*>(data);
+    std::size_t received = 0;
+    while (received < nbyte) {
+        FrameHeader header;
+        header.type = FrameType::kCredit;
+        header.tag = tag;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this, &state]() {
+                return !state.frames.empty() || closed_by_peer_ || recv_error_ != nullptr;
+            });
+            if (state.frames.empty()) {
+                if (recv_error_ != nullptr) {
+                    std::rethrow_exception(recv_error_);
+                }
+                throw std::runtime_error("channel is closed by the other party");
+            }
+            while (received < nbyte && !state.frames.empty()) {
+                const ByteVector& frame = state.frames.front();
+                std::size_t length = std::min(nbyte - received, frame.size() - state.front_offset);
+                std::memcpy(bytes + received, frame.data() + state.front_offset, length);
+                received += length;
+                state.front_offset += length;
+                state.consumed += length;
+                if (state.front_offset == frame.size()) {
+                    state.frames.pop_front();
+                    state.front_offset = 0;
+                }
+            }
+            // grants credits in batches of half a window. A blocked sender has window_size_ bytes either buffered
+            // here or consumed, so the bytes it waits for are granted once the buffered ones are consumed.
+            if (state.consumed < window_size_ / 2) {
+                continue;
+            }
+            header.value = state.consumed;
+            state.consumed = 0;
+        }
+        send_frame(header, nullptr);
+        flush();
+    }
+}
+
+void ChannelMux::flush() {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    io_->flush();
+}
+
+void ChannelMux::read_loop() {
+    try {
+        while (true) {
+            FrameHeader header;
+            io_->recv_data(&header, sizeof(header));
+            if (header.type == FrameType::kClose) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_by_peer_ = true;
+                cv_.notify_all();
+                return;
+            }
+            if (header.type == FrameType::kCredit) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                get_state(header.tag)->send_credit += header.value;
+                cv_.notify_all();
+                continue;
+            }
+            if (header.type != FrameType::kData || header.value > kMaxFrameSize) {
+                throw std::runtime_error("invalid frame");
+            }
+            ByteVector payload(header.value);
+            io_->recv_data(payload.data(), payload.size());
+            std::lock_guard<std::mutex> lock(mutex_);
+            get_state(header.tag)->frames.emplace_back(std::move(payload));
+            cv_.notify_all();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        recv_error_ = std::current_exception();
+        cv_.notify_all();
+    }
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,120 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/network/io_base.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Multiplexes logical channels, identified by tags, over one IOBase, so that threads talk to the other party at the
+// same time without opening new ports.
+// Every channel is an ordered byte stream of its own. Its messages are cut into frames of at most kMaxFrameSize
+// bytes that interleave with the frames of other channels. A background reader dispatches frames to their channels.
+// A channel sends at most window_size bytes that the other party has not consumed yet, so a channel that is not read
+// neither blocks other channels nor grows the memory of the other party without limit.
+// Must be created by std::make_shared, channels keep the mux alive.
+class ChannelMux : public std::enable_shared_from_this<ChannelMux> {
+public:
+    ChannelMux() = delete;
+
+    ChannelMux(const ChannelMux& other) = delete;
+
+    ChannelMux& operator=(const ChannelMux& other) = delete;
+
+    // Sends and receives through io, which must allow a send and a receive at the same time.
+    // Both parties must use the same window_size.
+    ChannelMux(std::shared_ptr<IOBase> io, std::size_t window_size);
+
+    // Tells the other party that no frame follows, and waits until the other party does the same. If it does not
+    // within kCloseTimeoutMs milliseconds, shuts io down to stop the background reader, see IOBase::shutdown().
+    ~ChannelMux();
+
+    // Returns the channel of tag, which the other party opens with the same tag. Frames that arrive before the
+    // channel is opened are kept for it.
+    // Throws std::logic_error if tag is already opened.
+    std::shared_ptr<IOBase> open_channel(std::uint32_t tag);
+
+    static const std::size_t kDefaultWindowSize = std::size_t(1) << 22;
+
+    static const std::size_t kMaxFrameSize = std::size_t(1) << 16;
+
+    static const std::size_t kCloseTimeoutMs = 10000;
+
+private:
+    class Channel;
+
+    enum class FrameType : std::uint32_t { kData = 0, kCredit = 1, kClose = 2 };
+
+    // value is the length of the payload of a data frame, or the number of bytes granted by a credit frame.
+    struct FrameHeader {
+        FrameType type = FrameType::kData;
+        std::uint32_t tag = 0;
+        std::uint64_t value = 0;
+    };
+
+    struct ChannelState {
+        bool opened = false;
+        // bytes the other party may still receive on this channel.
+        std::size_t send_credit = 0;
+        std::deque<ByteVector> frames{};
+        std::size_t front_offset = 0;
+        // bytes consumed but not yet granted back to the other party.
+        std::size_t consumed = 0;
+    };
+
+    // Returns the state of tag, where mutex_ must be held.
+    std::shared_ptr<ChannelState> get_state(std::uint32_t tag);
+
+    void send_frame(const FrameHeader& header, const void* payload);
+
+    void send(std::uint32_t tag, ChannelState& state, const void* data, std::size_t nbyte);
+
+    void recv(std::uint32_t tag, ChannelState& state, void* data, std::size_t nbyte);
+
+    void flush();
+
+    // Loop of the background reader.
+    void read_loop();
+
+    std::shared_ptr<IOBase> io_ = nullptr;
+    std::size_t window_size_ = 0;
+
+    // Serializes frames on io_.
+    std::mutex send_mutex_{};
+
+    // Guards the channel states.
+    std::mutex mutex_{};
+    std::condition_variable cv_{};
+    std::map<std::uint32_t, std::shared_ptr<ChannelState>> states_{};
+    bool closed_by_peer_ = false;
+    std::exception_ptr recv_error_ = nullptr;
+
+    std::thread reader_{};
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
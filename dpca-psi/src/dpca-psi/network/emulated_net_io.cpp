@@ -0,0 +1,139 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/emulated_net_io.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+EmulatedNetIO::EmulatedNetIO(std::shared_ptr<IOBase> io, std::uint64_t bandwidth_bps,
+        std::chrono::microseconds latency, std::chrono::microseconds jitter)
+        : ForwardingNetIO(io), bandwidth_bps_(bandwidth_bps), latency_(latency), jitter_(jitter) {
+    if (latency_.count() < 0 || jitter_.count() < 0) {
+        throw std::invalid_argument("latency and jitter must not be negative");
+    }
+    writer_ = std::thread([this]() { write_loop(); });
+}
+
+EmulatedNetIO::~EmulatedNetIO() {
+    try {
+        flush();
+    } catch (...) {
+        // the error of the underlying io has no receiver here.
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+}
+
+void EmulatedNetIO::send_data_impl(const void* data, std::size_t nbyte) {
+    if (nbyte == 0) {
+        return;
+    }
+    Clock::time_point now = Clock::now();
+    link_free_time_ = std::max(now, link_free_time_);
+    if (bandwidth_bps_ != 0) {
+        // in nanoseconds, the product fits in 64 bits for messages up to 2^34 bytes.
+        std::uint64_t transmit_ns = static_cast<std::uint64_t>(nbyte) * 8 * 1000000000 / bandwidth_bps_;
+        link_free_time_ += std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(transmit_ns));
+        // the sender runs ahead of the link by at most a millisecond, as a socket buffer lets it, so that the
+        // oversleeping of many small sends does not add up.
+        if (link_free_time_ - now > std::chrono::milliseconds(1)) {
+            std::this_thread::sleep_until(link_free_time_ - std::chrono::milliseconds(1));
+        }
+    }
+    Clock::time_point delivery_time = link_free_time_ + latency_;
+    if (jitter_.count() > 0) {
+        std::uniform_int_distribution<std::int64_t> distribution(0, jitter_.count());
+        delivery_time += std::chrono::microseconds(distribution(jitter_engine_));
+    }
+    // TCP does not reorder messages.
+    last_delivery_time_ = std::max(delivery_time, last_delivery_time_);
+
+    const Byte* bytes = reinterpret_cast<const Byte*>(data);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (send_error_ != nullptr) {
+            std::rethrow_exception(send_error_);
+        }
+        Packet packet;
+        packet.delivery_time = last_delivery_time_;
+        packet.data.assign(bytes, bytes + nbyte);
+        in_flight_.emplace_back(std::move(packet));
+    }
+    cv_.notify_all();
+}
+
+void EmulatedNetIO::recv_data_impl(void* data, std::size_t nbyte) {
+    io_->recv_data(data, nbyte);
+}
+
+void EmulatedNetIO::flush_impl() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return in_flight_.empty() || send_error_ != nullptr; });
+        if (send_error_ != nullptr) {
+            std::rethrow_exception(send_error_);
+        }
+    }
+    io_->flush();
+}
+
+void EmulatedNetIO::write_loop() {
+    while (true) {
+        Clock::time_point delivery_time;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopped_ || !in_flight_.empty(); });
+            if (in_flight_.empty()) {
+                return;
+            }
+            delivery_time = in_flight_.front().delivery_time;
+        }
+        // messages are only appended with later delivery times, so the front stays the next one.
+        std::this_thread::sleep_until(delivery_time);
+        Packet packet;
+        bool failed = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            packet = std::move(in_flight_.front());
+            failed = (send_error_ != nullptr);
+        }
+        // after a failure, the messages in flight are dropped.
+        if (!failed) {
+            try {
+                io_->send_data(packet.data.data(), packet.data.size());
+                io_->flush();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                send_error_ = std::current_exception();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            in_flight_.pop_front();
+        }
+        cv_.notify_all();
+    }
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,94 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/network/forwarding_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Decorator of an IOBase that emulates a slower link in the sending direction, to predict the performance on a WAN
+// from tests on a LAN or a single machine. Both parties wrap their io to emulate both directions.
+// A send occupies the link for nbyte * 8 / bandwidth_bps seconds and blocks while the link is busy, as a socket
+// with a full buffer does. A background writer delivers the message to the underlying io when the link has
+// transmitted it, plus latency and a uniform random jitter in [0, jitter], without reordering messages.
+class EmulatedNetIO : public ForwardingNetIO {
+public:
+    EmulatedNetIO() = delete;
+
+    EmulatedNetIO(const EmulatedNetIO& other) = delete;
+
+    EmulatedNetIO& operator=(const EmulatedNetIO& other) = delete;
+
+    // Sends and receives through io, which must allow a send and a receive at the same time.
+    // A bandwidth_bps of 0 means an unlimited bandwidth.
+    EmulatedNetIO(std::shared_ptr<IOBase> io, std::uint64_t bandwidth_bps, std::chrono::microseconds latency,
+            std::chrono::microseconds jitter);
+
+    // Delivers the messages in flight.
+    ~EmulatedNetIO() override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // A message on the emulated link.
+    struct Packet {
+        Clock::time_point delivery_time{};
+        ByteVector data{};
+    };
+
+    void send_data_impl(const void* data, std::size_t nbyte) override;
+
+    void recv_data_impl(void* data, std::size_t nbyte) override;
+
+    // Blocks until every message in flight is delivered, then flushes the underlying io.
+    // Throws what the underlying io has thrown in the background.
+    void flush_impl() override;
+
+    // Loop of the background writer.
+    void write_loop();
+
+    std::uint64_t bandwidth_bps_ = 0;
+    std::chrono::microseconds latency_{0};
+    std::chrono::microseconds jitter_{0};
+
+    // Only touched by the sending thread.
+    Clock::time_point link_free_time_{};
+    Clock::time_point last_delivery_time_{};
+    std::mt19937_64 jitter_engine_{std::random_device{}()};
+
+    std::mutex mutex_{};
+    std::condition_variable cv_{};
+    std::deque<Packet> in_flight_{};
+    std::exception_ptr send_error_ = nullptr;
+    bool stopped_ = false;
+
+    std::thread writer_{};
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
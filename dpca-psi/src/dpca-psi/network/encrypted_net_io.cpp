@@ -0,0 +1,254 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/encrypted_net_io.h"
+
+#include <openssl/crypto.h>
+#include <openssl/hmac.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+const std::size_t EncryptedNetIO::kDefaultRecordSize;
+const std::size_t EncryptedNetIO::kMaxRecordSize;
+const std::size_t EncryptedNetIO::kKeySize;
+const std::size_t EncryptedNetIO::kNonceSize;
+const std::size_t EncryptedNetIO::kTagSize;
+
+namespace {
+
+// Binds the derived keys to this protocol.
+const char kKeyLabel[] = "dpca-psi encrypted channel";
+
+struct PkeyDeleter {
+    void operator()(EVP_PKEY* key) const {
+        EVP_PKEY_free(key);
+    }
+};
+
+struct PkeyCtxDeleter {
+    void operator()(EVP_PKEY_CTX* ctx) const {
+        EVP_PKEY_CTX_free(ctx);
+    }
+};
+
+using PkeyPtr = std::unique_ptr<EVP_PKEY, PkeyDeleter>;
+using PkeyCtxPtr = std::unique_ptr<EVP_PKEY_CTX, PkeyCtxDeleter>;
+
+unsigned char* as_uchar(Byte* bytes) {
+    return reinterpret_cast<unsigned char*>(bytes);
+}
+
+const unsigned char* as_uchar(const Byte* bytes) {
+    return reinterpret_cast<const unsigned char*>(bytes);
+}
+
+void hmac_sha256(const ByteVector& key, const ByteVector& data, Byte* out) {
+    unsigned int out_len = 0;
+    if (HMAC(EVP_sha256(), key.data(), static_cast<int>(key.size()), as_uchar(data.data()), data.size(),
+                as_uchar(out), &out_len) == nullptr) {
+        throw std::runtime_error("failed to derive channel keys");
+    }
+}
+
+}  // namespace
+
+EncryptedNetIO::EncryptedNetIO(
+        std::shared_ptr<IOBase> io, bool is_sender, const ByteVector& pre_shared_key, std::size_t record_size)
+        : ForwardingNetIO(io), record_size_(record_size) {
+    if (record_size_ == 0 || record_size_ > kMaxRecordSize) {
+        throw std::invalid_argument("record_size must be in [1, " + std::to_string(kMaxRecordSize) + "]");
+    }
+    send_ctx_ = EVP_CIPHER_CTX_new();
+    recv_ctx_ = EVP_CIPHER_CTX_new();
+    if (send_ctx_ == nullptr || recv_ctx_ == nullptr) {
+        EVP_CIPHER_CTX_free(send_ctx_);
+        EVP_CIPHER_CTX_free(recv_ctx_);
+        throw std::runtime_error("failed to create cipher contexts");
+    }
+    try {
+        exchange_keys(is_sender, pre_shared_key);
+    } catch (...) {
+        EVP_CIPHER_CTX_free(send_ctx_);
+        EVP_CIPHER_CTX_free(recv_ctx_);
+        throw;
+    }
+    send_record_.resize(sizeof(std::uint32_t) + record_size_ + kTagSize);
+}
+
+EncryptedNetIO::~EncryptedNetIO() {
+    EVP_CIPHER_CTX_free(send_ctx_);
+    EVP_CIPHER_CTX_free(recv_ctx_);
+    OPENSSL_cleanse(recv_record_.data(), recv_record_.size());
+}
+
+void EncryptedNetIO::exchange_keys(bool is_sender, const ByteVector& pre_shared_key) {
+    PkeyCtxPtr keygen_ctx(EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, nullptr));
+    EVP_PKEY* raw_key = nullptr;
+    if (keygen_ctx == nullptr || EVP_PKEY_keygen_init(keygen_ctx.get()) <= 0 ||
+            EVP_PKEY_keygen(keygen_ctx.get(), &raw_key) <= 0) {
+        throw std::runtime_error("failed to generate an X25519 key");
+    }
+    PkeyPtr key(raw_key);
+    ByteVector public_key(kKeySize);
+    std::size_t public_key_size = public_key.size();
+    if (EVP_PKEY_get_raw_public_key(key.get(), as_uchar(public_key.data()), &public_key_size) <= 0 ||
+            public_key_size != kKeySize) {
+        throw std::runtime_error("failed to export the X25519 public key");
+    }
+
+    ByteVector remote_public_key;
+    if (is_sender) {
+        io_->send_bytes(public_key);
+        io_->flush();
+        io_->recv_bytes(remote_public_key);
+    } else {
+        io_->recv_bytes(remote_public_key);
+        io_->send_bytes(public_key);
+        io_->flush();
+    }
+    if (remote_public_key.size() != kKeySize) {
+        throw std::runtime_error("received X25519 public key is invalid");
+    }
+    PkeyPtr remote_key(EVP_PKEY_new_raw_public_key(
+            EVP_PKEY_X25519, nullptr, as_uchar(remote_public_key.data()), remote_public_key.size()));
+    PkeyCtxPtr derive_ctx(EVP_PKEY_CTX_new(key.get(), nullptr));
+    ByteVector secret(kKeySize);
+    std::size_t secret_size = secret.size();
+    if (remote_key == nullptr || derive_ctx == nullptr || EVP_PKEY_derive_init(derive_ctx.get()) <= 0 ||
+            EVP_PKEY_derive_set_peer(derive_ctx.get(), remote_key.get()) <= 0 ||
+            EVP_PKEY_derive(derive_ctx.get(), as_uchar(secret.data()), &secret_size) <= 0 || secret_size != kKeySize) {
+        throw std::runtime_error("failed to agree on a channel secret");
+    }
+
+    // HKDF-SHA256 with the pre-shared key as salt, and the public keys of both parties in the info.
+    ByteVector salt = pre_shared_key.empty() ? ByteVector(kKeySize, Byte(0)) : pre_shared_key;
+    ByteVector pseudo_random_key(kKeySize);
+    hmac_sha256(salt, secret, pseudo_random_key.data());
+    const Byte* label = reinterpret_cast<const Byte*>(kKeyLabel);
+    ByteVector info(label, label + sizeof(kKeyLabel) - 1);
+    const ByteVector& sender_public_key = is_sender ? public_key : remote_public_key;
+    const ByteVector& receiver_public_key = is_sender ? remote_public_key : public_key;
+    info.insert(info.end(), sender_public_key.begin(), sender_public_key.end());
+    info.insert(info.end(), receiver_public_key.begin(), receiver_public_key.end());
+    // expands to T(1) | T(2), where T(1) = HMAC(PRK, info | 0x01) and T(2) = HMAC(PRK, T(1) | info | 0x02).
+    // The first key encrypts from the sender to the receiver, the second one the other way.
+    ByteVector keys(2 * kKeySize);
+    ByteVector message(info);
+    message.push_back(Byte(1));
+    hmac_sha256(pseudo_random_key, message, keys.data());
+    message.assign(keys.begin(), keys.begin() + kKeySize);
+    message.insert(message.end(), info.begin(), info.end());
+    message.push_back(Byte(2));
+    hmac_sha256(pseudo_random_key, message, keys.data() + kKeySize);
+
+    const unsigned char* send_key = as_uchar(keys.data()) + (is_sender ? 0 : kKeySize);
+    const unsigned char* recv_key = as_uchar(keys.data()) + (is_sender ? kKeySize : 0);
+    bool initialized = EVP_EncryptInit_ex(send_ctx_, EVP_aes_256_gcm(), nullptr, send_key, nullptr) > 0 &&
+                       EVP_DecryptInit_ex(recv_ctx_, EVP_aes_256_gcm(), nullptr, recv_key, nullptr) > 0;
+    OPENSSL_cleanse(secret.data(), secret.size());
+    OPENSSL_cleanse(pseudo_random_key.data(), pseudo_random_key.size());
+    OPENSSL_cleanse(keys.data(), keys.size());
+    OPENSSL_cleanse(message.data(), message.size());
+    if (!initialized) {
+        throw std::runtime_error("failed to initialize AES-GCM");
+    }
+}
+
+void EncryptedNetIO::send_data_impl(const void* data, std::size_t nbyte) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    unsigned char nonce[kNonceSize];
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    for (std::size_t offset = 0; offset < nbyte;) {
+        std::uint32_t length = static_cast<std::uint32_t>(std::min(record_size_, nbyte - offset));
+        unsigned char* header = as_uchar(send_record_.data());
+        unsigned char* ciphertext = header + sizeof(length);
+        std::memcpy(header, &length, sizeof(length));
+        get_nonce(send_counter_, nonce);
+        int out_length = 0;
+        // the length is authenticated as additional data.
+        if (EVP_EncryptInit_ex(send_ctx_, nullptr, nullptr, nullptr, nonce) <= 0 ||
+                EVP_EncryptUpdate(send_ctx_, nullptr, &out_length, header, sizeof(length)) <= 0 ||
+                EVP_EncryptUpdate(send_ctx_, ciphertext, &out_length, bytes + offset, static_cast<int>(length)) <= 0 ||
+                EVP_EncryptFinal_ex(send_ctx_, ciphertext + length, &out_length) <= 0 ||
+                EVP_CIPHER_CTX_ctrl(send_ctx_, EVP_CTRL_GCM_GET_TAG, kTagSize, ciphertext + length) <= 0) {
+            throw std::runtime_error("failed to encrypt a record");
+        }
+        io_->send_data(header, sizeof(length) + length + kTagSize);
+        ++send_counter_;
+        offset += length;
+    }
+}
+
+void EncryptedNetIO::recv_data_impl(void* data, std::size_t nbyte) {
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(data);
+    std::lock_guard<std::mutex> lock(recv_mutex_);
+    while (nbyte > 0) {
+        if (recv_offset_ < recv_record_.size()) {
+            std::size_t length = std::min(recv_record_.size() - recv_offset_, nbyte);
+            std::memcpy(bytes, recv_record_.data() + recv_offset_, length);
+            recv_offset_ += length;
+            bytes += length;
+            nbyte -= length;
+            continue;
+        }
+        std::uint32_t length = io_->recv_value<std::uint32_t>();
+        if (length == 0 || length > kMaxRecordSize) {
+            throw std::runtime_error("received record length is invalid");
+        }
+        if (length <= nbyte) {
+            // a whole record is decrypted in place in the receive buffer.
+            recv_record(length, bytes);
+            bytes += length;
+            nbyte -= length;
+        } else {
+            recv_record_.resize(length);
+            recv_record(length, as_uchar(recv_record_.data()));
+            recv_offset_ = 0;
+        }
+    }
+}
+
+void EncryptedNetIO::recv_record(std::uint32_t length, unsigned char* plaintext) {
+    unsigned char tag[kTagSize];
+    iovec spans[2] = {{plaintext, length}, {tag, kTagSize}};
+    io_->recv_data_vector(spans, 2);
+    unsigned char nonce[kNonceSize];
+    get_nonce(recv_counter_, nonce);
+    int out_length = 0;
+    if (EVP_DecryptInit_ex(recv_ctx_, nullptr, nullptr, nullptr, nonce) <= 0 ||
+            EVP_DecryptUpdate(recv_ctx_, nullptr, &out_length, reinterpret_cast<const unsigned char*>(&length),
+                    sizeof(length)) <= 0 ||
+            EVP_DecryptUpdate(recv_ctx_, plaintext, &out_length, plaintext, static_cast<int>(length)) <= 0 ||
+            EVP_CIPHER_CTX_ctrl(recv_ctx_, EVP_CTRL_GCM_SET_TAG, kTagSize, tag) <= 0 ||
+            EVP_DecryptFinal_ex(recv_ctx_, plaintext + length, &out_length) <= 0) {
+        // nothing of a forged record is left behind.
+        OPENSSL_cleanse(plaintext, length);
+        throw std::runtime_error("failed to authenticate a record, the keys of both parties differ or it was modified");
+    }
+    ++recv_counter_;
+}
+
+void EncryptedNetIO::get_nonce(std::uint64_t counter, unsigned char* nonce) {
+    std::memset(nonce, 0, kNonceSize);
+    std::memcpy(nonce + kNonceSize - sizeof(counter), &counter, sizeof(counter));
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
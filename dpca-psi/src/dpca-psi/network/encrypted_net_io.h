@@ -0,0 +1,101 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <openssl/evp.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/network/forwarding_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Decorator of an IOBase that encrypts and authenticates the traffic with AES-256-GCM, in place of a TLS proxy.
+// The constructor runs a key exchange with the other party over io: an ephemeral X25519 key agreement, whose secret
+// is combined with an optional pre-shared key by HKDF-SHA256 into one key per direction. Without a pre-shared key
+// the channel is only secure against passive eavesdroppers, with one it also authenticates the other party.
+// Sends are split into records of at most record_size bytes. A record is its length, the ciphertext and a 16-byte
+// tag, with the record counter as its nonce, so records cannot be dropped, reordered or replayed. Receives of whole
+// records decrypt in place in the receive buffer without a staging copy.
+// GCM is computed by OpenSSL, which uses AES-NI with PCLMULQDQ, or VAES with VPCLMULQDQ, where available.
+class EncryptedNetIO : public ForwardingNetIO {
+public:
+    // Records are large enough to amortize the per-record cost, and small enough to stay in the cache.
+    static const std::size_t kDefaultRecordSize = 1 << 20;
+
+    // Bound on the length of a received record, which is only authenticated after it has been received.
+    static const std::size_t kMaxRecordSize = 1 << 24;
+
+    EncryptedNetIO() = delete;
+
+    EncryptedNetIO(const EncryptedNetIO& other) = delete;
+
+    EncryptedNetIO& operator=(const EncryptedNetIO& other) = delete;
+
+    // Sends and receives through io, and runs the key exchange with the other party, which must use the same
+    // pre_shared_key. An empty pre_shared_key skips the authentication of the other party.
+    // Throws std::invalid_argument if record_size is 0 or greater than kMaxRecordSize, or std::runtime_error if the
+    // key exchange fails.
+    EncryptedNetIO(std::shared_ptr<IOBase> io, bool is_sender, const ByteVector& pre_shared_key,
+            std::size_t record_size = kDefaultRecordSize);
+
+    ~EncryptedNetIO() override;
+
+private:
+    static const std::size_t kKeySize = 32;
+
+    static const std::size_t kNonceSize = 12;
+
+    static const std::size_t kTagSize = 16;
+
+    void exchange_keys(bool is_sender, const ByteVector& pre_shared_key);
+
+    void send_data_impl(const void* data, std::size_t nbyte) override;
+
+    // Throws std::runtime_error if a record fails to authenticate.
+    void recv_data_impl(void* data, std::size_t nbyte) override;
+
+    void flush_impl() override {
+        io_->flush();
+    }
+
+    // Receives the rest of the record of length bytes after its length, and decrypts it in place in plaintext.
+    void recv_record(std::uint32_t length, unsigned char* plaintext);
+
+    // Writes the nonce of the record of counter into nonce.
+    static void get_nonce(std::uint64_t counter, unsigned char* nonce);
+
+    std::size_t record_size_ = kDefaultRecordSize;
+
+    std::mutex send_mutex_{};
+    EVP_CIPHER_CTX* send_ctx_ = nullptr;
+    std::uint64_t send_counter_ = 0;
+    ByteVector send_record_{};
+
+    std::mutex recv_mutex_{};
+    EVP_CIPHER_CTX* recv_ctx_ = nullptr;
+    std::uint64_t recv_counter_ = 0;
+    // A decrypted record that is only partly received, from recv_offset_.
+    ByteVector recv_record_{};
+    std::size_t recv_offset_ = 0;
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
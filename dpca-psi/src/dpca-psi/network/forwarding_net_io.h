@@ -0,0 +1,69 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+#include "dpca-psi/network/io_base.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Base of the decorators of an IOBase, which forwards the settings of the transport to the underlying io.
+class ForwardingNetIO : public IOBase {
+public:
+    ForwardingNetIO() = delete;
+
+    ForwardingNetIO(const ForwardingNetIO& other) = delete;
+
+    ForwardingNetIO& operator=(const ForwardingNetIO& other) = delete;
+
+    // Throws std::invalid_argument if io is nullptr.
+    explicit ForwardingNetIO(std::shared_ptr<IOBase> io) : io_(io) {
+        if (io_ == nullptr) {
+            throw std::invalid_argument("io is nullptr");
+        }
+    }
+
+    ~ForwardingNetIO() override = default;
+
+    // Sets the delay of the underlying io.
+    void set_delay(bool delay) override {
+        io_->set_delay(delay);
+    }
+
+    // Sets the zero-copy threshold of the underlying io.
+    void set_zero_copy_threshold(std::size_t threshold) override {
+        io_->set_zero_copy_threshold(threshold);
+    }
+
+    // Sets the socket buffer size of the underlying io.
+    void set_socket_buffer_size(std::size_t size) override {
+        io_->set_socket_buffer_size(size);
+    }
+
+    // Shuts the underlying io down.
+    void shutdown() override {
+        io_->shutdown();
+    }
+
+protected:
+    std::shared_ptr<IOBase> io_ = nullptr;
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
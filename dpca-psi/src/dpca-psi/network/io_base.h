@@ -14,32 +14,184 @@
 
 #pragma once
 
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "dpca-psi/common/defines.h"
 
 namespace privacy_go {
 namespace dpca_psi {
 
+// Traffic of one phase of an IOBase, see IOBase::set_phase().
+struct PhaseTraffic {
+    std::uint64_t bytes_sent = 0;
+    std::uint64_t bytes_received = 0;
+    // Number of send and receive calls, e.g. send_bytes() makes two.
+    std::uint64_t messages_sent = 0;
+    std::uint64_t messages_received = 0;
+    // Time spent in send and receive calls, i.e. waiting for the network or for the peer to reply.
+    std::chrono::nanoseconds send_time{0};
+    std::chrono::nanoseconds recv_time{0};
+    // Time the phase was set.
+    std::chrono::nanoseconds active_time{0};
+
+    // Returns the bytes sent and received per second of send and receive time.
+    double get_throughput() const {
+        auto blocked_time = std::chrono::duration<double>(send_time + recv_time).count();
+        return blocked_time > 0 ? static_cast<double>(bytes_sent + bytes_received) / blocked_time : 0;
+    }
+
+    // Returns the share of the active time that was spent in send and receive calls. A phase close to 1 is bound by
+    // the network or by the peer, a phase close to 0 by local computation. Calls of concurrent threads add up, so
+    // the share can exceed 1.
+    double get_blocked_ratio() const {
+        return active_time.count() > 0 ? static_cast<double>((send_time + recv_time).count()) /
+                                                 static_cast<double>(active_time.count())
+                                       : 0;
+    }
+};
+
 class IOBase {
 public:
-    IOBase() = default;
+    IOBase() {
+        set_phase("");
+    }
 
     virtual ~IOBase() = default;
 
     // The send and receive data function handling some basic operation such as
     // count the data flow size and header metadata.
     // Leave the detailed data transfer implementation to child class.
+    // With a send buffer, small messages are coalesced into one send of the child class. A receive flushes the send
+    // buffer first unless another thread is sending, so that a request is never held back while waiting for its reply.
     void send_data(const void* data, std::size_t nbyte) {
-        send_data_impl(data, nbyte);
+        send_data_buffered(data, nbyte, false);
+    }
+
+    // Sends data as send_data() does, where the caller keeps data valid and unchanged until the next flush(). The
+    // child class may then send it without a copy and without waiting for the send to complete, e.g. by MSG_ZEROCOPY.
+    void send_data_no_copy(const void* data, std::size_t nbyte) {
+        send_data_buffered(data, nbyte, true);
+    }
+
+    // Sends the spans in order, as send_data() of their concatenation would, without copying them into one buffer
+    // if the transport supports scatter-gather I/O, e.g. sendmsg() of a socket.
+    void send_data_vector(const iovec* spans, std::size_t span_num) {
+        auto start = std::chrono::steady_clock::now();
+        std::size_t nbyte = get_total_size(spans, span_num);
+        if (send_buffer_size_ == 0) {
+            send_data_vector_impl(spans, span_num);
+        } else {
+            std::lock_guard<std::mutex> lock(send_buffer_mutex_);
+            if (send_buffer_.size() + nbyte > send_buffer_size_) {
+                flush_send_buffer();
+            }
+            if (nbyte >= send_buffer_size_) {
+                send_data_vector_impl(spans, span_num);
+            } else {
+                for (std::size_t i = 0; i < span_num; ++i) {
+                    const Byte* bytes = reinterpret_cast<const Byte*>(spans[i].iov_base);
+                    send_buffer_.insert(send_buffer_.end(), bytes, bytes + spans[i].iov_len);
+                }
+            }
+        }
         bytes_sent_ += nbyte;
+        count_phase_sent(nbyte, start);
     }
 
     void recv_data(void* data, std::size_t nbyte) {
+        auto start = std::chrono::steady_clock::now();
+        if (send_buffer_size_ != 0) {
+            std::unique_lock<std::mutex> lock(send_buffer_mutex_, std::try_to_lock);
+            if (lock.owns_lock()) {
+                flush_send_buffer();
+            }
+        }
         recv_data_impl(data, nbyte);
         bytes_received_ += nbyte;
+        count_phase_received(nbyte, start);
+    }
+
+    // Receives into the spans in order, as recv_data() of their concatenation would, without a staging buffer if
+    // the transport supports scatter-gather I/O.
+    void recv_data_vector(const iovec* spans, std::size_t span_num) {
+        auto start = std::chrono::steady_clock::now();
+        if (send_buffer_size_ != 0) {
+            std::unique_lock<std::mutex> lock(send_buffer_mutex_, std::try_to_lock);
+            if (lock.owns_lock()) {
+                flush_send_buffer();
+            }
+        }
+        recv_data_vector_impl(spans, span_num);
+        std::size_t nbyte = get_total_size(spans, span_num);
+        bytes_received_ += nbyte;
+        count_phase_received(nbyte, start);
+    }
+
+    // Sends the buffered bytes, including those held back by the child class.
+    // Must be called after the last send before waiting for anything other than a receive on this thread.
+    void flush() {
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(send_buffer_mutex_);
+            flush_send_buffer();
+        }
+        flush_impl();
+        current_phase_counters_.load()->send_time_ns += elapsed_ns(start);
+    }
+
+    // Sets the size of the send buffer in bytes. Messages of at least size bytes are sent without copies.
+    // The send buffer is disabled by default, or if size is 0.
+    void set_send_buffer_size(std::size_t size) {
+        std::lock_guard<std::mutex> lock(send_buffer_mutex_);
+        flush_send_buffer();
+        send_buffer_size_ = size;
+        send_buffer_.reserve(size);
+    }
+
+    std::size_t get_send_buffer_size() const {
+        return send_buffer_size_;
+    }
+
+    // Enables the delay of small segments by the transport, e.g. Nagle's algorithm of TCP, if delay is true.
+    // Disables it otherwise. Does nothing if the transport has no such delay.
+    virtual void set_delay(bool delay) {
+        (void)delay;
+    }
+
+    // Sends messages of send_data_no_copy() of at least threshold bytes without copying them into the kernel, e.g. by
+    // MSG_ZEROCOPY of TCP. A threshold of 0 disables it, which is the default. Does nothing if the transport has no
+    // such send path.
+    virtual void set_zero_copy_threshold(std::size_t threshold) {
+        (void)threshold;
+    }
+
+    // Sets the kernel's send and receive buffers of the transport to size bytes, e.g. SO_SNDBUF and SO_RCVBUF of a
+    // socket. A size of 0 keeps the kernel's own sizing, which is the default. Does nothing if the transport has no
+    // such buffers.
+    virtual void set_socket_buffer_size(std::size_t size) {
+        (void)size;
+    }
+
+    // Ends the connection in both directions, e.g. after a local error in the middle of an exchange, so that sends
+    // and receives blocked on it throw std::runtime_error instead of waiting for data that never comes, and the other
+    // party's receives fail as well. The object is not usable afterwards. Does nothing if the transport cannot be
+    // ended, which is the default.
+    virtual void shutdown() {
     }
 
     void send_block(const block* data, std::size_t nblock) {
@@ -95,6 +247,41 @@ class IOBase {
         return;
     }
 
+    // Sends the concatenation of data as send_bytes() does, without copying the elements into one buffer.
+    void send_bytes_vector(const std::vector<ByteVector>& data) {
+        std::size_t len = 0;
+        for (const auto& element : data) {
+            len += element.size();
+        }
+        std::vector<iovec> spans;
+        spans.reserve(data.size() + 1);
+        spans.push_back({&len, sizeof(len)});
+        for (const auto& element : data) {
+            if (!element.empty()) {
+                spans.push_back({const_cast<Byte*>(element.data()), element.size()});
+            }
+        }
+        send_data_vector(spans.data(), spans.size());
+    }
+
+    // Receives what send_bytes() or send_bytes_vector() sent directly into elements of element_size bytes.
+    // Throws std::runtime_error if the received size is not a multiple of element_size.
+    void recv_bytes_vector(std::vector<ByteVector>& data, std::size_t element_size) {
+        std::size_t len = recv_value<std::size_t>();
+        if (element_size == 0 || len % element_size != 0) {
+            throw std::runtime_error("received size is not a multiple of the element size");
+        }
+        data.resize(len / element_size);
+        std::vector<iovec> spans(data.size());
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            data[i].resize(element_size);
+            spans[i] = {data[i].data(), element_size};
+        }
+        if (!spans.empty()) {
+            recv_data_vector(spans.data(), spans.size());
+        }
+    }
+
     void send_bool(bool* data, std::size_t length) {
         void* ptr = reinterpret_cast<void*>(data);
         std::size_t space = length;
@@ -129,12 +316,213 @@ class IOBase {
         return bytes_received_;
     }
 
+    // Sets the label that the following traffic is accounted to, and returns the previous one. The phase is shared
+    // by all threads using this object. Traffic before the first call is accounted to the empty label.
+    std::string set_phase(const std::string& phase) {
+        std::lock_guard<std::mutex> lock(phase_mutex_);
+        auto now = std::chrono::steady_clock::now();
+        std::string previous_phase;
+        PhaseCounters* previous_counters = current_phase_counters_.load();
+        if (previous_counters != nullptr) {
+            previous_counters->active_time_ns += elapsed_ns(phase_start_, now);
+            previous_phase = current_phase_;
+        }
+        auto found = std::find_if(phase_counters_.begin(), phase_counters_.end(),
+                [&phase](const std::pair<std::string, std::unique_ptr<PhaseCounters>>& entry) {
+                    return entry.first == phase;
+                });
+        if (found == phase_counters_.end()) {
+            phase_counters_.emplace_back(phase, std::unique_ptr<PhaseCounters>(new PhaseCounters()));
+            found = phase_counters_.end() - 1;
+        }
+        current_phase_counters_.store(found->second.get());
+        current_phase_ = phase;
+        phase_start_ = now;
+        return previous_phase;
+    }
+
+    std::string get_phase() {
+        std::lock_guard<std::mutex> lock(phase_mutex_);
+        return current_phase_;
+    }
+
+    // Returns the traffic of every phase so far, in the order the phases were first set.
+    std::vector<std::pair<std::string, PhaseTraffic>> get_phase_traffic() {
+        std::lock_guard<std::mutex> lock(phase_mutex_);
+        auto now = std::chrono::steady_clock::now();
+        std::vector<std::pair<std::string, PhaseTraffic>> traffic;
+        for (const auto& entry : phase_counters_) {
+            const PhaseCounters& counters = *entry.second;
+            PhaseTraffic phase_traffic;
+            phase_traffic.bytes_sent = counters.bytes_sent;
+            phase_traffic.bytes_received = counters.bytes_received;
+            phase_traffic.messages_sent = counters.messages_sent;
+            phase_traffic.messages_received = counters.messages_received;
+            phase_traffic.send_time = std::chrono::nanoseconds(counters.send_time_ns);
+            phase_traffic.recv_time = std::chrono::nanoseconds(counters.recv_time_ns);
+            std::uint64_t active_time_ns = counters.active_time_ns;
+            if (entry.second.get() == current_phase_counters_.load()) {
+                active_time_ns += elapsed_ns(phase_start_, now);
+            }
+            phase_traffic.active_time = std::chrono::nanoseconds(active_time_ns);
+            // the empty label is left out if nothing was accounted to it.
+            if (phase_traffic.messages_sent != 0 || phase_traffic.messages_received != 0 || !entry.first.empty()) {
+                traffic.emplace_back(entry.first, phase_traffic);
+            }
+        }
+        return traffic;
+    }
+
+    // Returns a table of get_phase_traffic(), one phase per line. DPCardinalityPSI names the phases after its steps,
+    // e.g. "match_keys" and "share_features/init_paillier".
+    std::string get_traffic_report() {
+        std::ostringstream report;
+        report << std::left << std::setw(40) << "phase" << std::right << std::setw(14) << "sent(B)" << std::setw(10)
+               << "msgs" << std::setw(14) << "recv(B)" << std::setw(10) << "msgs" << std::setw(12) << "send(ms)"
+               << std::setw(12) << "recv(ms)" << std::setw(12) << "active(ms)" << std::setw(10) << "blocked"
+               << std::setw(12) << "MB/s" << "\n";
+        report << std::fixed << std::setprecision(2);
+        for (const auto& entry : get_phase_traffic()) {
+            const PhaseTraffic& traffic = entry.second;
+            report << std::left << std::setw(40) << (entry.first.empty() ? "(none)" : entry.first) << std::right
+                   << std::setw(14) << traffic.bytes_sent << std::setw(10) << traffic.messages_sent << std::setw(14)
+                   << traffic.bytes_received << std::setw(10) << traffic.messages_received << std::setw(12)
+                   << std::chrono::duration<double, std::milli>(traffic.send_time).count() << std::setw(12)
+                   << std::chrono::duration<double, std::milli>(traffic.recv_time).count() << std::setw(12)
+                   << std::chrono::duration<double, std::milli>(traffic.active_time).count() << std::setw(9)
+                   << traffic.get_blocked_ratio() * 100 << "%" << std::setw(12) << traffic.get_throughput() / 1e6
+                   << "\n";
+        }
+        return report.str();
+    }
+
+protected:
+    // Counts the bytes received other than by recv_data(), e.g. by asynchronous receives.
+    void count_bytes_received(std::size_t nbyte) {
+        bytes_received_ += nbyte;
+        current_phase_counters_.load()->bytes_received += nbyte;
+    }
+
+    static std::size_t get_total_size(const iovec* spans, std::size_t span_num) {
+        std::size_t nbyte = 0;
+        for (std::size_t i = 0; i < span_num; ++i) {
+            nbyte += spans[i].iov_len;
+        }
+        return nbyte;
+    }
+
+    // Drops the first nbyte bytes from spans[first, spans.size()) after a partial sendmsg() or recvmsg(), and
+    // returns the index of the first span that is not done.
+    static std::size_t advance_spans(std::vector<iovec>& spans, std::size_t first, std::size_t nbyte) {
+        while (first < spans.size() && nbyte >= spans[first].iov_len) {
+            nbyte -= spans[first].iov_len;
+            ++first;
+        }
+        if (nbyte != 0) {
+            spans[first].iov_base = reinterpret_cast<Byte*>(spans[first].iov_base) + nbyte;
+            spans[first].iov_len -= nbyte;
+        }
+        return first;
+    }
+
 private:
+    // Counters of one phase, updated by concurrent sends and receives without a lock.
+    struct PhaseCounters {
+        std::atomic<std::uint64_t> bytes_sent{0};
+        std::atomic<std::uint64_t> bytes_received{0};
+        std::atomic<std::uint64_t> messages_sent{0};
+        std::atomic<std::uint64_t> messages_received{0};
+        std::atomic<std::uint64_t> send_time_ns{0};
+        std::atomic<std::uint64_t> recv_time_ns{0};
+        // Only updated with phase_mutex_ held.
+        std::uint64_t active_time_ns = 0;
+    };
+
+    static std::uint64_t elapsed_ns(const std::chrono::steady_clock::time_point& start,
+            const std::chrono::steady_clock::time_point& end = std::chrono::steady_clock::now()) {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+
+    void count_phase_sent(std::size_t nbyte, const std::chrono::steady_clock::time_point& start) {
+        PhaseCounters* counters = current_phase_counters_.load();
+        counters->bytes_sent += nbyte;
+        ++counters->messages_sent;
+        counters->send_time_ns += elapsed_ns(start);
+    }
+
+    void count_phase_received(std::size_t nbyte, const std::chrono::steady_clock::time_point& start) {
+        PhaseCounters* counters = current_phase_counters_.load();
+        counters->bytes_received += nbyte;
+        ++counters->messages_received;
+        counters->recv_time_ns += elapsed_ns(start);
+    }
+
+    void send_data_buffered(const void* data, std::size_t nbyte, bool no_copy) {
+        auto start = std::chrono::steady_clock::now();
+        if (send_buffer_size_ == 0) {
+            no_copy ? send_data_no_copy_impl(data, nbyte) : send_data_impl(data, nbyte);
+        } else {
+            std::lock_guard<std::mutex> lock(send_buffer_mutex_);
+            if (send_buffer_.size() + nbyte > send_buffer_size_) {
+                flush_send_buffer();
+            }
+            if (nbyte >= send_buffer_size_) {
+                no_copy ? send_data_no_copy_impl(data, nbyte) : send_data_impl(data, nbyte);
+            } else {
+                const Byte* bytes = reinterpret_cast<const Byte*>(data);
+                send_buffer_.insert(send_buffer_.end(), bytes, bytes + nbyte);
+            }
+        }
+        bytes_sent_ += nbyte;
+        count_phase_sent(nbyte, start);
+    }
+
     // Implementation details for send and receiving data.
     virtual void send_data_impl(const void* data, std::size_t nbyte) = 0;
 
+    // Sends data that stays valid and unchanged until the next flush(), see send_data_no_copy(). Sends it by
+    // send_data_impl() unless the child class overrides it.
+    virtual void send_data_no_copy_impl(const void* data, std::size_t nbyte) {
+        send_data_impl(data, nbyte);
+    }
+
     virtual void recv_data_impl(void* data, std::size_t nbyte) = 0;
 
+    // Sends the spans in order. Unless the child class has scatter-gather I/O, they are copied into one buffer.
+    virtual void send_data_vector_impl(const iovec* spans, std::size_t span_num) {
+        ByteVector buffer;
+        buffer.reserve(get_total_size(spans, span_num));
+        for (std::size_t i = 0; i < span_num; ++i) {
+            const Byte* bytes = reinterpret_cast<const Byte*>(spans[i].iov_base);
+            buffer.insert(buffer.end(), bytes, bytes + spans[i].iov_len);
+        }
+        send_data_impl(buffer.data(), buffer.size());
+    }
+
+    // Receives into the spans in order. Unless the child class has scatter-gather I/O, they are received into one
+    // buffer and copied.
+    virtual void recv_data_vector_impl(const iovec* spans, std::size_t span_num) {
+        ByteVector buffer(get_total_size(spans, span_num));
+        recv_data_impl(buffer.data(), buffer.size());
+        const Byte* bytes = buffer.data();
+        for (std::size_t i = 0; i < span_num; ++i) {
+            std::memcpy(spans[i].iov_base, bytes, spans[i].iov_len);
+            bytes += spans[i].iov_len;
+        }
+    }
+
+    // Sends the bytes held back by the child class, if any.
+    virtual void flush_impl() {
+    }
+
+    // Sends the buffered bytes, where send_buffer_mutex_ must be held.
+    void flush_send_buffer() {
+        if (!send_buffer_.empty()) {
+            send_data_impl(send_buffer_.data(), send_buffer_.size());
+            send_buffer_.clear();
+        }
+    }
+
     void send_bool_aligned(const bool* data, std::size_t length) {
         const std::uint64_t* data64 = reinterpret_cast<const std::uint64_t*>(data);
         std::size_t i = 0;
@@ -183,6 +571,40 @@ class IOBase {
 
     std::uint64_t bytes_sent_ = 0;
     std::uint64_t bytes_received_ = 0;
+
+    // Counters are never removed, so that a pointer to the current ones stays valid while another thread sets the
+    // phase.
+    std::mutex phase_mutex_{};
+    std::vector<std::pair<std::string, std::unique_ptr<PhaseCounters>>> phase_counters_{};
+    std::atomic<PhaseCounters*> current_phase_counters_{nullptr};
+    std::string current_phase_{};
+    std::chrono::steady_clock::time_point phase_start_{};
+
+    // The size is written under send_buffer_mutex_, and read without it to skip the mutex if the buffer is disabled.
+    std::mutex send_buffer_mutex_{};
+    std::atomic<std::size_t> send_buffer_size_{0};
+    ByteVector send_buffer_{};
+};
+
+// Sets the phase of io to phase, nested under the current one as "current/phase", until the end of the scope.
+class ScopedIOPhase {
+public:
+    ScopedIOPhase(const std::shared_ptr<IOBase>& io, const std::string& phase) : io_(io) {
+        std::string current_phase = io_->get_phase();
+        previous_phase_ = io_->set_phase(current_phase.empty() ? phase : current_phase + "/" + phase);
+    }
+
+    ScopedIOPhase(const ScopedIOPhase&) = delete;
+
+    ScopedIOPhase& operator=(const ScopedIOPhase&) = delete;
+
+    ~ScopedIOPhase() {
+        io_->set_phase(previous_phase_);
+    }
+
+private:
+    std::shared_ptr<IOBase> io_ = nullptr;
+    std::string previous_phase_{};
 };
 
 }  // namespace dpca_psi
@@ -0,0 +1,123 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/link_tuner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+const std::size_t LinkTuner::kDefaultBurstSize;
+const std::size_t LinkTuner::kDefaultPingNum;
+constexpr double LinkTuner::kChunkTime;
+const std::size_t LinkTuner::kMinChunkSize;
+const std::size_t LinkTuner::kMaxChunkSize;
+const std::size_t LinkTuner::kAutoTuningLimit;
+const std::size_t LinkTuner::kMaxSocketBufferSize;
+constexpr double LinkTuner::kCompressionThroughput;
+
+namespace {
+
+// Returns value in [min_value, max_value], which also bounds an infinite value.
+std::size_t clamp_size(double value, std::size_t min_value, std::size_t max_value) {
+    if (!(value > static_cast<double>(min_value))) {
+        return min_value;
+    }
+    if (value >= static_cast<double>(max_value)) {
+        return max_value;
+    }
+    return static_cast<std::size_t>(value);
+}
+
+double seconds_from(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+std::string LinkTuning::to_string() const {
+    std::string socket_buffer =
+            socket_buffer_size == 0 ? "kernel autotuning" : std::to_string(socket_buffer_size) + " bytes";
+    return "chunk size " + std::to_string(chunk_size) + " bytes, socket buffers " + socket_buffer + ", " +
+           (compress_points ? "compressed" : "uncompressed") + " points";
+}
+
+LinkProfile LinkTuner::probe(bool is_sender, std::shared_ptr<IOBase> io, std::size_t ping_num, std::size_t burst_size) {
+    if (ping_num == 0 || burst_size == 0) {
+        throw std::invalid_argument("ping_num and burst_size must be positive");
+    }
+    std::vector<std::uint8_t> burst(burst_size);
+    LinkProfile profile;
+    if (is_sender) {
+        // the fastest round trip is the least disturbed by scheduling.
+        profile.rtt = std::numeric_limits<double>::max();
+        for (std::size_t ping_idx = 0; ping_idx < ping_num; ++ping_idx) {
+            auto start = std::chrono::steady_clock::now();
+            io->send_value<std::uint64_t>(ping_idx);
+            io->flush();
+            if (io->recv_value<std::uint64_t>() != ping_idx) {
+                throw std::runtime_error("unexpected probe reply");
+            }
+            profile.rtt = std::min(profile.rtt, seconds_from(start));
+        }
+        // a burst ends with the round trip of its acknowledgement.
+        double burst_time = 0.0;
+        for (std::size_t burst_idx = 0; burst_idx < 2; ++burst_idx) {
+            auto start = std::chrono::steady_clock::now();
+            io->send_data(burst.data(), burst.size());
+            io->flush();
+            io->recv_value<std::uint8_t>();
+            burst_time = seconds_from(start);
+        }
+        profile.throughput = static_cast<double>(burst_size) / std::max(burst_time - profile.rtt, 1e-6);
+        io->send_value(profile.rtt);
+        io->send_value(profile.throughput);
+        io->flush();
+    } else {
+        for (std::size_t ping_idx = 0; ping_idx < ping_num; ++ping_idx) {
+            io->send_value(io->recv_value<std::uint64_t>());
+            io->flush();
+        }
+        for (std::size_t burst_idx = 0; burst_idx < 2; ++burst_idx) {
+            io->recv_data(burst.data(), burst.size());
+            io->send_value<std::uint8_t>(1);
+            io->flush();
+        }
+        profile.rtt = io->recv_value<double>();
+        profile.throughput = io->recv_value<double>();
+    }
+    return profile;
+}
+
+// Chunks are small enough on a slow link to get the first one on the wire early, and large enough on a fast link to
+// amortize the cost of a chunk. Socket buffers hold twice the bandwidth-delay product, so that a window in flight
+// never stalls the next sends.
+LinkTuning LinkTuner::tune(const LinkProfile& profile) {
+    LinkTuning tuning;
+    tuning.chunk_size = clamp_size(profile.throughput * kChunkTime, kMinChunkSize, kMaxChunkSize);
+    std::size_t socket_buffer_size =
+            clamp_size(2.0 * profile.rtt * profile.throughput, kAutoTuningLimit, kMaxSocketBufferSize);
+    tuning.socket_buffer_size = socket_buffer_size > kAutoTuningLimit ? socket_buffer_size : 0;
+    tuning.compress_points = !(profile.throughput > kCompressionThroughput);
+    return tuning;
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,87 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "dpca-psi/network/io_base.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Round-trip time and throughput of a link, as measured by LinkTuner::probe().
+struct LinkProfile {
+    // In seconds.
+    double rtt = 0.0;
+    // In bytes per second.
+    double throughput = 0.0;
+};
+
+// Transfer settings that suit a link.
+struct LinkTuning {
+    // Bytes that are encrypted and sent at a time by the exchanges of the protocols.
+    std::size_t chunk_size = 0;
+    // Size of the kernel's socket buffers, or 0 to keep the kernel's autotuning.
+    std::size_t socket_buffer_size = 0;
+    // Whether points on elliptic curves are sent in compressed form, which halves their size but costs a square root
+    // to decompress.
+    bool compress_points = true;
+
+    std::string to_string() const;
+};
+
+// Measures the link to the other party with a short probe, and derives the transfer settings from it.
+// DPCardinalityPSI::init() runs it with "auto_tune" once the parameter checks have passed on both sides, and settings
+// that are configured explicitly override the tuned ones.
+class LinkTuner {
+public:
+    // Bytes of a probe burst.
+    static const std::size_t kDefaultBurstSize = std::size_t(1) << 21;
+
+    // Number of round trips of a probe.
+    static const std::size_t kDefaultPingNum = 8;
+
+    // A chunk is sent in about kChunkTime seconds, bounded by kMinChunkSize and kMaxChunkSize.
+    static constexpr double kChunkTime = 0.02;
+
+    static const std::size_t kMinChunkSize = std::size_t(1) << 16;
+
+    static const std::size_t kMaxChunkSize = std::size_t(1) << 24;
+
+    // Socket buffers are only set when twice the bandwidth-delay product exceeds what the kernel's autotuning
+    // reaches by default, and are bounded by kMaxSocketBufferSize.
+    static const std::size_t kAutoTuningLimit = std::size_t(1) << 22;
+
+    static const std::size_t kMaxSocketBufferSize = std::size_t(1) << 27;
+
+    // Points are sent uncompressed above this throughput, in bytes per second, where the decompression costs more
+    // than the transfer of the saved bytes.
+    static constexpr double kCompressionThroughput = 125e6;
+
+    // Measures the round-trip time by ping_num round trips, and the throughput by two bursts of burst_size bytes,
+    // the first of which opens the congestion window. Only the sender measures, and sends the result to the
+    // receiver, so that both parties get the same profile. Both parties must use the same arguments.
+    // Throws std::invalid_argument if ping_num or burst_size is 0.
+    static LinkProfile probe(bool is_sender, std::shared_ptr<IOBase> io, std::size_t ping_num = kDefaultPingNum,
+            std::size_t burst_size = kDefaultBurstSize);
+
+    // Returns the settings for profile, which are the same for both parties given the same profile.
+    static LinkTuning tune(const LinkProfile& profile);
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,173 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/memory_net_io.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+const std::size_t SpscRingBuffer::kCacheLineSize;
+const std::size_t SpscRingBuffer::kSpinCount;
+const std::size_t MemoryNetIO::kDefaultCapacity;
+
+SpscRingBuffer::SpscRingBuffer(std::size_t capacity) {
+    if (capacity == 0) {
+        throw std::invalid_argument("capacity must be positive");
+    }
+    std::size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    buffer_.resize(size);
+    mask_ = size - 1;
+}
+
+template <typename Condition>
+bool SpscRingBuffer::wait(const Condition& condition) {
+    for (std::size_t spin_idx = 0; spin_idx < kSpinCount; ++spin_idx) {
+        if (condition()) {
+            return true;
+        }
+        if (closed_.load(std::memory_order_acquire)) {
+            // bytes may have arrived right before the ring was closed.
+            return condition();
+        }
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    // the condition is checked after announcing the sleep, so that an update of the other side either is seen here
+    // or sees the sleeper and notifies under the mutex.
+    sleeper_num_.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ready = true;
+    while (!condition()) {
+        if (closed_.load(std::memory_order_acquire)) {
+            ready = condition();
+            break;
+        }
+        sleep_cv_.wait(lock);
+    }
+    sleeper_num_.fetch_sub(1, std::memory_order_relaxed);
+    return ready;
+}
+
+void SpscRingBuffer::notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeper_num_.load(std::memory_order_seq_cst) != 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.notify_all();
+    }
+}
+
+void SpscRingBuffer::write(const void* data, std::size_t nbyte) {
+    if (closed_.load(std::memory_order_acquire)) {
+        throw std::runtime_error("channel is closed");
+    }
+    const Byte* bytes = reinterpret_cast<const Byte*>(data);
+    std::uint64_t position = write_position_.load(std::memory_order_relaxed);
+    std::size_t written = 0;
+    while (written < nbyte) {
+        if (position - cached_read_position_ == buffer_.size()) {
+            bool ready = wait([this, position]() {
+                cached_read_position_ = read_position_.load(std::memory_order_acquire);
+                return position - cached_read_position_ != buffer_.size();
+            });
+            if (!ready || closed_.load(std::memory_order_acquire)) {
+                throw std::runtime_error("channel is closed");
+            }
+        }
+        std::size_t index = static_cast<std::size_t>(position & mask_);
+        std::size_t length = std::min<std::uint64_t>(
+                {nbyte - written, buffer_.size() - (position - cached_read_position_), buffer_.size() - index});
+        std::memcpy(buffer_.data() + index, bytes + written, length);
+        written += length;
+        position += length;
+        write_position_.store(position, std::memory_order_release);
+        notify();
+    }
+}
+
+void SpscRingBuffer::read(void* data, std::size_t nbyte) {
+    Byte* bytes = reinterpret_cast<Byte*>(data);
+    std::uint64_t position = read_position_.load(std::memory_order_relaxed);
+    std::size_t received = 0;
+    while (received < nbyte) {
+        if (cached_write_position_ == position) {
+            bool ready = wait([this, position]() {
+                cached_write_position_ = write_position_.load(std::memory_order_acquire);
+                return cached_write_position_ != position;
+            });
+            if (!ready) {
+                throw std::runtime_error("channel is closed");
+            }
+        }
+        std::size_t index = static_cast<std::size_t>(position & mask_);
+        std::size_t length =
+                std::min<std::uint64_t>({nbyte - received, cached_write_position_ - position, buffer_.size() - index});
+        std::memcpy(bytes + received, buffer_.data() + index, length);
+        received += length;
+        position += length;
+        read_position_.store(position, std::memory_order_release);
+        notify();
+    }
+}
+
+void SpscRingBuffer::close() {
+    closed_.store(true, std::memory_order_release);
+    notify();
+}
+
+MemoryNetIO::MemoryNetIO(std::shared_ptr<SpscRingBuffer> send_ring, std::shared_ptr<SpscRingBuffer> recv_ring)
+        : send_ring_(send_ring), recv_ring_(recv_ring) {
+}
+
+MemoryNetIO::~MemoryNetIO() {
+    try {
+        flush();
+    } catch (const std::runtime_error&) {
+        // the peer is gone, the buffered bytes have nowhere to go.
+    }
+    send_ring_->close();
+    recv_ring_->close();
+}
+
+// static
+std::pair<std::shared_ptr<MemoryNetIO>, std::shared_ptr<MemoryNetIO>> MemoryNetIO::create_pair(
+        std::size_t capacity) {
+    auto ring_0 = std::make_shared<SpscRingBuffer>(capacity);
+    auto ring_1 = std::make_shared<SpscRingBuffer>(capacity);
+    // the constructor is private, so std::make_shared is not available.
+    std::shared_ptr<MemoryNetIO> end_0(new MemoryNetIO(ring_0, ring_1));
+    std::shared_ptr<MemoryNetIO> end_1(new MemoryNetIO(ring_1, ring_0));
+    return std::make_pair(end_0, end_1);
+}
+
+void MemoryNetIO::shutdown() {
+    send_ring_->close();
+    recv_ring_->close();
+}
+
+void MemoryNetIO::send_data_impl(const void* data, std::size_t nbyte) {
+    send_ring_->write(data, nbyte);
+}
+
+void MemoryNetIO::recv_data_impl(void* data, std::size_t nbyte) {
+    recv_ring_->read(data, nbyte);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
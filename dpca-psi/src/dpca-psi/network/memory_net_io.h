@@ -0,0 +1,123 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/network/io_base.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// A lock-free ring buffer of bytes with a single producer and a single consumer.
+// write() and read() block until all bytes are transferred, by spinning for a short while and then sleeping on a
+// condition variable until the other side or close() wakes them up.
+class SpscRingBuffer {
+public:
+    SpscRingBuffer() = delete;
+
+    SpscRingBuffer(const SpscRingBuffer& other) = delete;
+
+    SpscRingBuffer& operator=(const SpscRingBuffer& other) = delete;
+
+    // Rounds capacity up to a power of two.
+    explicit SpscRingBuffer(std::size_t capacity);
+
+    // Throws std::runtime_error if the ring is closed before all bytes are written.
+    void write(const void* data, std::size_t nbyte);
+
+    // Throws std::runtime_error if the ring is closed and empty before all bytes are read.
+    void read(void* data, std::size_t nbyte);
+
+    // Wakes up the blocked producer and consumer, bytes written before can still be read.
+    void close();
+
+    std::size_t capacity() const {
+        return buffer_.size();
+    }
+
+private:
+    static const std::size_t kCacheLineSize = 64;
+
+    // Number of checks of a condition before the waiting side sleeps.
+    static const std::size_t kSpinCount = 1024;
+
+    // Blocks until condition() holds, returns false if the ring is closed before.
+    template <typename Condition>
+    bool wait(const Condition& condition);
+
+    // Wakes up the other side if it sleeps in wait().
+    void notify();
+
+    ByteVector buffer_{};
+    std::size_t mask_ = 0;
+
+    // The producer and consumer positions are on separate cache lines, and each side caches the other's position.
+    char padding_0_[kCacheLineSize];
+    std::atomic<std::uint64_t> write_position_{0};
+    std::uint64_t cached_read_position_ = 0;
+    char padding_1_[kCacheLineSize];
+    std::atomic<std::uint64_t> read_position_{0};
+    std::uint64_t cached_write_position_ = 0;
+    char padding_2_[kCacheLineSize];
+    std::atomic<bool> closed_{false};
+
+    // Number of sides sleeping in wait().
+    std::atomic<std::size_t> sleeper_num_{0};
+    std::mutex sleep_mutex_{};
+    std::condition_variable sleep_cv_{};
+};
+
+// An in-process channel between two parties running as threads of the same process, without sockets or ports.
+// Each direction is a SpscRingBuffer, so a send and a receive may run at the same time from two threads.
+// Destroying one end closes both directions, a peer blocked on the channel then throws std::runtime_error.
+class MemoryNetIO : public IOBase {
+public:
+    MemoryNetIO() = delete;
+
+    MemoryNetIO(const MemoryNetIO& other) = delete;
+
+    MemoryNetIO& operator=(const MemoryNetIO& other) = delete;
+
+    ~MemoryNetIO() override;
+
+    // Creates the two ends of a channel, with rings of at least capacity bytes in each direction.
+    static std::pair<std::shared_ptr<MemoryNetIO>, std::shared_ptr<MemoryNetIO>> create_pair(std::size_t capacity);
+
+    // Closes both directions.
+    void shutdown() override;
+
+    static const std::size_t kDefaultCapacity = std::size_t(1) << 22;
+
+private:
+    MemoryNetIO(std::shared_ptr<SpscRingBuffer> send_ring, std::shared_ptr<SpscRingBuffer> recv_ring);
+
+    void send_data_impl(const void* data, std::size_t nbyte) override;
+
+    void recv_data_impl(void* data, std::size_t nbyte) override;
+
+    std::shared_ptr<SpscRingBuffer> send_ring_ = nullptr;
+    std::shared_ptr<SpscRingBuffer> recv_ring_ = nullptr;
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
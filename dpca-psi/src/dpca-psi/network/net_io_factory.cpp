@@ -0,0 +1,82 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/net_io_factory.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/common/utils.h"
+#include "dpca-psi/network/emulated_net_io.h"
+#include "dpca-psi/network/encrypted_net_io.h"
+#include "dpca-psi/network/striped_net_io.h"
+#include "dpca-psi/network/transcript_net_io.h"
+#include "dpca-psi/network/two_channel_net_io.h"
+#include "dpca-psi/network/unix_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+std::shared_ptr<IOBase> create_net_io(const nlohmann::json& params) {
+    const nlohmann::json& common = params.at("common");
+    std::string transcript_mode = common.value("transcript_mode", "none");
+    std::string transcript_file = common.value("transcript_file", "");
+    bool replay = (transcript_mode == "replay" || transcript_mode == "replay_check");
+
+    std::shared_ptr<IOBase> net = nullptr;
+    if (replay) {
+        net = std::make_shared<ReplayNetIO>(
+                transcript_file, transcript_mode == "replay" ? ReplayMode::kDrop : ReplayMode::kCheck);
+    } else {
+        std::string address = common.at("address");
+        std::uint16_t remote_port = common.at("remote_port");
+        std::uint16_t local_port = common.at("local_port");
+        std::size_t stream_num = common.value("stream_num", 1);
+        std::size_t stripe_size = common.value("stripe_size", StripedNetIO::kDefaultStripeSize);
+        if (UnixNetIO::is_unix_address(address)) {
+            net = std::make_shared<UnixNetIO>(UnixNetIO::get_socket_path(address, remote_port),
+                    UnixNetIO::get_socket_path(address, local_port), UnixNetIO::kDefaultSocketBufferSize);
+        } else if (stream_num > 1) {
+            net = std::make_shared<StripedNetIO>(address, remote_port, local_port, stream_num, stripe_size);
+        } else {
+            net = std::make_shared<TwoChannelNetIO>(address, remote_port, local_port);
+        }
+    }
+
+    // a replay has no other party to encrypt for.
+    if (common.value("channel_encryption", false) && !replay) {
+        std::string pre_shared_key = hex_2_string(common.value("channel_pre_shared_key", ""));
+        const auto* key_bytes = reinterpret_cast<const Byte*>(pre_shared_key.data());
+        net = std::make_shared<EncryptedNetIO>(
+                net, common.at("is_sender").get<bool>(), ByteVector(key_bytes, key_bytes + pre_shared_key.size()));
+    }
+    if (transcript_mode == "record") {
+        net = std::make_shared<RecordingNetIO>(net, transcript_file);
+    }
+
+    double bandwidth_mbps = common.value("emulated_bandwidth_mbps", 0.0);
+    double latency_ms = common.value("emulated_latency_ms", 0.0);
+    double jitter_ms = common.value("emulated_jitter_ms", 0.0);
+    if (bandwidth_mbps > 0 || latency_ms > 0 || jitter_ms > 0) {
+        net = std::make_shared<EmulatedNetIO>(net, static_cast<std::uint64_t>(bandwidth_mbps * 1e6),
+                std::chrono::microseconds(static_cast<std::int64_t>(latency_ms * 1000)),
+                std::chrono::microseconds(static_cast<std::int64_t>(jitter_ms * 1000)));
+    }
+    return net;
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
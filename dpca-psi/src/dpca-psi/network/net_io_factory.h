@@ -0,0 +1,40 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+
+#include "nlohmann/json.hpp"
+
+#include "dpca-psi/network/io_base.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Connects to the other party as configured by the "common" keys of params, the json configuration of the examples,
+// and returns the transport stack:
+//   1. ReplayNetIO if "transcript_mode" is "replay" or "replay_check", which plays the other party from
+//      "transcript_file" without any connection. Otherwise UnixNetIO if "address" is "unix:<path>", StripedNetIO
+//      over "stream_num" connections of "stripe_size" bytes per stripe if "stream_num" is larger than 1, or
+//      TwoChannelNetIO, on "remote_port" and "local_port".
+//   2. EncryptedNetIO with the hex digits of "channel_pre_shared_key" if "channel_encryption" is set, except for
+//      replays.
+//   3. RecordingNetIO to "transcript_file" if "transcript_mode" is "record".
+//   4. EmulatedNetIO if any of "emulated_bandwidth_mbps", "emulated_latency_ms" and "emulated_jitter_ms" is positive.
+// Missing keys disable their layer. "is_sender" selects the role in the key exchange of EncryptedNetIO.
+std::shared_ptr<IOBase> create_net_io(const nlohmann::json& params);
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
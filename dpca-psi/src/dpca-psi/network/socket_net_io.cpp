@@ -0,0 +1,251 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/socket_net_io.h"
+
+#include <linux/errqueue.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+SocketNetIO::~SocketNetIO() {
+    if (send_socket_ >= 0) {
+        try {
+            flush();
+        } catch (const std::runtime_error&) {
+            // the connection is shut down, the buffered bytes have nowhere to go.
+        }
+    }
+    if (send_socket_ >= 0) {
+        close(send_socket_);
+    }
+    if (recv_socket_ >= 0) {
+        close(recv_socket_);
+    }
+}
+
+void SocketNetIO::open_sockets(
+        const std::function<int()>& accept_send_socket, const std::function<int()>& connect_recv_socket) {
+    std::thread server_thread([this, &accept_send_socket]() { send_socket_ = accept_send_socket(); });
+    std::thread client_thread([this, &connect_recv_socket]() { recv_socket_ = connect_recv_socket(); });
+    server_thread.join();
+    client_thread.join();
+}
+
+void SocketNetIO::shutdown() {
+    shut_down_ = true;
+    ::shutdown(send_socket_, SHUT_RDWR);
+    ::shutdown(recv_socket_, SHUT_RDWR);
+}
+
+void SocketNetIO::fail(const char* name) const {
+    if (shut_down_) {
+        throw std::runtime_error(std::string(name) + " on a shut down connection");
+    }
+    perror(name);
+    exit(EXIT_FAILURE);
+}
+
+void SocketNetIO::set_delay(bool delay) {
+    if (delay) {
+        disable_nodelay(send_socket_);
+    } else {
+        set_nodelay(send_socket_);
+    }
+}
+
+void SocketNetIO::set_nodelay(int socket) {
+    const int one = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+void SocketNetIO::disable_nodelay(int socket) {
+    const int zero = 0;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &zero, sizeof(zero));
+}
+
+void SocketNetIO::set_socket_buffer_size(std::size_t size) {
+    if (size == 0) {
+        return;
+    }
+    set_buffer_size(send_socket_, SO_SNDBUF, SO_SNDBUFFORCE, "/proc/sys/net/core/wmem_max", size);
+    set_buffer_size(recv_socket_, SO_RCVBUF, SO_RCVBUFFORCE, "/proc/sys/net/core/rmem_max", size);
+}
+
+// static
+bool SocketNetIO::set_buffer_size(
+        int socket, int option, int force_option, const char* max_path, std::size_t size) {
+    const int value = static_cast<int>(std::min(size, static_cast<std::size_t>(INT_MAX / 2)));
+    if (setsockopt(socket, SOL_SOCKET, force_option, &value, sizeof(value)) == 0) {
+        return true;
+    }
+    // a capped size would only shrink a buffer that the autotuning may grow further.
+    std::size_t max_size = 0;
+    std::ifstream max_file(max_path);
+    if (!(max_file >> max_size) || static_cast<std::size_t>(value) > max_size) {
+        return false;
+    }
+    return setsockopt(socket, SOL_SOCKET, option, &value, sizeof(value)) == 0;
+}
+
+void SocketNetIO::set_zero_copy_threshold(std::size_t threshold) {
+    if (threshold != 0 && !zero_copy_enabled_on_socket_) {
+        const int one = 1;
+        if (setsockopt(send_socket_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) != 0) {
+            zero_copy_threshold_ = 0;
+            return;
+        }
+        zero_copy_enabled_on_socket_ = true;
+    }
+    zero_copy_threshold_ = threshold;
+}
+
+void SocketNetIO::send_data_impl(const void* data, std::size_t nbyte) {
+    send_all(data, nbyte, false);
+}
+
+void SocketNetIO::send_data_no_copy_impl(const void* data, std::size_t nbyte) {
+    bool zero_copy = zero_copy_threshold_ != 0 && nbyte >= zero_copy_threshold_;
+    send_all(data, nbyte, zero_copy);
+    if (zero_copy) {
+        // keeps the error queue short, the pages are waited for in flush().
+        collect_zero_copy_completions(false);
+    }
+}
+
+void SocketNetIO::flush_impl() {
+    collect_zero_copy_completions(true);
+}
+
+void SocketNetIO::send_all(const void* data, std::size_t nbyte, bool zero_copy) {
+    // a send on a shut down socket fails instead of raising SIGPIPE.
+    int flags = MSG_NOSIGNAL | (zero_copy ? MSG_ZEROCOPY : 0);
+    std::size_t sent = 0;
+    while (sent < nbyte) {
+        ssize_t res = send(send_socket_, reinterpret_cast<const char*>(data) + sent, nbyte - sent, flags);
+        if (res > 0) {
+            sent += res;
+            // every successful zero-copy send() gets a completion notification.
+            zero_copy_sent_ += zero_copy ? 1 : 0;
+        } else if (zero_copy && errno == ENOBUFS) {
+            // the pinned pages exceed the socket's option memory, waits for some to be released.
+            collect_zero_copy_completions(true);
+        } else {
+            fail("send");
+        }
+    }
+}
+
+void SocketNetIO::send_data_vector_impl(const iovec* spans, std::size_t span_num) {
+    std::vector<iovec> remaining(spans, spans + span_num);
+    std::size_t first = advance_spans(remaining, 0, 0);
+    while (first < remaining.size()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = remaining.data() + first;
+        msg.msg_iovlen = std::min(remaining.size() - first, static_cast<std::size_t>(IOV_MAX));
+        ssize_t res = sendmsg(send_socket_, &msg, MSG_NOSIGNAL);
+        if (res > 0) {
+            first = advance_spans(remaining, first, res);
+        } else {
+            fail("sendmsg");
+        }
+    }
+}
+
+void SocketNetIO::recv_data_vector_impl(const iovec* spans, std::size_t span_num) {
+    std::vector<iovec> remaining(spans, spans + span_num);
+    std::size_t first = advance_spans(remaining, 0, 0);
+    while (first < remaining.size()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = remaining.data() + first;
+        msg.msg_iovlen = std::min(remaining.size() - first, static_cast<std::size_t>(IOV_MAX));
+        ssize_t res = recvmsg(recv_socket_, &msg, 0);
+        if (res > 0) {
+            first = advance_spans(remaining, first, res);
+        } else {
+            fail("recvmsg");
+        }
+    }
+}
+
+void SocketNetIO::collect_zero_copy_completions(bool wait) {
+    while (zero_copy_completed_ != zero_copy_sent_) {
+        // the pages of a shut down socket may never be released.
+        if (shut_down_) {
+            fail("recvmsg");
+        }
+        char control[128];
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(send_socket_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fail("recvmsg");
+            }
+            if (!wait) {
+                return;
+            }
+            // the error queue signals POLLERR, which needs no requested events.
+            pollfd fd = {send_socket_, 0, 0};
+            if (poll(&fd, 1, -1) < 0 && errno != EINTR) {
+                fail("poll");
+            }
+            continue;
+        }
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            auto* error = reinterpret_cast<sock_extended_err*>(CMSG_DATA(cmsg));
+            if (error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            // a notification covers the sends from ee_info to ee_data, both inclusive.
+            zero_copy_completed_ += error->ee_data - error->ee_info + 1;
+            if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                zero_copy_threshold_ = 0;
+            }
+        }
+    }
+}
+
+void SocketNetIO::recv_data_impl(void* data, std::size_t nbyte) {
+    std::size_t received = 0;
+    while (received < nbyte) {
+        ssize_t res = recv(recv_socket_, reinterpret_cast<char*>(data) + received, nbyte - received, 0);
+        if (res > 0) {
+            received += res;
+        } else {
+            fail("recv");
+        }
+    }
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
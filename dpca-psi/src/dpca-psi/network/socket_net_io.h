@@ -0,0 +1,123 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "dpca-psi/network/io_base.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Base of the transports over two connected stream sockets, one per direction, which does the I/O on the sockets.
+// A child class only connects the sockets, see open_sockets().
+class SocketNetIO : public IOBase {
+public:
+    SocketNetIO(const SocketNetIO& other) = delete;
+
+    SocketNetIO& operator=(const SocketNetIO& other) = delete;
+
+    // Flushes the send buffer and closes the sockets.
+    ~SocketNetIO() override;
+
+    // Enables Nagle's algorithm on the sending socket if delay is true, or sets TCP_NODELAY otherwise, which is the
+    // default. With a send buffer, TCP_NODELAY is preferred since the coalescing is already done before send().
+    // Does nothing on sockets other than TCP.
+    void set_delay(bool delay) override;
+
+    // Sends messages of send_data_no_copy() of at least threshold bytes with MSG_ZEROCOPY. Other messages are copied
+    // by send() as usual. The completions of the kernel are collected without blocking after each zero-copy send,
+    // and waited for only when the pinned pages hit the socket's limit and in flush(), before the caller may reuse
+    // the buffers. Zero copy stays disabled if the kernel does not support it, and is turned off once the kernel
+    // reports that it copied the data anyway, e.g. on loopback, where the completions are only an overhead.
+    void set_zero_copy_threshold(std::size_t threshold) override;
+
+    std::size_t get_zero_copy_threshold() const {
+        return zero_copy_threshold_;
+    }
+
+    // Sets SO_SNDBUF of the sending socket and SO_RCVBUF of the receiving one to size bytes, which turns off the
+    // kernel's autotuning of that buffer. Without CAP_NET_ADMIN the kernel caps the size at net.core.wmem_max or
+    // net.core.rmem_max, which may be less than the autotuning reaches, so a buffer is kept as it is in that case.
+    void set_socket_buffer_size(std::size_t size) override;
+
+    // Shuts both sockets down. Sends and receives on this object then throw std::runtime_error, while the other
+    // party's receives see the end of the stream.
+    void shutdown() override;
+
+protected:
+    SocketNetIO() = default;
+
+    // Runs accept_send_socket and connect_recv_socket in two threads, and keeps the sockets they return. Both
+    // parties listen and connect at the same time, so that neither waits for the other to accept first.
+    void open_sockets(const std::function<int()>& accept_send_socket, const std::function<int()>& connect_recv_socket);
+
+    static void set_nodelay(int socket);
+
+private:
+    static void disable_nodelay(int socket);
+
+    // Sets option of socket to size, or the forced option that bypasses max_path, the sysctl file of the cap.
+    // Returns false if the size is capped, or the options fail.
+    static bool set_buffer_size(int socket, int option, int force_option, const char* max_path, std::size_t size);
+
+    // Counts the completions of zero-copy sends that the kernel has reported. If wait is true, waits until the
+    // kernel has released the pages of every zero-copy send.
+    void collect_zero_copy_completions(bool wait);
+
+    // Sends data by send(), with MSG_ZEROCOPY and counted as a zero-copy send if zero_copy is true.
+    void send_all(const void* data, std::size_t nbyte, bool zero_copy);
+
+    void send_data_impl(const void* data, std::size_t nbyte) override;
+
+    // Sends data with MSG_ZEROCOPY if it reaches the threshold, without waiting for the completion.
+    void send_data_no_copy_impl(const void* data, std::size_t nbyte) override;
+
+    // Waits for the completions of the zero-copy sends, after which their buffers may be reused.
+    void flush_impl() override;
+
+    void recv_data_impl(void* data, std::size_t nbyte) override;
+
+    // Sends the spans by sendmsg() without copying them into one buffer, and without MSG_ZEROCOPY.
+    void send_data_vector_impl(const iovec* spans, std::size_t span_num) override;
+
+    // Receives into the spans by recvmsg().
+    void recv_data_vector_impl(const iovec* spans, std::size_t span_num) override;
+
+    // Throws std::runtime_error after shutdown(), or exits on other errors of the function name.
+    void fail(const char* name) const;
+
+    int send_socket_ = -1;
+    int recv_socket_ = -1;
+    std::atomic<bool> shut_down_{false};
+
+    std::size_t zero_copy_threshold_ = 0;
+    bool zero_copy_enabled_on_socket_ = false;
+    std::uint32_t zero_copy_sent_ = 0;
+    std::uint32_t zero_copy_completed_ = 0;
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
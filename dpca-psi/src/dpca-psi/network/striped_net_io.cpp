@@ -0,0 +1,172 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/striped_net_io.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+const std::size_t StripedNetIO::kDefaultStripeSize;
+
+StripedNetIO::StripedNetIO(const std::string& remote_ip_address, std::uint16_t remote_port, std::uint16_t local_port,
+        std::size_t stream_num, std::size_t stripe_size)
+        : stripe_size_(stripe_size) {
+    if (stream_num == 0 || stripe_size == 0) {
+        throw std::invalid_argument("stream_num and stripe_size must be positive");
+    }
+    for (std::size_t stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+        streams_.emplace_back(std::make_unique<TwoChannelNetIO>(remote_ip_address, remote_port, local_port));
+        // the other party has closed its listening socket once it replies, then the next connection can be opened.
+        std::uint32_t index = static_cast<std::uint32_t>(stream_idx);
+        streams_.back()->send_value<std::uint32_t>(index);
+        if (streams_.back()->recv_value<std::uint32_t>() != index) {
+            throw std::runtime_error("streams are out of order");
+        }
+    }
+}
+
+StripedNetIO::~StripedNetIO() {
+    try {
+        flush();
+    } catch (const std::runtime_error&) {
+        // the connections are shut down, the buffered bytes have nowhere to go.
+    }
+}
+
+void StripedNetIO::set_delay(bool delay) {
+    for (auto& stream : streams_) {
+        stream->set_delay(delay);
+    }
+}
+
+void StripedNetIO::set_zero_copy_threshold(std::size_t threshold) {
+    for (auto& stream : streams_) {
+        stream->set_zero_copy_threshold(threshold);
+    }
+}
+
+void StripedNetIO::set_socket_buffer_size(std::size_t size) {
+    for (auto& stream : streams_) {
+        stream->set_socket_buffer_size(size);
+    }
+}
+
+void StripedNetIO::shutdown() {
+    for (auto& stream : streams_) {
+        stream->shutdown();
+    }
+}
+
+std::size_t StripedNetIO::split(
+        std::uint64_t stream_offset, std::size_t nbyte, std::vector<std::vector<Fragment>>& fragments) const {
+    fragments.assign(streams_.size(), {});
+    std::size_t used_stream_num = 0;
+    std::size_t offset = 0;
+    while (offset < nbyte) {
+        std::uint64_t position = stream_offset + offset;
+        std::size_t stream_idx = static_cast<std::size_t>((position / stripe_size_) % streams_.size());
+        std::size_t length = std::min<std::uint64_t>(stripe_size_ - position % stripe_size_, nbyte - offset);
+        if (fragments[stream_idx].empty()) {
+            ++used_stream_num;
+        }
+        fragments[stream_idx].push_back({offset, length});
+        offset += length;
+    }
+    return used_stream_num;
+}
+
+template <typename Transfer>
+void StripedNetIO::for_each_stream(const std::vector<std::vector<Fragment>>& fragments, std::size_t used_stream_num,
+        const Transfer& transfer) {
+    if (used_stream_num == 1) {
+        for (std::size_t stream_idx = 0; stream_idx < streams_.size(); ++stream_idx) {
+            if (!fragments[stream_idx].empty()) {
+                transfer(stream_idx);
+            }
+        }
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (std::size_t stream_idx = 0; stream_idx < streams_.size(); ++stream_idx) {
+        if (!fragments[stream_idx].empty()) {
+            threads.emplace_back([&transfer, stream_idx]() { transfer(stream_idx); });
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void StripedNetIO::send_data_impl(const void* data, std::size_t nbyte) {
+    send_striped(data, nbyte, false);
+}
+
+void StripedNetIO::send_data_no_copy_impl(const void* data, std::size_t nbyte) {
+    send_striped(data, nbyte, true);
+}
+
+void StripedNetIO::send_striped(const void* data, std::size_t nbyte, bool no_copy) {
+    auto send = [no_copy](TwoChannelNetIO& stream, const void* fragment, std::size_t fragment_size) {
+        if (no_copy) {
+            stream.send_data_no_copy(fragment, fragment_size);
+        } else {
+            stream.send_data(fragment, fragment_size);
+        }
+    };
+    // a message within a stripe goes to a single connection without threads.
+    if (send_offset_ % stripe_size_ + nbyte <= stripe_size_) {
+        send(*streams_[(send_offset_ / stripe_size_) % streams_.size()], data, nbyte);
+        send_offset_ += nbyte;
+        return;
+    }
+    std::vector<std::vector<Fragment>> fragments;
+    std::size_t used_stream_num = split(send_offset_, nbyte, fragments);
+    const char* bytes = reinterpret_cast<const char*>(data);
+    for_each_stream(fragments, used_stream_num, [this, bytes, &fragments, &send](std::size_t stream_idx) {
+        for (const auto& fragment : fragments[stream_idx]) {
+            send(*streams_[stream_idx], bytes + fragment.offset, fragment.nbyte);
+        }
+    });
+    send_offset_ += nbyte;
+}
+
+void StripedNetIO::flush_impl() {
+    for (auto& stream : streams_) {
+        stream->flush();
+    }
+}
+
+void StripedNetIO::recv_data_impl(void* data, std::size_t nbyte) {
+    if (recv_offset_ % stripe_size_ + nbyte <= stripe_size_) {
+        streams_[(recv_offset_ / stripe_size_) % streams_.size()]->recv_data(data, nbyte);
+        recv_offset_ += nbyte;
+        return;
+    }
+    std::vector<std::vector<Fragment>> fragments;
+    std::size_t used_stream_num = split(recv_offset_, nbyte, fragments);
+    char* bytes = reinterpret_cast<char*>(data);
+    for_each_stream(fragments, used_stream_num, [this, bytes, &fragments](std::size_t stream_idx) {
+        for (const auto& fragment : fragments[stream_idx]) {
+            streams_[stream_idx]->recv_data(bytes + fragment.offset, fragment.nbyte);
+        }
+    });
+    recv_offset_ += nbyte;
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,100 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dpca-psi/network/io_base.h"
+#include "dpca-psi/network/two_channel_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Stripes the byte stream in each direction over stream_num TCP connections, so that a link with a high
+// bandwidth-delay product is not limited by the window of a single connection.
+// The byte at offset o of a direction goes to the connection (o / stripe_size) % stream_num, which both parties
+// derive from the bytes sent and received so far, regardless of how the bytes are split into calls. Large messages
+// are sent and received on all connections in parallel, small ones touch a single connection.
+class StripedNetIO : public IOBase {
+public:
+    StripedNetIO() = delete;
+
+    StripedNetIO(const StripedNetIO& other) = delete;
+
+    StripedNetIO& operator=(const StripedNetIO& other) = delete;
+
+    // Opens stream_num connections one after another on the ports of TwoChannelNetIO.
+    // Both parties must use the same stream_num and stripe_size.
+    StripedNetIO(const std::string& remote_ip_address, std::uint16_t remote_port, std::uint16_t local_port,
+            std::size_t stream_num, std::size_t stripe_size);
+
+    ~StripedNetIO() override;
+
+    // Sets the delay of every connection.
+    void set_delay(bool delay) override;
+
+    // Sets the zero-copy threshold of every connection, which applies to the fragments of a message.
+    void set_zero_copy_threshold(std::size_t threshold) override;
+
+    // Sets the socket buffer size of every connection.
+    void set_socket_buffer_size(std::size_t size) override;
+
+    // Shuts every connection down.
+    void shutdown() override;
+
+    static const std::size_t kDefaultStripeSize = std::size_t(1) << 18;
+
+private:
+    // A part of a call that goes to a single connection.
+    struct Fragment {
+        std::size_t offset = 0;
+        std::size_t nbyte = 0;
+    };
+
+    void send_data_impl(const void* data, std::size_t nbyte) override;
+
+    // Sends the fragments by send_data_no_copy() of the connections.
+    void send_data_no_copy_impl(const void* data, std::size_t nbyte) override;
+
+    void recv_data_impl(void* data, std::size_t nbyte) override;
+
+    // Flushes every connection.
+    void flush_impl() override;
+
+    // Sends the fragments of data to the connections, by send_data_no_copy() if no_copy is true.
+    void send_striped(const void* data, std::size_t nbyte, bool no_copy);
+
+    // Splits nbyte bytes starting at stream_offset of a direction into the fragments of every connection.
+    // Returns the number of connections that get a fragment.
+    std::size_t split(
+            std::uint64_t stream_offset, std::size_t nbyte, std::vector<std::vector<Fragment>>& fragments) const;
+
+    // Calls transfer(stream_idx) for every connection with fragments, in parallel if there are more than one.
+    template <typename Transfer>
+    void for_each_stream(const std::vector<std::vector<Fragment>>& fragments, std::size_t used_stream_num,
+            const Transfer& transfer);
+
+    std::vector<std::unique_ptr<TwoChannelNetIO>> streams_{};
+    std::size_t stripe_size_ = 0;
+    std::uint64_t send_offset_ = 0;
+    std::uint64_t recv_offset_ = 0;
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
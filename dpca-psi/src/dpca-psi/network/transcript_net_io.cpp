@@ -0,0 +1,112 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/transcript_net_io.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+RecordingNetIO::RecordingNetIO(std::shared_ptr<IOBase> io, const std::string& path) : ForwardingNetIO(io) {
+    sent_file_.open(path + ".sent", std::ios::binary | std::ios::trunc);
+    recv_file_.open(path + ".recv", std::ios::binary | std::ios::trunc);
+    if (!sent_file_.is_open() || !recv_file_.is_open()) {
+        throw std::runtime_error("failed to create transcript " + path);
+    }
+}
+
+RecordingNetIO::~RecordingNetIO() {
+    try {
+        flush();
+    } catch (...) {
+        // the error of the underlying io has no receiver here.
+    }
+}
+
+void RecordingNetIO::send_data_impl(const void* data, std::size_t nbyte) {
+    io_->send_data(data, nbyte);
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    sent_file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(nbyte));
+}
+
+void RecordingNetIO::send_data_no_copy_impl(const void* data, std::size_t nbyte) {
+    io_->send_data_no_copy(data, nbyte);
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    sent_file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(nbyte));
+}
+
+void RecordingNetIO::recv_data_impl(void* data, std::size_t nbyte) {
+    io_->recv_data(data, nbyte);
+    std::lock_guard<std::mutex> lock(recv_mutex_);
+    recv_file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(nbyte));
+}
+
+void RecordingNetIO::flush_impl() {
+    io_->flush();
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        sent_file_.flush();
+    }
+    std::lock_guard<std::mutex> lock(recv_mutex_);
+    recv_file_.flush();
+}
+
+ReplayNetIO::ReplayNetIO(const std::string& path, ReplayMode mode) : mode_(mode) {
+    recv_file_.open(path + ".recv", std::ios::binary);
+    if (!recv_file_.is_open()) {
+        throw std::runtime_error("failed to open transcript " + path + ".recv");
+    }
+    if (mode_ == ReplayMode::kCheck) {
+        sent_file_.open(path + ".sent", std::ios::binary);
+        if (!sent_file_.is_open()) {
+            throw std::runtime_error("failed to open transcript " + path + ".sent");
+        }
+    }
+}
+
+void ReplayNetIO::send_data_impl(const void* data, std::size_t nbyte) {
+    if (mode_ == ReplayMode::kDrop) {
+        return;
+    }
+    const char* bytes = reinterpret_cast<const char*>(data);
+    char buffer[4096];
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    for (std::size_t offset = 0; offset < nbyte;) {
+        std::size_t length = std::min(sizeof(buffer), nbyte - offset);
+        sent_file_.read(buffer, static_cast<std::streamsize>(length));
+        std::size_t count = static_cast<std::size_t>(sent_file_.gcount());
+        auto mismatch = std::mismatch(buffer, buffer + count, bytes + offset);
+        std::size_t equal_length = static_cast<std::size_t>(mismatch.first - buffer);
+        if (equal_length != length) {
+            throw std::runtime_error("sent data differs from the transcript at byte " +
+                                     std::to_string(sent_offset_ + equal_length));
+        }
+        offset += length;
+        sent_offset_ += length;
+    }
+}
+
+void ReplayNetIO::recv_data_impl(void* data, std::size_t nbyte) {
+    std::lock_guard<std::mutex> lock(recv_mutex_);
+    recv_file_.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(nbyte));
+    if (static_cast<std::size_t>(recv_file_.gcount()) != nbyte) {
+        throw std::runtime_error("transcript is exhausted");
+    }
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,103 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "dpca-psi/network/forwarding_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// Decorator of an IOBase that records the transcript of one party in a real run: the received bytes in
+// "<path>.recv" and the sent bytes in "<path>.sent". Only byte streams are recorded, so the transcript does not
+// depend on how messages are split or coalesced.
+// Together with set_random_seed(), ReplayNetIO then re-runs this party alone, e.g. under a profiler.
+class RecordingNetIO : public ForwardingNetIO {
+public:
+    RecordingNetIO() = delete;
+
+    RecordingNetIO(const RecordingNetIO& other) = delete;
+
+    RecordingNetIO& operator=(const RecordingNetIO& other) = delete;
+
+    // Sends and receives through io. Throws std::runtime_error if the transcript files cannot be created.
+    RecordingNetIO(std::shared_ptr<IOBase> io, const std::string& path);
+
+    ~RecordingNetIO() override;
+
+private:
+    void send_data_impl(const void* data, std::size_t nbyte) override;
+
+    // Sends data by send_data_no_copy() of the underlying io.
+    void send_data_no_copy_impl(const void* data, std::size_t nbyte) override;
+
+    void recv_data_impl(void* data, std::size_t nbyte) override;
+
+    // Flushes the underlying io and the transcript files.
+    void flush_impl() override;
+
+    std::mutex send_mutex_{};
+    std::ofstream sent_file_{};
+
+    std::mutex recv_mutex_{};
+    std::ofstream recv_file_{};
+};
+
+// What ReplayNetIO does with sends.
+enum class ReplayMode {
+    // Discards them.
+    kDrop,
+    // Throws std::runtime_error if they differ from the recorded ones. Requires the same seed as the recording.
+    kCheck
+};
+
+// IOBase that plays the other party from a transcript of RecordingNetIO, without any connection.
+// Receives are served from "<path>.recv" and throw std::runtime_error beyond its end.
+class ReplayNetIO : public IOBase {
+public:
+    ReplayNetIO() = delete;
+
+    ReplayNetIO(const ReplayNetIO& other) = delete;
+
+    ReplayNetIO& operator=(const ReplayNetIO& other) = delete;
+
+    // Throws std::runtime_error if the transcript files cannot be opened.
+    ReplayNetIO(const std::string& path, ReplayMode mode);
+
+    ~ReplayNetIO() override = default;
+
+private:
+    void send_data_impl(const void* data, std::size_t nbyte) override;
+
+    void recv_data_impl(void* data, std::size_t nbyte) override;
+
+    ReplayMode mode_ = ReplayMode::kDrop;
+
+    std::mutex send_mutex_{};
+    std::ifstream sent_file_{};
+    std::uint64_t sent_offset_ = 0;
+
+    std::mutex recv_mutex_{};
+    std::ifstream recv_file_{};
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
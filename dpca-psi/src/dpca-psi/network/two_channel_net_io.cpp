@@ -15,7 +15,6 @@
 #include "dpca-psi/network/two_channel_net_io.h"
 
 #include <iostream>
-#include <thread>
 
 namespace privacy_go {
 namespace dpca_psi {
@@ -24,64 +23,17 @@ TwoChannelNetIO::TwoChannelNetIO(
         const std::string& remote_ip_address, std::uint16_t remote_port, std::uint16_t local_port) {
     int domain = get_address_family(remote_ip_address);
 
-    // Using two threads running initServer and initClient in parallel to resolve  two instances dead lock.
-    std::thread server_thread([this, domain, local_port]() {
-        send_socket_ = init_server(domain, local_port);
-        set_nodelay(send_socket_);
-    });
-
-    std::thread client_thread([this, domain, &remote_ip_address, remote_port]() {
-        recv_socket_ = init_client(domain, remote_ip_address, remote_port);
-        set_nodelay(recv_socket_);
-    });
-
-    server_thread.join();
-    client_thread.join();
-}
-
-TwoChannelNetIO::~TwoChannelNetIO() {
-    if (send_socket_ >= 0) {
-        close(send_socket_);
-    }
-    if (recv_socket_ >= 0) {
-        close(recv_socket_);
-    }
-}
-
-void TwoChannelNetIO::set_nodelay(int socket) {
-    const int one = 1;
-    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
-}
-
-void TwoChannelNetIO::set_delay(int socket) {
-    const int zero = 0;
-    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &zero, sizeof(zero));
-}
-
-void TwoChannelNetIO::send_data_impl(const void* data, std::size_t nbyte) {
-    std::size_t sent = 0;
-    while (sent < nbyte) {
-        ssize_t res = send(send_socket_, reinterpret_cast<const char*>(data) + sent, nbyte - sent, 0);
-        if (res > 0) {
-            sent += res;
-        } else {
-            perror("send");
-            exit(EXIT_FAILURE);
-        }
-    }
-}
-
-void TwoChannelNetIO::recv_data_impl(void* data, std::size_t nbyte) {
-    std::size_t received = 0;
-    while (received < nbyte) {
-        ssize_t res = recv(recv_socket_, reinterpret_cast<char*>(data) + received, nbyte - received, 0);
-        if (res > 0) {
-            received += res;
-        } else {
-            perror("recv");
-            exit(EXIT_FAILURE);
-        }
-    }
+    open_sockets(
+            [domain, local_port]() {
+                int send_socket = init_server(domain, local_port);
+                set_nodelay(send_socket);
+                return send_socket;
+            },
+            [domain, &remote_ip_address, remote_port]() {
+                int recv_socket = init_client(domain, remote_ip_address, remote_port);
+                set_nodelay(recv_socket);
+                return recv_socket;
+            });
 }
 
 // static
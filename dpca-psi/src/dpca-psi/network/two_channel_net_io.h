@@ -17,21 +17,22 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/in.h>
-#include <netinet/tcp.h>
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <cstdint>
 #include <cstring>
 #include <string>
 
-#include "dpca-psi/network/io_base.h"
+#include "dpca-psi/network/socket_net_io.h"
 
 namespace privacy_go {
 namespace dpca_psi {
 
-class TwoChannelNetIO : public IOBase {
+// SocketNetIO over TCP, which listens on one port and connects to the other party on another.
+class TwoChannelNetIO : public SocketNetIO {
 public:
     TwoChannelNetIO() = delete;
 
@@ -45,25 +46,14 @@ class TwoChannelNetIO : public IOBase {
     // Machine B: TwoChannelNetIO("127.0.0.1", 4321, 1234);
     TwoChannelNetIO(const std::string& remote_ip_address, std::uint16_t remote_port, std::uint16_t local_port);
 
-    ~TwoChannelNetIO() override;
+    ~TwoChannelNetIO() override = default;
 
 private:
-    static void set_nodelay(int socket);
-
-    static void set_delay(int socket);
-
-    void send_data_impl(const void* data, std::size_t nbyte) override;
-
-    void recv_data_impl(void* data, std::size_t nbyte) override;
-
     static int get_address_family(const std::string& ip_address);
 
     static int init_server(int domain, std::uint16_t port);
 
     static int init_client(int domain, const std::string& ip_address, std::uint16_t port);
-
-    int send_socket_ = -1;
-    int recv_socket_ = -1;
 };
 
 }  // namespace dpca_psi
@@ -0,0 +1,121 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/unix_net_io.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace privacy_go {
+namespace dpca_psi {
+
+const std::size_t UnixNetIO::kDefaultSocketBufferSize;
+
+UnixNetIO::UnixNetIO(const std::string& remote_path, const std::string& local_path, std::size_t socket_buffer_size) {
+    if (remote_path == local_path) {
+        throw std::invalid_argument("remote_path and local_path must be different");
+    }
+    // checks the lengths of paths before the threads start.
+    get_socket_address(remote_path);
+    get_socket_address(local_path);
+
+    open_sockets(
+            [&local_path, socket_buffer_size]() {
+                int send_socket = init_server(local_path);
+                set_unix_buffer_size(send_socket, socket_buffer_size);
+                return send_socket;
+            },
+            [&remote_path, socket_buffer_size]() {
+                int recv_socket = init_client(remote_path);
+                set_unix_buffer_size(recv_socket, socket_buffer_size);
+                return recv_socket;
+            });
+}
+
+// static
+bool UnixNetIO::is_unix_address(const std::string& address) {
+    return address.compare(0, 5, "unix:") == 0;
+}
+
+// static
+std::string UnixNetIO::get_socket_path(const std::string& address, std::uint16_t port) {
+    if (!is_unix_address(address) || address.size() == 5) {
+        throw std::invalid_argument("invalid unix address " + address);
+    }
+    return address.substr(5) + "." + std::to_string(port);
+}
+
+// static
+sockaddr_un UnixNetIO::get_socket_address(const std::string& path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("invalid socket path " + path);
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size());
+    return address;
+}
+
+// static
+void UnixNetIO::set_unix_buffer_size(int socket, std::size_t socket_buffer_size) {
+    // the kernel caps the sizes at net.core.wmem_max and net.core.rmem_max.
+    int size = static_cast<int>(std::min<std::size_t>(socket_buffer_size, std::numeric_limits<int>::max()));
+    setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+
+// static
+int UnixNetIO::init_server(const std::string& path) {
+    sockaddr_un serv = get_socket_address(path);
+    // a socket file left by a previous run would fail the bind.
+    unlink(path.c_str());
+    int server_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (bind(server_socket, reinterpret_cast<sockaddr*>(&serv), sizeof(serv)) < 0) {
+        perror("error: bind");
+        exit(1);
+    }
+    if (listen(server_socket, 1) < 0) {
+        perror("error: listen");
+        exit(1);
+    }
+    int send_socket = accept(server_socket, nullptr, nullptr);
+    close(server_socket);
+    unlink(path.c_str());
+    return send_socket;
+}
+
+// static
+int UnixNetIO::init_client(const std::string& path) {
+    std::cout << "Connecting to: " << path << std::endl;
+    sockaddr_un dest = get_socket_address(path);
+    while (true) {
+        int client_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(client_socket, reinterpret_cast<sockaddr*>(&dest), sizeof(dest)) == 0) {
+            std::cout << "Connected to: " << path << std::endl;
+            return client_socket;
+        }
+        close(client_socket);
+        usleep(1000);
+    }
+    return -1;
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
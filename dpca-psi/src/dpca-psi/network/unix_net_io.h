@@ -0,0 +1,70 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "dpca-psi/network/socket_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+// SocketNetIO over Unix domain sockets, for parties on the same host, e.g. in containers sharing a volume. Data does
+// not go through the TCP/IP stack.
+class UnixNetIO : public SocketNetIO {
+public:
+    UnixNetIO() = delete;
+
+    UnixNetIO(const UnixNetIO& other) = delete;
+
+    UnixNetIO& operator=(const UnixNetIO& other) = delete;
+
+    // Listens on local_path and connects to remote_path, which must be swapped on the other party.
+    // The send and receive buffers of the sockets are set to socket_buffer_size bytes, or the system's limit.
+    // Example:
+    // Party A: UnixNetIO("/tmp/dpca.1234", "/tmp/dpca.4321", UnixNetIO::kDefaultSocketBufferSize);
+    // Party B: UnixNetIO("/tmp/dpca.4321", "/tmp/dpca.1234", UnixNetIO::kDefaultSocketBufferSize);
+    UnixNetIO(const std::string& remote_path, const std::string& local_path, std::size_t socket_buffer_size);
+
+    ~UnixNetIO() override = default;
+
+    // Returns whether address has the form "unix:<path prefix>".
+    static bool is_unix_address(const std::string& address);
+
+    // Returns the socket path "<path prefix>.<port>" of a "unix:<path prefix>" address, so that configurations with
+    // ports are reused as they are.
+    static std::string get_socket_path(const std::string& address, std::uint16_t port);
+
+    static const std::size_t kDefaultSocketBufferSize = std::size_t(1) << 22;
+
+private:
+    static sockaddr_un get_socket_address(const std::string& path);
+
+    static void set_unix_buffer_size(int socket, std::size_t socket_buffer_size);
+
+    static int init_server(const std::string& path);
+
+    static int init_client(const std::string& path);
+};
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
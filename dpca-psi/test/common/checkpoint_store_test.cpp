@@ -0,0 +1,123 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/common/checkpoint_store.h"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class CheckpointStoreTest : public ::testing::Test {
+public:
+    void SetUp() {
+        char dir_template[] = "/tmp/dpca_psi_checkpoint_XXXXXX";
+        ASSERT_NE(mkdtemp(dir_template), nullptr);
+        directory_ = dir_template;
+    }
+
+    static bool is_equal(const block& a, const block& b) {
+        return std::memcmp(&a, &b, sizeof(block)) == 0;
+    }
+
+    std::string directory_;
+    const block run_id_ = _mm_set_epi64x(1, 2);
+};
+
+TEST_F(CheckpointStoreTest, save_and_load) {
+    CheckpointStore store(directory_, "sender");
+    block run_id = kZeroBlock;
+    EXPECT_EQ(store.latest_phase(3, run_id), 0);
+
+    ByteVector state_1 = {Byte(1), Byte(2)};
+    ByteVector state_2 = {Byte(3)};
+    store.save(1, run_id_, state_1);
+    store.save(2, run_id_, state_2);
+    EXPECT_EQ(store.latest_phase(3, run_id), 2);
+    EXPECT_TRUE(is_equal(run_id, run_id_));
+
+    ByteVector state;
+    EXPECT_TRUE(store.load(2, run_id_, state));
+    EXPECT_EQ(state, state_2);
+    EXPECT_FALSE(store.load(2, _mm_set_epi64x(3, 4), state));
+    EXPECT_FALSE(store.load(3, run_id_, state));
+
+    // another party shares the directory.
+    EXPECT_EQ(CheckpointStore(directory_, "receiver").latest_phase(3, run_id), 0);
+
+    store.clear(3);
+    EXPECT_EQ(store.latest_phase(3, run_id), 0);
+}
+
+TEST_F(CheckpointStoreTest, stale_and_corrupted_phases) {
+    CheckpointStore store(directory_, "sender");
+    store.save(1, run_id_, ByteVector(8));
+    // a later phase of an older run does not count.
+    store.save(2, _mm_set_epi64x(3, 4), ByteVector(8));
+    block run_id = kZeroBlock;
+    EXPECT_EQ(store.latest_phase(3, run_id), 1);
+
+    std::ofstream out(directory_ + "/sender_1.ckpt", std::ios::binary | std::ios::trunc);
+    out << "corrupted";
+    out.close();
+    EXPECT_EQ(store.latest_phase(3, run_id), 0);
+    store.clear(3);
+}
+
+TEST_F(CheckpointStoreTest, owner_only_file) {
+    CheckpointStore store(directory_, "sender");
+    // a stale temporary file readable by others does not pass its permissions on.
+    std::ofstream(directory_ + "/sender_1.ckpt.tmp") << "stale";
+    chmod((directory_ + "/sender_1.ckpt.tmp").c_str(), 0644);
+    store.save(1, run_id_, ByteVector(8));
+
+    struct stat status;
+    ASSERT_EQ(stat((directory_ + "/sender_1.ckpt").c_str(), &status), 0);
+    EXPECT_EQ(status.st_mode & 0777, 0600);
+    store.clear(1);
+}
+
+TEST_F(CheckpointStoreTest, writer_and_reader) {
+    CheckpointWriter writer;
+    writer.write_value<std::uint64_t>(7);
+    writer.write_vector(std::vector<std::size_t>({1, 2, 3}));
+    writer.write_bytes_vector({{Byte(4)}, {}, {Byte(5), Byte(6)}});
+
+    CheckpointReader reader(writer.get_data());
+    EXPECT_EQ(reader.read_value<std::uint64_t>(), 7);
+    std::vector<std::size_t> values;
+    reader.read_vector(values);
+    EXPECT_EQ(values, std::vector<std::size_t>({1, 2, 3}));
+    std::vector<ByteVector> bytes;
+    reader.read_bytes_vector(bytes);
+    EXPECT_EQ(bytes, std::vector<ByteVector>({{Byte(4)}, {}, {Byte(5), Byte(6)}}));
+    EXPECT_THROW(reader.read_value<Byte>(), std::runtime_error);
+
+    ByteVector truncated(writer.get_data().begin(), writer.get_data().begin() + 12);
+    CheckpointReader truncated_reader(truncated);
+    truncated_reader.read_value<std::uint64_t>();
+    EXPECT_THROW(truncated_reader.read_vector(values), std::runtime_error);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,99 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/common/parameter_check.h"
+
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/network/memory_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+using json = nlohmann::json;
+
+class HandshakeTest : public ::testing::Test {
+public:
+    void SetUp() {
+        message_ = {{"version", 1}, {"capabilities", {"a", "b"}}, {"requires", {"a"}},
+                {"params", {{"ids_num", 2}, {"input_dp", true}}}, {"error", ""}, {"feature_bits", {8}}};
+    }
+
+    // Runs the handshake of both parties, and expects both to succeed or both to fail.
+    void run(const json& sender_message, const json& receiver_message, bool expect_success) {
+        auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+        std::thread receiver([&]() {
+            if (expect_success) {
+                EXPECT_EQ(exchange_handshake(false, nets.second, receiver_message), sender_message);
+            } else {
+                EXPECT_THROW(exchange_handshake(false, nets.second, receiver_message), std::invalid_argument);
+            }
+        });
+        if (expect_success) {
+            EXPECT_EQ(exchange_handshake(true, nets.first, sender_message), receiver_message);
+        } else {
+            EXPECT_THROW(exchange_handshake(true, nets.first, sender_message), std::invalid_argument);
+        }
+        receiver.join();
+    }
+
+    json message_{};
+};
+
+TEST_F(HandshakeTest, agreement) {
+    json receiver_message = message_;
+    receiver_message["feature_bits"] = {16, 16};
+    run(message_, receiver_message, true);
+}
+
+TEST_F(HandshakeTest, disagreement) {
+    json receiver_message = message_;
+    receiver_message["params"]["ids_num"] = 3;
+    run(message_, receiver_message, false);
+
+    // a parameter is missing on one side.
+    receiver_message = message_;
+    receiver_message["params"]["dp_epsilon"] = 2.0;
+    run(message_, receiver_message, false);
+
+    receiver_message = message_;
+    receiver_message["version"] = 2;
+    run(message_, receiver_message, false);
+}
+
+TEST_F(HandshakeTest, missing_capability) {
+    json receiver_message = message_;
+    receiver_message["requires"] = {"c"};
+    run(message_, receiver_message, false);
+}
+
+TEST_F(HandshakeTest, local_error) {
+    json receiver_message = message_;
+    receiver_message["error"] = "Check in range failed.";
+    run(message_, receiver_message, false);
+}
+
+TEST_F(HandshakeTest, incompatible_peer) {
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    // a party that checks parameters one by one sends the first one.
+    nets.second->send_value<std::size_t>(415);
+    EXPECT_THROW(exchange_handshake(false, nets.first, message_), std::invalid_argument);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
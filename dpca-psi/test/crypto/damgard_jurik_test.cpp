@@ -0,0 +1,222 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/damgard_jurik.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ipcl/utils/common.hpp"
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/crypto/ipcl_paillier.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class DamgardJurikTest : public ::testing::Test {
+public:
+    static const std::size_t bench_iter_num_ = 10;
+    static const std::size_t n_len_ = 2048;
+    static const std::size_t slot_bits_ = kValueBits + 40 + 1;
+    static const std::size_t bench_feature_num_ = 240;
+    static IpclPaillier pai_;
+    static DamgardJurik dj_s2_;
+    static DamgardJurik dj_s3_;
+    static DamgardJurik dj_s2_without_djn_;
+    static const std::vector<int> bits_vec_;
+
+    static void SetUpTestCase() {
+        pai_.keygen(n_len_, true);
+        dj_s2_.keygen(n_len_, true);
+        dj_s3_.keygen(n_len_, true);
+        dj_s2_without_djn_.keygen(n_len_, false);
+    }
+
+    static BigNumber n_power(const Paillier& pai, std::size_t s) {
+        BigNumber result = BigNumber::One();
+        for (std::size_t i = 0; i < s; ++i) {
+            result *= pai.n();
+        }
+        return result;
+    }
+
+    static std::vector<BigNumber> random_plaintexts() {
+        std::vector<BigNumber> bn;
+        for (std::size_t i = 0; i < bits_vec_.size(); ++i) {
+            bn.push_back(ipcl::getRandomBN(bits_vec_[i]));
+        }
+        return bn;
+    }
+
+    static void enc_dec(const DamgardJurik& dj) {
+        std::vector<BigNumber> bn = random_plaintexts();
+        BigNumber modulus = n_power(dj, dj.s());
+        bn.push_back(modulus - BigNumber::One());
+        bn.push_back(BigNumber::Zero());
+        auto pt = dj.decrypt(dj.encrypt(ipcl::PlainText(bn)));
+        for (std::size_t i = 0; i < bn.size(); ++i) {
+            EXPECT_EQ(bn[i] % modulus, pt.getElement(i));
+        }
+    }
+
+    // Encrypts, masks and decrypts feature_num features of one row that are packed as in DPCA-PSI.
+    // Returns the bytes of ciphertexts per feature.
+    static double process_packed_features(const Paillier& pai, std::size_t feature_num) {
+        std::size_t packing_capacity = pai.get_plaintext_bits() / slot_bits_;
+        std::size_t cipher_num = (feature_num + packing_capacity - 1) / packing_capacity;
+        std::vector<BigNumber> packed_values;
+        for (std::size_t i = 0; i < cipher_num; ++i) {
+            packed_values.push_back(ipcl::getRandomBN(static_cast<int>(packing_capacity * slot_bits_ - 1)));
+        }
+        ipcl::PlainText plain(packed_values);
+        auto ct = pai.add(pai.encrypt(plain), plain);
+        pai.decrypt(ct);
+        return static_cast<double>(cipher_num * pai.get_bytes_len(true)) / static_cast<double>(feature_num);
+    }
+};
+
+IpclPaillier DamgardJurikTest::pai_;
+DamgardJurik DamgardJurikTest::dj_s2_(2);
+DamgardJurik DamgardJurikTest::dj_s3_(3);
+DamgardJurik DamgardJurikTest::dj_s2_without_djn_(2);
+const std::vector<int> DamgardJurikTest::bits_vec_ = {2, 31, 32, 511, 1024, 2047, 2048, 3000, 4000};
+
+TEST_F(DamgardJurikTest, test_enc_dec) {
+    enc_dec(dj_s2_);
+    enc_dec(dj_s3_);
+    enc_dec(dj_s2_without_djn_);
+}
+
+TEST_F(DamgardJurikTest, test_add) {
+    std::vector<BigNumber> bn0 = random_plaintexts();
+    std::vector<BigNumber> bn1 = random_plaintexts();
+    BigNumber modulus = n_power(dj_s2_, 2);
+    auto ct0 = dj_s2_.encrypt(ipcl::PlainText(bn0));
+    auto ct1 = dj_s2_.encrypt(ipcl::PlainText(bn1));
+    auto pt = dj_s2_.decrypt(dj_s2_.add(ct0, ct1));
+    auto pt_plain = dj_s2_.decrypt(dj_s2_.add(ct0, ipcl::PlainText(bn1)));
+    for (std::size_t i = 0; i < bn0.size(); ++i) {
+        EXPECT_EQ((bn0[i] + bn1[i]) % modulus, pt.getElement(i));
+        EXPECT_EQ((bn0[i] + bn1[i]) % modulus, pt_plain.getElement(i));
+    }
+}
+
+TEST_F(DamgardJurikTest, test_mult) {
+    std::vector<BigNumber> bn0 = random_plaintexts();
+    std::vector<BigNumber> bn1 = random_plaintexts();
+    BigNumber modulus = n_power(dj_s3_, 3);
+    auto ct0 = dj_s3_.encrypt(ipcl::PlainText(bn0));
+    auto pt = dj_s3_.decrypt(dj_s3_.mult(ct0, ipcl::PlainText(bn1)));
+    for (std::size_t i = 0; i < bn0.size(); ++i) {
+        EXPECT_EQ((bn0[i] * bn1[i]) % modulus, pt.getElement(i));
+    }
+}
+
+TEST_F(DamgardJurikTest, test_pk) {
+    for (bool enable_djn : {true, false}) {
+        const DamgardJurik& dj = enable_djn ? dj_s2_ : dj_s2_without_djn_;
+        auto serialized_pk = dj.export_pk();
+        EXPECT_EQ(serialized_pk.size(), (n_len_ / 8) * (enable_djn ? 4 : 1));
+        DamgardJurik imported(2);
+        imported.import_pk(serialized_pk, enable_djn);
+        EXPECT_EQ(serialized_pk, imported.export_pk());
+        BigNumber bn = ipcl::getRandomBN(3000);
+        auto pt = dj.decrypt(imported.encrypt(ipcl::PlainText(bn)));
+        EXPECT_EQ(bn, pt.getElement(0));
+    }
+}
+
+TEST_F(DamgardJurikTest, test_sk) {
+    auto serialized_sk = dj_s2_.export_sk();
+    EXPECT_EQ(serialized_sk.size(), IpclPaillier::privkey_bytes(n_len_));
+    DamgardJurik imported(2);
+    imported.import_sk(serialized_sk);
+    BigNumber bn = ipcl::getRandomBN(3000);
+    auto pt = imported.decrypt(dj_s2_.encrypt(ipcl::PlainText(bn)));
+    EXPECT_EQ(bn, pt.getElement(0));
+}
+
+TEST_F(DamgardJurikTest, test_sk_then_pk) {
+    // the key store imports the sk before the pk of the same n, which must keep the sk.
+    for (bool enable_djn : {true, false}) {
+        const DamgardJurik& dj = enable_djn ? dj_s2_ : dj_s2_without_djn_;
+        DamgardJurik imported(2);
+        imported.import_sk(dj.export_sk());
+        imported.import_pk(dj.export_pk(), enable_djn);
+        EXPECT_EQ(dj.export_pk(), imported.export_pk());
+        BigNumber bn = ipcl::getRandomBN(3000);
+        auto pt = imported.decrypt(imported.encrypt(ipcl::PlainText(bn)));
+        EXPECT_EQ(bn, pt.getElement(0));
+    }
+    // a pk of another n drops the sk.
+    DamgardJurik imported(2);
+    imported.import_sk(dj_s2_.export_sk());
+    imported.import_pk(dj_s3_.export_pk(), true);
+    EXPECT_THROW(imported.export_sk(), std::logic_error);
+}
+
+TEST_F(DamgardJurikTest, test_bytes_len) {
+    EXPECT_EQ(2 * n_len_ / 8, dj_s2_.get_bytes_len(false));
+    EXPECT_EQ(3 * n_len_ / 8, dj_s2_.get_bytes_len(true));
+    EXPECT_EQ(3 * n_len_ / 8, dj_s3_.get_bytes_len(false));
+    EXPECT_EQ(4 * n_len_ / 8, dj_s3_.get_bytes_len(true));
+    // n^2 may have one bit less than 2 * n_len.
+    EXPECT_EQ(static_cast<std::size_t>(n_power(dj_s2_, 2).BitSize() - 1), dj_s2_.get_plaintext_bits());
+    EXPECT_EQ("damgard_jurik_s2", dj_s2_.scheme_name());
+}
+
+TEST_F(DamgardJurikTest, test_invalid_key) {
+    EXPECT_THROW(DamgardJurik(0), std::invalid_argument);
+    DamgardJurik dj(2);
+    EXPECT_THROW(dj.export_pk(), std::logic_error);
+    EXPECT_THROW(dj.export_sk(), std::logic_error);
+    EXPECT_THROW(dj.encrypt(ipcl::PlainText(BigNumber::One())), std::logic_error);
+    EXPECT_THROW(dj.import_pk(ByteVector{}, false), std::logic_error);
+    EXPECT_THROW(dj.import_pk(ByteVector{Byte('\x03'), Byte('\x01')}, true), std::logic_error);
+    EXPECT_THROW(dj.import_sk(ByteVector{Byte(1), Byte(2), Byte(3)}), std::logic_error);
+    EXPECT_THROW(dj.import_sk(ByteVector(8, Byte(1))), std::logic_error);
+}
+
+// A ciphertext of (s + 1) * |n| bits packs about s * |n| / slot_bits features.
+// Bytes per feature are recorded as test properties, CPU costs are the elapsed times of the benchmarks.
+TEST_F(DamgardJurikTest, bench_packed_features_paillier) {
+    double bytes_per_feature = 0;
+    for (std::size_t i = 0; i < bench_iter_num_; ++i) {
+        bytes_per_feature = process_packed_features(pai_, bench_feature_num_);
+    }
+    RecordProperty("bytes_per_feature", std::to_string(bytes_per_feature));
+}
+
+TEST_F(DamgardJurikTest, bench_packed_features_damgard_jurik_s2) {
+    double bytes_per_feature = 0;
+    for (std::size_t i = 0; i < bench_iter_num_; ++i) {
+        bytes_per_feature = process_packed_features(dj_s2_, bench_feature_num_);
+    }
+    RecordProperty("bytes_per_feature", std::to_string(bytes_per_feature));
+    EXPECT_LT(bytes_per_feature, process_packed_features(pai_, bench_feature_num_));
+}
+
+TEST_F(DamgardJurikTest, bench_packed_features_damgard_jurik_s3) {
+    double bytes_per_feature = 0;
+    for (std::size_t i = 0; i < bench_iter_num_; ++i) {
+        bytes_per_feature = process_packed_features(dj_s3_, bench_feature_num_);
+    }
+    RecordProperty("bytes_per_feature", std::to_string(bytes_per_feature));
+    EXPECT_LT(bytes_per_feature, process_packed_features(dj_s2_, bench_feature_num_));
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
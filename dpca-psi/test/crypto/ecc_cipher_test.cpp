@@ -315,5 +315,36 @@ TEST_F(EccCipherTest, bench_encrypt_and_div_multi_threads) {
     }
 }
 
+TEST_F(EccCipherTest, uncompressed_points) {
+    EccCipher sender(curve_id_, 2);
+    EccCipher receiver(curve_id_, 2);
+    sender.set_point_compression(false);
+    ASSERT_EQ(sender.get_point_len(), kEccUncompressedPointLen);
+    ASSERT_EQ(receiver.get_point_len(), kEccPointLen);
+
+    ByteVector sender_encrypted = sender.hash_encrypt("test1@tiktok.com", 0);
+    ASSERT_EQ(sender_encrypted.size(), kEccUncompressedPointLen);
+    ByteVector receiver_encrypted = receiver.hash_encrypt("test1@tiktok.com", 0);
+    ASSERT_EQ(receiver_encrypted.size(), kEccPointLen);
+
+    // either form is deserialized, and both forms hold the same point.
+    ByteVector exchanged_sender_encrypted = receiver.encrypt(sender_encrypted, 0);
+    receiver.set_point_compression(false);
+    ASSERT_EQ(receiver.encrypt(sender_encrypted, 0), sender.encrypt(receiver_encrypted, 0));
+    receiver.set_point_compression(true);
+    ASSERT_EQ(receiver.encrypt(sender_encrypted, 0), exchanged_sender_encrypted);
+}
+
+TEST_F(EccCipherTest, export_and_import_private_keys) {
+    EccCipher cipher(curve_id_, 2);
+    EccCipher restored(curve_id_, 2);
+    restored.import_private_keys(cipher.export_private_keys());
+    EXPECT_EQ(restored.hash_encrypt("test1@tiktok.com", 1), cipher.hash_encrypt("test1@tiktok.com", 1));
+    EXPECT_EQ(restored.export_private_keys(), cipher.export_private_keys());
+
+    EccCipher other(curve_id_, 3);
+    EXPECT_THROW(other.import_private_keys(cipher.export_private_keys()), std::invalid_argument);
+}
+
 }  // namespace dpca_psi
 }  // namespace privacy_go
@@ -0,0 +1,160 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/fixed_bignum.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ipcl/utils/common.hpp"
+
+#include "dpca-psi/common/defines.h"
+#include "dpca-psi/common/utils.h"
+#include "dpca-psi/crypto/ipcl_utils.h"
+#include "dpca-psi/crypto/prng.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class FixedBigNumTest : public ::testing::Test {
+public:
+    static const std::size_t test_iter_num_ = 10;
+    static const std::size_t bench_iter_num_ = 1e4;
+    static const std::size_t n_bits_ = 2048;
+    static const std::size_t slot_bits_ = kValueBits + 40 + 1;
+    static const std::size_t packing_capacity_ = n_bits_ / slot_bits_;
+
+    void SetUp() {
+        PRNG prng(read_block_from_dev_urandom());
+        values_.resize(packing_capacity_);
+        prng.get<std::uint64_t>(values_.data(), packing_capacity_);
+    }
+
+    // Packs values with BigNumber arithmetic, the first value takes the most significant slot.
+    BigNumber pack_with_bignum(const std::vector<std::uint64_t>& values) const {
+        BigNumber bn_slot(BigNumber::One());
+        ipcl_bn_lshift(bn_slot, slot_bits_);
+        BigNumber packed_value(0);
+        packed_value += ipcl_u64_2_bn(values[0]);
+        for (std::size_t pack_idx = 1; pack_idx < values.size(); ++pack_idx) {
+            packed_value *= bn_slot;
+            packed_value += ipcl_u64_2_bn(values[pack_idx]);
+        }
+        return packed_value;
+    }
+
+    void pack_with_fixed_bignum(const std::vector<std::uint64_t>& values, FixedBigNum& packed_value) const {
+        packed_value.set_zero();
+        for (std::size_t pack_idx = 0; pack_idx < values.size(); ++pack_idx) {
+            packed_value.set_u64((values.size() - 1 - pack_idx) * slot_bits_, values[pack_idx]);
+        }
+    }
+
+    std::vector<std::uint64_t> values_;
+};
+
+TEST_F(FixedBigNumTest, pack) {
+    FixedBigNum packed_value(n_bits_);
+    pack_with_fixed_bignum(values_, packed_value);
+    EXPECT_EQ(pack_with_bignum(values_), packed_value.to_bn());
+}
+
+TEST_F(FixedBigNumTest, unpack) {
+    BigNumber packed_value = pack_with_bignum(values_);
+    FixedBigNum unpacked_value(n_bits_);
+    unpacked_value.from_bn(packed_value);
+    for (std::size_t pack_idx = 0; pack_idx < packing_capacity_; ++pack_idx) {
+        EXPECT_EQ(values_[pack_idx], unpacked_value.get_u64((packing_capacity_ - 1 - pack_idx) * slot_bits_));
+    }
+}
+
+TEST_F(FixedBigNumTest, mod_two_power_l) {
+    BigNumber modulus(BigNumber::One());
+    ipcl_bn_lshift(modulus, kValueBits);
+    FixedBigNum value(n_bits_);
+    for (std::size_t i = 0; i < test_iter_num_; ++i) {
+        BigNumber bn = ipcl::getRandomBN(static_cast<int>(n_bits_));
+        value.from_bn(bn);
+        EXPECT_EQ(ipcl_bn_2_u64(bn % modulus), value.get_u64(0));
+        EXPECT_EQ(ipcl_bn_2_u64(bn), value.get_u64(0));
+    }
+}
+
+TEST_F(FixedBigNumTest, set_bits) {
+    FixedBigNum value(3 * 64);
+    std::vector<std::uint64_t> limbs = {~std::uint64_t(0), ~std::uint64_t(0)};
+    value.set_bits(60, limbs.data(), 72);
+    EXPECT_EQ(0xF000000000000000ull, value.get_u64(0));
+    EXPECT_EQ(~std::uint64_t(0), value.get_u64(60));
+    EXPECT_EQ(0xFFull, value.get_u64(124));
+    EXPECT_EQ(0ull, value.get_u64(132));
+    EXPECT_THROW(value.set_bits(180, limbs.data(), 72), std::out_of_range);
+}
+
+TEST_F(FixedBigNumTest, zero) {
+    FixedBigNum value(n_bits_);
+    value.from_bn(BigNumber::Zero());
+    EXPECT_EQ(0ull, value.get_u64(0));
+    EXPECT_EQ(BigNumber::Zero(), value.to_bn());
+}
+
+TEST_F(FixedBigNumTest, invalid_width) {
+    FixedBigNum value(64);
+    EXPECT_THROW(value.set_u64(1, 1), std::out_of_range);
+    EXPECT_THROW(value.from_bn(ipcl_u64_2_bn(1) + ipcl_u64_2_bn(~std::uint64_t(0))), std::out_of_range);
+}
+
+TEST_F(FixedBigNumTest, bench_pack_bignum) {
+    for (std::size_t i = 0; i < bench_iter_num_; ++i) {
+        pack_with_bignum(values_);
+    }
+}
+
+TEST_F(FixedBigNumTest, bench_pack_fixed_bignum) {
+    FixedBigNum packed_value(n_bits_);
+    for (std::size_t i = 0; i < bench_iter_num_; ++i) {
+        pack_with_fixed_bignum(values_, packed_value);
+        packed_value.to_bn();
+    }
+}
+
+TEST_F(FixedBigNumTest, bench_unpack_bignum) {
+    BigNumber packed_value = pack_with_bignum(values_);
+    BigNumber modulus(BigNumber::One());
+    ipcl_bn_lshift(modulus, kValueBits);
+    BigNumber slot_modulus(BigNumber::One());
+    ipcl_bn_lshift(slot_modulus, slot_bits_);
+    for (std::size_t i = 0; i < bench_iter_num_; ++i) {
+        BigNumber x_plus_r = packed_value;
+        ipcl_bn_2_u64((x_plus_r % slot_modulus) % modulus);
+        for (std::size_t pack_idx = 1; pack_idx < packing_capacity_; ++pack_idx) {
+            x_plus_r /= slot_modulus;
+            ipcl_bn_2_u64((x_plus_r % slot_modulus) % modulus);
+        }
+    }
+}
+
+TEST_F(FixedBigNumTest, bench_unpack_fixed_bignum) {
+    BigNumber packed_value = pack_with_bignum(values_);
+    FixedBigNum unpacked_value(n_bits_);
+    for (std::size_t i = 0; i < bench_iter_num_; ++i) {
+        unpacked_value.from_bn(packed_value);
+        for (std::size_t pack_idx = 0; pack_idx < packing_capacity_; ++pack_idx) {
+            unpacked_value.get_u64(pack_idx * slot_bits_);
+        }
+    }
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
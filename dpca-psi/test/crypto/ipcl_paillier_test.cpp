@@ -14,6 +14,7 @@
 
 #include "dpca-psi/crypto/ipcl_paillier.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -59,6 +60,35 @@ TEST_F(IpclPaillierTest, test_enc_dec) {
     }
 }
 
+TEST_F(IpclPaillierTest, test_enc_dec_without_djn) {
+    std::vector<BigNumber> bn;
+    for (std::size_t i = 0; i < bits_vec_.size(); ++i) {
+        bn.push_back(ipcl::getRandomBN(bits_vec_[i]));
+    }
+    ipcl::PlainText plain(bn);
+    auto ct = pai_without_djn_.encrypt(plain);
+    auto pt = pai_without_djn_.decrypt(ct);
+    for (std::size_t i = 0; i < pt.getSize(); ++i) {
+        EXPECT_EQ(plain.getElement(i) % pai_without_djn_.n(), pt.getElement(i));
+    }
+}
+
+TEST_F(IpclPaillierTest, test_enc_with_pk_only) {
+    IpclPaillier pai;
+    pai.import_pk(pai_.export_pk(), true);
+    std::vector<BigNumber> bn;
+    for (std::size_t i = 0; i < bits_vec_.size(); ++i) {
+        bn.push_back(ipcl::getRandomBN(bits_vec_[i]));
+    }
+    ipcl::PlainText plain(bn);
+    // ciphertexts of the owner of sk are added to those of the public key only.
+    auto ct = pai_.add(pai.encrypt(plain), pai_.encrypt(plain));
+    auto pt = pai_.decrypt(ct);
+    for (std::size_t i = 0; i < pt.getSize(); ++i) {
+        EXPECT_EQ((bn[i] + bn[i]) % pai_.n(), pt.getElement(i));
+    }
+}
+
 TEST_F(IpclPaillierTest, test_add) {
     std::vector<BigNumber> bn0;
     std::vector<BigNumber> bn1;
@@ -192,6 +222,48 @@ TEST_F(IpclPaillierTest, bn_string_conversion) {
     }
 }
 
+TEST_F(IpclPaillierTest, bn_bytes_conversion_in_place) {
+    std::vector<std::uint32_t> words;
+    for (std::size_t i = 0; i < test_iter_num_; ++i) {
+        for (std::size_t j = 0; j < bits_vec_.size(); ++j) {
+            BigNumber bn = ipcl::getRandomBN(bits_vec_[j]);
+            ByteVector serialized_bytes;
+            ipcl_bn_2_bytes(bn, serialized_bytes);
+            std::size_t bytes_len = n_len_ / 8 + 3;
+            ByteVector buffer(bytes_len, Byte('\xff'));
+            ipcl_bn_2_bytes(bn, buffer.data(), bytes_len);
+            EXPECT_TRUE(std::equal(serialized_bytes.begin(), serialized_bytes.end(), buffer.begin()));
+            EXPECT_TRUE(std::all_of(buffer.begin() + serialized_bytes.size(), buffer.end(),
+                    [](Byte byte) { return byte == Byte('\x00'); }));
+            EXPECT_TRUE(bn == ipcl_bytes_2_bn(buffer.data(), bytes_len, words));
+        }
+    }
+    BigNumber bn = ipcl::getRandomBN(64);
+    ByteVector buffer(4);
+    EXPECT_THROW(ipcl_bn_2_bytes(bn, buffer.data(), buffer.size()), std::out_of_range);
+}
+
+TEST_F(IpclPaillierTest, ciphertext_batch_codec) {
+    std::vector<BigNumber> bn;
+    for (std::size_t i = 0; i < bits_vec_.size(); ++i) {
+        bn.push_back(ipcl::getRandomBN(bits_vec_[i]));
+    }
+    auto ct = pai_.encrypt(ipcl::PlainText(bn));
+    std::size_t cipher_len = pai_.get_bytes_len(true);
+    ByteVector buffer(ct.getSize() * cipher_len);
+    pai_.encode(ct, buffer.data());
+    for (std::size_t i = 0; i < ct.getSize(); ++i) {
+        ByteVector expected = pai_.encode(ct.getElement(i), true);
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buffer.begin() + i * cipher_len));
+    }
+    auto decoded_ct = pai_.decode(buffer.data(), ct.getSize());
+    ASSERT_EQ(decoded_ct.getSize(), ct.getSize());
+    auto pt = pai_.decrypt(decoded_ct);
+    for (std::size_t i = 0; i < pt.getSize(); ++i) {
+        EXPECT_EQ(bn[i] % pai_.n(), pt.getElement(i));
+    }
+}
+
 TEST_F(IpclPaillierTest, bn_lshift) {
     for (std::size_t i = 0; i < test_iter_num_; ++i) {
         for (std::size_t j = 0; j < bits_vec_.size(); ++j) {
@@ -242,6 +314,19 @@ TEST_F(IpclPaillierTest, bench_enc_large) {
     }
 }
 
+TEST_F(IpclPaillierTest, bench_enc_small_with_pk_only) {
+    IpclPaillier pai;
+    pai.import_pk(pai_.export_pk(), true);
+    std::vector<BigNumber> bn;
+    for (std::size_t i = 0; i < bench_vec_num_values_; ++i) {
+        bn.push_back(ipcl::getRandomBN(32));
+    }
+    ipcl::PlainText pt(bn);
+    for (std::size_t i = 0; i < bench_iter_num_; ++i) {
+        pai.encrypt(pt);
+    }
+}
+
 TEST_F(IpclPaillierTest, bench_dec) {
     std::vector<BigNumber> bn;
     for (std::size_t i = 0; i < bench_vec_num_values_; ++i) {
@@ -285,6 +370,19 @@ TEST_F(IpclPaillierTest, bench_mul) {
     }
 }
 
+TEST_F(IpclPaillierTest, bench_ciphertext_batch_codec) {
+    std::vector<BigNumber> bn;
+    for (std::size_t i = 0; i < bench_vec_num_values_; ++i) {
+        bn.push_back(ipcl::getRandomBN(32));
+    }
+    auto ct = pai_.encrypt(ipcl::PlainText(bn));
+    ByteVector buffer(ct.getSize() * pai_.get_bytes_len(true));
+    for (std::size_t i = 0; i < bench_iter_num_; ++i) {
+        pai_.encode(ct, buffer.data());
+        pai_.decode(buffer.data(), ct.getSize());
+    }
+}
+
 TEST_F(IpclPaillierTest, bench_keygen) {
     IpclPaillier pai;
     for (std::size_t i = 0; i < bench_keygen_; ++i) {
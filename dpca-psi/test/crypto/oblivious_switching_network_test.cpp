@@ -0,0 +1,90 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/oblivious_switching_network.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/common/utils.h"
+#include "dpca-psi/network/two_channel_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class ObliviousSwitchingNetworkTest : public ::testing::Test {
+public:
+    void permute_and_share(std::size_t data_size, std::size_t column_num, std::size_t output_size) {
+        std::vector<std::vector<std::uint64_t>> values(column_num, std::vector<std::uint64_t>(data_size));
+        PRNG prng(read_block_from_dev_urandom());
+        for (auto& column : values) {
+            prng.get<std::uint64_t>(column.data(), data_size);
+        }
+        std::vector<std::size_t> permutation = generate_permutation(data_size);
+
+        std::vector<std::vector<std::uint64_t>> sender_shares;
+        std::vector<std::vector<std::uint64_t>> receiver_shares;
+        std::thread sender([&values, &sender_shares, output_size]() {
+            auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30330, 30331);
+            ObliviousSwitchingNetwork osn(net);
+            osn.send(values, output_size, sender_shares);
+        });
+        std::thread receiver([&permutation, &receiver_shares, column_num, output_size]() {
+            auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30331, 30330);
+            ObliviousSwitchingNetwork osn(net);
+            osn.recv(permutation, column_num, output_size, receiver_shares);
+        });
+        sender.join();
+        receiver.join();
+
+        ASSERT_EQ(column_num, sender_shares.size());
+        ASSERT_EQ(column_num, receiver_shares.size());
+        for (std::size_t col_idx = 0; col_idx < column_num; ++col_idx) {
+            ASSERT_EQ(output_size, sender_shares[col_idx].size());
+            ASSERT_EQ(output_size, receiver_shares[col_idx].size());
+            for (std::size_t item_idx = 0; item_idx < output_size; ++item_idx) {
+                EXPECT_EQ(values[col_idx][permutation[item_idx]],
+                        sender_shares[col_idx][item_idx] + receiver_shares[col_idx][item_idx]);
+            }
+        }
+    }
+};
+
+TEST_F(ObliviousSwitchingNetworkTest, single_column) {
+    permute_and_share(1000, 1, 1000);
+}
+
+TEST_F(ObliviousSwitchingNetworkTest, multiple_columns) {
+    permute_and_share(1000, 5, 300);
+}
+
+TEST_F(ObliviousSwitchingNetworkTest, single_row) {
+    permute_and_share(1, 3, 1);
+}
+
+TEST_F(ObliviousSwitchingNetworkTest, invalid_size) {
+    auto net = std::shared_ptr<IOBase>(nullptr);
+    ObliviousSwitchingNetwork osn(net);
+    std::vector<std::vector<std::uint64_t>> shares;
+    EXPECT_THROW(osn.send({}, 0, shares), std::invalid_argument);
+    EXPECT_THROW(osn.send({{1, 2}}, 3, shares), std::invalid_argument);
+    EXPECT_THROW(osn.recv({0, 1}, 0, 1, shares), std::invalid_argument);
+    EXPECT_THROW(osn.recv({0, 1}, 1, 3, shares), std::invalid_argument);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,81 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/oblivious_transfer.h"
+
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/common/utils.h"
+#include "dpca-psi/network/two_channel_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class ObliviousTransferTest : public ::testing::Test {
+public:
+    static bool block_equal(const block& lhs, const block& rhs) {
+        return std::memcmp(&lhs, &rhs, sizeof(block)) == 0;
+    }
+
+    void random_ot(std::size_t ot_num) {
+        PRNG prng(read_block_from_dev_urandom());
+        std::vector<bool> choices(ot_num);
+        for (std::size_t i = 0; i < ot_num; ++i) {
+            choices[i] = prng.get<bool>();
+        }
+        std::vector<block> messages_0;
+        std::vector<block> messages_1;
+        std::vector<block> messages;
+        std::thread sender([&messages_0, &messages_1, ot_num]() {
+            auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30330, 30331);
+            ObliviousTransfer ot(net);
+            ot.send_random(ot_num, messages_0, messages_1);
+        });
+        std::thread receiver([&messages, &choices]() {
+            auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30331, 30330);
+            ObliviousTransfer ot(net);
+            ot.recv_random(choices, messages);
+        });
+        sender.join();
+        receiver.join();
+
+        ASSERT_EQ(ot_num, messages_0.size());
+        ASSERT_EQ(ot_num, messages_1.size());
+        ASSERT_EQ(ot_num, messages.size());
+        for (std::size_t i = 0; i < ot_num; ++i) {
+            EXPECT_FALSE(block_equal(messages_0[i], messages_1[i]));
+            EXPECT_TRUE(block_equal(messages[i], choices[i] ? messages_1[i] : messages_0[i]));
+        }
+    }
+};
+
+TEST_F(ObliviousTransferTest, random_ot) {
+    random_ot(1000);
+}
+
+TEST_F(ObliviousTransferTest, random_ot_aligned) {
+    random_ot(2 * ObliviousTransfer::kBaseOtNum);
+}
+
+TEST_F(ObliviousTransferTest, random_ot_few) {
+    random_ot(1);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,142 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/paillier_key_store.h"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "ipcl/utils/common.hpp"
+
+#include "dpca-psi/crypto/ipcl_paillier.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class PaillierKeyStoreTest : public ::testing::Test {
+public:
+    static const std::size_t n_len_ = 1024;
+
+    void SetUp() {
+        char dir_template[] = "/tmp/dpca_psi_key_store_XXXXXX";
+        ASSERT_NE(mkdtemp(dir_template), nullptr);
+        directory_ = dir_template;
+    }
+
+    static void decrypt_with(const IpclPaillier& encryptor, const IpclPaillier& decryptor) {
+        BigNumber bn = ipcl::getRandomBN(32);
+        auto ct = encryptor.encrypt(ipcl::PlainText(bn));
+        EXPECT_EQ(bn, decryptor.decrypt(ct).getElement(0));
+    }
+
+    std::string directory_;
+};
+
+TEST_F(PaillierKeyStoreTest, load_stored_key) {
+    PaillierKeyStore key_store(directory_, 0);
+    IpclPaillier pai_0;
+    EXPECT_FALSE(key_store.load_or_generate(n_len_, true, pai_0));
+    IpclPaillier pai_1;
+    EXPECT_TRUE(key_store.load_or_generate(n_len_, true, pai_1));
+    EXPECT_EQ(pai_0.export_sk(), pai_1.export_sk());
+    EXPECT_EQ(pai_0.export_pk(), pai_1.export_pk());
+    decrypt_with(pai_0, pai_1);
+
+    // keys of different settings are stored separately.
+    IpclPaillier pai_2;
+    EXPECT_FALSE(key_store.load_or_generate(n_len_, false, pai_2));
+}
+
+TEST_F(PaillierKeyStoreTest, rotate_expired_key) {
+    PaillierKeyStore key_store(directory_, 2);
+    IpclPaillier pai_0;
+    EXPECT_FALSE(key_store.load_or_generate(n_len_, false, pai_0));
+    std::this_thread::sleep_for(std::chrono::milliseconds(3100));
+    IpclPaillier pai_1;
+    EXPECT_FALSE(key_store.load_or_generate(n_len_, false, pai_1));
+    EXPECT_NE(pai_0.export_sk(), pai_1.export_sk());
+    IpclPaillier pai_2;
+    EXPECT_TRUE(key_store.load_or_generate(n_len_, false, pai_2));
+    EXPECT_EQ(pai_1.export_sk(), pai_2.export_sk());
+}
+
+TEST_F(PaillierKeyStoreTest, corrupted_key) {
+    PaillierKeyStore key_store(directory_, 0);
+    IpclPaillier pai_0;
+    key_store.load_or_generate(n_len_, false, pai_0);
+    std::ofstream(directory_ + "/paillier_1024.key", std::ios::trunc) << "corrupted";
+    IpclPaillier pai_1;
+    EXPECT_FALSE(key_store.load_or_generate(n_len_, false, pai_1));
+    decrypt_with(pai_1, pai_1);
+}
+
+TEST_F(PaillierKeyStoreTest, owner_only_file) {
+    // a stale temporary file of a crash does not pass its permissions on.
+    std::string path = directory_ + "/paillier_1024.key";
+    std::ofstream(path + ".tmp") << "stale";
+    ASSERT_EQ(chmod((path + ".tmp").c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH), 0);
+    PaillierKeyStore key_store(directory_, 0);
+    IpclPaillier pai_0;
+    EXPECT_FALSE(key_store.load(n_len_, false, pai_0));
+    EXPECT_FALSE(key_store.load_or_generate(n_len_, false, pai_0));
+    struct stat status;
+    ASSERT_EQ(stat(path.c_str(), &status), 0);
+    EXPECT_EQ(status.st_mode & 0777, 0600u);
+    EXPECT_NE(stat((path + ".tmp").c_str(), &status), 0);
+    IpclPaillier pai_1;
+    EXPECT_TRUE(key_store.load(n_len_, false, pai_1));
+    EXPECT_EQ(pai_0.export_sk(), pai_1.export_sk());
+}
+
+TEST_F(PaillierKeyStoreTest, peer_pk) {
+    PaillierKeyStore key_store(directory_, 0);
+    IpclPaillier remote;
+    remote.keygen(n_len_, true);
+    ByteVector pk = remote.export_pk();
+    ByteVector fingerprint = PaillierKeyStore::fingerprint(pk, true);
+    EXPECT_NE(fingerprint, PaillierKeyStore::fingerprint(pk, false));
+
+    IpclPaillier cached;
+    EXPECT_FALSE(key_store.load_peer_pk(fingerprint, true, cached));
+    key_store.save_peer_pk(pk, true);
+    EXPECT_TRUE(key_store.load_peer_pk(fingerprint, true, cached));
+    EXPECT_EQ(pk, cached.export_pk());
+    decrypt_with(cached, remote);
+}
+
+TEST_F(PaillierKeyStoreTest, disabled) {
+    PaillierKeyStore key_store;
+    EXPECT_FALSE(key_store.enabled());
+    IpclPaillier pai;
+    EXPECT_FALSE(key_store.load_or_generate(n_len_, false, pai));
+    decrypt_with(pai, pai);
+    key_store.save_peer_pk(pai.export_pk(), false);
+    IpclPaillier cached;
+    EXPECT_FALSE(key_store.load_peer_pk(PaillierKeyStore::fingerprint(pai.export_pk(), false), false, cached));
+}
+
+TEST_F(PaillierKeyStoreTest, invalid_directory) {
+    PaillierKeyStore key_store(directory_ + "/not_exist", 0);
+    IpclPaillier pai;
+    EXPECT_THROW(key_store.load_or_generate(n_len_, false, pai), std::runtime_error);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,78 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/crypto/permutation_network.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/common/utils.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class PermutationNetworkTest : public ::testing::Test {
+public:
+    static void route_and_check(const std::vector<std::size_t>& permutation) {
+        PermutationNetwork network(permutation);
+        std::size_t network_size = PermutationNetwork::network_size(permutation.size());
+        EXPECT_EQ(PermutationNetwork::switch_count(permutation.size()), network.get_switches().size());
+        std::vector<std::size_t> values(network_size);
+        for (std::size_t i = 0; i < network_size; ++i) {
+            values[i] = i;
+        }
+        network.apply(values);
+        for (std::size_t i = 0; i < permutation.size(); ++i) {
+            ASSERT_EQ(permutation[i], values[i]);
+        }
+    }
+};
+
+TEST_F(PermutationNetworkTest, size) {
+    EXPECT_EQ(2, PermutationNetwork::network_size(0));
+    EXPECT_EQ(2, PermutationNetwork::network_size(2));
+    EXPECT_EQ(8, PermutationNetwork::network_size(5));
+    EXPECT_EQ(1024, PermutationNetwork::network_size(1024));
+    EXPECT_EQ(1, PermutationNetwork::switch_count(2));
+    EXPECT_EQ(6, PermutationNetwork::switch_count(4));
+    EXPECT_EQ(19 * 512, PermutationNetwork::switch_count(1000));
+}
+
+TEST_F(PermutationNetworkTest, identity_and_reverse) {
+    for (std::size_t size : {2, 16, 1024}) {
+        std::vector<std::size_t> identity(size);
+        std::vector<std::size_t> reverse(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            identity[i] = i;
+            reverse[i] = size - 1 - i;
+        }
+        route_and_check(identity);
+        route_and_check(reverse);
+    }
+}
+
+TEST_F(PermutationNetworkTest, random) {
+    for (std::size_t size : {1, 2, 3, 4, 7, 100, 1000, 4097}) {
+        route_and_check(generate_permutation(size));
+    }
+}
+
+TEST_F(PermutationNetworkTest, invalid_permutation) {
+    EXPECT_THROW(PermutationNetwork(std::vector<std::size_t>{0, 0}), std::invalid_argument);
+    EXPECT_THROW(PermutationNetwork(std::vector<std::size_t>{0, 2}), std::invalid_argument);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
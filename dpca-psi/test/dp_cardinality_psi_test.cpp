@@ -14,8 +14,15 @@
 
 #include "dpca-psi/dp_cardinality_psi.h"
 
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <fstream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <utility>
@@ -25,6 +32,7 @@
 #include "dpca-psi/common/dummy_data_utils.h"
 #include "dpca-psi/common/utils.h"
 #include "dpca-psi/crypto/prng.h"
+#include "dpca-psi/network/memory_net_io.h"
 #include "dpca-psi/network/two_channel_net_io.h"
 
 namespace privacy_go {
@@ -32,6 +40,48 @@ namespace dpca_psi {
 
 using json = nlohmann::json;
 
+// Fails every receive once the file at path exists, to interrupt a run after a checkpoint.
+class InterruptedNetIO : public IOBase {
+public:
+    InterruptedNetIO(std::shared_ptr<IOBase> io, const std::string& path) : io_(io), path_(path) {
+    }
+
+private:
+    void send_data_impl(const void* data, std::size_t nbyte) override {
+        io_->send_data(data, nbyte);
+    }
+
+    void recv_data_impl(void* data, std::size_t nbyte) override {
+        if (std::ifstream(path_).good()) {
+            throw std::runtime_error("interrupted");
+        }
+        io_->recv_data(data, nbyte);
+    }
+
+    void flush_impl() override {
+        io_->flush();
+    }
+
+    std::shared_ptr<IOBase> io_ = nullptr;
+    std::string path_{};
+};
+
+// Removes the files in directory and then directory itself.
+void remove_directory(const std::string& directory) {
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    for (dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            std::remove((directory + "/" + name).c_str());
+        }
+    }
+    closedir(dir);
+    rmdir(directory.c_str());
+}
+
 class DPCAPSITest : public ::testing::Test {
 public:
     void SetUp() {
@@ -107,12 +157,20 @@ class DPCAPSITest : public ::testing::Test {
         receiver_params_without_djn_["paillier_params"]["enable_djn"] = false;
     }
 
-    void dpca_psi_default(const json& params, int idx) {
-        bool is_sender = params["common"]["is_sender"];
+    // Connects to the other party at the address and ports of params.
+    static std::shared_ptr<IOBase> create_net(const json& params) {
         std::string address = params["common"]["address"];
         std::uint16_t remote_port = params["common"]["remote_port"];
         std::uint16_t local_port = params["common"]["local_port"];
-        auto net = std::make_shared<TwoChannelNetIO>(address, remote_port, local_port);
+        return std::make_shared<TwoChannelNetIO>(address, remote_port, local_port);
+    }
+
+    void dpca_psi_default(const json& params, int idx) {
+        dpca_psi_default(params, idx, create_net(params));
+    }
+
+    void dpca_psi_default(const json& params, int idx, const std::shared_ptr<IOBase>& net) {
+        bool is_sender = params["common"]["is_sender"];
         DPCardinalityPSI psi;
         psi.init(params, net);
         if (is_sender) {
@@ -128,6 +186,103 @@ class DPCAPSITest : public ::testing::Test {
         }
     }
 
+    // Runs dpca_psi_default() twice with a key store of each party, where the first run generates and caches the
+    // keys and the second run loads them.
+    void dpca_psi_default_with_key_store(json sender_params, json receiver_params) {
+        char sender_dir[] = "/tmp/dpca_psi_sender_key_store_XXXXXX";
+        char receiver_dir[] = "/tmp/dpca_psi_receiver_key_store_XXXXXX";
+        ASSERT_NE(mkdtemp(sender_dir), nullptr);
+        ASSERT_NE(mkdtemp(receiver_dir), nullptr);
+        sender_params["paillier_params"]["key_store_dir"] = sender_dir;
+        receiver_params["paillier_params"]["key_store_dir"] = receiver_dir;
+
+        for (std::size_t run = 0; run < 2; ++run) {
+            shares_0_.clear();
+            shares_1_.clear();
+            t_[0] = std::thread([this, &sender_params]() { dpca_psi_default(sender_params, 0); });
+            t_[1] = std::thread([this, &receiver_params]() { dpca_psi_default(receiver_params, 1); });
+
+            t_[0].join();
+            t_[1].join();
+
+            EXPECT_EQ(shares_0_.size(), shares_1_.size());
+            EXPECT_EQ(shares_0_[0].size(), shares_1_[0].size());
+            std::size_t idx = shares_0_.size() - 1;
+            std::uint64_t actual_result = 0;
+            for (std::size_t j = 0; j < shares_0_[idx].size(); ++j) {
+                actual_result += shares_0_[idx][j] + shares_1_[idx][j];
+            }
+            EXPECT_EQ(actual_result, default_expected_sum_);
+        }
+        remove_directory(sender_dir);
+        remove_directory(receiver_dir);
+    }
+
+    void dpca_psi_aggregate(const json& params, int idx) {
+        bool is_sender = params["common"]["is_sender"];
+        DPCardinalityPSI psi;
+        psi.init(params, create_net(params));
+        if (is_sender) {
+            psi.data_sampling(default_sender_keys_, default_sender_features_);
+        } else {
+            psi.data_sampling(default_receiver_keys_, default_receiver_features_);
+        }
+        psi.process_aggregate(idx == 0 ? shares_0_ : shares_1_);
+    }
+
+    // Runs an aggregate query of the default features and one of the doubled features in a session, then checks the
+    // session is out of queries. Stores the shares of both queries in sums.
+    void dpca_psi_session(const json& params, std::vector<std::vector<std::vector<std::uint64_t>>>& sums) {
+        bool is_sender = params["common"]["is_sender"];
+        DPCardinalityPSI psi;
+        psi.init(params, create_net(params));
+        const auto& features = is_sender ? default_sender_features_ : default_receiver_features_;
+        psi.data_sampling(is_sender ? default_sender_keys_ : default_receiver_keys_, features);
+        EXPECT_EQ(psi.start_session(), default_expected_results_[0].size());
+        EXPECT_EQ(psi.get_remaining_queries(), 2);
+
+        sums.resize(2);
+        psi.query_aggregate(features, sums[0]);
+        std::vector<std::vector<std::uint64_t>> doubled_features(1, features[0]);
+        for (auto& value : doubled_features[0]) {
+            value *= 2;
+        }
+        psi.query_aggregate(doubled_features, sums[1]);
+        EXPECT_EQ(psi.get_remaining_queries(), 0);
+        std::vector<std::vector<std::uint64_t>> shares;
+        EXPECT_THROW(psi.query(features, shares), std::logic_error);
+        psi.end_session();
+        EXPECT_THROW(psi.query(features, shares), std::logic_error);
+    }
+
+    // Returns the sums revealed from shares_0_ and shares_1_.
+    std::vector<std::vector<std::uint64_t>> reveal_sums() {
+        EXPECT_EQ(shares_0_.size(), shares_1_.size());
+        std::vector<std::vector<std::uint64_t>> sums(shares_0_.size());
+        for (std::size_t idx = 0; idx < sums.size(); ++idx) {
+            EXPECT_EQ(shares_0_[idx].size(), shares_1_[idx].size());
+            for (std::size_t j = 0; j < shares_0_[idx].size(); ++j) {
+                sums[idx].emplace_back(shares_0_[idx][j] + shares_1_[idx][j]);
+            }
+        }
+        return sums;
+    }
+
+    // Runs process_cardinality(), or process() with no feature columns, and returns the intersection size.
+    std::size_t dpca_psi_cardinality(const json& params, bool use_process) {
+        bool is_sender = params["common"]["is_sender"];
+        DPCardinalityPSI psi;
+        psi.init(params, create_net(params));
+        psi.data_sampling(is_sender ? default_sender_keys_ : default_receiver_keys_, {});
+        if (use_process) {
+            std::vector<std::vector<std::uint64_t>> shares;
+            psi.process(shares);
+            EXPECT_TRUE(shares.empty());
+            return psi.get_intersection_size();
+        }
+        return psi.process_cardinality();
+    }
+
     std::uint64_t dpca_psi_random(const json& params, std::size_t intersection_size, std::size_t feature_size,
             std::vector<std::vector<std::uint64_t>>& shares) {
         std::size_t data_size = 10 * intersection_size;
@@ -158,12 +313,8 @@ class DPCAPSITest : public ::testing::Test {
         }
 
         bool is_sender = params["common"]["is_sender"];
-        std::string address = params["common"]["address"];
-        std::uint16_t remote_port = params["common"]["remote_port"];
-        std::uint16_t local_port = params["common"]["local_port"];
-        auto net = std::make_shared<TwoChannelNetIO>(address, remote_port, local_port);
         DPCardinalityPSI psi;
-        psi.init(params, net);
+        psi.init(params, create_net(params));
         psi.data_sampling(keys, features);
         psi.process(shares);
 
@@ -292,6 +443,509 @@ TEST_F(DPCAPSITest, default_without_djn) {
     EXPECT_EQ(actual_result, default_expected_sum_);
 }
 
+TEST_F(DPCAPSITest, default_with_key_store) {
+    dpca_psi_default_with_key_store(sender_params_, receiver_params_);
+}
+
+TEST_F(DPCAPSITest, default_with_key_store_and_damgard_jurik) {
+    json sender_params = sender_params_;
+    json receiver_params = receiver_params_;
+    sender_params["paillier_params"]["damgard_jurik_s"] = 2;
+    receiver_params["paillier_params"]["damgard_jurik_s"] = 2;
+    dpca_psi_default_with_key_store(sender_params, receiver_params);
+}
+
+TEST_F(DPCAPSITest, default_with_damgard_jurik) {
+    json sender_params = sender_params_;
+    json receiver_params = receiver_params_;
+    sender_params["paillier_params"]["damgard_jurik_s"] = 2;
+    receiver_params["paillier_params"]["damgard_jurik_s"] = 2;
+    t_[0] = std::thread([this, &sender_params]() { dpca_psi_default(sender_params, 0); });
+    t_[1] = std::thread([this, &receiver_params]() { dpca_psi_default(receiver_params, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(shares_0_.size(), shares_1_.size());
+    EXPECT_EQ(shares_0_[0].size(), shares_1_[0].size());
+    std::size_t idx = shares_0_.size() - 1;
+    std::uint64_t actual_result = 0;
+    for (std::size_t j = 0; j < shares_0_[idx].size(); ++j) {
+        actual_result += shares_0_[idx][j] + shares_1_[idx][j];
+    }
+    EXPECT_EQ(actual_result, default_expected_sum_);
+}
+
+TEST_F(DPCAPSITest, default_with_damgard_jurik_without_packing) {
+    json sender_params = sender_params_without_packing_;
+    json receiver_params = receiver_params_without_packing_;
+    sender_params["paillier_params"]["damgard_jurik_s"] = 3;
+    receiver_params["paillier_params"]["damgard_jurik_s"] = 3;
+    t_[0] = std::thread([this, &sender_params]() { dpca_psi_default(sender_params, 0); });
+    t_[1] = std::thread([this, &receiver_params]() { dpca_psi_default(receiver_params, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(shares_0_.size(), shares_1_.size());
+    EXPECT_EQ(shares_0_[0].size(), shares_1_[0].size());
+    std::size_t idx = shares_0_.size() - 1;
+    std::uint64_t actual_result = 0;
+    for (std::size_t j = 0; j < shares_0_[idx].size(); ++j) {
+        actual_result += shares_0_[idx][j] + shares_1_[idx][j];
+    }
+    EXPECT_EQ(actual_result, default_expected_sum_);
+}
+
+TEST_F(DPCAPSITest, default_with_feature_bits) {
+    json sender_params = sender_params_;
+    json receiver_params = receiver_params_;
+    sender_params["common"]["feature_bits"] = {8};
+    receiver_params["common"]["feature_bits"] = {3, 16};
+    t_[0] = std::thread([this, &sender_params]() { dpca_psi_default(sender_params, 0); });
+    t_[1] = std::thread([this, &receiver_params]() { dpca_psi_default(receiver_params, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(shares_0_.size(), shares_1_.size());
+    EXPECT_EQ(shares_0_[0].size(), shares_1_[0].size());
+    std::size_t idx = shares_0_.size() - 1;
+    std::uint64_t actual_result = 0;
+    for (std::size_t j = 0; j < shares_0_[idx].size(); ++j) {
+        actual_result += shares_0_[idx][j] + shares_1_[idx][j];
+    }
+    EXPECT_EQ(actual_result, default_expected_sum_);
+}
+
+TEST_F(DPCAPSITest, default_with_ot_sharing) {
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["common"]["feature_sharing"] = "ot";
+    receiver_params["common"]["feature_sharing"] = "ot";
+    t_[0] = std::thread([this, &sender_params]() { dpca_psi_default(sender_params, 0); });
+    t_[1] = std::thread([this, &receiver_params]() { dpca_psi_default(receiver_params, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    // rows of the sender's column followed by the receiver's columns, matched on "c", "e", "g" and "#".
+    std::vector<std::vector<std::uint64_t>> expected_rows = {{1, 2, 2}, {2, 1, 1}, {3, 3, 3}, {4, 4, 4}};
+    ASSERT_EQ(shares_0_.size(), 3);
+    ASSERT_EQ(shares_1_.size(), 3);
+    std::vector<std::vector<std::uint64_t>> rows(shares_0_[0].size());
+    for (std::size_t j = 0; j < rows.size(); ++j) {
+        for (std::size_t idx = 0; idx < shares_0_.size(); ++idx) {
+            ASSERT_EQ(shares_0_[idx].size(), rows.size());
+            ASSERT_EQ(shares_1_[idx].size(), rows.size());
+            rows[j].emplace_back(shares_0_[idx][j] + shares_1_[idx][j]);
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    EXPECT_EQ(rows, expected_rows);
+}
+
+TEST_F(DPCAPSITest, default_with_ot_sharing_and_dp) {
+    json sender_params = sender_params_;
+    json receiver_params = receiver_params_;
+    sender_params["common"]["feature_sharing"] = "ot";
+    receiver_params["common"]["feature_sharing"] = "ot";
+    t_[0] = std::thread([this, &sender_params]() { dpca_psi_default(sender_params, 0); });
+    t_[1] = std::thread([this, &receiver_params]() { dpca_psi_default(receiver_params, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(shares_0_.size(), shares_1_.size());
+    EXPECT_EQ(shares_0_[0].size(), shares_1_[0].size());
+    std::size_t idx = shares_0_.size() - 1;
+    std::uint64_t actual_result = 0;
+    for (std::size_t j = 0; j < shares_0_[idx].size(); ++j) {
+        actual_result += shares_0_[idx][j] + shares_1_[idx][j];
+    }
+    EXPECT_EQ(actual_result, default_expected_sum_);
+}
+
+TEST_F(DPCAPSITest, default_with_ot_sharing_over_memory_net_io) {
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["common"]["feature_sharing"] = "ot";
+    receiver_params["common"]["feature_sharing"] = "ot";
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    t_[0] = std::thread([this, &sender_params, &nets]() { dpca_psi_default(sender_params, 0, nets.first); });
+    t_[1] = std::thread([this, &receiver_params, &nets]() { dpca_psi_default(receiver_params, 1, nets.second); });
+
+    t_[0].join();
+    t_[1].join();
+
+    std::vector<std::vector<std::uint64_t>> expected_rows = {{1, 2, 2}, {2, 1, 1}, {3, 3, 3}, {4, 4, 4}};
+    ASSERT_EQ(shares_0_.size(), 3);
+    ASSERT_EQ(shares_1_.size(), 3);
+    std::vector<std::vector<std::uint64_t>> rows(shares_0_[0].size());
+    for (std::size_t j = 0; j < rows.size(); ++j) {
+        for (std::size_t idx = 0; idx < shares_0_.size(); ++idx) {
+            ASSERT_EQ(shares_1_[idx].size(), rows.size());
+            rows[j].emplace_back(shares_0_[idx][j] + shares_1_[idx][j]);
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    EXPECT_EQ(rows, expected_rows);
+}
+
+TEST_F(DPCAPSITest, default_with_checkpoints) {
+    char checkpoint_dir[] = "/tmp/dpca_psi_checkpoint_XXXXXX";
+    ASSERT_NE(mkdtemp(checkpoint_dir), nullptr);
+    std::string directory = checkpoint_dir;
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["common"]["feature_sharing"] = "ot";
+    receiver_params["common"]["feature_sharing"] = "ot";
+    sender_params["common"]["checkpoint_dir"] = directory;
+    receiver_params["common"]["checkpoint_dir"] = directory;
+
+    // both parties stop right after the intersection is computed.
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    auto sender_net = std::make_shared<InterruptedNetIO>(nets.first, directory + "/sender_2.ckpt");
+    auto receiver_net = std::make_shared<InterruptedNetIO>(nets.second, directory + "/receiver_2.ckpt");
+    t_[0] = std::thread([this, &sender_params, &sender_net]() {
+        EXPECT_THROW(dpca_psi_default(sender_params, 0, sender_net), std::runtime_error);
+    });
+    t_[1] = std::thread([this, &receiver_params, &receiver_net]() {
+        EXPECT_THROW(dpca_psi_default(receiver_params, 1, receiver_net), std::runtime_error);
+    });
+    t_[0].join();
+    t_[1].join();
+
+    // new instances, which have not sampled data, resume from the checkpoints.
+    nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    auto resume = [&nets](const json& params, std::vector<std::vector<std::uint64_t>>& shares) {
+        bool is_sender = params["common"]["is_sender"];
+        DPCardinalityPSI psi;
+        psi.init(params, is_sender ? nets.first : nets.second);
+        EXPECT_TRUE(psi.resume(shares));
+        // checkpoints are removed once the run completes.
+        EXPECT_FALSE(psi.resume(shares));
+    };
+    shares_0_.clear();
+    shares_1_.clear();
+    t_[0] = std::thread([this, &sender_params, &resume]() { resume(sender_params, shares_0_); });
+    t_[1] = std::thread([this, &receiver_params, &resume]() { resume(receiver_params, shares_1_); });
+    t_[0].join();
+    t_[1].join();
+
+    std::vector<std::vector<std::uint64_t>> expected_rows = {{1, 2, 2}, {2, 1, 1}, {3, 3, 3}, {4, 4, 4}};
+    ASSERT_EQ(shares_0_.size(), 3);
+    ASSERT_EQ(shares_1_.size(), 3);
+    std::vector<std::vector<std::uint64_t>> rows(shares_0_[0].size());
+    for (std::size_t j = 0; j < rows.size(); ++j) {
+        for (std::size_t idx = 0; idx < shares_0_.size(); ++idx) {
+            ASSERT_EQ(shares_1_[idx].size(), rows.size());
+            rows[j].emplace_back(shares_0_[idx][j] + shares_1_[idx][j]);
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    EXPECT_EQ(rows, expected_rows);
+
+    remove_directory(directory);
+}
+
+TEST_F(DPCAPSITest, default_with_checkpoints_without_paillier_key) {
+    char checkpoint_dir[] = "/tmp/dpca_psi_checkpoint_XXXXXX";
+    ASSERT_NE(mkdtemp(checkpoint_dir), nullptr);
+    std::string directory = checkpoint_dir;
+    std::string sender_key_store_dir = directory + "/sender_keys";
+    std::string receiver_key_store_dir = directory + "/receiver_keys";
+    ASSERT_EQ(mkdir(sender_key_store_dir.c_str(), S_IRWXU), 0);
+    ASSERT_EQ(mkdir(receiver_key_store_dir.c_str(), S_IRWXU), 0);
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["common"]["checkpoint_dir"] = directory;
+    receiver_params["common"]["checkpoint_dir"] = directory;
+    sender_params["paillier_params"]["key_store_dir"] = sender_key_store_dir;
+    receiver_params["paillier_params"]["key_store_dir"] = receiver_key_store_dir;
+
+    // both parties stop right after the features are exchanged.
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    auto sender_net = std::make_shared<InterruptedNetIO>(nets.first, directory + "/sender_3.ckpt");
+    auto receiver_net = std::make_shared<InterruptedNetIO>(nets.second, directory + "/receiver_3.ckpt");
+    t_[0] = std::thread([this, &sender_params, &sender_net]() {
+        EXPECT_THROW(dpca_psi_default(sender_params, 0, sender_net), std::runtime_error);
+    });
+    t_[1] = std::thread([this, &receiver_params, &receiver_net]() {
+        EXPECT_THROW(dpca_psi_default(receiver_params, 1, receiver_net), std::runtime_error);
+    });
+    t_[0].join();
+    t_[1].join();
+
+    // the sender loses its key pair, so both parties resume from the intersection with a new one.
+    remove_directory(sender_key_store_dir);
+    ASSERT_EQ(mkdir(sender_key_store_dir.c_str(), S_IRWXU), 0);
+    nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    auto resume = [&nets](const json& params, std::vector<std::vector<std::uint64_t>>& shares) {
+        bool is_sender = params["common"]["is_sender"];
+        DPCardinalityPSI psi;
+        psi.init(params, is_sender ? nets.first : nets.second);
+        EXPECT_TRUE(psi.resume(shares));
+    };
+    shares_0_.clear();
+    shares_1_.clear();
+    t_[0] = std::thread([this, &sender_params, &resume]() { resume(sender_params, shares_0_); });
+    t_[1] = std::thread([this, &receiver_params, &resume]() { resume(receiver_params, shares_1_); });
+    t_[0].join();
+    t_[1].join();
+
+    std::vector<std::vector<std::uint64_t>> expected_rows = {{1, 2, 2}, {2, 1, 1}, {3, 3, 3}, {4, 4, 4}};
+    ASSERT_EQ(shares_0_.size(), 3);
+    ASSERT_EQ(shares_1_.size(), 3);
+    std::vector<std::vector<std::uint64_t>> rows(shares_0_[0].size());
+    for (std::size_t j = 0; j < rows.size(); ++j) {
+        for (std::size_t idx = 0; idx < shares_0_.size(); ++idx) {
+            ASSERT_EQ(shares_1_[idx].size(), rows.size());
+            rows[j].emplace_back(shares_0_[idx][j] + shares_1_[idx][j]);
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    EXPECT_EQ(rows, expected_rows);
+
+    remove_directory(sender_key_store_dir);
+    remove_directory(receiver_key_store_dir);
+    remove_directory(directory);
+}
+
+TEST_F(DPCAPSITest, aggregate_test) {
+    t_[0] = std::thread([this]() { dpca_psi_aggregate(sender_params_without_dp_, 0); });
+    t_[1] = std::thread([this]() { dpca_psi_aggregate(receiver_params_without_dp_, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    std::vector<std::vector<std::uint64_t>> expected_sums = {{10}, {10}, {10}};
+    EXPECT_EQ(reveal_sums(), expected_sums);
+}
+
+TEST_F(DPCAPSITest, aggregate_with_dp) {
+    t_[0] = std::thread([this]() { dpca_psi_aggregate(sender_params_, 0); });
+    t_[1] = std::thread([this]() { dpca_psi_aggregate(receiver_params_, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    // dummy rows of the receiver's zero column add nothing.
+    auto sums = reveal_sums();
+    ASSERT_EQ(sums.size(), 3);
+    EXPECT_EQ(sums[2], std::vector<std::uint64_t>{default_expected_sum_});
+}
+
+TEST_F(DPCAPSITest, aggregate_without_packing) {
+    t_[0] = std::thread([this]() { dpca_psi_aggregate(sender_params_without_packing_, 0); });
+    t_[1] = std::thread([this]() { dpca_psi_aggregate(receiver_params_without_packing_, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    auto sums = reveal_sums();
+    ASSERT_EQ(sums.size(), 3);
+    EXPECT_EQ(sums[2], std::vector<std::uint64_t>{default_expected_sum_});
+}
+
+TEST_F(DPCAPSITest, aggregate_with_feature_bits) {
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["common"]["feature_bits"] = {4};
+    receiver_params["common"]["feature_bits"] = {3, 1};
+    receiver_params["aggregate_params"]["group_column"] = 0;
+    receiver_params["aggregate_params"]["group_num"] = 3;
+    default_receiver_features_[1] = {0, 1, 1, 0};
+    t_[0] = std::thread([this, &sender_params]() { dpca_psi_aggregate(sender_params, 0); });
+    t_[1] = std::thread([this, &receiver_params]() { dpca_psi_aggregate(receiver_params, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    // the receiver's rows matched are (2, 1), (1, 0), (3, 1) and (4, 0).
+    std::vector<std::vector<std::uint64_t>> expected_sums = {{10}, {0, 0, 1}};
+    EXPECT_EQ(reveal_sums(), expected_sums);
+}
+
+TEST_F(DPCAPSITest, aggregate_with_group_column) {
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    receiver_params["aggregate_params"]["group_column"] = 0;
+    receiver_params["aggregate_params"]["group_num"] = 3;
+    t_[0] = std::thread([this, &sender_params]() { dpca_psi_aggregate(sender_params, 0); });
+    t_[1] = std::thread([this, &receiver_params]() { dpca_psi_aggregate(receiver_params, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    // the receiver's rows matched are (2, 2), (1, 1), (3, 3) and (4, 4), group ids 3 and 4 fall in no group.
+    std::vector<std::vector<std::uint64_t>> expected_sums = {{10}, {0, 1, 2}};
+    EXPECT_EQ(reveal_sums(), expected_sums);
+}
+
+TEST_F(DPCAPSITest, aggregate_with_ot_sharing) {
+    json sender_params = sender_params_;
+    json receiver_params = receiver_params_;
+    sender_params["common"]["feature_sharing"] = "ot";
+    receiver_params["common"]["feature_sharing"] = "ot";
+    receiver_params["aggregate_params"]["group_column"] = 0;
+    receiver_params["aggregate_params"]["group_num"] = 3;
+    t_[0] = std::thread([this, &sender_params]() { dpca_psi_aggregate(sender_params, 0); });
+    t_[1] = std::thread([this, &receiver_params]() { dpca_psi_aggregate(receiver_params, 1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    auto sums = reveal_sums();
+    ASSERT_EQ(sums.size(), 2);
+    EXPECT_EQ(sums[1], (std::vector<std::uint64_t>{0, 1, 2}));
+}
+
+TEST_F(DPCAPSITest, session_test) {
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["dp_params"]["maximum_queries"] = 2;
+    receiver_params["dp_params"]["maximum_queries"] = 3;
+    std::vector<std::vector<std::vector<std::uint64_t>>> sums_0;
+    std::vector<std::vector<std::vector<std::uint64_t>>> sums_1;
+    t_[0] = std::thread([this, &sender_params, &sums_0]() { dpca_psi_session(sender_params, sums_0); });
+    t_[1] = std::thread([this, &receiver_params, &sums_1]() { dpca_psi_session(receiver_params, sums_1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    shares_0_ = sums_0[0];
+    shares_1_ = sums_1[0];
+    std::vector<std::vector<std::uint64_t>> expected_sums = {{10}, {10}, {10}};
+    EXPECT_EQ(reveal_sums(), expected_sums);
+    shares_0_ = sums_0[1];
+    shares_1_ = sums_1[1];
+    expected_sums = {{20}, {20}};
+    EXPECT_EQ(reveal_sums(), expected_sums);
+}
+
+TEST_F(DPCAPSITest, session_with_ot_sharing) {
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["common"]["feature_sharing"] = "ot";
+    receiver_params["common"]["feature_sharing"] = "ot";
+    sender_params["dp_params"]["maximum_queries"] = 3;
+    receiver_params["dp_params"]["maximum_queries"] = 2;
+    std::vector<std::vector<std::vector<std::uint64_t>>> sums_0;
+    std::vector<std::vector<std::vector<std::uint64_t>>> sums_1;
+    t_[0] = std::thread([this, &sender_params, &sums_0]() { dpca_psi_session(sender_params, sums_0); });
+    t_[1] = std::thread([this, &receiver_params, &sums_1]() { dpca_psi_session(receiver_params, sums_1); });
+
+    t_[0].join();
+    t_[1].join();
+
+    shares_0_ = sums_0[0];
+    shares_1_ = sums_1[0];
+    std::vector<std::vector<std::uint64_t>> expected_sums = {{10}, {10}, {10}};
+    EXPECT_EQ(reveal_sums(), expected_sums);
+    shares_0_ = sums_0[1];
+    shares_1_ = sums_1[1];
+    expected_sums = {{20}, {20}};
+    EXPECT_EQ(reveal_sums(), expected_sums);
+}
+
+TEST_F(DPCAPSITest, cardinality_only) {
+    std::size_t size_0 = 0;
+    std::size_t size_1 = 0;
+    t_[0] = std::thread([this, &size_0]() { size_0 = dpca_psi_cardinality(sender_params_without_dp_, false); });
+    t_[1] = std::thread([this, &size_1]() { size_1 = dpca_psi_cardinality(receiver_params_without_dp_, false); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(size_0, default_expected_results_[0].size());
+    EXPECT_EQ(size_1, default_expected_results_[0].size());
+}
+
+TEST_F(DPCAPSITest, cardinality_only_with_send_buffer) {
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["common"]["send_buffer_size"] = 4096;
+    receiver_params["common"]["send_buffer_size"] = 4096;
+    receiver_params["common"]["send_delay"] = true;
+    std::size_t size_0 = 0;
+    std::size_t size_1 = 0;
+    t_[0] = std::thread([this, &sender_params, &size_0]() { size_0 = dpca_psi_cardinality(sender_params, false); });
+    t_[1] = std::thread(
+            [this, &receiver_params, &size_1]() { size_1 = dpca_psi_cardinality(receiver_params, false); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(size_0, default_expected_results_[0].size());
+    EXPECT_EQ(size_1, default_expected_results_[0].size());
+}
+
+TEST_F(DPCAPSITest, cardinality_only_with_auto_tune) {
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["common"]["auto_tune"] = true;
+    receiver_params["common"]["auto_tune"] = true;
+    std::size_t size_0 = 0;
+    std::size_t size_1 = 0;
+    t_[0] = std::thread([this, &sender_params, &size_0]() { size_0 = dpca_psi_cardinality(sender_params, false); });
+    t_[1] = std::thread(
+            [this, &receiver_params, &size_1]() { size_1 = dpca_psi_cardinality(receiver_params, false); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(size_0, default_expected_results_[0].size());
+    EXPECT_EQ(size_1, default_expected_results_[0].size());
+}
+
+TEST_F(DPCAPSITest, cardinality_only_with_uncompressed_points) {
+    json sender_params = sender_params_without_dp_;
+    json receiver_params = receiver_params_without_dp_;
+    sender_params["ecc_params"]["point_compression"] = "uncompressed";
+    receiver_params["ecc_params"]["point_compression"] = "uncompressed";
+    // chunks of a few keys, which differ between the parties.
+    sender_params["common"]["exchange_chunk_size"] = 100;
+    receiver_params["common"]["exchange_chunk_size"] = 200;
+    std::size_t size_0 = 0;
+    std::size_t size_1 = 0;
+    t_[0] = std::thread([this, &sender_params, &size_0]() { size_0 = dpca_psi_cardinality(sender_params, false); });
+    t_[1] = std::thread(
+            [this, &receiver_params, &size_1]() { size_1 = dpca_psi_cardinality(receiver_params, false); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(size_0, default_expected_results_[0].size());
+    EXPECT_EQ(size_1, default_expected_results_[0].size());
+}
+
+TEST_F(DPCAPSITest, cardinality_only_with_dp) {
+    std::size_t size_0 = 0;
+    std::size_t size_1 = 0;
+    t_[0] = std::thread([this, &size_0]() { size_0 = dpca_psi_cardinality(sender_params_, false); });
+    t_[1] = std::thread([this, &size_1]() { size_1 = dpca_psi_cardinality(receiver_params_, false); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(size_0, size_1);
+    EXPECT_GE(size_0, default_expected_results_[0].size());
+}
+
+TEST_F(DPCAPSITest, process_without_features) {
+    std::size_t size_0 = 0;
+    std::size_t size_1 = 0;
+    t_[0] = std::thread([this, &size_0]() { size_0 = dpca_psi_cardinality(sender_params_without_dp_, true); });
+    t_[1] = std::thread([this, &size_1]() { size_1 = dpca_psi_cardinality(receiver_params_without_dp_, true); });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(size_0, default_expected_results_[0].size());
+    EXPECT_EQ(size_1, default_expected_results_[0].size());
+}
+
 TEST_F(DPCAPSITest, random_test) {
     std::vector<std::vector<std::uint64_t>> shares_0;
     std::vector<std::vector<std::uint64_t>> shares_1;
@@ -427,6 +1081,38 @@ TEST_F(DPCAPSITest, random_without_djn) {
     EXPECT_EQ(actual_result, expected_sum_1);
 }
 
+TEST_F(DPCAPSITest, random_with_ot_sharing) {
+    json sender_params = sender_params_;
+    json receiver_params = receiver_params_;
+    sender_params["common"]["feature_sharing"] = "ot";
+    receiver_params["common"]["feature_sharing"] = "ot";
+    std::vector<std::vector<std::uint64_t>> shares_0;
+    std::vector<std::vector<std::uint64_t>> shares_1;
+
+    std::uint64_t expected_sum_0 = 0;
+    std::uint64_t expected_sum_1 = 0;
+    t_[0] = std::thread([this, &sender_params, &shares_0, &expected_sum_0]() {
+        expected_sum_0 = dpca_psi_random(sender_params, 50, 3, shares_0);
+    });
+    t_[1] = std::thread([this, &receiver_params, &shares_1, &expected_sum_1]() {
+        expected_sum_1 = dpca_psi_random(receiver_params, 50, 2, shares_1);
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(shares_0.size(), 5);
+    EXPECT_EQ(shares_0.size(), shares_1.size());
+    EXPECT_EQ(shares_0[0].size(), shares_1[0].size());
+
+    std::size_t idx = shares_0.size() - 1;
+    std::uint64_t actual_result = 0;
+    for (std::size_t j = 0; j < shares_0[idx].size(); ++j) {
+        actual_result += shares_0[idx][j] + shares_1[idx][j];
+    }
+    EXPECT_EQ(actual_result, expected_sum_1);
+}
+
 TEST_F(DPCAPSITest, inconsistent_curve_id) {
     json receiver_invalid_params = receiver_params_without_dp_;
     receiver_invalid_params["ecc_params"]["curve_id"] = 414;
@@ -550,6 +1236,24 @@ TEST_F(DPCAPSITest, unexpected_ids_num) {
     t_[1].join();
 }
 
+TEST_F(DPCAPSITest, unexpected_send_buffer_size) {
+    json sender_invalid_params = sender_params_;
+    sender_invalid_params["common"]["send_buffer_size"] = (1ull << 30) + 1;
+    std::vector<std::vector<std::uint64_t>> shares_0;
+    std::vector<std::vector<std::uint64_t>> shares_1;
+
+    // the other party learns of the failed check in the handshake instead of waiting for it.
+    t_[0] = std::thread([this, &shares_0, &sender_invalid_params]() {
+        EXPECT_THROW(dpca_psi_default(sender_invalid_params, 0), std::invalid_argument);
+    });
+    t_[1] = std::thread([this, &shares_1]() {
+        EXPECT_THROW(dpca_psi_default(receiver_params_, 0), std::invalid_argument);
+    });
+
+    t_[0].join();
+    t_[1].join();
+}
+
 TEST_F(DPCAPSITest, inconsistent_apply_packing) {
     json receiver_invalid_params = receiver_params_;
     receiver_invalid_params["paillier_params"]["apply_packing"] = false;
@@ -584,6 +1288,132 @@ TEST_F(DPCAPSITest, inconsistent_statistical_security) {
     t_[1].join();
 }
 
+TEST_F(DPCAPSITest, inconsistent_damgard_jurik_s) {
+    json receiver_invalid_params = receiver_params_;
+    receiver_invalid_params["paillier_params"]["damgard_jurik_s"] = 2;
+    std::vector<std::vector<std::uint64_t>> shares_0;
+    std::vector<std::vector<std::uint64_t>> shares_1;
+
+    t_[0] = std::thread([this, &shares_0]() {
+        EXPECT_THROW(dpca_psi_random(sender_params_, 1, 1, shares_0), std::invalid_argument);
+    });
+    t_[1] = std::thread([this, &shares_1, &receiver_invalid_params]() {
+        EXPECT_THROW(dpca_psi_random(receiver_invalid_params, 1, 2, shares_1), std::invalid_argument);
+    });
+
+    t_[0].join();
+    t_[1].join();
+}
+
+TEST_F(DPCAPSITest, inconsistent_feature_sharing) {
+    json receiver_invalid_params = receiver_params_;
+    receiver_invalid_params["common"]["feature_sharing"] = "ot";
+    std::vector<std::vector<std::uint64_t>> shares_0;
+    std::vector<std::vector<std::uint64_t>> shares_1;
+
+    t_[0] = std::thread([this, &shares_0]() {
+        EXPECT_THROW(dpca_psi_random(sender_params_, 1, 1, shares_0), std::invalid_argument);
+    });
+    t_[1] = std::thread([this, &shares_1, &receiver_invalid_params]() {
+        EXPECT_THROW(dpca_psi_random(receiver_invalid_params, 1, 2, shares_1), std::invalid_argument);
+    });
+
+    t_[0].join();
+    t_[1].join();
+}
+
+TEST_F(DPCAPSITest, inconsistent_point_compression) {
+    json receiver_invalid_params = receiver_params_;
+    receiver_invalid_params["ecc_params"]["point_compression"] = "uncompressed";
+    std::vector<std::vector<std::uint64_t>> shares_0;
+    std::vector<std::vector<std::uint64_t>> shares_1;
+
+    t_[0] = std::thread([this, &shares_0]() {
+        EXPECT_THROW(dpca_psi_random(sender_params_, 1, 1, shares_0), std::invalid_argument);
+    });
+    t_[1] = std::thread([this, &shares_1, &receiver_invalid_params]() {
+        EXPECT_THROW(dpca_psi_random(receiver_invalid_params, 1, 2, shares_1), std::invalid_argument);
+    });
+
+    t_[0].join();
+    t_[1].join();
+}
+
+TEST_F(DPCAPSITest, unexpected_feature_sharing) {
+    json receiver_invalid_params = receiver_params_;
+    json sender_invalid_params = sender_params_;
+    receiver_invalid_params["common"]["feature_sharing"] = "cot";
+    sender_invalid_params["common"]["feature_sharing"] = "cot";
+    std::vector<std::vector<std::uint64_t>> shares_0;
+    std::vector<std::vector<std::uint64_t>> shares_1;
+
+    t_[0] = std::thread([this, &shares_0, &sender_invalid_params]() {
+        EXPECT_THROW(dpca_psi_random(sender_invalid_params, 1, 1, shares_0), std::invalid_argument);
+    });
+    t_[1] = std::thread([this, &shares_1, &receiver_invalid_params]() {
+        EXPECT_THROW(dpca_psi_random(receiver_invalid_params, 1, 2, shares_1), std::invalid_argument);
+    });
+
+    t_[0].join();
+    t_[1].join();
+}
+
+TEST_F(DPCAPSITest, unexpected_group_num) {
+    json receiver_invalid_params = receiver_params_;
+    json sender_invalid_params = sender_params_;
+    receiver_invalid_params["aggregate_params"]["group_column"] = 0;
+    receiver_invalid_params["aggregate_params"]["group_num"] = 0;
+    sender_invalid_params["aggregate_params"]["group_column"] = 0;
+    sender_invalid_params["aggregate_params"]["group_num"] = 65537;
+    std::vector<std::vector<std::uint64_t>> shares_0;
+    std::vector<std::vector<std::uint64_t>> shares_1;
+
+    t_[0] = std::thread([this, &shares_0, &sender_invalid_params]() {
+        EXPECT_THROW(dpca_psi_random(sender_invalid_params, 1, 1, shares_0), std::invalid_argument);
+    });
+    t_[1] = std::thread([this, &shares_1, &receiver_invalid_params]() {
+        EXPECT_THROW(dpca_psi_random(receiver_invalid_params, 1, 2, shares_1), std::invalid_argument);
+    });
+
+    t_[0].join();
+    t_[1].join();
+}
+
+TEST_F(DPCAPSITest, unexpected_feature_bits) {
+    json receiver_invalid_params = receiver_params_;
+    json sender_invalid_params = sender_params_;
+    receiver_invalid_params["common"]["feature_bits"] = {0};
+    sender_invalid_params["common"]["feature_bits"] = {65};
+    std::vector<std::vector<std::uint64_t>> shares_0;
+    std::vector<std::vector<std::uint64_t>> shares_1;
+
+    t_[0] = std::thread([this, &shares_0, &sender_invalid_params]() {
+        EXPECT_THROW(dpca_psi_random(sender_invalid_params, 1, 1, shares_0), std::invalid_argument);
+    });
+    t_[1] = std::thread([this, &shares_1, &receiver_invalid_params]() {
+        EXPECT_THROW(dpca_psi_random(receiver_invalid_params, 1, 2, shares_1), std::invalid_argument);
+    });
+
+    t_[0].join();
+    t_[1].join();
+}
+
+TEST_F(DPCAPSITest, mismatched_feature_bits) {
+    json sender_invalid_params = sender_params_;
+    json receiver_invalid_params = receiver_params_;
+    sender_invalid_params["common"]["feature_bits"] = {8, 8};
+
+    t_[0] = std::thread([this, &sender_invalid_params]() {
+        EXPECT_THROW(dpca_psi_default(sender_invalid_params, 0), std::invalid_argument);
+    });
+    t_[1] = std::thread([this, &receiver_invalid_params]() {
+        EXPECT_THROW(dpca_psi_default(receiver_invalid_params, 1), std::invalid_argument);
+    });
+
+    t_[0].join();
+    t_[1].join();
+}
+
 TEST_F(DPCAPSITest, unexpected_statistical_security) {
     json receiver_invalid_params = receiver_params_;
     json sender_invalid_params = sender_params_;
@@ -0,0 +1,205 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/async_net_io.h"
+
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/network/memory_net_io.h"
+#include "dpca-psi/network/two_channel_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class AsyncNetIOTest : public ::testing::Test {
+public:
+    void SetUp() {
+    }
+
+    static std::shared_ptr<AsyncNetIO> connect(std::uint16_t remote_port, std::uint16_t local_port,
+            std::size_t max_pending_bytes) {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", remote_port, local_port);
+        return std::make_shared<AsyncNetIO>(net, max_pending_bytes);
+    }
+
+    std::thread t_[2];
+    std::vector<std::uint64_t> send_bytes_count_ = {0, 0};
+    std::vector<std::uint64_t> recv_bytes_count_ = {0, 0};
+    std::vector<std::uint64_t> expected_send_bytes_count_ = {0, 0};
+    std::vector<std::uint64_t> expected_recv_bytes_count_ = {0, 0};
+};
+
+TEST_F(AsyncNetIOTest, send_value_and_bytes) {
+    std::vector<std::size_t> send_data = {100, 200};
+    std::vector<std::size_t> recv_data = {0, 0};
+    std::vector<ByteVector> send_bytes = {{Byte(0), Byte(1)}, {Byte(2), Byte(3)}};
+    std::vector<ByteVector> recv_bytes(2);
+
+    t_[0] = std::thread([this, send_data, send_bytes, &recv_data, &recv_bytes]() {
+        auto net = connect(30330, 30331, AsyncNetIO::kDefaultMaxPendingBytes);
+        net->send_value<std::size_t>(send_data[0]);
+        net->send_bytes(send_bytes[0]);
+        recv_data[1] = net->recv_value<std::size_t>();
+        net->recv_bytes(recv_bytes[1]);
+        net->flush();
+        send_bytes_count_[0] = net->get_bytes_sent();
+        recv_bytes_count_[0] = net->get_bytes_received();
+    });
+    t_[1] = std::thread([this, send_data, send_bytes, &recv_data, &recv_bytes]() {
+        auto net = connect(30331, 30330, AsyncNetIO::kDefaultMaxPendingBytes);
+        net->send_value<std::size_t>(send_data[1]);
+        net->send_bytes(send_bytes[1]);
+        recv_data[0] = net->recv_value<std::size_t>();
+        net->recv_bytes(recv_bytes[0]);
+        net->flush();
+        send_bytes_count_[1] = net->get_bytes_sent();
+        recv_bytes_count_[1] = net->get_bytes_received();
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    std::uint64_t expected_bytes_count = 2 + 2 * sizeof(std::size_t);
+    expected_send_bytes_count_ = {expected_bytes_count, expected_bytes_count};
+    expected_recv_bytes_count_ = {expected_bytes_count, expected_bytes_count};
+
+    ASSERT_EQ(send_data, recv_data);
+    ASSERT_EQ(send_bytes, recv_bytes);
+    ASSERT_EQ(send_bytes_count_, expected_send_bytes_count_);
+    ASSERT_EQ(recv_bytes_count_, expected_recv_bytes_count_);
+}
+
+// Both parties send a message far beyond the socket buffers before receiving, which needs the background writer.
+TEST_F(AsyncNetIOTest, send_before_recv) {
+    std::size_t size = std::size_t(1) << 24;
+    std::vector<std::vector<std::uint8_t>> send_data(2, std::vector<std::uint8_t>(size));
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        send_data[0][idx] = static_cast<std::uint8_t>(idx);
+        send_data[1][idx] = static_cast<std::uint8_t>(idx * 7);
+    }
+    std::vector<std::vector<std::uint8_t>> recv_data(2, std::vector<std::uint8_t>(size));
+
+    t_[0] = std::thread([&send_data, &recv_data, size]() {
+        auto net = connect(30330, 30331, 2 * size);
+        net->send_data(send_data[0].data(), size);
+        net->recv_data(recv_data[1].data(), size);
+    });
+    t_[1] = std::thread([&send_data, &recv_data, size]() {
+        auto net = connect(30331, 30330, 2 * size);
+        net->send_data(send_data[1].data(), size);
+        net->recv_data(recv_data[0].data(), size);
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    ASSERT_EQ(send_data, recv_data);
+}
+
+TEST_F(AsyncNetIOTest, recv_data_async) {
+    std::size_t num = 64;
+    std::vector<std::vector<std::uint64_t>> send_data(2);
+    std::vector<std::vector<std::uint64_t>> recv_data(2, std::vector<std::uint64_t>(num, 0));
+    for (std::size_t idx = 0; idx < num; ++idx) {
+        send_data[0].emplace_back(idx);
+        send_data[1].emplace_back(idx + num);
+    }
+
+    t_[0] = std::thread([this, &send_data, &recv_data, num]() {
+        auto net = connect(30330, 30331, AsyncNetIO::kDefaultMaxPendingBytes);
+        std::vector<std::future<void>> receiving;
+        for (std::size_t idx = 0; idx < num; ++idx) {
+            receiving.emplace_back(net->recv_data_async(&recv_data[1][idx], sizeof(std::uint64_t)));
+        }
+        for (std::size_t idx = 0; idx < num; ++idx) {
+            net->send_value<std::uint64_t>(send_data[0][idx]);
+        }
+        for (auto& done : receiving) {
+            done.get();
+        }
+        recv_bytes_count_[0] = net->get_bytes_received();
+    });
+    t_[1] = std::thread([this, &send_data, &recv_data, num]() {
+        auto net = connect(30331, 30330, AsyncNetIO::kDefaultMaxPendingBytes);
+        std::vector<std::future<void>> receiving;
+        for (std::size_t idx = 0; idx < num; ++idx) {
+            receiving.emplace_back(net->recv_data_async(&recv_data[0][idx], sizeof(std::uint64_t)));
+        }
+        for (std::size_t idx = 0; idx < num; ++idx) {
+            net->send_value<std::uint64_t>(send_data[1][idx]);
+        }
+        for (auto& done : receiving) {
+            done.get();
+        }
+        recv_bytes_count_[1] = net->get_bytes_received();
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    expected_recv_bytes_count_ = {num * sizeof(std::uint64_t), num * sizeof(std::uint64_t)};
+
+    ASSERT_EQ(send_data, recv_data);
+    ASSERT_EQ(recv_bytes_count_, expected_recv_bytes_count_);
+}
+
+TEST_F(AsyncNetIOTest, recv_data_vector_async) {
+    std::vector<ByteVector> send_data = {{Byte(1), Byte(2)}, {Byte(3), Byte(4)}, {Byte(5), Byte(6)}};
+    std::vector<ByteVector> recv_data(send_data.size(), ByteVector(2));
+    std::size_t len = 0;
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    auto net = std::make_shared<AsyncNetIO>(nets.first, AsyncNetIO::kDefaultMaxPendingBytes);
+
+    std::vector<iovec> spans;
+    for (auto& element : recv_data) {
+        spans.push_back({element.data(), element.size()});
+    }
+    std::future<void> len_received = net->recv_data_async(&len, sizeof(len));
+    std::future<void> data_received = net->recv_data_vector_async(spans.data(), spans.size());
+    nets.second->send_bytes_vector(send_data);
+    nets.second->flush();
+    len_received.get();
+    data_received.get();
+
+    ASSERT_EQ(len, 6);
+    ASSERT_EQ(send_data, recv_data);
+    ASSERT_EQ(net->get_bytes_received(), sizeof(len) + 6);
+}
+
+// A party that fails in the middle of an exchange shuts the connection down, which fails the receives of both.
+TEST_F(AsyncNetIOTest, shutdown) {
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    auto net = std::make_shared<AsyncNetIO>(nets.first, AsyncNetIO::kDefaultMaxPendingBytes);
+    std::uint64_t value = 0;
+    std::future<void> receiving = net->recv_data_async(&value, sizeof(value));
+    std::thread other([&nets]() { EXPECT_THROW(nets.second->recv_value<std::uint64_t>(), std::runtime_error); });
+
+    net->shutdown();
+    EXPECT_THROW(receiving.get(), std::runtime_error);
+    EXPECT_THROW(net->recv_value<std::uint64_t>(), std::runtime_error);
+    other.join();
+}
+
+TEST_F(AsyncNetIOTest, null_io) {
+    EXPECT_THROW(AsyncNetIO(nullptr, AsyncNetIO::kDefaultMaxPendingBytes), std::invalid_argument);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
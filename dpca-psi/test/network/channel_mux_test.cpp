@@ -0,0 +1,155 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/channel_mux.h"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/network/memory_net_io.h"
+#include "dpca-psi/network/two_channel_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class ChannelMuxTest : public ::testing::Test {
+public:
+    void SetUp() {
+    }
+
+    static std::vector<std::uint64_t> make_data(std::size_t size, std::uint64_t seed) {
+        std::vector<std::uint64_t> data(size);
+        for (std::size_t idx = 0; idx < size; ++idx) {
+            data[idx] = seed * size + idx;
+        }
+        return data;
+    }
+
+    std::thread t_[2];
+};
+
+TEST_F(ChannelMuxTest, concurrent_channels) {
+    std::size_t channel_num = 4;
+    std::size_t data_size = 100000;
+    std::vector<std::vector<std::vector<std::uint64_t>>> recv_data(
+            2, std::vector<std::vector<std::uint64_t>>(channel_num, std::vector<std::uint64_t>(data_size)));
+
+    // every channel has a thread that sends a message and receives the other party's one on the same channel.
+    auto run = [&](std::size_t party, std::uint16_t remote_port, std::uint16_t local_port) {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", remote_port, local_port);
+        auto mux = std::make_shared<ChannelMux>(net, 4096);
+        std::vector<std::thread> threads;
+        for (std::size_t tag = 0; tag < channel_num; ++tag) {
+            auto channel = mux->open_channel(static_cast<std::uint32_t>(tag));
+            threads.emplace_back([&, party, tag, channel]() {
+                std::vector<std::uint64_t> send_data = make_data(data_size, party * channel_num + tag);
+                std::thread sender([&]() {
+                    channel->send_data(send_data.data(), data_size * sizeof(std::uint64_t));
+                    channel->flush();
+                });
+                channel->recv_data(recv_data[party][tag].data(), data_size * sizeof(std::uint64_t));
+                sender.join();
+                EXPECT_EQ(channel->get_bytes_sent(), data_size * sizeof(std::uint64_t));
+                EXPECT_EQ(channel->get_bytes_received(), data_size * sizeof(std::uint64_t));
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+    t_[0] = std::thread(run, 0, 30330, 30331);
+    t_[1] = std::thread(run, 1, 30331, 30330);
+
+    t_[0].join();
+    t_[1].join();
+
+    for (std::size_t party = 0; party < 2; ++party) {
+        for (std::size_t tag = 0; tag < channel_num; ++tag) {
+            EXPECT_EQ(recv_data[party][tag], make_data(data_size, (1 - party) * channel_num + tag));
+        }
+    }
+}
+
+TEST_F(ChannelMuxTest, unread_channel_does_not_block_others) {
+    std::size_t data_size = 100000;
+    std::size_t round_num = 100;
+    std::vector<std::uint64_t> bulk = make_data(data_size, 1);
+    std::vector<std::uint64_t> recv_bulk(data_size);
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+
+    // the bulk transfer on channel 1 outgrows the window and stalls, while channel 2 ping-pongs. The bulk is read
+    // only after the ping-pong.
+    t_[0] = std::thread([&]() {
+        auto mux = std::make_shared<ChannelMux>(nets.first, 1024);
+        auto bulk_channel = mux->open_channel(1);
+        auto ping_channel = mux->open_channel(2);
+        std::thread bulk_sender([&]() { bulk_channel->send_data(bulk.data(), data_size * sizeof(std::uint64_t)); });
+        for (std::size_t round = 0; round < round_num; ++round) {
+            ping_channel->send_value<std::uint64_t>(round);
+            EXPECT_EQ(ping_channel->recv_value<std::uint64_t>(), round + 1);
+        }
+        bulk_sender.join();
+    });
+    t_[1] = std::thread([&]() {
+        auto mux = std::make_shared<ChannelMux>(nets.second, 1024);
+        auto bulk_channel = mux->open_channel(1);
+        auto ping_channel = mux->open_channel(2);
+        for (std::size_t round = 0; round < round_num; ++round) {
+            ping_channel->send_value<std::uint64_t>(ping_channel->recv_value<std::uint64_t>() + 1);
+        }
+        bulk_channel->recv_data(recv_bulk.data(), data_size * sizeof(std::uint64_t));
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(recv_bulk, bulk);
+}
+
+TEST_F(ChannelMuxTest, peer_without_mux) {
+    // the other party never closes a mux, so the destructor gives up after the timeout instead of hanging.
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    auto start = std::chrono::steady_clock::now();
+    {
+        auto mux = std::make_shared<ChannelMux>(nets.first, ChannelMux::kDefaultWindowSize);
+        auto channel = mux->open_channel(0);
+        channel->send_value<std::uint64_t>(1);
+    }
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(ChannelMux::kCloseTimeoutMs));
+    EXPECT_THROW(nets.first->send_value<std::uint64_t>(1), std::runtime_error);
+}
+
+TEST_F(ChannelMuxTest, invalid_arguments) {
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    EXPECT_THROW(ChannelMux(nullptr, ChannelMux::kDefaultWindowSize), std::invalid_argument);
+    EXPECT_THROW(ChannelMux(nets.first, 0), std::invalid_argument);
+    t_[0] = std::thread([&]() {
+        auto mux = std::make_shared<ChannelMux>(nets.first, ChannelMux::kDefaultWindowSize);
+        auto channel = mux->open_channel(0);
+        EXPECT_THROW(mux->open_channel(0), std::logic_error);
+    });
+    t_[1] = std::thread(
+            [&]() { auto mux = std::make_shared<ChannelMux>(nets.second, ChannelMux::kDefaultWindowSize); });
+
+    t_[0].join();
+    t_[1].join();
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
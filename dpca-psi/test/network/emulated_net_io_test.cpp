@@ -0,0 +1,131 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/emulated_net_io.h"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/common/utils.h"
+#include "dpca-psi/network/memory_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class EmulatedNetIOTest : public ::testing::Test {
+public:
+    void SetUp() {
+        auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+        nets_[0] = nets.first;
+        nets_[1] = nets.second;
+    }
+
+    std::shared_ptr<MemoryNetIO> nets_[2];
+    std::thread t_[2];
+};
+
+TEST_F(EmulatedNetIOTest, latency) {
+    std::size_t round_num = 5;
+    std::chrono::microseconds latency(10000);
+    std::int64_t duration = 0;
+
+    t_[0] = std::thread([this, round_num, latency, &duration]() {
+        EmulatedNetIO net(nets_[0], 0, latency, std::chrono::microseconds(0));
+        auto start = clock_start();
+        for (std::size_t round = 0; round < round_num; ++round) {
+            net.send_value<std::uint64_t>(round);
+            EXPECT_EQ(net.recv_value<std::uint64_t>(), round + 1);
+        }
+        duration = time_from(start);
+    });
+    t_[1] = std::thread([this, round_num, latency]() {
+        EmulatedNetIO net(nets_[1], 0, latency, std::chrono::microseconds(0));
+        for (std::size_t round = 0; round < round_num; ++round) {
+            net.send_value<std::uint64_t>(net.recv_value<std::uint64_t>() + 1);
+        }
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    // every round trip crosses the link twice.
+    EXPECT_GE(duration, static_cast<std::int64_t>(round_num) * 2 * latency.count());
+}
+
+TEST_F(EmulatedNetIOTest, bandwidth) {
+    // 2^20 bytes take 100 ms at 83.9 Mbit/s.
+    std::vector<std::uint8_t> send_data(std::size_t(1) << 20, 1);
+    std::vector<std::uint8_t> recv_data(send_data.size());
+    std::uint64_t bandwidth_bps = send_data.size() * 8 * 10;
+    std::int64_t duration = 0;
+
+    t_[0] = std::thread([this, bandwidth_bps, &send_data]() {
+        EmulatedNetIO net(nets_[0], bandwidth_bps, std::chrono::microseconds(0), std::chrono::microseconds(0));
+        // sent in small pieces, which must not add up rounding errors.
+        for (std::size_t offset = 0; offset < send_data.size(); offset += 1000) {
+            net.send_data(send_data.data() + offset, std::min<std::size_t>(1000, send_data.size() - offset));
+        }
+    });
+    t_[1] = std::thread([this, &recv_data, &duration]() {
+        auto start = clock_start();
+        nets_[1]->recv_data(recv_data.data(), recv_data.size());
+        duration = time_from(start);
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(send_data, recv_data);
+    EXPECT_GE(duration, 95000);
+}
+
+TEST_F(EmulatedNetIOTest, jitter_keeps_order) {
+    std::size_t message_num = 200;
+    std::vector<std::uint64_t> recv_data(message_num);
+
+    t_[0] = std::thread([this, message_num]() {
+        EmulatedNetIO net(nets_[0], 0, std::chrono::microseconds(100), std::chrono::microseconds(2000));
+        for (std::uint64_t idx = 0; idx < message_num; ++idx) {
+            net.send_value<std::uint64_t>(idx);
+        }
+        net.flush();
+        EXPECT_EQ(net.get_bytes_sent(), message_num * sizeof(std::uint64_t));
+    });
+    t_[1] = std::thread([this, message_num, &recv_data]() {
+        for (std::size_t idx = 0; idx < message_num; ++idx) {
+            recv_data[idx] = nets_[1]->recv_value<std::uint64_t>();
+        }
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    for (std::uint64_t idx = 0; idx < message_num; ++idx) {
+        ASSERT_EQ(recv_data[idx], idx);
+    }
+}
+
+TEST_F(EmulatedNetIOTest, invalid_arguments) {
+    std::chrono::microseconds zero(0);
+    EXPECT_THROW(EmulatedNetIO(nullptr, 0, zero, zero), std::invalid_argument);
+    EXPECT_THROW(EmulatedNetIO(nets_[0], 0, std::chrono::microseconds(-1), zero), std::invalid_argument);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,130 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/encrypted_net_io.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/network/memory_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class EncryptedNetIOTest : public ::testing::Test {
+public:
+    void SetUp() {
+        auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+        nets_[0] = nets.first;
+        nets_[1] = nets.second;
+    }
+
+    static ByteVector generate_data(std::size_t nbyte, std::size_t seed) {
+        ByteVector data(nbyte);
+        for (std::size_t i = 0; i < nbyte; ++i) {
+            data[i] = Byte((i * 7 + seed) & 0xff);
+        }
+        return data;
+    }
+
+    std::shared_ptr<MemoryNetIO> nets_[2];
+    const ByteVector pre_shared_key_ = ByteVector(32, Byte(1));
+};
+
+TEST_F(EncryptedNetIOTest, send_and_recv) {
+    ByteVector sent_data = generate_data(1000, 1);
+    ByteVector replied_data = generate_data(300, 2);
+    std::thread peer([this, &sent_data, &replied_data]() {
+        EncryptedNetIO net(nets_[1], false, pre_shared_key_, 64);
+        EXPECT_EQ(net.recv_value<std::uint64_t>(), 42);
+        // receives do not have to follow the records.
+        ByteVector data(sent_data.size());
+        net.recv_data(data.data(), 10);
+        net.recv_data(data.data() + 10, 500);
+        net.recv_data(data.data() + 510, 490);
+        EXPECT_EQ(data, sent_data);
+        net.send_bytes(replied_data);
+        net.flush();
+    });
+    EncryptedNetIO net(nets_[0], true, pre_shared_key_, 64);
+    net.send_value<std::uint64_t>(42);
+    net.send_data(sent_data.data(), sent_data.size());
+    net.flush();
+    ByteVector data;
+    net.recv_bytes(data);
+    EXPECT_EQ(data, replied_data);
+    peer.join();
+
+    // every record carries a length and a tag.
+    EXPECT_EQ(net.get_bytes_sent(), sizeof(std::uint64_t) + sent_data.size());
+    EXPECT_GT(nets_[0]->get_bytes_sent(), net.get_bytes_sent() + 16 * (sent_data.size() / 64));
+}
+
+TEST_F(EncryptedNetIOTest, large_message) {
+    ByteVector sent_data = generate_data(3 * EncryptedNetIO::kDefaultRecordSize + 5, 3);
+    std::thread peer([this, &sent_data]() {
+        EncryptedNetIO net(nets_[1], false, {});
+        ByteVector data;
+        net.recv_bytes(data);
+        EXPECT_EQ(data, sent_data);
+    });
+    EncryptedNetIO net(nets_[0], true, {});
+    net.send_bytes(sent_data);
+    net.flush();
+    peer.join();
+}
+
+TEST_F(EncryptedNetIOTest, ciphertext_differs) {
+    ByteVector sent_data = generate_data(256, 4);
+    ByteVector wire_data;
+    std::thread peer([this, &wire_data]() {
+        // plays the other party of the key exchange, then reads the ciphertext.
+        ByteVector public_key;
+        nets_[1]->recv_bytes(public_key);
+        nets_[1]->send_bytes(ByteVector(32, Byte(9)));
+        nets_[1]->flush();
+        wire_data.resize(sizeof(std::uint32_t) + 256 + 16);
+        nets_[1]->recv_data(wire_data.data(), wire_data.size());
+    });
+    EncryptedNetIO net(nets_[0], true, {});
+    net.send_data(sent_data.data(), sent_data.size());
+    net.flush();
+    peer.join();
+    EXPECT_EQ(std::search(wire_data.begin(), wire_data.end(), sent_data.begin(), sent_data.begin() + 16),
+            wire_data.end());
+}
+
+TEST_F(EncryptedNetIOTest, mismatched_pre_shared_key) {
+    std::thread peer([this]() {
+        EncryptedNetIO net(nets_[1], false, ByteVector(32, Byte(2)));
+        EXPECT_THROW(net.recv_value<std::uint64_t>(), std::runtime_error);
+    });
+    EncryptedNetIO net(nets_[0], true, pre_shared_key_);
+    net.send_value<std::uint64_t>(42);
+    net.flush();
+    peer.join();
+}
+
+TEST_F(EncryptedNetIOTest, invalid_record_size) {
+    EXPECT_THROW(EncryptedNetIO(nets_[0], true, {}, 0), std::invalid_argument);
+    EXPECT_THROW(EncryptedNetIO(nets_[0], true, {}, EncryptedNetIO::kMaxRecordSize + 1), std::invalid_argument);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,88 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/link_tuner.h"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/network/emulated_net_io.h"
+#include "dpca-psi/network/memory_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+TEST(LinkTunerTest, probe_emulated_link) {
+    // 10 ms round trips at 10^7 bytes per second.
+    std::uint64_t bandwidth_bps = 80000000;
+    std::chrono::microseconds latency(5000);
+    std::chrono::microseconds jitter(0);
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    LinkProfile profiles[2];
+
+    std::thread other([&]() {
+        auto net = std::make_shared<EmulatedNetIO>(nets.second, bandwidth_bps, latency, jitter);
+        profiles[1] = LinkTuner::probe(false, net, 4, std::size_t(1) << 20);
+    });
+    auto net = std::make_shared<EmulatedNetIO>(nets.first, bandwidth_bps, latency, jitter);
+    profiles[0] = LinkTuner::probe(true, net, 4, std::size_t(1) << 20);
+    other.join();
+
+    EXPECT_EQ(profiles[0].rtt, profiles[1].rtt);
+    EXPECT_EQ(profiles[0].throughput, profiles[1].throughput);
+    EXPECT_GE(profiles[0].rtt, 0.01);
+    EXPECT_LT(profiles[0].rtt, 0.05);
+    EXPECT_GT(profiles[0].throughput, 5e6);
+    EXPECT_LT(profiles[0].throughput, 1.5e7);
+}
+
+TEST(LinkTunerTest, tune) {
+    LinkProfile wan;
+    wan.rtt = 0.05;
+    wan.throughput = 1.25e6;
+    LinkTuning tuning = LinkTuner::tune(wan);
+    EXPECT_EQ(tuning.chunk_size, LinkTuner::kMinChunkSize);
+    EXPECT_EQ(tuning.socket_buffer_size, 0);
+    EXPECT_TRUE(tuning.compress_points);
+
+    // a long fat link needs more than the autotuning reaches.
+    LinkProfile long_fat;
+    long_fat.rtt = 0.1;
+    long_fat.throughput = 1e8;
+    tuning = LinkTuner::tune(long_fat);
+    EXPECT_EQ(tuning.chunk_size, 2000000);
+    EXPECT_EQ(tuning.socket_buffer_size, 20000000);
+    EXPECT_TRUE(tuning.compress_points);
+
+    LinkProfile lan;
+    lan.rtt = 1e-4;
+    lan.throughput = 1.25e9;
+    tuning = LinkTuner::tune(lan);
+    EXPECT_EQ(tuning.chunk_size, LinkTuner::kMaxChunkSize);
+    EXPECT_EQ(tuning.socket_buffer_size, 0);
+    EXPECT_FALSE(tuning.compress_points);
+}
+
+TEST(LinkTunerTest, invalid_arguments) {
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    EXPECT_THROW(LinkTuner::probe(true, nets.first, 0), std::invalid_argument);
+    EXPECT_THROW(LinkTuner::probe(true, nets.first, 4, 0), std::invalid_argument);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
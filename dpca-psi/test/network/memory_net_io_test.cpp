@@ -0,0 +1,217 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/memory_net_io.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/common/utils.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class MemoryNetIOTest : public ::testing::Test {
+public:
+    void SetUp() {
+    }
+
+    std::thread t_[2];
+    std::vector<std::uint64_t> send_bytes_count_ = {0, 0};
+    std::vector<std::uint64_t> recv_bytes_count_ = {0, 0};
+};
+
+TEST_F(MemoryNetIOTest, send_value_and_bytes) {
+    std::vector<std::size_t> send_data = {100, 200};
+    std::vector<std::size_t> recv_data = {0, 0};
+    std::vector<ByteVector> send_bytes = {{Byte(0), Byte(1)}, {Byte(2), Byte(3)}};
+    std::vector<ByteVector> recv_bytes(2);
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+
+    t_[0] = std::thread([this, send_data, send_bytes, &recv_data, &recv_bytes, &nets]() {
+        auto net = nets.first;
+        net->send_value<std::size_t>(send_data[0]);
+        net->send_bytes(send_bytes[0]);
+        recv_data[1] = net->recv_value<std::size_t>();
+        net->recv_bytes(recv_bytes[1]);
+        send_bytes_count_[0] = net->get_bytes_sent();
+        recv_bytes_count_[0] = net->get_bytes_received();
+    });
+    t_[1] = std::thread([this, send_data, send_bytes, &recv_data, &recv_bytes, &nets]() {
+        auto net = nets.second;
+        recv_data[0] = net->recv_value<std::size_t>();
+        net->recv_bytes(recv_bytes[0]);
+        net->send_value<std::size_t>(send_data[1]);
+        net->send_bytes(send_bytes[1]);
+        send_bytes_count_[1] = net->get_bytes_sent();
+        recv_bytes_count_[1] = net->get_bytes_received();
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    std::uint64_t expected_bytes_count = 2 + 2 * sizeof(std::size_t);
+    for (std::size_t i = 0; i < 2; ++i) {
+        EXPECT_EQ(send_data[i], recv_data[i]);
+        EXPECT_EQ(send_bytes[i], recv_bytes[i]);
+        EXPECT_EQ(send_bytes_count_[i], expected_bytes_count);
+        EXPECT_EQ(recv_bytes_count_[i], expected_bytes_count);
+    }
+}
+
+TEST_F(MemoryNetIOTest, messages_larger_than_capacity) {
+    std::size_t data_size = 1000003;
+    std::vector<std::vector<std::uint8_t>> send_data(2, std::vector<std::uint8_t>(data_size));
+    for (std::size_t i = 0; i < data_size; ++i) {
+        send_data[0][i] = static_cast<std::uint8_t>(i * 7 + 1);
+        send_data[1][i] = static_cast<std::uint8_t>(i * 13 + 5);
+    }
+    std::vector<std::vector<std::uint8_t>> recv_data(2, std::vector<std::uint8_t>(data_size));
+    // a capacity of 1000 is rounded up to 1024 bytes.
+    auto nets = MemoryNetIO::create_pair(1000);
+
+    // both parties send at the same time, each message wraps around the rings many times.
+    auto run = [&](std::size_t party, std::shared_ptr<MemoryNetIO> net) {
+        std::thread sender([&]() { net->send_data(send_data[party].data(), data_size); });
+        net->recv_data(recv_data[1 - party].data(), data_size);
+        sender.join();
+    };
+    t_[0] = std::thread(run, 0, nets.first);
+    t_[1] = std::thread(run, 1, nets.second);
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(send_data[0], recv_data[0]);
+    EXPECT_EQ(send_data[1], recv_data[1]);
+}
+
+TEST_F(MemoryNetIOTest, send_bytes_vector) {
+    // without scatter-gather I/O, the elements are staged in one buffer.
+    std::vector<ByteVector> send_data = {{Byte(0), Byte(1)}, {Byte(2), Byte(3)}, {Byte(4), Byte(5)}};
+    std::vector<ByteVector> recv_data;
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+
+    nets.first->send_bytes_vector(send_data);
+    nets.second->recv_bytes_vector(recv_data, 2);
+    EXPECT_EQ(send_data, recv_data);
+    EXPECT_EQ(nets.second->get_bytes_received(), sizeof(std::size_t) + 6);
+
+    nets.first->send_bytes(ByteVector(5));
+    EXPECT_THROW(nets.second->recv_bytes_vector(recv_data, 2), std::runtime_error);
+}
+
+TEST_F(MemoryNetIOTest, phase_traffic) {
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    auto net = nets.first;
+    net->send_value<std::uint64_t>(1);
+    {
+        ScopedIOPhase io_phase(net, "keys");
+        net->send_bytes(ByteVector(10));
+        ScopedIOPhase nested_io_phase(net, "round");
+        EXPECT_EQ(net->get_phase(), "keys/round");
+        net->send_value<std::uint64_t>(2);
+    }
+    EXPECT_EQ(net->get_phase(), "");
+
+    // the time waiting for the peer is accounted to the receive.
+    std::thread peer([&nets]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        nets.second->send_value<std::uint64_t>(3);
+    });
+    EXPECT_EQ(net->set_phase("wait"), "");
+    EXPECT_EQ(net->recv_value<std::uint64_t>(), 3);
+    peer.join();
+
+    auto traffic = net->get_phase_traffic();
+    ASSERT_EQ(traffic.size(), 4);
+    EXPECT_EQ(traffic[0].first, "");
+    EXPECT_EQ(traffic[0].second.bytes_sent, sizeof(std::uint64_t));
+    EXPECT_EQ(traffic[0].second.messages_sent, 1);
+    EXPECT_EQ(traffic[1].first, "keys");
+    EXPECT_EQ(traffic[1].second.bytes_sent, sizeof(std::size_t) + 10);
+    EXPECT_EQ(traffic[1].second.messages_sent, 2);
+    EXPECT_EQ(traffic[2].first, "keys/round");
+    EXPECT_EQ(traffic[2].second.bytes_sent, sizeof(std::uint64_t));
+    EXPECT_EQ(traffic[3].first, "wait");
+    EXPECT_EQ(traffic[3].second.bytes_received, sizeof(std::uint64_t));
+    EXPECT_EQ(traffic[3].second.messages_received, 1);
+    EXPECT_GE(traffic[3].second.recv_time, std::chrono::milliseconds(20));
+    EXPECT_GT(traffic[3].second.get_blocked_ratio(), 0.5);
+    EXPECT_GT(traffic[3].second.get_throughput(), 0);
+    EXPECT_NE(net->get_traffic_report().find("keys/round"), std::string::npos);
+}
+
+TEST_F(MemoryNetIOTest, closed_peer) {
+    auto nets = MemoryNetIO::create_pair(16);
+    auto net = nets.first;
+    nets.second->send_value<std::uint64_t>(1);
+    nets.second.reset();
+
+    // bytes sent before the peer is closed can still be received.
+    EXPECT_EQ(net->recv_value<std::uint64_t>(), 1);
+    EXPECT_THROW(net->recv_value<std::uint64_t>(), std::runtime_error);
+    EXPECT_THROW(net->send_value<std::uint64_t>(1), std::runtime_error);
+}
+
+TEST_F(MemoryNetIOTest, sleeping_receiver) {
+    auto nets = MemoryNetIO::create_pair(16);
+    // the receivers sleep long before the send and the shutdown wake them up.
+    t_[0] = std::thread([&nets]() {
+        EXPECT_EQ(nets.second->recv_value<std::uint64_t>(), 1);
+        EXPECT_THROW(nets.second->recv_value<std::uint64_t>(), std::runtime_error);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    nets.first->send_value<std::uint64_t>(1);
+    nets.first->flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    nets.first->shutdown();
+    t_[0].join();
+}
+
+TEST_F(MemoryNetIOTest, invalid_capacity) {
+    EXPECT_THROW(MemoryNetIO::create_pair(0), std::invalid_argument);
+}
+
+TEST_F(MemoryNetIOTest, bench_round_trip) {
+    std::size_t round_num = 100000;
+    auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+    auto start = clock_start();
+    t_[0] = std::thread([&]() {
+        for (std::size_t i = 0; i < round_num; ++i) {
+            nets.first->send_value<std::uint64_t>(i);
+            EXPECT_EQ(nets.first->recv_value<std::uint64_t>(), i);
+        }
+    });
+    t_[1] = std::thread([&]() {
+        for (std::size_t i = 0; i < round_num; ++i) {
+            nets.second->send_value<std::uint64_t>(nets.second->recv_value<std::uint64_t>());
+        }
+    });
+    t_[0].join();
+    t_[1].join();
+    auto duration = time_from(start);
+
+    std::cout << duration * 1000 / static_cast<int64_t>(round_num) << "ns per round trip.\n";
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,56 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/net_io_factory.h"
+
+#include <memory>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/network/emulated_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+TEST(NetIOFactoryTest, create_net_io) {
+    nlohmann::json params[2];
+    for (std::size_t party = 0; party < 2; ++party) {
+        params[party]["common"] = {{"address", "unix:/tmp/dpca_psi_net_io_factory_test"},
+                {"remote_port", 30330 + party}, {"local_port", 30331 - party}, {"is_sender", party == 0},
+                {"channel_encryption", true}, {"channel_pre_shared_key", "00112233445566778899aabbccddeeff"},
+                {"emulated_latency_ms", 1.0}};
+    }
+    std::uint64_t received = 0;
+
+    std::thread other([&params, &received]() {
+        auto net = create_net_io(params[1]);
+        received = net->recv_value<std::uint64_t>();
+    });
+    auto net = create_net_io(params[0]);
+    // the emulated link is the outermost layer, over the encrypted channel.
+    EXPECT_NE(std::dynamic_pointer_cast<EmulatedNetIO>(net), nullptr);
+    net->send_value<std::uint64_t>(42);
+    net->flush();
+    other.join();
+
+    EXPECT_EQ(received, 42);
+}
+
+TEST(NetIOFactoryTest, missing_common) {
+    EXPECT_THROW(create_net_io(nlohmann::json::object()), nlohmann::json::out_of_range);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
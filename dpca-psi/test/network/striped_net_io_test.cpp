@@ -0,0 +1,126 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/striped_net_io.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class StripedNetIOTest : public ::testing::Test {
+public:
+    void SetUp() {
+    }
+
+    static std::shared_ptr<StripedNetIO> connect(
+            std::uint16_t remote_port, std::uint16_t local_port, std::size_t stream_num, std::size_t stripe_size) {
+        return std::make_shared<StripedNetIO>("127.0.0.1", remote_port, local_port, stream_num, stripe_size);
+    }
+
+    std::thread t_[2];
+    std::vector<std::uint64_t> send_bytes_count_ = {0, 0};
+    std::vector<std::uint64_t> recv_bytes_count_ = {0, 0};
+};
+
+TEST_F(StripedNetIOTest, send_value_and_bytes) {
+    std::vector<std::size_t> send_data = {100, 200};
+    std::vector<std::size_t> recv_data = {0, 0};
+    std::vector<ByteVector> send_bytes = {{Byte(0), Byte(1)}, {Byte(2), Byte(3)}};
+    std::vector<ByteVector> recv_bytes(2);
+
+    t_[0] = std::thread([this, send_data, send_bytes, &recv_data, &recv_bytes]() {
+        auto net = connect(30330, 30331, 4, 8);
+        net->send_value<std::size_t>(send_data[0]);
+        net->send_bytes(send_bytes[0]);
+        recv_data[1] = net->recv_value<std::size_t>();
+        net->recv_bytes(recv_bytes[1]);
+        send_bytes_count_[0] = net->get_bytes_sent();
+        recv_bytes_count_[0] = net->get_bytes_received();
+    });
+    t_[1] = std::thread([this, send_data, send_bytes, &recv_data, &recv_bytes]() {
+        auto net = connect(30331, 30330, 4, 8);
+        recv_data[0] = net->recv_value<std::size_t>();
+        net->recv_bytes(recv_bytes[0]);
+        net->send_value<std::size_t>(send_data[1]);
+        net->send_bytes(send_bytes[1]);
+        send_bytes_count_[1] = net->get_bytes_sent();
+        recv_bytes_count_[1] = net->get_bytes_received();
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    // send_bytes sends its size before the bytes.
+    std::uint64_t expected_bytes_count = 2 + 2 * sizeof(std::size_t);
+    for (std::size_t i = 0; i < 2; ++i) {
+        EXPECT_EQ(send_data[i], recv_data[i]);
+        EXPECT_EQ(send_bytes[i], recv_bytes[i]);
+        EXPECT_EQ(send_bytes_count_[i], expected_bytes_count);
+        EXPECT_EQ(recv_bytes_count_[i], expected_bytes_count);
+    }
+}
+
+TEST_F(StripedNetIOTest, large_messages_split_differently) {
+    std::size_t stripe_size = 1000;
+    std::size_t data_size = 100003;
+    std::vector<std::vector<std::uint8_t>> send_data(2, std::vector<std::uint8_t>(data_size));
+    for (std::size_t i = 0; i < data_size; ++i) {
+        send_data[0][i] = static_cast<std::uint8_t>(i * 7 + 1);
+        send_data[1][i] = static_cast<std::uint8_t>(i * 13 + 5);
+    }
+    std::vector<std::vector<std::uint8_t>> recv_data(2, std::vector<std::uint8_t>(data_size));
+
+    // both parties send at the same time, a message is sent in one call and received in pieces of other sizes.
+    auto run = [&](std::size_t party, std::uint16_t remote_port, std::uint16_t local_port) {
+        auto net = connect(remote_port, local_port, 3, stripe_size);
+        std::thread sender([&]() { net->send_data(send_data[party].data(), data_size); });
+        std::size_t offset = 0;
+        std::size_t piece = 1;
+        while (offset < data_size) {
+            std::size_t nbyte = std::min(piece, data_size - offset);
+            net->recv_data(recv_data[1 - party].data() + offset, nbyte);
+            offset += nbyte;
+            piece = piece * 3 + 17;
+        }
+        sender.join();
+        send_bytes_count_[party] = net->get_bytes_sent();
+        recv_bytes_count_[party] = net->get_bytes_received();
+    };
+    t_[0] = std::thread(run, 0, 30330, 30331);
+    t_[1] = std::thread(run, 1, 30331, 30330);
+
+    t_[0].join();
+    t_[1].join();
+
+    for (std::size_t i = 0; i < 2; ++i) {
+        EXPECT_EQ(send_data[i], recv_data[i]);
+        EXPECT_EQ(send_bytes_count_[i], data_size);
+        EXPECT_EQ(recv_bytes_count_[i], data_size);
+    }
+}
+
+TEST_F(StripedNetIOTest, invalid_stream_num) {
+    EXPECT_THROW(StripedNetIO("127.0.0.1", 30330, 30331, 0, StripedNetIO::kDefaultStripeSize), std::invalid_argument);
+    EXPECT_THROW(StripedNetIO("127.0.0.1", 30330, 30331, 2, 0), std::invalid_argument);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -0,0 +1,108 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/transcript_net_io.h"
+
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dpca-psi/common/utils.h"
+#include "dpca-psi/network/memory_net_io.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class TranscriptNetIOTest : public ::testing::Test {
+public:
+    void SetUp() {
+        set_random_seed(seed_);
+        auto nets = MemoryNetIO::create_pair(MemoryNetIO::kDefaultCapacity);
+        // only the recorded party draws from the seeded randomness.
+        std::thread other([&nets]() { run_peer(nets.second); });
+        auto net = std::make_shared<RecordingNetIO>(nets.first, path_);
+        outputs_ = run_party(net, 0);
+        net.reset();
+        other.join();
+    }
+
+    void TearDown() {
+        clear_random_seed();
+        std::remove((path_ + ".sent").c_str());
+        std::remove((path_ + ".recv").c_str());
+    }
+
+    // Exchanges random masks and masked values, and returns the unmasked values received.
+    static std::vector<std::uint64_t> run_party(std::shared_ptr<IOBase> net, std::uint64_t value) {
+        std::vector<std::uint64_t> outputs;
+        for (std::size_t i = 0; i < 4; ++i) {
+            std::uint64_t mask = read_data_from_dev_urandom<std::uint64_t>();
+            net->send_value(mask);
+            net->send_value(mask + value + i);
+            std::uint64_t peer_mask = net->recv_value<std::uint64_t>();
+            outputs.push_back(net->recv_value<std::uint64_t>() - peer_mask);
+        }
+        net->flush();
+        return outputs;
+    }
+
+    // Plays the other party with a fixed mask.
+    static void run_peer(std::shared_ptr<IOBase> net) {
+        for (std::size_t i = 0; i < 4; ++i) {
+            net->send_value<std::uint64_t>(7);
+            net->send_value<std::uint64_t>(7 + 1 + i);
+            net->recv_value<std::uint64_t>();
+            net->recv_value<std::uint64_t>();
+        }
+        net->flush();
+    }
+
+    const block seed_ = _mm_set_epi64x(1, 2);
+    const std::string path_ = "transcript_net_io_test";
+    std::vector<std::uint64_t> outputs_{};
+};
+
+TEST_F(TranscriptNetIOTest, replay_with_check) {
+    set_random_seed(seed_);
+    auto net = std::make_shared<ReplayNetIO>(path_, ReplayMode::kCheck);
+    EXPECT_EQ(run_party(net, 0), outputs_);
+    EXPECT_EQ(outputs_, std::vector<std::uint64_t>({1, 2, 3, 4}));
+}
+
+TEST_F(TranscriptNetIOTest, replay_with_drop) {
+    set_random_seed(_mm_set_epi64x(3, 4));
+    auto net = std::make_shared<ReplayNetIO>(path_, ReplayMode::kDrop);
+    EXPECT_EQ(run_party(net, 0), outputs_);
+}
+
+TEST_F(TranscriptNetIOTest, check_mismatch) {
+    set_random_seed(seed_);
+    auto net = std::make_shared<ReplayNetIO>(path_, ReplayMode::kCheck);
+    EXPECT_THROW(run_party(net, 1), std::runtime_error);
+}
+
+TEST_F(TranscriptNetIOTest, transcript_exhausted) {
+    set_random_seed(seed_);
+    auto net = std::make_shared<ReplayNetIO>(path_, ReplayMode::kCheck);
+    run_party(net, 0);
+    EXPECT_THROW(net->recv_value<std::uint64_t>(), std::runtime_error);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
@@ -14,7 +14,11 @@
 
 #include "dpca-psi/network/two_channel_net_io.h"
 
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 
@@ -216,6 +220,148 @@ TEST_F(TwoChannelNetIOTest, send_bool) {
     ASSERT_EQ(recv_bytes_count_, expected_recv_bytes_count_);
 }
 
+TEST_F(TwoChannelNetIOTest, send_buffer) {
+    std::size_t buffer_size = 64;
+    std::vector<std::uint64_t> send_data(2 * buffer_size);
+    for (std::size_t idx = 0; idx < send_data.size(); ++idx) {
+        send_data[idx] = idx;
+    }
+    std::vector<std::uint64_t> recv_data(send_data.size());
+    std::uint64_t reply = 0;
+
+    t_[0] = std::thread([this, buffer_size, &send_data, &reply]() {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30330, 30331);
+        net->set_send_buffer_size(buffer_size);
+        net->set_delay(true);
+        EXPECT_EQ(net->get_send_buffer_size(), buffer_size);
+        // small values are buffered, the large block is sent without a copy, the rest is flushed by recv_value().
+        for (std::size_t idx = 0; idx < buffer_size; ++idx) {
+            net->send_value<std::uint64_t>(send_data[idx]);
+        }
+        net->send_data(send_data.data() + buffer_size, (buffer_size - 1) * sizeof(std::uint64_t));
+        net->send_value<std::uint64_t>(send_data.back());
+        reply = net->recv_value<std::uint64_t>();
+        send_bytes_count_[0] = net->get_bytes_sent();
+        recv_bytes_count_[0] = net->get_bytes_received();
+    });
+    t_[1] = std::thread([this, &recv_data]() {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30331, 30330);
+        net->set_send_buffer_size(1024);
+        net->recv_data(recv_data.data(), recv_data.size() * sizeof(std::uint64_t));
+        net->send_value<std::uint64_t>(recv_data.back());
+        net->flush();
+        send_bytes_count_[1] = net->get_bytes_sent();
+        recv_bytes_count_[1] = net->get_bytes_received();
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    expected_send_bytes_count_ = {send_data.size() * sizeof(std::uint64_t), sizeof(std::uint64_t)};
+    expected_recv_bytes_count_ = {sizeof(std::uint64_t), send_data.size() * sizeof(std::uint64_t)};
+
+    ASSERT_EQ(send_data, recv_data);
+    ASSERT_EQ(reply, send_data.back());
+    ASSERT_EQ(send_bytes_count_, expected_send_bytes_count_);
+    ASSERT_EQ(recv_bytes_count_, expected_recv_bytes_count_);
+}
+
+TEST_F(TwoChannelNetIOTest, zero_copy) {
+    std::size_t threshold = 4096;
+    std::size_t round_num = 4;
+    std::vector<std::uint64_t> send_data(std::size_t(1) << 20);
+    std::vector<std::vector<std::uint64_t>> recv_data(round_num, std::vector<std::uint64_t>(send_data.size()));
+
+    t_[0] = std::thread([this, threshold, round_num, &send_data]() {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30330, 30331);
+        net->set_zero_copy_threshold(threshold);
+        // the buffer is overwritten right after every flush, which must not change the data on the wire.
+        for (std::size_t round = 0; round < round_num; ++round) {
+            for (std::size_t idx = 0; idx < send_data.size(); ++idx) {
+                send_data[idx] = round * send_data.size() + idx;
+            }
+            net->send_value<std::uint64_t>(round);
+            net->send_data_no_copy(send_data.data(), send_data.size() * sizeof(std::uint64_t));
+            net->flush();
+        }
+        send_bytes_count_[0] = net->get_bytes_sent();
+        recv_bytes_count_[0] = net->get_bytes_received();
+    });
+    t_[1] = std::thread([this, round_num, &recv_data]() {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30331, 30330);
+        for (std::size_t round = 0; round < round_num; ++round) {
+            EXPECT_EQ(net->recv_value<std::uint64_t>(), round);
+            net->recv_data(recv_data[round].data(), recv_data[round].size() * sizeof(std::uint64_t));
+        }
+        send_bytes_count_[1] = net->get_bytes_sent();
+        recv_bytes_count_[1] = net->get_bytes_received();
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    for (std::size_t round = 0; round < round_num; ++round) {
+        for (std::size_t idx = 0; idx < send_data.size(); ++idx) {
+            ASSERT_EQ(recv_data[round][idx], round * send_data.size() + idx);
+        }
+    }
+    std::uint64_t bytes_count = round_num * (send_data.size() + 1) * sizeof(std::uint64_t);
+    expected_send_bytes_count_ = {bytes_count, 0};
+    expected_recv_bytes_count_ = {0, bytes_count};
+    ASSERT_EQ(send_bytes_count_, expected_send_bytes_count_);
+    ASSERT_EQ(recv_bytes_count_, expected_recv_bytes_count_);
+}
+
+TEST_F(TwoChannelNetIOTest, send_bytes_vector) {
+    // more elements than IOV_MAX.
+    std::size_t element_num = 3000;
+    std::size_t element_size = 33;
+    std::vector<ByteVector> send_data(element_num, ByteVector(element_size));
+    for (std::size_t idx = 0; idx < element_num; ++idx) {
+        for (std::size_t byte_idx = 0; byte_idx < element_size; ++byte_idx) {
+            send_data[idx][byte_idx] = static_cast<Byte>(idx + byte_idx);
+        }
+    }
+    std::vector<ByteVector> recv_data;
+    ByteVector recv_flat_data;
+    std::vector<ByteVector> recv_buffered_data;
+
+    t_[0] = std::thread([this, &send_data]() {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30330, 30331);
+        net->send_bytes_vector(send_data);
+        net->send_bytes_vector(send_data);
+        net->set_send_buffer_size(1024);
+        net->send_bytes_vector({send_data[0], send_data[1]});
+        net->flush();
+        send_bytes_count_[0] = net->get_bytes_sent();
+        recv_bytes_count_[0] = net->get_bytes_received();
+    });
+    t_[1] = std::thread([this, element_size, &recv_data, &recv_flat_data, &recv_buffered_data]() {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30331, 30330);
+        net->recv_bytes_vector(recv_data, element_size);
+        net->recv_bytes(recv_flat_data);
+        net->recv_bytes_vector(recv_buffered_data, element_size);
+        send_bytes_count_[1] = net->get_bytes_sent();
+        recv_bytes_count_[1] = net->get_bytes_received();
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    ASSERT_EQ(recv_data, send_data);
+    ASSERT_EQ(recv_flat_data.size(), element_num * element_size);
+    for (std::size_t idx = 0; idx < element_num; ++idx) {
+        ASSERT_TRUE(std::equal(send_data[idx].begin(), send_data[idx].end(),
+                recv_flat_data.begin() + idx * element_size));
+    }
+    ASSERT_EQ(recv_buffered_data, std::vector<ByteVector>({send_data[0], send_data[1]}));
+    std::uint64_t bytes_count = 3 * sizeof(std::size_t) + (2 * element_num + 2) * element_size;
+    expected_send_bytes_count_ = {bytes_count, 0};
+    expected_recv_bytes_count_ = {0, bytes_count};
+    ASSERT_EQ(send_bytes_count_, expected_send_bytes_count_);
+    ASSERT_EQ(recv_bytes_count_, expected_recv_bytes_count_);
+}
+
 TEST_F(TwoChannelNetIOTest, ipv6) {
     std::vector<std::size_t> send_data = {100, 200};
     std::vector<std::size_t> recv_data = {0, 0};
@@ -246,5 +392,29 @@ TEST_F(TwoChannelNetIOTest, ipv6) {
     ASSERT_EQ(recv_bytes_count_, expected_recv_bytes_count_);
 }
 
+// A receive blocked on the connection throws once the connection is shut down.
+TEST_F(TwoChannelNetIOTest, shutdown) {
+    std::promise<void> shut_down;
+    std::future<void> shut_down_future = shut_down.get_future();
+
+    t_[0] = std::thread([&shut_down]() {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30330, 30331);
+        std::thread receiving(
+                [&net]() { EXPECT_THROW(net->recv_value<std::uint64_t>(), std::runtime_error); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        net->shutdown();
+        receiving.join();
+        EXPECT_THROW(net->send_value<std::uint64_t>(1), std::runtime_error);
+        shut_down.set_value();
+    });
+    t_[1] = std::thread([&shut_down_future]() {
+        auto net = std::make_shared<TwoChannelNetIO>("127.0.0.1", 30331, 30330);
+        shut_down_future.wait();
+    });
+
+    t_[0].join();
+    t_[1].join();
+}
+
 }  // namespace dpca_psi
 }  // namespace privacy_go
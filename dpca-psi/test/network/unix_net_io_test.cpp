@@ -0,0 +1,116 @@
+// Copyright 2023 TikTok Pte. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpca-psi/network/unix_net_io.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace privacy_go {
+namespace dpca_psi {
+
+class UnixNetIOTest : public ::testing::Test {
+public:
+    void SetUp() {
+        path_0_ = UnixNetIO::get_socket_path(address_, 30330);
+        path_1_ = UnixNetIO::get_socket_path(address_, 30331);
+    }
+
+    std::string address_ = "unix:/tmp/dpca_psi_unix_net_io_test";
+    std::string path_0_;
+    std::string path_1_;
+    std::thread t_[2];
+    std::vector<std::uint64_t> send_bytes_count_ = {0, 0};
+    std::vector<std::uint64_t> recv_bytes_count_ = {0, 0};
+};
+
+TEST_F(UnixNetIOTest, send_value_and_bytes) {
+    std::vector<std::size_t> send_data = {100, 200};
+    std::vector<std::size_t> recv_data = {0, 0};
+    std::vector<ByteVector> send_bytes = {{Byte(0), Byte(1)}, {Byte(2), Byte(3)}};
+    std::vector<ByteVector> recv_bytes(2);
+
+    t_[0] = std::thread([this, send_data, send_bytes, &recv_data, &recv_bytes]() {
+        auto net = std::make_shared<UnixNetIO>(path_0_, path_1_, UnixNetIO::kDefaultSocketBufferSize);
+        net->send_value<std::size_t>(send_data[0]);
+        net->send_bytes(send_bytes[0]);
+        recv_data[1] = net->recv_value<std::size_t>();
+        net->recv_bytes(recv_bytes[1]);
+        send_bytes_count_[0] = net->get_bytes_sent();
+        recv_bytes_count_[0] = net->get_bytes_received();
+    });
+    t_[1] = std::thread([this, send_data, send_bytes, &recv_data, &recv_bytes]() {
+        auto net = std::make_shared<UnixNetIO>(path_1_, path_0_, UnixNetIO::kDefaultSocketBufferSize);
+        net->send_value<std::size_t>(send_data[1]);
+        net->send_bytes(send_bytes[1]);
+        recv_data[0] = net->recv_value<std::size_t>();
+        net->recv_bytes(recv_bytes[0]);
+        send_bytes_count_[1] = net->get_bytes_sent();
+        recv_bytes_count_[1] = net->get_bytes_received();
+    });
+
+    t_[0].join();
+    t_[1].join();
+
+    std::uint64_t expected_bytes_count = 2 + 2 * sizeof(std::size_t);
+    for (std::size_t i = 0; i < 2; ++i) {
+        EXPECT_EQ(send_data[i], recv_data[i]);
+        EXPECT_EQ(send_bytes[i], recv_bytes[i]);
+        EXPECT_EQ(send_bytes_count_[i], expected_bytes_count);
+        EXPECT_EQ(recv_bytes_count_[i], expected_bytes_count);
+    }
+}
+
+TEST_F(UnixNetIOTest, large_message) {
+    std::size_t data_size = std::size_t(1) << 24;
+    std::vector<std::vector<std::uint8_t>> send_data(2, std::vector<std::uint8_t>(data_size));
+    for (std::size_t i = 0; i < data_size; ++i) {
+        send_data[0][i] = static_cast<std::uint8_t>(i * 7 + 1);
+        send_data[1][i] = static_cast<std::uint8_t>(i * 13 + 5);
+    }
+    std::vector<std::vector<std::uint8_t>> recv_data(2, std::vector<std::uint8_t>(data_size));
+
+    auto run = [&](std::size_t party, const std::string& remote_path, const std::string& local_path) {
+        auto net = std::make_shared<UnixNetIO>(remote_path, local_path, UnixNetIO::kDefaultSocketBufferSize);
+        std::thread sender([&]() { net->send_data(send_data[party].data(), data_size); });
+        net->recv_data(recv_data[1 - party].data(), data_size);
+        sender.join();
+    };
+    t_[0] = std::thread(run, 0, path_0_, path_1_);
+    t_[1] = std::thread(run, 1, path_1_, path_0_);
+
+    t_[0].join();
+    t_[1].join();
+
+    EXPECT_EQ(send_data[0], recv_data[0]);
+    EXPECT_EQ(send_data[1], recv_data[1]);
+}
+
+TEST_F(UnixNetIOTest, address) {
+    EXPECT_TRUE(UnixNetIO::is_unix_address("unix:/tmp/dpca"));
+    EXPECT_FALSE(UnixNetIO::is_unix_address("127.0.0.1"));
+    EXPECT_EQ(UnixNetIO::get_socket_path("unix:/tmp/dpca", 1234), "/tmp/dpca.1234");
+    EXPECT_THROW(UnixNetIO::get_socket_path("127.0.0.1", 1234), std::invalid_argument);
+    EXPECT_THROW(UnixNetIO::get_socket_path("unix:", 1234), std::invalid_argument);
+    EXPECT_THROW(UnixNetIO(path_0_, path_0_, UnixNetIO::kDefaultSocketBufferSize), std::invalid_argument);
+    EXPECT_THROW(UnixNetIO(path_0_, std::string(200, 'a'), UnixNetIO::kDefaultSocketBufferSize), std::invalid_argument);
+}
+
+}  // namespace dpca_psi
+}  // namespace privacy_go
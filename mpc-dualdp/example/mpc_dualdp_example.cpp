@@ -12,17 +12,26 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <chrono>
 #include <memory>
 #include <string>
 
 #include "mpc-dualdp/mpc_dualdp.h"
 
 #include "dpca-psi/dp_cardinality_psi.h"
+#include "dpca-psi/network/emulated_net_io.h"
 #include "dpca-psi/network/two_channel_net_io.h"
 
 void mpc_dualdp_example(std::size_t party, std::string local_addr, std::size_t local_port, std::string remote_addr,
-        std::size_t remote_port) {
-    auto net = std::make_shared<privacy_go::dpca_psi::TwoChannelNetIO>(remote_addr, remote_port, local_port);
+        std::size_t remote_port, double bandwidth_mbps, double latency_ms) {
+    std::shared_ptr<privacy_go::dpca_psi::IOBase> net =
+            std::make_shared<privacy_go::dpca_psi::TwoChannelNetIO>(remote_addr, remote_port, local_port);
+    // emulates a WAN link in the sending direction, if configured.
+    if (bandwidth_mbps > 0 || latency_ms > 0) {
+        net = std::make_shared<privacy_go::dpca_psi::EmulatedNetIO>(net,
+                static_cast<std::uint64_t>(bandwidth_mbps * 1e6),
+                std::chrono::microseconds(static_cast<std::int64_t>(latency_ms * 1000)), std::chrono::microseconds(0));
+    }
 
     auto aby_test = privacy_go::ppam::AbyProtocol::Instance();
     aby_test->initialize(party, net);
@@ -56,7 +65,11 @@ void mpc_dualdp_example(std::size_t party, std::string local_addr, std::size_t l
 
 // ./build/bin/mpc_dualdp_example  127.0.0.1 8899 127.0.0.1 8890 0
 // ./build/bin/mpc_dualdp_example  127.0.0.1 8890 127.0.0.1 8899 1
+// Optionally followed by the bandwidth in Mbit/s and the one-way latency in ms of an emulated link, e.g. 200 50.
 int main(int argc, char* argv[]) {
-    mpc_dualdp_example(atoi(argv[5]), std::string(argv[1]), atoi(argv[2]), std::string(argv[3]), atoi(argv[4]));
+    double bandwidth_mbps = (argc > 6) ? atof(argv[6]) : 0.0;
+    double latency_ms = (argc > 7) ? atof(argv[7]) : 0.0;
+    mpc_dualdp_example(atoi(argv[5]), std::string(argv[1]), atoi(argv[2]), std::string(argv[3]), atoi(argv[4]),
+            bandwidth_mbps, latency_ms);
     return 0;
 }
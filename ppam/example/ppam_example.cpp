@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
 #include <random>
+#include <stdexcept>
 #include <string>
 
 #include "gflags/gflags.h"
@@ -23,13 +25,13 @@
 #include "dpca-psi/common/utils.h"
 #include "dpca-psi/crypto/prng.h"
 #include "dpca-psi/dp_cardinality_psi.h"
-#include "dpca-psi/network/two_channel_net_io.h"
+#include "dpca-psi/network/net_io_factory.h"
 #include "ppam/ppam.h"
 
 std::vector<double> random_features(std::size_t n, std::size_t min, std::size_t max, bool is_zero) {
     std::vector<double> result(n, 0.0);
-    std::random_device rd("/dev/urandom");
-    std::default_random_engine eng(rd());
+    // follows the random seed of the config.
+    std::default_random_engine eng(privacy_go::dpca_psi::read_data_from_dev_urandom<std::uint32_t>());
     std::uniform_real_distribution<double> distr(static_cast<double>(min), static_cast<double>(max));
     if (!is_zero) {
         for (std::size_t i = 0; i < n; ++i) {
@@ -57,11 +59,20 @@ void ppam_example(const std::string& config_path, const std::string& log_path, s
 
     google::InitGoogleLogging(log_file_name.c_str());
 
-    // 2. Connect net io.
-    std::string address = params["common"]["address"];
-    std::uint16_t remote_port = params["common"]["remote_port"];
-    std::uint16_t local_port = params["common"]["local_port"];
-    auto net = std::make_shared<privacy_go::dpca_psi::TwoChannelNetIO>(address, remote_port, local_port);
+    // seeds the randomness of this party before anything is drawn, if configured, e.g. to replay a transcript.
+    std::string random_seed = params["common"].value("random_seed", "");
+    if (!random_seed.empty()) {
+        std::string seed_bytes = privacy_go::dpca_psi::hex_2_string(random_seed);
+        if (seed_bytes.size() != sizeof(privacy_go::dpca_psi::block)) {
+            throw std::invalid_argument("random_seed must have 32 hex digits");
+        }
+        privacy_go::dpca_psi::block seed;
+        std::memcpy(&seed, seed_bytes.data(), sizeof(seed));
+        privacy_go::dpca_psi::set_random_seed(seed);
+    }
+
+    // 2. Connect net io, see create_net_io() for the transport keys of the config.
+    std::shared_ptr<privacy_go::dpca_psi::IOBase> net = privacy_go::dpca_psi::create_net_io(params);
 
     // 3. Read keys and features from file or use randomly generated data.
     std::vector<std::vector<std::string>> keys;
@@ -159,6 +170,8 @@ void ppam_example(const std::string& config_path, const std::string& log_path, s
     LOG(INFO) << "Total Communication is " << total_comm << "(" << self_comm << " + " << remote_comm << ")"
               << "MB." << std::endl;
     LOG(INFO) << "Total time is " << duration << " s.";
+    // tells the phases bound by the network, or by the peer, from those bound by local computation.
+    LOG(INFO) << "Traffic by phase:\n" << net->get_traffic_report();
     LOG(INFO) << "Expected / Actual sum is " << expected_sum << " / " << actual_sum;
 
     assert((expected_sum - actual_sum < 0.01));
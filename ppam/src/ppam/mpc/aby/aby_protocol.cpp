@@ -41,6 +41,7 @@ int AbyProtocol::initialize(const std::size_t party_id, const std::shared_ptr<IO
 
     // set network
     net_io_ = net_io;
+    ScopedIOPhase io_phase(net_io_, "initialize");
 
     // set random seed
     set_seed();
@@ -80,9 +81,11 @@ int AbyProtocol::share(const std::size_t party, const eMatrix<double>& in, Crypt
 }
 
 int AbyProtocol::reveal(const std::size_t party, const CryptoMatrix& in, eMatrix<double>& out) {
+    ScopedIOPhase io_phase(net_io_, "reveal");
     CryptoMatrix fixed_matrix(in.rows(), in.cols());
     if (party_id_ != party) {
         send_matrix(net_io_, &in, 1);
+        net_io_->flush();
     } else {
         recv_matrix(net_io_, &fixed_matrix, 1);
     }
@@ -113,6 +116,7 @@ int AbyProtocol::elementwise_bool_mul(const CryptoMatrix& x, const CryptoMatrix&
     if (x.size() != y.size()) {
         return -1;
     }
+    ScopedIOPhase io_phase(net_io_, "elementwise_bool_mul");
     std::size_t row = x.rows();
     std::size_t col = x.cols();
     z.resize(row, col);
@@ -219,6 +223,7 @@ int AbyProtocol::kogge_stone_ppa(const CryptoMatrix& x, const CryptoMatrix& y, C
 }
 
 int AbyProtocol::a2b(const CryptoMatrix& x, CryptoMatrix& z) {
+    ScopedIOPhase io_phase(net_io_, "a2b");
     std::size_t size = x.size();
     std::size_t row = x.rows();
     std::size_t col = x.cols();
@@ -292,6 +297,7 @@ int AbyProtocol::multiplexer(const CryptoMatrix& x, const CryptoMatrix& y, Crypt
     if (x.size() != y.size()) {
         return -1;
     }
+    ScopedIOPhase io_phase(net_io_, "multiplexer");
     std::size_t size = x.size();
     std::size_t row = x.rows();
     std::size_t col = x.cols();
@@ -404,6 +410,7 @@ int AbyProtocol::multiplexer(const CryptoMatrix& x, const CryptoMatrix& y, Crypt
 }
 
 int AbyProtocol::attribution(const double& tf, const CryptoMatrix& in, CryptoMatrix& out) {
+    ScopedIOPhase io_phase(net_io_, "attribution");
     auto t0 = in.shares.col(0);
     auto t1 = in.shares.col(1);
     auto value = in.shares.col(2);
@@ -40,6 +40,8 @@ class AbyProtocol {
 
     int set_seed();
 
+    // The traffic of net_io is accounted to phases named after the operations below, e.g. "a2b/elementwise_bool_mul",
+    // see IOBase::get_traffic_report().
     int initialize(const std::size_t party_id, const std::shared_ptr<IOBase>& net_io);
 
     int release();
@@ -33,6 +33,7 @@ namespace privacy_go {
 namespace ppam {
 
 using IOBase = dpca_psi::IOBase;
+using ScopedIOPhase = dpca_psi::ScopedIOPhase;
 using TwoChannelNetIO = dpca_psi::TwoChannelNetIO;
 using AES = dpca_psi::AES;
 using PRNG = dpca_psi::PRNG;
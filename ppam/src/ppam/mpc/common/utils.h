@@ -18,6 +18,7 @@
 #include <random>
 #include <sstream>
 
+#include "dpca-psi/common/utils.h"
 #include "ppam/mpc/common/utils.h"
 
 namespace privacy_go {
@@ -60,21 +61,14 @@ inline void recv_matrix(const std::shared_ptr<IOBase>& net, CryptoMatrix* data,
     data->shares = Eigen::Map<eMatrix<int64_t>>(buf.data(), data->shares.rows(), data->shares.cols());
 }
 
+// Follows the seeded randomness of dpca_psi::set_random_seed().
 inline block read_block_from_dev_urandom() {
-    block ret;
-    std::ifstream in("/dev/urandom");
-    in.read(reinterpret_cast<char*>(&ret), sizeof(ret));
-    in.close();
-    return ret;
+    return dpca_psi::read_block_from_dev_urandom();
 }
 
 template <typename T>
 inline T read_data_from_dev_urandom() {
-    T ret;
-    std::ifstream in("/dev/urandom");
-    in.read(reinterpret_cast<char*>(&ret), sizeof(ret));
-    in.close();
-    return ret;
+    return dpca_psi::read_data_from_dev_urandom<T>();
 }
 
 }  // namespace ppam